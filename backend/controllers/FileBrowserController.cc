@@ -1,72 +1,9 @@
 #include "FileBrowserController.h"
 #include "../utils/FileUtils.h"
 #include <filesystem>
-#include <regex>
 
 namespace fs = std::filesystem;
 
-// Helper for Glob matching (copied from ScannerService for directory filtering)
-static bool globMatch(const std::string &str, const std::string &pattern) {
-  std::string reStr;
-  for (size_t i = 0; i < pattern.size(); ++i) {
-    char c = pattern[i];
-    if (c == '*')
-      reStr += ".*";
-    else if (c == '?')
-      reStr += ".";
-    else if (std::string(".^+|{}()[]\\").find(c) != std::string::npos) {
-      reStr += "\\";
-      reStr += c;
-    } else {
-      reStr += c;
-    }
-  }
-  try {
-    std::regex re(reStr);
-    return std::regex_match(str, re);
-  } catch (...) {
-    return false;
-  }
-}
-
-static bool checkRule(const std::string &dirName, const FilterRule &rule) {
-  if (rule.type == "exact") {
-    return dirName == rule.pattern;
-  } else if (rule.type == "regex") {
-    try {
-      std::regex re(rule.pattern);
-      return std::regex_search(dirName, re);
-    } catch (...) {
-      return false;
-    }
-  } else if (rule.type == "glob") {
-    return globMatch(dirName, rule.pattern);
-  }
-  return false;
-}
-
-// Check if a directory should be included based on rules
-// This applies to ALL path components, not just the first level
-static bool shouldIncludeDirectory(const std::string &dirName,
-                                   const VideoRootConfig &rootConfig) {
-  bool isWhitelist = (rootConfig.filter_mode == "whitelist");
-
-  if (rootConfig.rules.empty()) {
-    // Empty whitelist -> deny all, Empty blacklist -> allow all
-    return !isWhitelist;
-  }
-
-  bool ruleMatched = false;
-  for (const auto &rule : rootConfig.rules) {
-    if (checkRule(dirName, rule)) {
-      ruleMatched = true;
-      break;
-    }
-  }
-
-  return isWhitelist ? ruleMatched : !ruleMatched;
-}
-
 FileBrowserController::FileBrowserController() {
   LOG_INFO << "FileBrowserController initialized";
 
@@ -157,6 +94,15 @@ void FileBrowserController::browseFiles(
     parentPath = fs::path(pathParam).parent_path().string();
   }
 
+  // 目录过滤规则（按配置版本预编译，所有层级的目录名都适用）
+  auto rules = lpConfigService_->getCompiledRules();
+  const auto *rootRules = rules->find(matchedRoot->path);
+  std::optional<live2mp3::utils::RuleSet> fallbackFilter;
+  const live2mp3::utils::RuleSet &filter =
+      rootRules ? rootRules->filter
+                : fallbackFilter.emplace(ConfigService::compileRuleSet(
+                      matchedRoot->rules, matchedRoot->filter_mode));
+
   Json::Value dirsArr(Json::arrayValue);
   Json::Value filesArr(Json::arrayValue);
 
@@ -167,7 +113,7 @@ void FileBrowserController::browseFiles(
 
       if (entry.is_directory()) {
         // Apply filter rules to directory name (recursive filtering)
-        if (!shouldIncludeDirectory(entryName, *matchedRoot)) {
+        if (!filter.allows(entryName)) {
           continue;
         }
 
@@ -212,7 +158,8 @@ void FileBrowserController::browseFiles(
         std::string fingerprint =
             live2mp3::utils::calculateFileFingerprint(entryPath);
         fileItem["fingerprint"] = fingerprint;
-        fileItem["processed"] = lpPendingFileService_->isProcessed(fingerprint);
+        fileItem["processed"] =
+            lpPendingFileService_->isFileProcessed(entryPath, fingerprint);
 
         filesArr.append(fileItem);
       }
@@ -1,5 +1,8 @@
 #include "SystemController.h"
 #include "../services/ConfigService.h"
+#include "../services/DatabaseService.h"
+#include "../services/FfmpegTaskService.h"
+#include "../services/MediaInfoService.h"
 
 SystemController::SystemController() {
   LOG_INFO << "SystemController initialized";
@@ -90,6 +93,63 @@ void SystemController::getDetailedStatus(
     ret["system"]["mem_available_kb"] = (Json::Value::UInt64)memAvailable;
   }
 
+  // 数据库语句缓存命中情况
+  auto stmtStats = DatabaseService::getInstance().getStatementCacheStats();
+  ret["database"]["stmt_cache_hits"] = (Json::Value::UInt64)stmtStats.hits;
+  ret["database"]["stmt_cache_misses"] = (Json::Value::UInt64)stmtStats.misses;
+  ret["database"]["stmt_cache_size"] = (Json::Value::UInt64)stmtStats.cached;
+
+  // 只读连接池占用情况
+  auto poolStats = DatabaseService::getInstance().getReadPoolStats();
+  ret["database"]["read_pool_size"] = (Json::Value::UInt64)poolStats.size;
+  ret["database"]["read_pool_idle"] = (Json::Value::UInt64)poolStats.idle;
+  ret["database"]["read_pool_waits"] = (Json::Value::UInt64)poolStats.waits;
+
+  // FFmpeg 任务队列：各优先级排队/执行数
+  if (auto ffmpegTaskService =
+          drogon::app().getSharedPlugin<FfmpegTaskService>()) {
+    auto queueStats = ffmpegTaskService->getQueueStats();
+    for (size_t i = 0; i < FFMPEG_TASK_PRIORITY_COUNT; ++i) {
+      const char *name =
+          taskPriorityName(static_cast<FfmpegTaskPriority>(i));
+      ret["ffmpeg_queue"]["pending"][name] =
+          (Json::Value::UInt64)queueStats.pending[i];
+      ret["ffmpeg_queue"]["running"][name] =
+          (Json::Value::UInt64)queueStats.running[i];
+    }
+    ret["ffmpeg_queue"]["watchdog_aborts"] =
+        (Json::Value::UInt64)queueStats.watchdogAborts;
+    ret["ffmpeg_queue"]["retry_delayed"] =
+        (Json::Value::UInt64)queueStats.retryDelayed;
+    for (const auto &lane : queueStats.lanes) {
+      Json::Value laneJson;
+      laneJson["name"] = lane.name;
+      laneJson["max_concurrent"] = (Json::Value::UInt64)lane.maxConcurrent;
+      laneJson["pending"] = (Json::Value::UInt64)lane.pending;
+      laneJson["running"] = (Json::Value::UInt64)lane.running;
+      ret["ffmpeg_queue"]["lanes"].append(laneJson);
+    }
+  }
+
+  // 媒体元数据缓存：命中 = 内存 + 数据库，未命中 = 原生探测 + ffprobe
+  if (auto mediaInfoService =
+          drogon::app().getSharedPlugin<MediaInfoService>()) {
+    auto mediaStats = mediaInfoService->getStats();
+    uint64_t hits = mediaStats.memoryHits + mediaStats.dbHits;
+    uint64_t lookups = hits + mediaStats.nativeProbes +
+                       mediaStats.ffprobeProbes + mediaStats.failures;
+    ret["media_info"]["memory_hits"] = (Json::Value::UInt64)mediaStats.memoryHits;
+    ret["media_info"]["db_hits"] = (Json::Value::UInt64)mediaStats.dbHits;
+    ret["media_info"]["native_probes"] =
+        (Json::Value::UInt64)mediaStats.nativeProbes;
+    ret["media_info"]["ffprobe_probes"] =
+        (Json::Value::UInt64)mediaStats.ffprobeProbes;
+    ret["media_info"]["failures"] = (Json::Value::UInt64)mediaStats.failures;
+    ret["media_info"]["cached"] = (Json::Value::UInt64)mediaStats.cached;
+    ret["media_info"]["hit_rate"] =
+        lookups > 0 ? static_cast<double>(hits) / lookups : 0.0;
+  }
+
   auto resp = HttpResponse::newHttpJsonResponse(ret);
   callback(resp);
 }
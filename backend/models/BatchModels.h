@@ -2,6 +2,7 @@
 
 #include "PendingFile.h"
 #include <chrono>
+#include <cstdint>
 #include <nlohmann/json.hpp>
 #include <string>
 #include <vector>
@@ -41,6 +42,15 @@ struct BatchFile {
   std::string getFilepath() const;
 };
 
+/**
+ * @brief encoding 批次的转码进度（批次完成判定用）
+ */
+struct BatchProgress {
+  int batch_id;
+  int outstanding;     // pending + encoding 文件数
+  int64_t last_update; // 批次文件最后一次变化的 Unix 秒
+};
+
 void to_json(nlohmann::json &j, const BatchInfo &b);
 void to_json(nlohmann::json &j, const BatchFile &f);
 
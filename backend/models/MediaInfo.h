@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <vector>
+
+/**
+ * @brief 单个媒体流信息（来自 ffprobe -show_streams）
+ */
+struct MediaStream {
+  int index = 0;
+  std::string codec_type; // video / audio / subtitle / data
+  std::string codec_name;
+  int width = 0;        // 仅视频
+  int height = 0;       // 仅视频
+  int sample_rate = 0;  // 仅音频
+  int channels = 0;     // 仅音频
+  int64_t bit_rate = 0; // bits/s，未知为 0
+};
+
+/**
+ * @brief 媒体文件元数据（按指纹缓存，见 MediaInfoService）
+ */
+struct MediaInfo {
+  std::string fingerprint;
+  int duration_ms = -1;
+  int64_t bit_rate = 0;     // 总码率 bits/s，未知为 0
+  std::string format_name;  // flv / mpegts / mp4 或 ffprobe 的 format_name
+  std::string source;       // native / ffprobe
+  bool has_streams = false; // streams 是否已由 ffprobe 填充
+  std::vector<MediaStream> streams;
+
+  /// 第一个指定类型的流，不存在返回 nullptr
+  const MediaStream *firstStream(const std::string &codecType) const;
+};
+
+void to_json(nlohmann::json &j, const MediaStream &s);
+void from_json(const nlohmann::json &j, MediaStream &s);
+void to_json(nlohmann::json &j, const MediaInfo &m);
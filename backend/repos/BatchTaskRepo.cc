@@ -1,8 +1,11 @@
 #include "BatchTaskRepo.h"
+#include "StatusCodes.h"
+#include <ctime>
 #include <filesystem>
 #include <sqlite3.h>
 
 namespace fs = std::filesystem;
+using status_code::toSql;
 
 // ============ 静态辅助 ============
 
@@ -27,7 +30,7 @@ BatchInfo BatchTaskRepo::readBatchRow(sqlite3_stmt *stmt) {
   BatchInfo b;
   b.id = sqlite3_column_int(stmt, 0);
   b.streamer = reinterpret_cast<const char *>(sqlite3_column_text(stmt, 1));
-  b.status = reinterpret_cast<const char *>(sqlite3_column_text(stmt, 2));
+  b.status = status_code::toName<BatchStatus>(sqlite3_column_int(stmt, 2));
   auto od = sqlite3_column_text(stmt, 3);
   b.output_dir = od ? reinterpret_cast<const char *>(od) : "";
   auto td = sqlite3_column_text(stmt, 4);
@@ -51,7 +54,7 @@ BatchFile BatchTaskRepo::readBatchFileRow(sqlite3_stmt *stmt) {
   auto fpText = sqlite3_column_text(stmt, 4);
   f.fingerprint = fpText ? reinterpret_cast<const char *>(fpText) : "";
   f.pending_file_id = sqlite3_column_int(stmt, 5);
-  f.status = reinterpret_cast<const char *>(sqlite3_column_text(stmt, 6));
+  f.status = status_code::toName<BatchFileStatus>(sqlite3_column_int(stmt, 6));
   auto encodedText = sqlite3_column_text(stmt, 7);
   f.encoded_path =
       encodedText ? reinterpret_cast<const char *>(encodedText) : "";
@@ -74,8 +77,9 @@ std::optional<BatchInfo> BatchTaskRepo::findBatch(int batchId) {
 std::vector<BatchInfo> BatchTaskRepo::findIncompleteBatches() {
   std::string sql =
       std::string("SELECT ") + batchSelectCols() +
-      " FROM task_batches WHERE status NOT IN ('completed', 'failed') "
-      "ORDER BY id";
+      " FROM task_batches WHERE status IN (" +
+      toSql(BatchStatus::ENCODING) + ", " + toSql(BatchStatus::MERGING) + ", " +
+      toSql(BatchStatus::EXTRACTING_MP3) + ") ORDER BY id";
   return db().queryAll<BatchInfo>(sql, readBatchRow);
 }
 
@@ -83,18 +87,23 @@ std::vector<BatchInfo>
 BatchTaskRepo::findEncodingByStreamer(const std::string &streamer) {
   std::string sql =
       std::string("SELECT ") + batchSelectCols() +
-      " FROM task_batches WHERE streamer = ? AND status = 'encoding' "
-      "ORDER BY id";
+      " FROM task_batches WHERE status = " + toSql(BatchStatus::ENCODING) +
+      " AND streamer = ? ORDER BY id";
   return db().queryAll<BatchInfo>(sql, readBatchRow, [&](sqlite3_stmt *stmt) {
     sqlite3_bind_text(stmt, 1, streamer.c_str(), -1, SQLITE_TRANSIENT);
   });
 }
 
 bool BatchTaskRepo::updateBatchStatus(int batchId, const std::string &status) {
+  int code = status_code::toCode<BatchStatus>(status);
+  if (code == status_code::UNKNOWN) {
+    LOG_ERROR << "[updateBatchStatus] Unknown status: " << status;
+    return false;
+  }
   std::string sql = "UPDATE task_batches SET status = ?, "
-                    "updated_at = datetime('now', 'localtime') WHERE id = ?";
+                    "updated_at = unixepoch() WHERE id = ?";
   return db().executeUpdate(sql, [&](sqlite3_stmt *stmt) {
-    sqlite3_bind_text(stmt, 1, status.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(stmt, 1, code);
     sqlite3_bind_int(stmt, 2, batchId);
   });
 }
@@ -103,7 +112,7 @@ bool BatchTaskRepo::setBatchFinalPaths(int batchId, const std::string &mp4Path,
                                        const std::string &mp3Path) {
   std::string sql =
       "UPDATE task_batches SET final_mp4_path = ?, final_mp3_path = ?, "
-      "updated_at = datetime('now', 'localtime') WHERE id = ?";
+      "updated_at = unixepoch() WHERE id = ?";
   return db().executeUpdate(sql, [&](sqlite3_stmt *stmt) {
     sqlite3_bind_text(stmt, 1, mp4Path.c_str(), -1, SQLITE_TRANSIENT);
     if (mp3Path.empty()) {
@@ -127,7 +136,8 @@ std::vector<BatchFile> BatchTaskRepo::findBatchFiles(int batchId) {
 
 std::vector<std::string> BatchTaskRepo::findEncodedPaths(int batchId) {
   std::string sql = "SELECT encoded_path FROM task_batch_files "
-                    "WHERE batch_id = ? AND status = 'encoded' ORDER BY id";
+                    "WHERE batch_id = ? AND status = " +
+                    toSql(BatchFileStatus::ENCODED) + " ORDER BY id";
   return db().queryAll<std::string>(
       sql,
       [](sqlite3_stmt *stmt) -> std::string {
@@ -151,13 +161,19 @@ std::vector<std::string> BatchTaskRepo::findBatchFilenames(int batchId) {
 bool BatchTaskRepo::updateBatchFileStatus(int batchId,
                                           const std::string &filepath,
                                           const std::string &status) {
+  int code = status_code::toCode<BatchFileStatus>(status);
+  if (code == status_code::UNKNOWN) {
+    LOG_ERROR << "[updateBatchFileStatus] Unknown status: " << status;
+    return false;
+  }
+
   std::string dirPath, fname;
   splitPath(filepath, dirPath, fname);
   std::string sql = "UPDATE task_batch_files SET status = ?, "
-                    "updated_at = datetime('now', 'localtime') "
+                    "updated_at = unixepoch() "
                     "WHERE batch_id = ? AND dir_path = ? AND filename = ?";
   return db().executeUpdate(sql, [&](sqlite3_stmt *stmt) {
-    sqlite3_bind_text(stmt, 1, status.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(stmt, 1, code);
     sqlite3_bind_int(stmt, 2, batchId);
     sqlite3_bind_text(stmt, 3, dirPath.c_str(), -1, SQLITE_TRANSIENT);
     sqlite3_bind_text(stmt, 4, fname.c_str(), -1, SQLITE_TRANSIENT);
@@ -166,29 +182,72 @@ bool BatchTaskRepo::updateBatchFileStatus(int batchId,
 
 int BatchTaskRepo::countPendingOrEncoding(int batchId) {
   std::string sql = "SELECT COUNT(*) FROM task_batch_files "
-                    "WHERE batch_id = ? AND status IN ('pending', 'encoding')";
+                    "WHERE batch_id = ? AND status IN (" +
+                    toSql(BatchFileStatus::PENDING) + ", " +
+                    toSql(BatchFileStatus::ENCODING) + ")";
   return db().queryScalar(
       sql, [&](sqlite3_stmt *stmt) { sqlite3_bind_int(stmt, 1, batchId); });
 }
 
 std::vector<int> BatchTaskRepo::findCompleteBatchIds(int minAgeSeconds) {
+  // 两个子查询都命中 (batch_id, status, updated_at) 覆盖索引；
+  // 截止时间在调用侧算好，避免逐行做日期函数
+  int64_t cutoff = static_cast<int64_t>(std::time(nullptr)) - minAgeSeconds;
   std::string sql =
       "SELECT b.id FROM task_batches b "
-      "WHERE b.status = 'encoding' "
-      "AND NOT EXISTS ("
+      "WHERE b.status = " +
+      toSql(BatchStatus::ENCODING) +
+      " AND NOT EXISTS ("
       "  SELECT 1 FROM task_batch_files f "
-      "  WHERE f.batch_id = b.id AND f.status IN ('pending', 'encoding')"
+      "  WHERE f.batch_id = b.id AND f.status IN (" +
+      toSql(BatchFileStatus::PENDING) + ", " +
+      toSql(BatchFileStatus::ENCODING) +
+      ")"
       ") "
-      "AND (cast(strftime('%s', 'now', 'localtime') as integer) - "
-      "     cast(strftime('%s', ("
-      "       SELECT MAX(f2.updated_at) FROM task_batch_files f2 "
-      "       WHERE f2.batch_id = b.id"
-      "     )) as integer)) > ? "
+      "AND (SELECT MAX(f2.updated_at) FROM task_batch_files f2 "
+      "     WHERE f2.batch_id = b.id) < ? "
       "ORDER BY b.id";
   return db().queryAll<int>(
       sql,
       [](sqlite3_stmt *stmt) -> int { return sqlite3_column_int(stmt, 0); },
-      [&](sqlite3_stmt *stmt) { sqlite3_bind_int(stmt, 1, minAgeSeconds); });
+      [&](sqlite3_stmt *stmt) { sqlite3_bind_int64(stmt, 1, cutoff); });
+}
+
+std::vector<BatchProgress> BatchTaskRepo::findEncodingBatchProgress(int batchId) {
+  std::string sql =
+      "SELECT b.id, "
+      "(SELECT COUNT(*) FROM task_batch_files f "
+      " WHERE f.batch_id = b.id AND f.status IN (" +
+      toSql(BatchFileStatus::PENDING) + ", " +
+      toSql(BatchFileStatus::ENCODING) +
+      ")), "
+      "(SELECT MAX(f2.updated_at) FROM task_batch_files f2 "
+      " WHERE f2.batch_id = b.id) "
+      "FROM task_batches b WHERE b.status = " +
+      toSql(BatchStatus::ENCODING) + " AND (? < 0 OR b.id = ?)";
+  return db().queryAll<BatchProgress>(
+      sql,
+      [](sqlite3_stmt *stmt) -> BatchProgress {
+        BatchProgress p;
+        p.batch_id = sqlite3_column_int(stmt, 0);
+        p.outstanding = sqlite3_column_int(stmt, 1);
+        p.last_update = sqlite3_column_int64(stmt, 2);
+        return p;
+      },
+      [&](sqlite3_stmt *stmt) {
+        sqlite3_bind_int(stmt, 1, batchId);
+        sqlite3_bind_int(stmt, 2, batchId);
+      });
+}
+
+bool BatchTaskRepo::claimBatchForMerge(int batchId) {
+  std::string sql = "UPDATE task_batches SET status = " +
+                    toSql(BatchStatus::MERGING) +
+                    ", updated_at = unixepoch() WHERE id = ? AND status = " +
+                    toSql(BatchStatus::ENCODING);
+  return db().executeUpdateCount(sql, [&](sqlite3_stmt *stmt) {
+    sqlite3_bind_int(stmt, 1, batchId);
+  }) == 1;
 }
 
 // ============ 事务性操作 ============
@@ -200,14 +259,15 @@ int BatchTaskRepo::createBatchWithFiles(
   if (!rawDb)
     return -1;
 
-  ScopedTransaction txn(rawDb);
+  ScopedTransaction txn(db());
   if (!txn.begin())
     return -1;
 
   // 插入批次记录
   std::string batchSql =
       "INSERT INTO task_batches (streamer, status, output_dir, tmp_dir, "
-      "total_files) VALUES (?, 'encoding', ?, ?, ?)";
+      "total_files) VALUES (?, " +
+      toSql(BatchStatus::ENCODING) + ", ?, ?, ?)";
   sqlite3_stmt *batchStmt;
   if (sqlite3_prepare_v2(rawDb, batchSql.c_str(), -1, &batchStmt, 0) !=
       SQLITE_OK) {
@@ -234,7 +294,8 @@ int BatchTaskRepo::createBatchWithFiles(
   // 插入批次文件记录
   std::string fileSql =
       "INSERT INTO task_batch_files (batch_id, dir_path, filename, "
-      "fingerprint, pending_file_id, status) VALUES (?, ?, ?, ?, ?, 'pending')";
+      "fingerprint, pending_file_id, status) VALUES (?, ?, ?, ?, ?, " +
+      toSql(BatchFileStatus::PENDING) + ")";
   sqlite3_stmt *fileStmt;
   if (sqlite3_prepare_v2(rawDb, fileSql.c_str(), -1, &fileStmt, 0) !=
       SQLITE_OK) {
@@ -279,13 +340,14 @@ bool BatchTaskRepo::addFilesToBatch(int batchId,
   if (!rawDb)
     return false;
 
-  ScopedTransaction txn(rawDb);
+  ScopedTransaction txn(db());
   if (!txn.begin())
     return false;
 
   std::string fileSql =
       "INSERT INTO task_batch_files (batch_id, dir_path, filename, "
-      "fingerprint, pending_file_id, status) VALUES (?, ?, ?, ?, ?, 'pending')";
+      "fingerprint, pending_file_id, status) VALUES (?, ?, ?, ?, ?, " +
+      toSql(BatchFileStatus::PENDING) + ")";
   sqlite3_stmt *fileStmt;
   if (sqlite3_prepare_v2(rawDb, fileSql.c_str(), -1, &fileStmt, 0) !=
       SQLITE_OK) {
@@ -316,7 +378,7 @@ bool BatchTaskRepo::addFilesToBatch(int batchId,
   // 更新 total_files 计数
   std::string batchSql =
       "UPDATE task_batches SET total_files = total_files + ?, "
-      "updated_at = datetime('now', 'localtime') WHERE id = ?";
+      "updated_at = unixepoch() WHERE id = ?";
   sqlite3_stmt *batchStmt;
   if (sqlite3_prepare_v2(rawDb, batchSql.c_str(), -1, &batchStmt, 0) !=
       SQLITE_OK)
@@ -348,14 +410,16 @@ bool BatchTaskRepo::markFileEncoded(int batchId, const std::string &filepath,
   std::string dirPath, fname;
   splitPath(filepath, dirPath, fname);
 
-  ScopedTransaction txn(rawDb);
+  ScopedTransaction txn(db());
   if (!txn.begin())
     return false;
 
   // 更新文件状态
   std::string fileSql =
-      "UPDATE task_batch_files SET status = 'encoded', encoded_path = ?, "
-      "fingerprint = ?, updated_at = datetime('now', 'localtime') "
+      "UPDATE task_batch_files SET status = " +
+      toSql(BatchFileStatus::ENCODED) +
+      ", encoded_path = ?, "
+      "fingerprint = ?, updated_at = unixepoch() "
       "WHERE batch_id = ? AND dir_path = ? AND filename = ?";
   sqlite3_stmt *fileStmt;
   if (sqlite3_prepare_v2(rawDb, fileSql.c_str(), -1, &fileStmt, 0) !=
@@ -382,7 +446,7 @@ bool BatchTaskRepo::markFileEncoded(int batchId, const std::string &filepath,
   // 递增批次 encoded_count
   std::string batchSql =
       "UPDATE task_batches SET encoded_count = encoded_count + 1, "
-      "updated_at = datetime('now', 'localtime') WHERE id = ?";
+      "updated_at = unixepoch() WHERE id = ?";
   sqlite3_stmt *batchStmt;
   if (sqlite3_prepare_v2(rawDb, batchSql.c_str(), -1, &batchStmt, 0) !=
       SQLITE_OK)
@@ -410,7 +474,7 @@ bool BatchTaskRepo::deleteBatchFileAndIncrFailed(int batchId,
   std::string dirPath, fname;
   splitPath(filepath, dirPath, fname);
 
-  ScopedTransaction txn(rawDb);
+  ScopedTransaction txn(db());
   if (!txn.begin())
     return false;
 
@@ -434,7 +498,7 @@ bool BatchTaskRepo::deleteBatchFileAndIncrFailed(int batchId,
   // 递增 failed_count
   std::string batchSql =
       "UPDATE task_batches SET failed_count = failed_count + 1, "
-      "updated_at = datetime('now', 'localtime') WHERE id = ?";
+      "updated_at = unixepoch() WHERE id = ?";
   sqlite3_stmt *batchStmt;
   if (sqlite3_prepare_v2(rawDb, batchSql.c_str(), -1, &batchStmt, 0) !=
       SQLITE_OK)
@@ -456,16 +520,19 @@ bool BatchTaskRepo::deleteBatchFileAndIncrFailed(int batchId,
 // ============ 恢复操作 ============
 
 int BatchTaskRepo::rollbackEncodingFiles() {
-  std::string sql = "UPDATE task_batch_files SET status = 'pending', "
-                    "updated_at = datetime('now', 'localtime') "
-                    "WHERE status = 'encoding'";
+  std::string sql = "UPDATE task_batch_files SET status = " +
+                    toSql(BatchFileStatus::PENDING) +
+                    ", updated_at = unixepoch() WHERE status = " +
+                    toSql(BatchFileStatus::ENCODING);
   return db().executeUpdateCount(sql);
 }
 
 int BatchTaskRepo::rollbackBatchStatus() {
-  std::string sql = "UPDATE task_batches SET status = 'encoding', "
-                    "updated_at = datetime('now', 'localtime') "
-                    "WHERE status IN ('merging', 'extracting_mp3')";
+  std::string sql = "UPDATE task_batches SET status = " +
+                    toSql(BatchStatus::ENCODING) +
+                    ", updated_at = unixepoch() WHERE status IN (" +
+                    toSql(BatchStatus::MERGING) + ", " +
+                    toSql(BatchStatus::EXTRACTING_MP3) + ")";
   return db().executeUpdateCount(sql);
 }
 
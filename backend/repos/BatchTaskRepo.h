@@ -38,6 +38,10 @@ public:
                              const std::string &status);
   int countPendingOrEncoding(int batchId);
   std::vector<int> findCompleteBatchIds(int minAgeSeconds);
+  /// encoding 批次的未完成文件数与最后更新时间，batchId < 0 表示全部
+  std::vector<BatchProgress> findEncodingBatchProgress(int batchId = -1);
+  /// 原子地把 encoding 批次置为 merging，返回是否由本次调用完成转换
+  bool claimBatchForMerge(int batchId);
 
   // ============ 事务性操作 ============
 
@@ -0,0 +1,70 @@
+#include "MediaInfoRepo.h"
+#include <sqlite3.h>
+
+DatabaseService &MediaInfoRepo::db() { return DatabaseService::getInstance(); }
+
+const char *MediaInfoRepo::selectCols() {
+  return "fingerprint, duration_ms, bit_rate, format_name, source, streams";
+}
+
+MediaInfo MediaInfoRepo::readRow(sqlite3_stmt *stmt) {
+  MediaInfo m;
+  m.fingerprint = reinterpret_cast<const char *>(sqlite3_column_text(stmt, 0));
+  m.duration_ms = sqlite3_column_int(stmt, 1);
+  m.bit_rate = sqlite3_column_int64(stmt, 2);
+  auto fmtText = sqlite3_column_text(stmt, 3);
+  m.format_name = fmtText ? reinterpret_cast<const char *>(fmtText) : "";
+  auto srcText = sqlite3_column_text(stmt, 4);
+  m.source = srcText ? reinterpret_cast<const char *>(srcText) : "";
+
+  // streams 为 NULL 表示只有时长（原生探测），未调用过 ffprobe
+  auto streamsText = sqlite3_column_text(stmt, 5);
+  if (streamsText) {
+    auto parsed = nlohmann::json::parse(
+        reinterpret_cast<const char *>(streamsText), nullptr, false);
+    if (parsed.is_array()) {
+      m.streams = parsed.get<std::vector<MediaStream>>();
+      m.has_streams = true;
+    }
+  }
+  return m;
+}
+
+std::optional<MediaInfo>
+MediaInfoRepo::findByFingerprint(const std::string &fingerprint) {
+  std::string sql = std::string("SELECT ") + selectCols() +
+                    " FROM media_info WHERE fingerprint = ?";
+  return db().queryOne<MediaInfo>(sql, readRow, [&](sqlite3_stmt *stmt) {
+    sqlite3_bind_text(stmt, 1, fingerprint.c_str(), -1, SQLITE_TRANSIENT);
+  });
+}
+
+bool MediaInfoRepo::upsert(const MediaInfo &info) {
+  std::string streams;
+  if (info.has_streams) {
+    streams = nlohmann::json(info.streams).dump();
+  }
+  std::string sql =
+      "INSERT INTO media_info (fingerprint, duration_ms, bit_rate, "
+      "format_name, source, streams) VALUES (?, ?, ?, ?, ?, ?) "
+      "ON CONFLICT(fingerprint) DO UPDATE SET "
+      "duration_ms = excluded.duration_ms, bit_rate = excluded.bit_rate, "
+      "format_name = excluded.format_name, source = excluded.source, "
+      "streams = excluded.streams, updated_at = unixepoch()";
+  return db().executeUpdate(sql, [&](sqlite3_stmt *stmt) {
+    sqlite3_bind_text(stmt, 1, info.fingerprint.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(stmt, 2, info.duration_ms);
+    sqlite3_bind_int64(stmt, 3, info.bit_rate);
+    sqlite3_bind_text(stmt, 4, info.format_name.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 5, info.source.c_str(), -1, SQLITE_TRANSIENT);
+    if (info.has_streams) {
+      sqlite3_bind_text(stmt, 6, streams.c_str(), -1, SQLITE_TRANSIENT);
+    } else {
+      sqlite3_bind_null(stmt, 6);
+    }
+  });
+}
+
+int MediaInfoRepo::count() {
+  return db().queryScalar("SELECT COUNT(*) FROM media_info");
+}
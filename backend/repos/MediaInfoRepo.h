@@ -0,0 +1,28 @@
+#pragma once
+
+#include "../models/MediaInfo.h"
+#include "../services/DatabaseService.h"
+#include <optional>
+#include <string>
+
+/**
+ * @brief media_info 表的数据访问层
+ *
+ * 以文件指纹为主键，streams 列存储 JSON 数组。
+ * 纯数据库操作类，不包含业务逻辑。
+ */
+class MediaInfoRepo {
+public:
+  static MediaInfo readRow(sqlite3_stmt *stmt);
+  static const char *selectCols();
+
+  std::optional<MediaInfo> findByFingerprint(const std::string &fingerprint);
+
+  /// 插入或整行替换
+  bool upsert(const MediaInfo &info);
+
+  int count();
+
+private:
+  DatabaseService &db();
+};
@@ -1,8 +1,12 @@
 #include "PendingFileRepo.h"
+#include "StatusCodes.h"
+#include <algorithm>
+#include <ctime>
 #include <filesystem>
 #include <sqlite3.h>
 
 namespace fs = std::filesystem;
+using status_code::toSql;
 
 // ============ 静态辅助 ============
 
@@ -26,7 +30,7 @@ PendingFile PendingFileRepo::readRow(sqlite3_stmt *stmt) {
   auto fpText = sqlite3_column_text(stmt, 3);
   f.fingerprint = fpText ? reinterpret_cast<const char *>(fpText) : "";
   f.stable_count = sqlite3_column_int(stmt, 4);
-  f.status = reinterpret_cast<const char *>(sqlite3_column_text(stmt, 5));
+  f.status = status_code::toName<PendingStatus>(sqlite3_column_int(stmt, 5));
   auto mp4Text = sqlite3_column_text(stmt, 6);
   f.temp_mp4_path = mp4Text ? reinterpret_cast<const char *>(mp4Text) : "";
   auto mp3Text = sqlite3_column_text(stmt, 7);
@@ -38,6 +42,14 @@ PendingFile PendingFileRepo::readRow(sqlite3_stmt *stmt) {
   return f;
 }
 
+int PendingFileRepo::statusCode(const std::string &status) {
+  int code = status_code::toCode<PendingStatus>(status);
+  if (code == status_code::UNKNOWN) {
+    LOG_ERROR << "[PendingFileRepo] Unknown status: " << status;
+  }
+  return code;
+}
+
 DatabaseService &PendingFileRepo::db() {
   return DatabaseService::getInstance();
 }
@@ -73,48 +85,92 @@ std::vector<PendingFile> PendingFileRepo::findAll() {
 
 std::vector<PendingFile>
 PendingFileRepo::findByStatus(const std::string &status) {
+  int code = status_code::toCode<PendingStatus>(status);
+  if (code == status_code::UNKNOWN)
+    return {};
+
   std::string sql = std::string("SELECT ") + selectCols() +
                     " FROM pending_files WHERE status = ?";
-  if (status == "completed") {
+  if (code == static_cast<int>(PendingStatus::COMPLETED)) {
     sql += " ORDER BY updated_at DESC";
   }
   return db().queryAll<PendingFile>(sql, readRow, [&](sqlite3_stmt *stmt) {
-    sqlite3_bind_text(stmt, 1, status.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(stmt, 1, code);
   });
 }
 
 std::vector<PendingFile> PendingFileRepo::findStableWithMinCount(int minCount) {
   std::string sql =
       std::string("SELECT ") + selectCols() +
-      " FROM pending_files WHERE stable_count >= ? AND status = 'pending'";
+      " FROM pending_files WHERE status = " + toSql(PendingStatus::PENDING) +
+      " AND stable_count >= ?";
   return db().queryAll<PendingFile>(sql, readRow, [&](sqlite3_stmt *stmt) {
     sqlite3_bind_int(stmt, 1, minCount);
   });
 }
 
 std::vector<PendingFile> PendingFileRepo::findStagedOlderThan(int seconds) {
+  // 截止时间在调用侧算好，(status, updated_at) 索引上直接范围扫描
+  int64_t cutoff = static_cast<int64_t>(std::time(nullptr)) - seconds;
   std::string sql = std::string("SELECT ") + selectCols() +
-                    " FROM pending_files WHERE status = 'staged' "
-                    "AND datetime(updated_at, '+' || ? || ' seconds') <= "
-                    "datetime('now', 'localtime')";
+                    " FROM pending_files WHERE status = " +
+                    toSql(PendingStatus::STAGED) + " AND updated_at <= ?";
   return db().queryAll<PendingFile>(sql, readRow, [&](sqlite3_stmt *stmt) {
-    sqlite3_bind_int(stmt, 1, seconds);
+    sqlite3_bind_int64(stmt, 1, cutoff);
   });
 }
 
 bool PendingFileRepo::existsByFingerprint(const std::string &fingerprint) {
   std::string sql = "SELECT COUNT(*) FROM pending_files WHERE fingerprint = ? "
-                    "AND status = 'completed'";
+                    "AND status = " +
+                    toSql(PendingStatus::COMPLETED);
   int count = db().queryScalar(sql, [&](sqlite3_stmt *stmt) {
     sqlite3_bind_text(stmt, 1, fingerprint.c_str(), -1, SQLITE_TRANSIENT);
   });
   return count > 0;
 }
 
+std::unordered_map<std::string, PendingFile> PendingFileRepo::findByKeys(
+    const std::vector<std::pair<std::string, std::string>> &keys) {
+  // 每条语句的键数上限，保持在 SQLite 默认的 999 个绑定参数以内
+  constexpr size_t KEYS_PER_QUERY = 256;
+
+  std::unordered_map<std::string, PendingFile> result;
+  for (size_t begin = 0; begin < keys.size(); begin += KEYS_PER_QUERY) {
+    size_t end = std::min(keys.size(), begin + KEYS_PER_QUERY);
+    // 只按 (dir_path, filename) 唯一索引查找本批的键，不读取整个目录
+    std::string sql = "WITH keys(d, f) AS (VALUES ";
+    for (size_t i = begin; i < end; ++i) {
+      sql += i == begin ? "(?, ?)" : ", (?, ?)";
+    }
+    sql += std::string(") SELECT ") + selectCols() +
+           " FROM pending_files JOIN keys ON dir_path = d AND filename = f";
+    auto rows =
+        db().queryAll<PendingFile>(sql, readRow, [&](sqlite3_stmt *stmt) {
+          int index = 1;
+          for (size_t i = begin; i < end; ++i) {
+            sqlite3_bind_text(stmt, index++, keys[i].first.c_str(), -1,
+                              SQLITE_TRANSIENT);
+            sqlite3_bind_text(stmt, index++, keys[i].second.c_str(), -1,
+                              SQLITE_TRANSIENT);
+          }
+        });
+    for (auto &row : rows) {
+      std::string path = row.getFilepath();
+      result.emplace(std::move(path), std::move(row));
+    }
+  }
+  return result;
+}
+
 std::vector<PendingFile>
 PendingFileRepo::findByDirAndStemLike(const std::string &dir,
                                       const std::string &pattern,
                                       const std::string &status) {
+  int code = statusCode(status);
+  if (code == status_code::UNKNOWN)
+    return {};
+
   std::string sql =
       std::string("SELECT ") + selectCols() +
       " FROM pending_files WHERE dir_path = ? AND filename LIKE ? "
@@ -122,7 +178,7 @@ PendingFileRepo::findByDirAndStemLike(const std::string &dir,
   return db().queryAll<PendingFile>(sql, readRow, [&](sqlite3_stmt *stmt) {
     sqlite3_bind_text(stmt, 1, dir.c_str(), -1, SQLITE_TRANSIENT);
     sqlite3_bind_text(stmt, 2, pattern.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 3, status.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(stmt, 3, code);
   });
 }
 
@@ -133,7 +189,8 @@ bool PendingFileRepo::insert(const std::string &dirPath,
                              const std::string &fingerprint) {
   std::string sql =
       "INSERT INTO pending_files (dir_path, filename, fingerprint, "
-      "stable_count, status) VALUES (?, ?, ?, 1, 'pending')";
+      "stable_count, status) VALUES (?, ?, ?, 1, " +
+      toSql(PendingStatus::PENDING) + ")";
   return db().executeUpdate(sql, [&](sqlite3_stmt *stmt) {
     sqlite3_bind_text(stmt, 1, dirPath.c_str(), -1, SQLITE_TRANSIENT);
     sqlite3_bind_text(stmt, 2, filename.c_str(), -1, SQLITE_TRANSIENT);
@@ -144,7 +201,7 @@ bool PendingFileRepo::insert(const std::string &dirPath,
 bool PendingFileRepo::incrementStableCount(const std::string &dirPath,
                                            const std::string &filename) {
   std::string sql = "UPDATE pending_files SET stable_count = stable_count + 1, "
-                    "updated_at = datetime('now', 'localtime') "
+                    "updated_at = unixepoch() "
                     "WHERE dir_path = ? AND filename = ?";
   return db().executeUpdate(sql, [&](sqlite3_stmt *stmt) {
     sqlite3_bind_text(stmt, 1, dirPath.c_str(), -1, SQLITE_TRANSIENT);
@@ -157,7 +214,9 @@ bool PendingFileRepo::resetFingerprint(const std::string &dirPath,
                                        const std::string &fingerprint) {
   std::string sql =
       "UPDATE pending_files SET fingerprint = ?, stable_count = 1, "
-      "status = 'pending', updated_at = datetime('now', 'localtime') "
+      "status = " +
+      toSql(PendingStatus::PENDING) +
+      ", updated_at = unixepoch() "
       "WHERE dir_path = ? AND filename = ?";
   return db().executeUpdate(sql, [&](sqlite3_stmt *stmt) {
     sqlite3_bind_text(stmt, 1, fingerprint.c_str(), -1, SQLITE_TRANSIENT);
@@ -166,16 +225,32 @@ bool PendingFileRepo::resetFingerprint(const std::string &dirPath,
   });
 }
 
+bool PendingFileRepo::updateFingerprint(const std::string &dirPath,
+                                        const std::string &filename,
+                                        const std::string &fingerprint) {
+  std::string sql = "UPDATE pending_files SET fingerprint = ? "
+                    "WHERE dir_path = ? AND filename = ?";
+  return db().executeUpdate(sql, [&](sqlite3_stmt *stmt) {
+    sqlite3_bind_text(stmt, 1, fingerprint.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 2, dirPath.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 3, filename.c_str(), -1, SQLITE_TRANSIENT);
+  });
+}
+
 bool PendingFileRepo::updateStatus(const std::string &filepath,
                                    const std::string &status) {
+  int code = statusCode(status);
+  if (code == status_code::UNKNOWN)
+    return false;
+
   std::string dirPath, fname;
   splitPath(filepath, dirPath, fname);
 
   std::string sql = "UPDATE pending_files SET status = ?, "
-                    "updated_at = datetime('now', 'localtime') "
+                    "updated_at = unixepoch() "
                     "WHERE dir_path = ? AND filename = ?";
   return db().executeUpdate(sql, [&](sqlite3_stmt *stmt) {
-    sqlite3_bind_text(stmt, 1, status.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(stmt, 1, code);
     sqlite3_bind_text(stmt, 2, dirPath.c_str(), -1, SQLITE_TRANSIENT);
     sqlite3_bind_text(stmt, 3, fname.c_str(), -1, SQLITE_TRANSIENT);
   });
@@ -185,15 +260,19 @@ bool PendingFileRepo::updateStatusWithStartEnd(const std::string &filepath,
                                                const std::string &status,
                                                const std::string &startTime,
                                                const std::string &endTime) {
+  int code = statusCode(status);
+  if (code == status_code::UNKNOWN)
+    return false;
+
   std::string dirPath, fname;
   splitPath(filepath, dirPath, fname);
 
   std::string sql = "UPDATE pending_files SET status = ?, "
                     "start_time = ?, end_time = ?, "
-                    "updated_at = datetime('now', 'localtime') "
+                    "updated_at = unixepoch() "
                     "WHERE dir_path = ? AND filename = ?";
   return db().executeUpdate(sql, [&](sqlite3_stmt *stmt) {
-    sqlite3_bind_text(stmt, 1, status.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(stmt, 1, code);
     if (startTime.empty()) {
       sqlite3_bind_null(stmt, 2);
     } else {
@@ -212,14 +291,18 @@ bool PendingFileRepo::updateStatusWithStartEnd(const std::string &filepath,
 bool PendingFileRepo::updateStatusWithTempPath(const std::string &filepath,
                                                const std::string &status,
                                                const std::string &tempPath) {
+  int code = statusCode(status);
+  if (code == status_code::UNKNOWN)
+    return false;
+
   std::string dirPath, fname;
   splitPath(filepath, dirPath, fname);
 
   std::string sql = "UPDATE pending_files SET status = ?, temp_mp4_path = ?, "
-                    "updated_at = datetime('now', 'localtime') "
+                    "updated_at = unixepoch() "
                     "WHERE dir_path = ? AND filename = ?";
   return db().executeUpdate(sql, [&](sqlite3_stmt *stmt) {
-    sqlite3_bind_text(stmt, 1, status.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(stmt, 1, code);
     sqlite3_bind_text(stmt, 2, tempPath.c_str(), -1, SQLITE_TRANSIENT);
     sqlite3_bind_text(stmt, 3, dirPath.c_str(), -1, SQLITE_TRANSIENT);
     sqlite3_bind_text(stmt, 4, fname.c_str(), -1, SQLITE_TRANSIENT);
@@ -227,10 +310,14 @@ bool PendingFileRepo::updateStatusWithTempPath(const std::string &filepath,
 }
 
 bool PendingFileRepo::updateStatusById(int id, const std::string &status) {
+  int code = statusCode(status);
+  if (code == status_code::UNKNOWN)
+    return false;
+
   std::string sql = "UPDATE pending_files SET status = ?, "
-                    "updated_at = datetime('now', 'localtime') WHERE id = ?";
+                    "updated_at = unixepoch() WHERE id = ?";
   return db().executeUpdate(sql, [&](sqlite3_stmt *stmt) {
-    sqlite3_bind_text(stmt, 1, status.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(stmt, 1, code);
     sqlite3_bind_int(stmt, 2, id);
   });
 }
@@ -257,71 +344,109 @@ bool PendingFileRepo::deleteById(int id) {
 
 // ============ 事务性操作 ============
 
-std::vector<PendingFile> PendingFileRepo::claimStableFiles() {
-  std::vector<PendingFile> files;
+std::vector<int> PendingFileRepo::upsertFingerprints(
+    const std::vector<FingerprintUpsert> &items,
+    const std::vector<FingerprintUpsert> &migrations) {
+  if (items.empty() && migrations.empty())
+    return {};
+
   sqlite3 *rawDb = db().getDb();
   if (!rawDb)
-    return files;
-
-  ScopedTransaction txn(rawDb);
-  if (!txn.begin()) {
-    LOG_DEBUG << "[claimStableFiles] 无法获取数据库锁，可能存在并发任务";
-    return files;
-  }
-
-  std::string selectSql = std::string("SELECT ") + selectCols() +
-                          " FROM pending_files WHERE status = 'stable'";
-  sqlite3_stmt *selectStmt;
-  if (sqlite3_prepare_v2(rawDb, selectSql.c_str(), -1, &selectStmt, 0) !=
-      SQLITE_OK) {
-    LOG_ERROR << "[claimStableFiles] Failed to prepare select: "
-              << sqlite3_errmsg(rawDb);
-    return files;
-  }
+    return {};
 
-  std::vector<int> fileIds;
-  while (sqlite3_step(selectStmt) == SQLITE_ROW) {
-    files.push_back(readRow(selectStmt));
-    fileIds.push_back(files.back().id);
-  }
-  sqlite3_finalize(selectStmt);
+  ScopedTransaction txn(db());
+  if (!txn.begin())
+    return {};
 
-  if (files.empty()) {
-    txn.commit();
-    return files;
+  if (!migrations.empty()) {
+    auto migrate = db().prepareCached("UPDATE pending_files SET fingerprint = ? "
+                                      "WHERE dir_path = ? AND filename = ?");
+    if (!migrate) {
+      LOG_ERROR << "[upsertFingerprints] Failed to prepare migration: "
+                << sqlite3_errmsg(rawDb);
+      return {};
+    }
+    for (const auto &item : migrations) {
+      sqlite3_stmt *stmt = migrate.get();
+      sqlite3_reset(stmt);
+      sqlite3_bind_text(stmt, 1, item.fingerprint.c_str(), -1,
+                        SQLITE_TRANSIENT);
+      sqlite3_bind_text(stmt, 2, item.dirPath.c_str(), -1, SQLITE_TRANSIENT);
+      sqlite3_bind_text(stmt, 3, item.filename.c_str(), -1, SQLITE_TRANSIENT);
+      if (sqlite3_step(stmt) != SQLITE_DONE) {
+        LOG_ERROR << "[upsertFingerprints] Migration failed for "
+                  << item.filename << ": " << sqlite3_errmsg(rawDb);
+        return {};
+      }
+    }
   }
 
-  std::string updateSql =
-      "UPDATE pending_files SET status = 'processing', "
-      "updated_at = datetime('now', 'localtime') WHERE id = ?";
-  sqlite3_stmt *updateStmt;
-  if (sqlite3_prepare_v2(rawDb, updateSql.c_str(), -1, &updateStmt, 0) !=
-      SQLITE_OK) {
-    LOG_ERROR << "[claimStableFiles] Failed to prepare update: "
+  // UPDATE 中的 pending_files.* 均为旧值；WHERE 不满足时不修改也不返回行
+  const std::string pending = toSql(PendingStatus::PENDING);
+  const std::string sql =
+      "INSERT INTO pending_files (dir_path, filename, fingerprint, "
+      "stable_count, status) VALUES (?, ?, ?, 1, " +
+      pending +
+      ") "
+      "ON CONFLICT(dir_path, filename) DO UPDATE SET "
+      "stable_count = CASE WHEN pending_files.fingerprint = "
+      "excluded.fingerprint THEN pending_files.stable_count + 1 ELSE 1 END, "
+      "fingerprint = excluded.fingerprint, status = " +
+      pending +
+      ", updated_at = unixepoch() "
+      "WHERE pending_files.status = " +
+      pending +
+      " "
+      "OR pending_files.fingerprint IS NOT excluded.fingerprint "
+      "RETURNING stable_count";
+  auto cached = db().prepareCached(sql);
+  if (!cached) {
+    LOG_ERROR << "[upsertFingerprints] Failed to prepare: "
               << sqlite3_errmsg(rawDb);
     return {};
   }
+  sqlite3_stmt *stmt = cached.get();
 
-  for (int id : fileIds) {
-    sqlite3_reset(updateStmt);
-    sqlite3_bind_int(updateStmt, 1, id);
-    if (sqlite3_step(updateStmt) != SQLITE_DONE) {
-      LOG_ERROR << "[claimStableFiles] Failed to update file id=" << id << ": "
+  std::vector<int> counts;
+  counts.reserve(items.size());
+  for (const auto &item : items) {
+    sqlite3_reset(stmt);
+    sqlite3_bind_text(stmt, 1, item.dirPath.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 2, item.filename.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 3, item.fingerprint.c_str(), -1,
+                      SQLITE_TRANSIENT);
+
+    int count = -1;
+    int rc = sqlite3_step(stmt);
+    if (rc == SQLITE_ROW) {
+      count = sqlite3_column_int(stmt, 0);
+      rc = sqlite3_step(stmt);
+    }
+    if (rc != SQLITE_DONE) {
+      LOG_ERROR << "[upsertFingerprints] Failed for " << item.filename << ": "
                 << sqlite3_errmsg(rawDb);
-      sqlite3_finalize(updateStmt);
       return {};
     }
+    counts.push_back(count);
   }
-  sqlite3_finalize(updateStmt);
 
-  if (!txn.commit()) {
+  if (!txn.commit())
     return {};
-  }
+  return counts;
+}
 
-  LOG_INFO << "[claimStableFiles] Atomically claimed " << files.size()
-           << " stable files";
-  for (auto &f : files) {
-    f.status = "processing";
+std::vector<PendingFile> PendingFileRepo::claimStableFiles() {
+  // 单条 UPDATE ... RETURNING 本身即原子操作，无需先 SELECT 再逐条更新
+  std::string sql =
+      "UPDATE pending_files SET status = " +
+      toSql(PendingStatus::PROCESSING) +
+      ", updated_at = unixepoch() WHERE status = " +
+      toSql(PendingStatus::STABLE) + " RETURNING " + selectCols();
+  auto files = db().queryAll<PendingFile>(sql, readRow);
+
+  if (!files.empty()) {
+    LOG_INFO << "[claimStableFiles] Atomically claimed " << files.size()
+             << " stable files";
   }
   return files;
 }
@@ -335,13 +460,15 @@ bool PendingFileRepo::markProcessingBatch(
   if (!rawDb)
     return false;
 
-  ScopedTransaction txn(rawDb);
+  ScopedTransaction txn(db());
   if (!txn.begin())
     return false;
 
-  std::string sql = "UPDATE pending_files SET status = 'processing', "
-                    "updated_at = datetime('now', 'localtime') "
-                    "WHERE dir_path = ? AND filename = ? AND status = 'stable'";
+  std::string sql = "UPDATE pending_files SET status = " +
+                    toSql(PendingStatus::PROCESSING) +
+                    ", updated_at = unixepoch() "
+                    "WHERE dir_path = ? AND filename = ? AND status = " +
+                    toSql(PendingStatus::STABLE);
   sqlite3_stmt *stmt;
   if (sqlite3_prepare_v2(rawDb, sql.c_str(), -1, &stmt, 0) != SQLITE_OK) {
     LOG_ERROR << "[markProcessingBatch] Failed to prepare: "
@@ -393,12 +520,13 @@ bool PendingFileRepo::rollbackToStable(
   if (!rawDb)
     return false;
 
-  ScopedTransaction txn(rawDb);
+  ScopedTransaction txn(db());
   if (!txn.begin())
     return false;
 
-  std::string sql = "UPDATE pending_files SET status = 'stable', "
-                    "updated_at = datetime('now', 'localtime') "
+  std::string sql = "UPDATE pending_files SET status = " +
+                    toSql(PendingStatus::STABLE) +
+                    ", updated_at = unixepoch() "
                     "WHERE dir_path = ? AND filename = ?";
   sqlite3_stmt *stmt;
   if (sqlite3_prepare_v2(rawDb, sql.c_str(), -1, &stmt, 0) != SQLITE_OK)
@@ -430,7 +558,8 @@ bool PendingFileRepo::rollbackToStable(
 std::vector<PendingFileRepo::ProcessingRecord>
 PendingFileRepo::findProcessingRecords() {
   std::string sql = "SELECT id, dir_path, filename FROM pending_files WHERE "
-                    "status = 'processing'";
+                    "status = " +
+                    toSql(PendingStatus::PROCESSING);
   return db().queryAll<ProcessingRecord>(
       sql, [](sqlite3_stmt *stmt) -> ProcessingRecord {
         ProcessingRecord rec;
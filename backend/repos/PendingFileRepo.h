@@ -4,6 +4,8 @@
 #include "../services/DatabaseService.h"
 #include <optional>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 /**
@@ -31,6 +33,10 @@ public:
   std::vector<PendingFile> findStagedOlderThan(int seconds);
   bool existsByFingerprint(const std::string &fingerprint);
 
+  /// 批量读取指定 (dir_path, filename) 的记录，键为完整路径
+  std::unordered_map<std::string, PendingFile> findByKeys(
+      const std::vector<std::pair<std::string, std::string>> &keys);
+
   /// 查询同目录下 filename LIKE pattern 且指定状态的文件
   std::vector<PendingFile> findByDirAndStemLike(const std::string &dir,
                                                 const std::string &pattern,
@@ -44,6 +50,10 @@ public:
                             const std::string &filename);
   bool resetFingerprint(const std::string &dirPath, const std::string &filename,
                         const std::string &fingerprint);
+  /// 仅替换指纹（版本迁移用），不改变状态和 stable_count
+  bool updateFingerprint(const std::string &dirPath,
+                         const std::string &filename,
+                         const std::string &fingerprint);
 
   /// 通用状态更新
   bool updateStatus(const std::string &filepath, const std::string &status);
@@ -68,6 +78,26 @@ public:
 
   // ============ 事务性操作 ============
 
+  struct FingerprintUpsert {
+    std::string dirPath;
+    std::string filename;
+    std::string fingerprint;
+  };
+
+  /**
+   * @brief 在一个事务中批量写入扫描指纹
+   *
+   * 新文件插入(stable_count=1)；指纹相同且 pending 的 stable_count+1；
+   * 指纹变化的重置为 pending/1；指纹相同但非 pending 的不修改。
+   * migrations 中的记录先在同一事务内仅替换指纹（版本迁移）。
+   *
+   * @return 与 items 顺序对应的新 stable_count，未修改或失败为 -1；
+   *         事务失败时返回空
+   */
+  std::vector<int>
+  upsertFingerprints(const std::vector<FingerprintUpsert> &items,
+                     const std::vector<FingerprintUpsert> &migrations = {});
+
   /// 原子性地获取 stable 文件并标记为 processing
   std::vector<PendingFile> claimStableFiles();
 
@@ -92,4 +122,6 @@ private:
   DatabaseService &db();
   static void splitPath(const std::string &filepath, std::string &dirPath,
                         std::string &filename);
+  /// 状态字符串转为数据库编码，未知状态记录错误并返回 status_code::UNKNOWN
+  static int statusCode(const std::string &status);
 };
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief 数据库状态列的整数编码
+ *
+ * 表中以小整数存储状态，配合 (status, updated_at) 等复合索引做范围扫描；
+ * 模型和 HTTP 接口仍使用字符串，由仓储层在读写时转换。
+ * 已写入数据库的数值不可更改，新增状态只能在末尾追加。
+ */
+
+enum class PendingStatus : int {
+  PENDING = 0, ///< 待处理（等待稳定）
+  STABLE,      ///< 已稳定
+  PROCESSING,  ///< 处理中
+  CONVERTING,  ///< 转换中
+  STAGED,      ///< 已暂存
+  COMPLETED,   ///< 已完成
+  DEPRECATED   ///< 已废弃（同名文件中较小者）
+};
+
+enum class BatchStatus : int {
+  ENCODING = 0,   ///< 转码中
+  MERGING,        ///< 合并中
+  EXTRACTING_MP3, ///< 提取 MP3 中
+  COMPLETED,      ///< 已完成
+  FAILED          ///< 失败
+};
+
+enum class BatchFileStatus : int {
+  PENDING = 0, ///< 等待转码
+  ENCODING,    ///< 转码中
+  ENCODED,     ///< 已转码
+  FAILED       ///< 失败
+};
+
+namespace status_code {
+
+/// 无法识别的状态（迁移旧数据时遇到未知字符串）
+inline constexpr int UNKNOWN = -1;
+
+template <typename E> struct Names;
+
+template <> struct Names<PendingStatus> {
+  static constexpr const char *values[] = {
+      "pending", "stable",    "processing", "converting",
+      "staged",  "completed", "deprecated"};
+};
+
+template <> struct Names<BatchStatus> {
+  static constexpr const char *values[] = {"encoding", "merging",
+                                           "extracting_mp3", "completed",
+                                           "failed"};
+};
+
+template <> struct Names<BatchFileStatus> {
+  static constexpr const char *values[] = {"pending", "encoding", "encoded",
+                                           "failed"};
+};
+
+/**
+ * @brief 状态字符串 -> 整数编码，未知返回 UNKNOWN
+ */
+template <typename E> int toCode(std::string_view name) {
+  const auto &values = Names<E>::values;
+  for (size_t i = 0; i < std::size(values); ++i) {
+    if (name == values[i])
+      return static_cast<int>(i);
+  }
+  return UNKNOWN;
+}
+
+/**
+ * @brief 整数编码 -> 状态字符串，未知返回 "unknown"
+ */
+template <typename E> const char *toName(int code) {
+  const auto &values = Names<E>::values;
+  if (code < 0 || static_cast<size_t>(code) >= std::size(values))
+    return "unknown";
+  return values[code];
+}
+
+/**
+ * @brief 拼接到 SQL 中的状态常量
+ */
+template <typename E> std::string toSql(E status) {
+  return std::to_string(static_cast<int>(status));
+}
+
+/**
+ * @brief 生成把旧版字符串状态列转换为编码的 CASE 表达式（迁移用）
+ */
+template <typename E> std::string caseSql(const std::string &column) {
+  std::string expr = "CASE " + column;
+  const auto &values = Names<E>::values;
+  for (size_t i = 0; i < std::size(values); ++i) {
+    expr += " WHEN '" + std::string(values[i]) + "' THEN " + std::to_string(i);
+  }
+  expr += " ELSE " + std::to_string(UNKNOWN) + " END";
+  return expr;
+}
+
+} // namespace status_code
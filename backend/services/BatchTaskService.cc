@@ -2,7 +2,9 @@
 #include "FfmpegTaskService.h"
 #include "MergerService.h"
 #include "SchedulerService.h"
+#include <algorithm>
 #include <cmath>
+#include <ctime>
 #include <filesystem>
 #include <map>
 #include <set>
@@ -83,6 +85,11 @@ int BatchTaskService::createBatch(const std::string &streamer,
                                   const std::vector<BatchInputFile> &files) {
   int batchId = repo_.createBatchWithFiles(streamer, outputDir, tmpDir, files);
   if (batchId >= 0) {
+    {
+      std::lock_guard<std::mutex> lock(progressMutex_);
+      progress_[batchId] = {batchId, static_cast<int>(files.size()),
+                            static_cast<int64_t>(std::time(nullptr))};
+    }
     LOG_INFO << "[createBatch] Created batch id=" << batchId
              << " streamer=" << streamer << " files=" << files.size();
   }
@@ -97,7 +104,12 @@ bool BatchTaskService::markFileEncoding(int batchId,
 bool BatchTaskService::markFileEncoded(int batchId, const std::string &filepath,
                                        const std::string &encodedPath,
                                        const std::string &fingerprint) {
-  return repo_.markFileEncoded(batchId, filepath, encodedPath, fingerprint);
+  bool success =
+      repo_.markFileEncoded(batchId, filepath, encodedPath, fingerprint);
+  if (success) {
+    updateProgress(batchId, -1);
+  }
+  return success;
 }
 
 bool BatchTaskService::markFileFailed(int batchId,
@@ -109,7 +121,11 @@ bool BatchTaskService::markFileFailed(int batchId,
   }
 
   // 2. 删除批次文件记录并递增 failed_count
-  return repo_.deleteBatchFileAndIncrFailed(batchId, filepath);
+  bool success = repo_.deleteBatchFileAndIncrFailed(batchId, filepath);
+  if (success) {
+    updateProgress(batchId, -1);
+  }
+  return success;
 }
 
 std::vector<BatchFile> BatchTaskService::getBatchFiles(int batchId) {
@@ -129,6 +145,59 @@ BatchTaskService::getEncodingCompleteBatchIds(int minAgeSeconds) {
   return repo_.findCompleteBatchIds(minAgeSeconds);
 }
 
+void BatchTaskService::updateProgress(int batchId, int delta) {
+  {
+    std::lock_guard<std::mutex> lock(progressMutex_);
+    auto it = progress_.find(batchId);
+    if (it != progress_.end()) {
+      it->second.outstanding = std::max(0, it->second.outstanding + delta);
+      it->second.last_update = static_cast<int64_t>(std::time(nullptr));
+      return;
+    }
+  }
+  // 内存中没有（重启后首次触达）：数据库已完成本次修改，直接加载
+  getBatchProgress(batchId);
+}
+
+std::optional<BatchProgress> BatchTaskService::getBatchProgress(int batchId) {
+  {
+    std::lock_guard<std::mutex> lock(progressMutex_);
+    auto it = progress_.find(batchId);
+    if (it != progress_.end())
+      return it->second;
+  }
+
+  auto rows = repo_.findEncodingBatchProgress(batchId);
+  if (rows.empty())
+    return std::nullopt;
+
+  std::lock_guard<std::mutex> lock(progressMutex_);
+  return progress_.try_emplace(batchId, rows.front()).first->second;
+}
+
+std::vector<BatchProgress> BatchTaskService::loadDrainedBatches() {
+  auto rows = repo_.findEncodingBatchProgress();
+  std::vector<BatchProgress> drained;
+
+  std::lock_guard<std::mutex> lock(progressMutex_);
+  progress_.clear();
+  for (const auto &row : rows) {
+    progress_[row.batch_id] = row;
+    if (row.outstanding == 0) {
+      drained.push_back(row);
+    }
+  }
+  return drained;
+}
+
+bool BatchTaskService::claimBatchForMerge(int batchId) {
+  if (!repo_.claimBatchForMerge(batchId))
+    return false;
+  std::lock_guard<std::mutex> lock(progressMutex_);
+  progress_.erase(batchId);
+  return true;
+}
+
 bool BatchTaskService::updateBatchStatus(int batchId,
                                          const std::string &status) {
   return repo_.updateBatchStatus(batchId, status);
@@ -176,6 +245,7 @@ bool BatchTaskService::addFilesToBatch(
     int batchId, const std::vector<BatchInputFile> &files) {
   bool success = repo_.addFilesToBatch(batchId, files);
   if (success) {
+    updateProgress(batchId, static_cast<int>(files.size()));
     LOG_INFO << "[addFilesToBatch] Added " << files.size()
              << " files to batch id=" << batchId;
   }
@@ -4,8 +4,10 @@
 #include "models/BatchModels.h"
 #include "services/PendingFileService.h"
 #include <drogon/drogon.h>
+#include <mutex>
 #include <optional>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 /**
@@ -13,6 +15,10 @@
  *
  * 管理 task_batches 和 task_batch_files 表的CRUD操作。
  * 负责批次创建、文件状态跟踪、批次状态流转。
+ *
+ * 同时在内存中维护 encoding 批次的未完成文件计数，由建批次/追加文件/
+ * 文件完成或失败时更新，供调度器事件驱动地判断批次是否可以合并；
+ * 内存中没有记录的批次（如重启后）按需从数据库重新加载。
  */
 class BatchTaskService : public drogon::Plugin<BatchTaskService> {
 public:
@@ -78,6 +84,23 @@ public:
    */
   std::vector<int> getEncodingCompleteBatchIds(int minAgeSeconds = 0);
 
+  /**
+   * @brief 获取 encoding 批次的转码进度（内存计数，缺失时从数据库加载）
+   */
+  std::optional<BatchProgress> getBatchProgress(int batchId);
+
+  /**
+   * @brief 从数据库重新加载所有 encoding 批次的进度，返回已无未完成文件的批次
+   */
+  std::vector<BatchProgress> loadDrainedBatches();
+
+  /**
+   * @brief 原子地把批次从 encoding 置为 merging
+   *
+   * 事件触发与周期兜底可能同时发现同一批次，只有返回 true 的调用方继续合并。
+   */
+  bool claimBatchForMerge(int batchId);
+
   /**
    * @brief 更新批次状态
    */
@@ -146,5 +169,14 @@ public:
   void processBatch(int batchId);
 
 private:
+  /**
+   * @brief 文件增减后更新内存计数
+   * @param delta 未完成文件数的变化量
+   */
+  void updateProgress(int batchId, int delta);
+
   BatchTaskRepo repo_;
+
+  std::mutex progressMutex_;
+  std::unordered_map<int, BatchProgress> progress_;
 };
@@ -0,0 +1,292 @@
+#include "ChunkEncodeService.h"
+#include <drogon/drogon.h>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+/**
+ * @brief 分段流程中单个 FFmpeg 调用的失败分类
+ *
+ * 与整段任务一致：确定性失败不重试，其余（含未运行 FFmpeg 的失败）按暂时性处理。
+ */
+live2mp3::utils::FfmpegFailureKind
+failureKindOf(const live2mp3::utils::FfmpegExitInfo &exitInfo) {
+  using live2mp3::utils::FfmpegFailureKind;
+  auto kind = live2mp3::utils::classifyFfmpegFailure(exitInfo);
+  return kind == FfmpegFailureKind::PERMANENT ? kind
+                                              : FfmpegFailureKind::TRANSIENT;
+}
+
+/**
+ * @brief 分段任务共用的进度、取消与 PID 回调
+ */
+struct TaskHooks {
+  live2mp3::utils::FfmpegProgressCallback progress;
+  live2mp3::utils::CancelCheckCallback cancelCheck;
+  std::function<void(pid_t)> pid;
+};
+
+TaskHooks makeHooks(const std::weak_ptr<FfmpegTaskProcDetail> &item,
+                    const std::shared_ptr<FfmpegTaskProcDetail> &detail) {
+  TaskHooks hooks;
+  hooks.progress = [item](const live2mp3::utils::FfmpegPipeInfo &info) {
+    if (auto detail = item.lock()) {
+      detail->setPipeInfo(info);
+    }
+  };
+  hooks.cancelCheck = [detail]() {
+    return detail->isCancelled() || !drogon::app().isRunning();
+  };
+  hooks.pid = [detail](pid_t pid) { detail->setPid(pid); };
+  return hooks;
+}
+
+} // namespace
+
+/**
+ * @brief 一个源文件的分段转码状态
+ */
+struct ChunkEncodeService::Job {
+  std::string inputPath;
+  std::string outputDir;
+  std::string chunkDir;
+  std::function<void(FfmpegTaskResult)> onComplete;
+
+  std::mutex mutex;
+  std::vector<std::string> encoded; ///< 按片段顺序的转码输出
+  size_t remaining = 0;             ///< 尚未结束的片段任务
+  std::optional<FfmpegTaskResult> failure; ///< 第一个失败的片段结果
+};
+
+void ChunkEncodeService::initAndStart(const Json::Value &config) {
+  configServicePtr_ = drogon::app().getSharedPlugin<ConfigService>();
+  if (!configServicePtr_) {
+    LOG_FATAL << "Failed to get ConfigService plugin";
+    return;
+  }
+
+  converterServicePtr_ = drogon::app().getSharedPlugin<ConverterService>();
+  if (!converterServicePtr_) {
+    LOG_FATAL << "Failed to get ConverterService plugin";
+    return;
+  }
+
+  ffmpegTaskServicePtr_ = drogon::app().getSharedPlugin<FfmpegTaskService>();
+  if (!ffmpegTaskServicePtr_) {
+    LOG_FATAL << "Failed to get FfmpegTaskService plugin";
+    return;
+  }
+
+  mediaInfoServicePtr_ = drogon::app().getSharedPlugin<MediaInfoService>();
+  if (!mediaInfoServicePtr_) {
+    LOG_FATAL << "Failed to get MediaInfoService plugin";
+    return;
+  }
+
+  LOG_INFO << "ChunkEncodeService initialized";
+}
+
+void ChunkEncodeService::shutdown() {}
+
+bool ChunkEncodeService::submit(
+    const std::string &inputPath, const std::string &outputDir,
+    std::function<void(FfmpegTaskResult)> onComplete) {
+  int chunkMinutes = configServicePtr_->getConfig().ffmpeg.chunk_minutes;
+  if (chunkMinutes <= 0)
+    return false;
+  if (!configServicePtr_->getCompiledCommands()->chunkAudioOptions)
+    return false;
+
+  // 不足两段时分段没有收益，只多了切分和拼接
+  int chunkSeconds = chunkMinutes * 60;
+  int durationMs = mediaInfoServicePtr_->getDuration(inputPath);
+  if (durationMs < 0 || durationMs < 2 * chunkSeconds * 1000)
+    return false;
+
+  auto job = std::make_shared<Job>();
+  job->inputPath = inputPath;
+  job->outputDir = outputDir;
+  job->chunkDir =
+      (fs::path(outputDir) / (fs::path(inputPath).stem().string() + "_chunks"))
+          .string();
+  job->onComplete = std::move(onComplete);
+
+  LOG_INFO << "分段转码: " << inputPath << " (" << durationMs / 1000
+           << " 秒，每段 " << chunkSeconds << " 秒)";
+
+  ffmpegTaskServicePtr_->submitTask(
+      FfmpegTaskType::MERGE, {inputPath}, {job->chunkDir},
+      [this, job](FfmpegTaskResult result) { onSplit(job, result); }, nullptr,
+      [this, chunkSeconds](std::weak_ptr<FfmpegTaskProcDetail> item) {
+        auto detail = item.lock();
+        if (!detail)
+          return;
+        auto task = detail->getProcessResult();
+        auto hooks = makeHooks(item, detail);
+        live2mp3::utils::FfmpegExitInfo exitInfo;
+        auto chunks = converterServicePtr_->splitVideoAtKeyframes(
+            task.files[0], task.outputFiles[0], chunkSeconds, hooks.progress,
+            hooks.cancelCheck, hooks.pid, &exitInfo);
+        if (!chunks) {
+          detail->setOutputFiles({});
+          if (detail->isCancelled())
+            return;
+          throw FfmpegTaskError(failureKindOf(exitInfo),
+                                "分段失败: " + task.files[0] + " (" +
+                                    live2mp3::utils::describeFfmpegExit(
+                                        exitInfo) +
+                                    ")");
+        }
+        detail->setOutputFiles(*chunks);
+      });
+  return true;
+}
+
+void ChunkEncodeService::onSplit(const std::shared_ptr<Job> &job,
+                                 const FfmpegTaskResult &result) {
+  if (result.status != FfmpegTaskStatus::COMPLETED ||
+      result.outputFiles.empty()) {
+    fallback(job, result);
+    return;
+  }
+
+  const auto &chunks = result.outputFiles;
+  {
+    std::lock_guard<std::mutex> lock(job->mutex);
+    job->encoded.assign(chunks.size(), "");
+    job->remaining = chunks.size();
+  }
+  LOG_INFO << "分段完成: " << job->inputPath << " -> " << chunks.size()
+           << " 段，提交并行转码";
+
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    // 片段不含音频，不能追加片段 MP3 输出，因此不使用内置 ConvertMp4Task
+    ffmpegTaskServicePtr_->submitTask(
+        FfmpegTaskType::CONVERT_MP4, {chunks[i]}, {job->chunkDir},
+        [this, job, i](FfmpegTaskResult result) {
+          onChunkEncoded(job, i, result);
+        },
+        nullptr,
+        [this](std::weak_ptr<FfmpegTaskProcDetail> item) {
+          auto detail = item.lock();
+          if (!detail)
+            return;
+          auto task = detail->getProcessResult();
+          auto hooks = makeHooks(item, detail);
+          live2mp3::utils::FfmpegExitInfo exitInfo;
+          auto outputPath = converterServicePtr_->convertToAv1Mp4(
+              task.files[0], task.outputFiles[0], hooks.progress,
+              hooks.cancelCheck, hooks.pid, &exitInfo);
+          if (!outputPath) {
+            detail->setOutputFiles({});
+            if (detail->isCancelled())
+              return;
+            throw FfmpegTaskError(failureKindOf(exitInfo),
+                                  "片段转码失败: " + task.files[0] + " (" +
+                                      live2mp3::utils::describeFfmpegExit(
+                                          exitInfo) +
+                                      ")");
+          }
+          detail->setOutputFiles({*outputPath});
+        });
+  }
+}
+
+void ChunkEncodeService::onChunkEncoded(const std::shared_ptr<Job> &job,
+                                        size_t index,
+                                        const FfmpegTaskResult &result) {
+  std::vector<std::string> encoded;
+  std::optional<FfmpegTaskResult> failure;
+  {
+    std::lock_guard<std::mutex> lock(job->mutex);
+    if (result.status == FfmpegTaskStatus::COMPLETED &&
+        !result.outputFiles.empty()) {
+      job->encoded[index] = result.outputFiles[0];
+    } else if (!job->failure) {
+      job->failure = result;
+    }
+    if (--job->remaining > 0)
+      return;
+    encoded = job->encoded;
+    failure = job->failure;
+  }
+
+  // 所有片段任务都已结束（失败时也等其余片段结束，避免清理正在写入的目录）
+  if (failure) {
+    fallback(job, *failure);
+    return;
+  }
+
+  ffmpegTaskServicePtr_->submitTask(
+      FfmpegTaskType::MERGE, encoded, {job->outputDir},
+      [this, job](FfmpegTaskResult result) { onAssembled(job, result); },
+      nullptr,
+      [this, sourcePath = job->inputPath](
+          std::weak_ptr<FfmpegTaskProcDetail> item) {
+        auto detail = item.lock();
+        if (!detail)
+          return;
+        auto task = detail->getProcessResult();
+        auto hooks = makeHooks(item, detail);
+        live2mp3::utils::FfmpegExitInfo exitInfo;
+        auto outputPath = converterServicePtr_->assembleChunks(
+            task.files, sourcePath, task.outputFiles[0], hooks.progress,
+            hooks.cancelCheck, hooks.pid, &exitInfo);
+        if (!outputPath) {
+          detail->setOutputFiles({});
+          if (detail->isCancelled())
+            return;
+          throw FfmpegTaskError(failureKindOf(exitInfo),
+                                "分段拼接失败: " + sourcePath + " (" +
+                                    live2mp3::utils::describeFfmpegExit(
+                                        exitInfo) +
+                                    ")");
+        }
+        detail->setOutputFiles({*outputPath});
+      });
+}
+
+void ChunkEncodeService::onAssembled(const std::shared_ptr<Job> &job,
+                                     const FfmpegTaskResult &result) {
+  if (result.status != FfmpegTaskStatus::COMPLETED ||
+      result.outputFiles.empty()) {
+    fallback(job, result);
+    return;
+  }
+
+  std::error_code ec;
+  fs::remove_all(job->chunkDir, ec);
+
+  // 对调用方而言等同于一次整段 CONVERT_MP4
+  FfmpegTaskResult encoded = result;
+  encoded.type = FfmpegTaskType::CONVERT_MP4;
+  encoded.files = {job->inputPath};
+  if (job->onComplete) {
+    job->onComplete(encoded);
+  }
+}
+
+void ChunkEncodeService::fallback(const std::shared_ptr<Job> &job,
+                                  const FfmpegTaskResult &result) {
+  std::error_code ec;
+  fs::remove_all(job->chunkDir, ec);
+
+  if (result.failureKind == live2mp3::utils::FfmpegFailureKind::CANCELLED) {
+    LOG_INFO << "分段转码已取消: " << job->inputPath;
+    if (job->onComplete) {
+      job->onComplete(result);
+    }
+    return;
+  }
+
+  LOG_WARN << "分段转码失败，回退为整段转码: " << job->inputPath << " ("
+           << result.resultMessage << ")";
+  ffmpegTaskServicePtr_->submitTask(FfmpegTaskType::CONVERT_MP4,
+                                    {job->inputPath}, {job->outputDir},
+                                    job->onComplete);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "ConfigService.h"
+#include "ConverterService.h"
+#include "FfmpegTaskService.h"
+#include "MediaInfoService.h"
+#include <drogon/plugins/Plugin.h>
+#include <functional>
+#include <memory>
+#include <string>
+
+/**
+ * @brief 分段并行转码服务
+ *
+ * 单个长视频只能由一个 FFmpeg 进程转码，SVT-AV1 线程数增加到一定程度后
+ * 不再线性加速。开启 chunk_minutes 后，时长超过两段的视频按以下步骤处理：
+ * 1. MERGE 任务：按关键帧把视频流切成 chunk_minutes 分钟的片段（流复制）；
+ * 2. 每个片段一个 CONVERT_MP4 任务，在任务队列中与其他任务一起并行转码；
+ * 3. MERGE 任务：无损拼接转码后的片段，并从源文件一次性编码整段音频。
+ *
+ * 最终输出与整段转码相同（输出目录下同名文件），任一步骤失败时清理片段
+ * 并回退为整段 CONVERT_MP4；被取消时直接以取消结果结束。
+ */
+class ChunkEncodeService : public drogon::Plugin<ChunkEncodeService> {
+public:
+  ChunkEncodeService() = default;
+  ChunkEncodeService(const ChunkEncodeService &) = delete;
+  ChunkEncodeService &operator=(const ChunkEncodeService &) = delete;
+
+  void initAndStart(const Json::Value &config) override;
+  void shutdown() override;
+
+  /**
+   * @brief 以分段方式提交视频转码
+   *
+   * @param inputPath 源视频
+   * @param outputDir 输出目录（批次临时目录）
+   * @param onComplete 最终结果回调，语义与 CONVERT_MP4 任务的完成回调一致
+   * @return 未开启、时长不足两段或命令模板不支持时返回 false，
+   *         此时不会提交任何任务，由调用方按整段转码处理
+   */
+  bool submit(const std::string &inputPath, const std::string &outputDir,
+              std::function<void(FfmpegTaskResult)> onComplete);
+
+private:
+  struct Job;
+
+  void onSplit(const std::shared_ptr<Job> &job,
+               const FfmpegTaskResult &result);
+  void onChunkEncoded(const std::shared_ptr<Job> &job, size_t index,
+                      const FfmpegTaskResult &result);
+  void onAssembled(const std::shared_ptr<Job> &job,
+                   const FfmpegTaskResult &result);
+
+  /**
+   * @brief 分段流程无法完成：清理片段，取消时直接结束，否则整段转码
+   */
+  void fallback(const std::shared_ptr<Job> &job,
+                const FfmpegTaskResult &result);
+
+  std::shared_ptr<ConfigService> configServicePtr_;
+  std::shared_ptr<ConverterService> converterServicePtr_;
+  std::shared_ptr<FfmpegTaskService> ffmpegTaskServicePtr_;
+  std::shared_ptr<MediaInfoService> mediaInfoServicePtr_;
+};
@@ -43,7 +43,9 @@ void from_json(const json &j, VideoRootConfig &p) {
 }
 
 void to_json(json &j, const ScannerConfig &p) {
-  j = json{{"video_roots", p.video_roots}, {"extensions", p.extensions}};
+  j = json{{"video_roots", p.video_roots},
+           {"extensions", p.extensions},
+           {"scan_mode", p.scan_mode}};
 }
 
 void from_json(const json &j, ScannerConfig &p) {
@@ -51,6 +53,8 @@ void from_json(const json &j, ScannerConfig &p) {
     j.at("video_roots").get_to(p.video_roots);
   if (j.contains("extensions"))
     j.at("extensions").get_to(p.extensions);
+  if (j.contains("scan_mode"))
+    j.at("scan_mode").get_to(p.scan_mode);
 }
 
 void to_json(json &j, const OutputConfig &p) {
@@ -79,7 +83,13 @@ void to_json(json &j, const SchedulerConfig &p) {
            {"stop_waiting_seconds", p.stop_waiting_seconds},
            {"stability_checks", p.stability_checks},
            {"ffmpeg_worker_count", p.ffmpeg_worker_count},
-           {"ffmpeg_retry_count", p.ffmpeg_retry_count}};
+           {"ffmpeg_retry_count", p.ffmpeg_retry_count},
+           {"scan_fingerprint_workers", p.scan_fingerprint_workers},
+           {"scan_queue_size", p.scan_queue_size},
+           {"encode_ahead", p.encode_ahead},
+           {"follow_mode", p.follow_mode},
+           {"follow_extensions", p.follow_extensions},
+           {"follow_idle_seconds", p.follow_idle_seconds}};
 }
 
 void from_json(const json &j, SchedulerConfig &p) {
@@ -93,6 +103,18 @@ void from_json(const json &j, SchedulerConfig &p) {
     j.at("ffmpeg_worker_count").get_to(p.ffmpeg_worker_count);
   if (j.contains("ffmpeg_retry_count"))
     j.at("ffmpeg_retry_count").get_to(p.ffmpeg_retry_count);
+  if (j.contains("scan_fingerprint_workers"))
+    j.at("scan_fingerprint_workers").get_to(p.scan_fingerprint_workers);
+  if (j.contains("scan_queue_size"))
+    j.at("scan_queue_size").get_to(p.scan_queue_size);
+  if (j.contains("encode_ahead"))
+    j.at("encode_ahead").get_to(p.encode_ahead);
+  if (j.contains("follow_mode"))
+    j.at("follow_mode").get_to(p.follow_mode);
+  if (j.contains("follow_extensions"))
+    j.at("follow_extensions").get_to(p.follow_extensions);
+  if (j.contains("follow_idle_seconds"))
+    j.at("follow_idle_seconds").get_to(p.follow_idle_seconds);
 }
 
 void to_json(json &j, const TempConfig &p) {
@@ -109,7 +131,11 @@ void from_json(const json &j, TempConfig &p) {
 void to_json(json &j, const FfmpegConfig &p) {
   j = json{{"video_convert_command", p.video_convert_command},
            {"audio_convert_command", p.audio_convert_command},
-           {"merge_command", p.merge_command}};
+           {"merge_command", p.merge_command},
+           {"progress_pipe", p.progress_pipe},
+           {"single_pass_audio", p.single_pass_audio},
+           {"parallel_audio", p.parallel_audio},
+           {"chunk_minutes", p.chunk_minutes}};
 }
 
 void from_json(const json &j, FfmpegConfig &p) {
@@ -119,6 +145,14 @@ void from_json(const json &j, FfmpegConfig &p) {
     j.at("audio_convert_command").get_to(p.audio_convert_command);
   if (j.contains("merge_command"))
     j.at("merge_command").get_to(p.merge_command);
+  if (j.contains("progress_pipe"))
+    j.at("progress_pipe").get_to(p.progress_pipe);
+  if (j.contains("single_pass_audio"))
+    j.at("single_pass_audio").get_to(p.single_pass_audio);
+  if (j.contains("parallel_audio"))
+    j.at("parallel_audio").get_to(p.parallel_audio);
+  if (j.contains("chunk_minutes"))
+    j.at("chunk_minutes").get_to(p.chunk_minutes);
 }
 
 void to_json(json &j, const CommonThreadConfig &p) {
@@ -131,10 +165,61 @@ void from_json(const json &j, CommonThreadConfig &p) {
     j.at("name").get_to(p.name);
 }
 
+void to_json(json &j, const FfmpegLaneConfig &p) {
+  j = json{{"name", p.name},
+           {"maxConcurrent", p.maxConcurrent},
+           {"types", p.types}};
+}
+
+void from_json(const json &j, FfmpegLaneConfig &p) {
+  j.at("name").get_to(p.name);
+  if (j.contains("maxConcurrent"))
+    j.at("maxConcurrent").get_to(p.maxConcurrent);
+  if (j.contains("types"))
+    j.at("types").get_to(p.types);
+}
+
+void to_json(json &j, const FfmpegAdaptiveConfig &p) {
+  j = json{{"enabled", p.enabled},
+           {"lane", p.lane},
+           {"minConcurrent", p.minConcurrent},
+           {"maxConcurrent", p.maxConcurrent},
+           {"intervalSeconds", p.intervalSeconds},
+           {"cpuBusyHigh", p.cpuBusyHigh},
+           {"cpuPressureHigh", p.cpuPressureHigh},
+           {"ioPressureHigh", p.ioPressureHigh}};
+}
+
+void from_json(const json &j, FfmpegAdaptiveConfig &p) {
+  if (j.contains("enabled"))
+    j.at("enabled").get_to(p.enabled);
+  if (j.contains("lane"))
+    j.at("lane").get_to(p.lane);
+  if (j.contains("minConcurrent"))
+    j.at("minConcurrent").get_to(p.minConcurrent);
+  if (j.contains("maxConcurrent"))
+    j.at("maxConcurrent").get_to(p.maxConcurrent);
+  if (j.contains("intervalSeconds"))
+    j.at("intervalSeconds").get_to(p.intervalSeconds);
+  if (j.contains("cpuBusyHigh"))
+    j.at("cpuBusyHigh").get_to(p.cpuBusyHigh);
+  if (j.contains("cpuPressureHigh"))
+    j.at("cpuPressureHigh").get_to(p.cpuPressureHigh);
+  if (j.contains("ioPressureHigh"))
+    j.at("ioPressureHigh").get_to(p.ioPressureHigh);
+}
+
 void to_json(json &j, const FfmpegTaskConfig &p) {
   j = json{{"maxConcurrentTasks", p.maxConcurrentTasks},
            {"maxWaitingTasks", p.maxWaitingTasks},
-           {"taskTimeoutSeconds", p.taskTimeoutSeconds}};
+           {"taskTimeoutSeconds", p.taskTimeoutSeconds},
+           {"timeoutDurationFactor", p.timeoutDurationFactor},
+           {"stallTimeoutSeconds", p.stallTimeoutSeconds},
+           {"retryBackoffBaseSeconds", p.retryBackoffBaseSeconds},
+           {"retryBackoffMaxSeconds", p.retryBackoffMaxSeconds},
+           {"priorityAgingSeconds", p.priorityAgingSeconds},
+           {"lanes", p.lanes},
+           {"adaptive", p.adaptive}};
 }
 void from_json(const json &j, FfmpegTaskConfig &p) {
   if (j.contains("maxConcurrentTasks"))
@@ -143,6 +228,20 @@ void from_json(const json &j, FfmpegTaskConfig &p) {
     j.at("maxWaitingTasks").get_to(p.maxWaitingTasks);
   if (j.contains("taskTimeoutSeconds"))
     j.at("taskTimeoutSeconds").get_to(p.taskTimeoutSeconds);
+  if (j.contains("timeoutDurationFactor"))
+    j.at("timeoutDurationFactor").get_to(p.timeoutDurationFactor);
+  if (j.contains("stallTimeoutSeconds"))
+    j.at("stallTimeoutSeconds").get_to(p.stallTimeoutSeconds);
+  if (j.contains("retryBackoffBaseSeconds"))
+    j.at("retryBackoffBaseSeconds").get_to(p.retryBackoffBaseSeconds);
+  if (j.contains("retryBackoffMaxSeconds"))
+    j.at("retryBackoffMaxSeconds").get_to(p.retryBackoffMaxSeconds);
+  if (j.contains("priorityAgingSeconds"))
+    j.at("priorityAgingSeconds").get_to(p.priorityAgingSeconds);
+  if (j.contains("lanes"))
+    j.at("lanes").get_to(p.lanes);
+  if (j.contains("adaptive"))
+    j.at("adaptive").get_to(p.adaptive);
 }
 
 // ============================================================
@@ -176,6 +275,7 @@ static toml::array stringVecToTomlArray(const std::vector<std::string> &vec) {
 // ============================================================
 void ConfigService::loadConfig() {
   std::lock_guard<std::mutex> lock(configMutex_);
+  configVersion_++;
   auto lpPath = configPath_.get();
   try {
     toml::table tbl = toml::parse_file(*lpPath);
@@ -245,6 +345,8 @@ void ConfigService::loadConfig() {
 
       currentConfig_.scanner.extensions =
           tomlArrayToStringVec((*scanner)["extensions"].as_array());
+      currentConfig_.scanner.scan_mode =
+          (*scanner)["scan_mode"].value_or(std::string("poll"));
     }
 
     // Output config
@@ -269,6 +371,19 @@ void ConfigService::loadConfig() {
           (*scheduler)["ffmpeg_worker_count"].value_or(4);
       currentConfig_.scheduler.ffmpeg_retry_count =
           (*scheduler)["ffmpeg_retry_count"].value_or(3);
+      currentConfig_.scheduler.scan_fingerprint_workers =
+          (*scheduler)["scan_fingerprint_workers"].value_or(4);
+      currentConfig_.scheduler.scan_queue_size =
+          (*scheduler)["scan_queue_size"].value_or(256);
+      currentConfig_.scheduler.encode_ahead =
+          (*scheduler)["encode_ahead"].value_or(true);
+      currentConfig_.scheduler.follow_mode =
+          (*scheduler)["follow_mode"].value_or(false);
+      if (auto arr = (*scheduler)["follow_extensions"].as_array()) {
+        currentConfig_.scheduler.follow_extensions = tomlArrayToStringVec(arr);
+      }
+      currentConfig_.scheduler.follow_idle_seconds =
+          (*scheduler)["follow_idle_seconds"].value_or(60);
     }
 
     // Temp config
@@ -281,17 +396,39 @@ void ConfigService::loadConfig() {
 
     // Ffmpeg config
     if (auto ffmpeg = tbl["ffmpeg"].as_table()) {
-      currentConfig_.ffmpeg.video_convert_command =
-          (*ffmpeg)["video_convert_command"].value_or(
-              std::string("ffmpeg -y -i \"{input}\" -c:v libsvtav1 -crf 30 "
-                          "-preset 6 -c:a aac -b:a 128k \"{output}\" 2>&1"));
+      // 命令既可以是字符串，也可以是 argv 数组（数组转为等价的字符串保存）
+      auto readCommand = [&ffmpeg](const char *key, std::string fallback) {
+        if (auto arr = (*ffmpeg)[key].as_array()) {
+          std::vector<std::string> argv;
+          for (const auto &el : *arr) {
+            if (auto v = el.value<std::string>())
+              argv.push_back(*v);
+          }
+          return live2mp3::utils::formatArgv(argv);
+        }
+        return (*ffmpeg)[key].value_or(std::move(fallback));
+      };
+
+      currentConfig_.ffmpeg.video_convert_command = readCommand(
+          "video_convert_command",
+          "ffmpeg -y -i \"{input}\" -c:v libsvtav1 -crf 30 "
+          "-preset 6 -c:a aac -b:a 128k \"{output}\" 2>&1");
       currentConfig_.ffmpeg.audio_convert_command =
-          (*ffmpeg)["audio_convert_command"].value_or(std::string(
-              "ffmpeg -y -i \"{input}\" -vn -acodec libmp3lame -q:a 2 "
-              "\"{output}\" 2>&1"));
-      currentConfig_.ffmpeg.merge_command = (*ffmpeg)["merge_command"].value_or(
-          std::string("ffmpeg -f concat -safe 0 -i \"{input}\" -c copy -y "
-                      "\"{output}\" 2>&1"));
+          readCommand("audio_convert_command",
+                      "ffmpeg -y -i \"{input}\" -vn -acodec libmp3lame -q:a 2 "
+                      "\"{output}\" 2>&1");
+      currentConfig_.ffmpeg.merge_command =
+          readCommand("merge_command",
+                      "ffmpeg -f concat -safe 0 -i \"{input}\" -c copy -y "
+                      "\"{output}\" 2>&1");
+      currentConfig_.ffmpeg.progress_pipe =
+          (*ffmpeg)["progress_pipe"].value_or(true);
+      currentConfig_.ffmpeg.single_pass_audio =
+          (*ffmpeg)["single_pass_audio"].value_or(true);
+      currentConfig_.ffmpeg.parallel_audio =
+          (*ffmpeg)["parallel_audio"].value_or(false);
+      currentConfig_.ffmpeg.chunk_minutes =
+          (*ffmpeg)["chunk_minutes"].value_or(0);
 
       // Validation: Check for {input} and {output} placeholders
       auto validateCommand = [](std::string &cmd, const std::string &defaultCmd,
@@ -360,6 +497,42 @@ void ConfigService::loadConfig() {
           (*ft)["maxWaitingTasks"].value_or(10000);
       currentConfig_.ffmpeg_task.taskTimeoutSeconds =
           (*ft)["taskTimeoutSeconds"].value_or(600);
+      currentConfig_.ffmpeg_task.timeoutDurationFactor =
+          (*ft)["timeoutDurationFactor"].value_or(4.0);
+      currentConfig_.ffmpeg_task.stallTimeoutSeconds =
+          (*ft)["stallTimeoutSeconds"].value_or(180);
+      currentConfig_.ffmpeg_task.retryBackoffBaseSeconds =
+          (*ft)["retryBackoffBaseSeconds"].value_or(30);
+      currentConfig_.ffmpeg_task.retryBackoffMaxSeconds =
+          (*ft)["retryBackoffMaxSeconds"].value_or(600);
+      currentConfig_.ffmpeg_task.priorityAgingSeconds =
+          (*ft)["priorityAgingSeconds"].value_or(600);
+
+      currentConfig_.ffmpeg_task.lanes.clear();
+      if (auto lanesArr = (*ft)["lanes"].as_array()) {
+        for (const auto &elem : *lanesArr) {
+          if (auto laneTbl = elem.as_table()) {
+            FfmpegLaneConfig lane;
+            lane.name = (*laneTbl)["name"].value_or(std::string(""));
+            lane.maxConcurrent = (*laneTbl)["maxConcurrent"].value_or(1);
+            lane.types = tomlArrayToStringVec((*laneTbl)["types"].as_array());
+            currentConfig_.ffmpeg_task.lanes.push_back(lane);
+          }
+        }
+      }
+
+      auto &adaptive = currentConfig_.ffmpeg_task.adaptive;
+      adaptive = FfmpegAdaptiveConfig{};
+      if (auto ad = (*ft)["adaptive"].as_table()) {
+        adaptive.enabled = (*ad)["enabled"].value_or(false);
+        adaptive.lane = (*ad)["lane"].value_or(std::string("default"));
+        adaptive.minConcurrent = (*ad)["minConcurrent"].value_or(1);
+        adaptive.maxConcurrent = (*ad)["maxConcurrent"].value_or(4);
+        adaptive.intervalSeconds = (*ad)["intervalSeconds"].value_or(15);
+        adaptive.cpuBusyHigh = (*ad)["cpuBusyHigh"].value_or(0.9);
+        adaptive.cpuPressureHigh = (*ad)["cpuPressureHigh"].value_or(25.0);
+        adaptive.ioPressureHigh = (*ad)["ioPressureHigh"].value_or(40.0);
+      }
     }
 
     // Server port (optional in user config)
@@ -419,7 +592,8 @@ void ConfigService::saveConfig() {
         "scanner",
         toml::table{{"video_roots", rootsArr},
                     {"extensions",
-                     stringVecToTomlArray(currentConfig_.scanner.extensions)}});
+                     stringVecToTomlArray(currentConfig_.scanner.extensions)},
+                    {"scan_mode", currentConfig_.scanner.scan_mode}});
 
     // Output section
     tbl.insert_or_assign(
@@ -441,7 +615,16 @@ void ConfigService::saveConfig() {
             {"ffmpeg_worker_count",
              currentConfig_.scheduler.ffmpeg_worker_count},
             {"ffmpeg_retry_count",
-             currentConfig_.scheduler.ffmpeg_retry_count}});
+             currentConfig_.scheduler.ffmpeg_retry_count},
+            {"scan_fingerprint_workers",
+             currentConfig_.scheduler.scan_fingerprint_workers},
+            {"scan_queue_size", currentConfig_.scheduler.scan_queue_size},
+            {"encode_ahead", currentConfig_.scheduler.encode_ahead},
+            {"follow_mode", currentConfig_.scheduler.follow_mode},
+            {"follow_extensions",
+             stringVecToTomlArray(currentConfig_.scheduler.follow_extensions)},
+            {"follow_idle_seconds",
+             currentConfig_.scheduler.follow_idle_seconds}});
 
     // Temp section
     tbl.insert_or_assign(
@@ -456,7 +639,12 @@ void ConfigService::saveConfig() {
                      currentConfig_.ffmpeg.video_convert_command},
                     {"audio_convert_command",
                      currentConfig_.ffmpeg.audio_convert_command},
-                    {"merge_command", currentConfig_.ffmpeg.merge_command}});
+                    {"merge_command", currentConfig_.ffmpeg.merge_command},
+                    {"progress_pipe", currentConfig_.ffmpeg.progress_pipe},
+                    {"single_pass_audio",
+                     currentConfig_.ffmpeg.single_pass_audio},
+                    {"parallel_audio", currentConfig_.ffmpeg.parallel_audio},
+                    {"chunk_minutes", currentConfig_.ffmpeg.chunk_minutes}});
 
     // CommonThread section
     tbl.insert_or_assign(
@@ -465,6 +653,16 @@ void ConfigService::saveConfig() {
                     {"name", currentConfig_.common_thread.name}});
 
     // FfmpegTask section
+    const auto &adaptive = currentConfig_.ffmpeg_task.adaptive;
+    toml::array lanesArr;
+    for (const auto &lane : currentConfig_.ffmpeg_task.lanes) {
+      toml::table laneTable;
+      laneTable.insert("name", lane.name);
+      laneTable.insert("maxConcurrent", lane.maxConcurrent);
+      laneTable.insert("types", stringVecToTomlArray(lane.types));
+      lanesArr.push_back(laneTable);
+    }
+
     tbl.insert_or_assign(
         "ffmpeg_task",
         toml::table{
@@ -472,7 +670,28 @@ void ConfigService::saveConfig() {
              currentConfig_.ffmpeg_task.maxConcurrentTasks},
             {"maxWaitingTasks", currentConfig_.ffmpeg_task.maxWaitingTasks},
             {"taskTimeoutSeconds",
-             currentConfig_.ffmpeg_task.taskTimeoutSeconds}});
+             currentConfig_.ffmpeg_task.taskTimeoutSeconds},
+            {"timeoutDurationFactor",
+             currentConfig_.ffmpeg_task.timeoutDurationFactor},
+            {"stallTimeoutSeconds",
+             currentConfig_.ffmpeg_task.stallTimeoutSeconds},
+            {"retryBackoffBaseSeconds",
+             currentConfig_.ffmpeg_task.retryBackoffBaseSeconds},
+            {"retryBackoffMaxSeconds",
+             currentConfig_.ffmpeg_task.retryBackoffMaxSeconds},
+            {"priorityAgingSeconds",
+             currentConfig_.ffmpeg_task.priorityAgingSeconds},
+            {"lanes", lanesArr},
+            {"adaptive",
+             toml::table{
+                 {"enabled", adaptive.enabled},
+                 {"lane", adaptive.lane},
+                 {"minConcurrent", adaptive.minConcurrent},
+                 {"maxConcurrent", adaptive.maxConcurrent},
+                 {"intervalSeconds", adaptive.intervalSeconds},
+                 {"cpuBusyHigh", adaptive.cpuBusyHigh},
+                 {"cpuPressureHigh", adaptive.cpuPressureHigh},
+                 {"ioPressureHigh", adaptive.ioPressureHigh}}}});
 
     // Server port
     tbl.insert("server_port", currentConfig_.server_port);
@@ -500,6 +719,58 @@ AppConfig ConfigService::getConfig() {
 void ConfigService::updateConfig(const AppConfig &newConfig) {
   std::lock_guard<std::mutex> lock(configMutex_);
   currentConfig_ = newConfig;
+  configVersion_++;
+}
+
+uint64_t ConfigService::getConfigVersion() const {
+  std::lock_guard<std::mutex> lock(configMutex_);
+  return configVersion_;
+}
+
+live2mp3::utils::RuleSet
+ConfigService::compileRuleSet(const std::vector<FilterRule> &rules,
+                              const std::string &mode) {
+  std::vector<live2mp3::utils::RuleSet::Rule> specs;
+  specs.reserve(rules.size());
+  for (const auto &rule : rules) {
+    specs.push_back({rule.type, rule.pattern});
+  }
+  return live2mp3::utils::RuleSet(specs, mode == "whitelist");
+}
+
+std::shared_ptr<const live2mp3::utils::CompiledRules>
+ConfigService::getCompiledRules() {
+  std::lock_guard<std::mutex> lock(configMutex_);
+  if (!compiledRules_ || compiledRulesVersion_ != configVersion_) {
+    std::vector<live2mp3::utils::RootRuleSet> roots;
+    roots.reserve(currentConfig_.scanner.video_roots.size());
+    for (const auto &root : currentConfig_.scanner.video_roots) {
+      live2mp3::utils::RootRuleSet rootRules;
+      rootRules.rootPath = root.path;
+      rootRules.filter = compileRuleSet(root.rules, root.filter_mode);
+      rootRules.deletion = compileRuleSet(root.delete_rules, root.delete_mode);
+      rootRules.enableDelete = root.enable_delete;
+      roots.push_back(std::move(rootRules));
+    }
+    compiledRules_ =
+        std::make_shared<const live2mp3::utils::CompiledRules>(std::move(roots));
+    compiledRulesVersion_ = configVersion_;
+  }
+  return compiledRules_;
+}
+
+std::shared_ptr<const live2mp3::utils::CompiledCommands>
+ConfigService::getCompiledCommands() {
+  std::lock_guard<std::mutex> lock(configMutex_);
+  if (!compiledCommands_ || compiledCommandsVersion_ != configVersion_) {
+    compiledCommands_ =
+        std::make_shared<const live2mp3::utils::CompiledCommands>(
+            currentConfig_.ffmpeg.video_convert_command,
+            currentConfig_.ffmpeg.audio_convert_command,
+            currentConfig_.ffmpeg.merge_command);
+    compiledCommandsVersion_ = configVersion_;
+  }
+  return compiledCommands_;
 }
 
 // ============================================================
@@ -1,7 +1,11 @@
 #pragma once
 
+#include "utils/CommandTemplate.h"
+#include "utils/RuleSet.h"
 #include "utils/ThreadSafe.hpp"
+#include <cstdint>
 #include <drogon/drogon.h>
+#include <memory>
 #include <mutex>
 #include <nlohmann/json.hpp>
 #include <string>
@@ -36,6 +40,7 @@ struct VideoRootConfig {
 struct ScannerConfig {
   std::vector<VideoRootConfig> video_roots; // 视频根目录列表
   std::vector<std::string> extensions;      // 关心的文件扩展名
+  std::string scan_mode = "poll"; // "poll"(定期全量遍历), "watch"(inotify 监听)
 };
 
 /**
@@ -59,6 +64,12 @@ struct SchedulerConfig {
   int stability_checks = 2;    // 稳定性检查次数(连续MD5一致次数)
   int ffmpeg_worker_count = 4; // FFmpeg 并发 Worker 数量
   int ffmpeg_retry_count = 3;  // FFmpeg 任务重试次数（适用于所有FFmpeg任务）
+  int scan_fingerprint_workers = 4; // 稳定性扫描中并行计算指纹的 Worker 数量
+  int scan_queue_size = 256; // 扫描流水线各阶段之间的队列容量
+  bool encode_ahead = true; // 片段稳定即转码，只有合并等待 stop_waiting_seconds
+  bool follow_mode = false;  // 边录边转：跟随仍在写入的文件转码
+  std::vector<std::string> follow_extensions = {".flv", ".ts"}; // 可跟随的容器
+  int follow_idle_seconds = 60; // 跟随时文件多久未增长视为写完
 };
 
 /**
@@ -76,6 +87,10 @@ struct FfmpegConfig {
   std::string video_convert_command;
   std::string audio_convert_command;
   std::string merge_command;
+  bool progress_pipe = true; // 注入 -progress pipe:3 -nostats，进度走独立管道
+  bool single_pass_audio = true; // 转码时同时输出片段 MP3，最终 MP3 直接拼接
+  bool parallel_audio = false; // 片段稳定后立即并行提取 MP3，流结束后即拼接
+  int chunk_minutes = 0; // 长视频按关键帧切成 N 分钟并行转码后拼接，0 关闭
 };
 
 /**
@@ -86,13 +101,50 @@ struct CommonThreadConfig {
   std::string name = "CommonThreadPool";
 };
 
+/**
+ * @brief FFmpeg 任务通道（lane）配置
+ *
+ * 每个通道有独立的并发上限，types 中列出的任务类型进入该通道；
+ * 未被任何通道认领的类型进入默认通道（并发上限为 maxConcurrentTasks）。
+ */
+struct FfmpegLaneConfig {
+  std::string name;
+  int maxConcurrent = 1;
+  std::vector<std::string> types; // "convert_mp4", "convert_mp3", "merge", "other", "follow_mp4"
+};
+
+/**
+ * @brief FFmpeg 自适应并发配置（AIMD）
+ *
+ * 启用后按 intervalSeconds 采样系统负载，调整 lane 的并发上限：
+ * 压力超限时减半，队列积压且 CPU 有余量时加一；
+ * 加一后整体转码速度没有提升则退回。
+ */
+struct FfmpegAdaptiveConfig {
+  bool enabled = false;
+  std::string lane = "default"; // 受控的 lane 名称
+  int minConcurrent = 1;
+  int maxConcurrent = 4;
+  int intervalSeconds = 15;
+  double cpuBusyHigh = 0.9;      // CPU 忙碌比例上限 (0-1)，超过后不再加并发
+  double cpuPressureHigh = 25.0; // /proc/pressure/cpu some avg10 上限 (%)
+  double ioPressureHigh = 40.0;  // /proc/pressure/io some avg10 上限 (%)
+};
+
 /**
  * @brief FfmpegTaskService 配置结构体
  */
 struct FfmpegTaskConfig {
   int maxConcurrentTasks = 2;
   int maxWaitingTasks = 10000;
-  int taskTimeoutSeconds = 600;
+  int taskTimeoutSeconds = 600;      ///< 单个任务的基础墙钟预算（秒）
+  double timeoutDurationFactor = 4.0; ///< 每秒输入时长追加的预算（秒）
+  int stallTimeoutSeconds = 180;      ///< FFmpeg 进度停滞多久视为卡死（秒）
+  int retryBackoffBaseSeconds = 30;   ///< 首次重试的退避时长（秒）
+  int retryBackoffMaxSeconds = 600;   ///< 退避时长上限（秒）
+  int priorityAgingSeconds = 600; ///< 排队每满该秒数优先级提升一级，<=0 不老化
+  std::vector<FfmpegLaneConfig> lanes; ///< 额外的任务通道
+  FfmpegAdaptiveConfig adaptive;       ///< 自适应并发
 };
 
 /**
@@ -126,6 +178,10 @@ void to_json(nlohmann::json &j, const FfmpegConfig &p);
 void from_json(const nlohmann::json &j, FfmpegConfig &p);
 void to_json(nlohmann::json &j, const CommonThreadConfig &p);
 void from_json(const nlohmann::json &j, CommonThreadConfig &p);
+void to_json(nlohmann::json &j, const FfmpegLaneConfig &p);
+void from_json(const nlohmann::json &j, FfmpegLaneConfig &p);
+void to_json(nlohmann::json &j, const FfmpegAdaptiveConfig &p);
+void from_json(const nlohmann::json &j, FfmpegAdaptiveConfig &p);
 void to_json(nlohmann::json &j, const FfmpegTaskConfig &p);
 void from_json(const nlohmann::json &j, FfmpegTaskConfig &p);
 
@@ -173,6 +229,37 @@ public:
    */
   void updateConfig(const AppConfig &newConfig);
 
+  /**
+   * @brief 获取配置版本号，每次加载或更新配置后递增
+   */
+  uint64_t getConfigVersion() const;
+
+  /**
+   * @brief 获取当前配置对应的已编译过滤规则
+   *
+   * 每个配置版本只编译一次，扫描器、转换器和文件浏览共享同一份结果。
+   *
+   * @return std::shared_ptr<const live2mp3::utils::CompiledRules> 只读规则
+   */
+  std::shared_ptr<const live2mp3::utils::CompiledRules> getCompiledRules();
+
+  /**
+   * @brief 把配置中的规则列表编译为 RuleSet
+   *
+   * @param rules 规则列表
+   * @param mode "whitelist" 或 "blacklist"
+   */
+  static live2mp3::utils::RuleSet
+  compileRuleSet(const std::vector<FilterRule> &rules, const std::string &mode);
+
+  /**
+   * @brief 获取当前配置对应的已分词 FFmpeg 命令模板
+   *
+   * 每个配置版本只分词一次，转换器和合并器直接填充占位符后 posix_spawn。
+   */
+  std::shared_ptr<const live2mp3::utils::CompiledCommands>
+  getCompiledCommands();
+
   /**
    * @brief 序列化配置为JSON
    *
@@ -183,6 +270,15 @@ public:
 private:
   mutable std::mutex configMutex_;
   AppConfig currentConfig_;
+  uint64_t configVersion_ = 0;
+
+  // 已编译规则缓存（受 configMutex_ 保护）
+  std::shared_ptr<const live2mp3::utils::CompiledRules> compiledRules_;
+  uint64_t compiledRulesVersion_ = 0;
+
+  // 已分词命令模板缓存（受 configMutex_ 保护）
+  std::shared_ptr<const live2mp3::utils::CompiledCommands> compiledCommands_;
+  uint64_t compiledCommandsVersion_ = 0;
 
   // 线程安全的配置路径管理，从本地加载的文件路径
   live2mp3::utils::ThreadSafeString configPath_;
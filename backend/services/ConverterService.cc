@@ -2,54 +2,14 @@
 #include "../utils/FfmpegUtils.h"
 #include "../utils/FileUtils.h"
 #include "PendingFileService.h"
+#include <algorithm>
 #include <drogon/drogon.h>
 #include <filesystem>
-#include <fmt/format.h>
-#include <regex>
+#include <fstream>
+#include <memory>
 
 namespace fs = std::filesystem;
 
-// Helper for Glob matching (same as ScannerService)
-static bool globMatch(const std::string &str, const std::string &pattern) {
-  std::string reStr;
-  for (size_t i = 0; i < pattern.size(); ++i) {
-    char c = pattern[i];
-    if (c == '*')
-      reStr += ".*";
-    else if (c == '?')
-      reStr += ".";
-    else if (std::string(".^+|{}()[]\\").find(c) != std::string::npos) {
-      reStr += "\\";
-      reStr += c;
-    } else {
-      reStr += c;
-    }
-  }
-  try {
-    std::regex re(reStr);
-    return std::regex_match(str, re);
-  } catch (...) {
-    return false;
-  }
-}
-
-static bool checkDeleteRule(const std::string &subDirName,
-                            const FilterRule &rule) {
-  if (rule.type == "exact") {
-    return subDirName == rule.pattern;
-  } else if (rule.type == "regex") {
-    try {
-      std::regex re(rule.pattern);
-      return std::regex_search(subDirName, re);
-    } catch (...) {
-      return false;
-    }
-  } else if (rule.type == "glob") {
-    return globMatch(subDirName, rule.pattern);
-  }
-  return false;
-}
-
 std::optional<std::string>
 ConverterService::convertToMp3(const std::string &inputPath,
                                live2mp3::utils::CancelCheckCallback cancelCheck,
@@ -62,7 +22,8 @@ ConverterService::convertToMp3(const std::string &inputPath,
     return std::nullopt;
   }
 
-  if (pendingFileServicePtr->isProcessed(fingerprint)) {
+  // 兼容升级前按旧版指纹记录的已处理文件
+  if (pendingFileServicePtr->isFileProcessed(inputPath, fingerprint)) {
     LOG_INFO << "文件已处理 (fingerprint match): " << inputPath;
     return std::nullopt; // Or return existing path if we knew it? For now
                          // nullopt implies "nothing done"
@@ -81,35 +42,39 @@ ConverterService::convertToMp3(const std::string &inputPath,
     return std::nullopt;
   }
 
-  std::string cmd = fmt::format(
-      "ffmpeg -y -i \"{}\" -vn -acodec libmp3lame -q:a 2 \"{}\" 2>&1",
-      inputPath, outputPath);
+  std::vector<std::string> argv = {
+      "ffmpeg", "-y", "-i", inputPath, "-vn", "-acodec", "libmp3lame",
+      "-q:a",   "2",  outputPath};
+  if (config.ffmpeg.progress_pipe) {
+    argv = live2mp3::utils::withProgressPipe(std::move(argv));
+  }
 
-  LOG_INFO << "Starting conversion: " << cmd;
+  LOG_INFO << "Starting conversion: " << live2mp3::utils::formatArgv(argv);
 
   // 获取输入文件时长用于计算进度百分比
-  int totalDuration = live2mp3::utils::getMediaDuration(inputPath);
+  int totalDuration = mediaInfoServicePtr->getDuration(inputPath, fingerprint);
   if (totalDuration < 0) {
     totalDuration = 0;
   }
 
   if (live2mp3::utils::runFfmpegWithProgress(
-          cmd, nullptr, totalDuration, cancelCheck, nullptr, pidCallback)) {
+          argv, nullptr, totalDuration, cancelCheck, nullptr, pidCallback)) {
     LOG_INFO << "Conversion successful: " << outputPath;
 
     // Handle source file deletion based on per-root settings
     bool shouldDelete = false;
 
     // Find which root this file belongs to
-    for (const auto &rootConfig : config.scanner.video_roots) {
-      fs::path rootPath(rootConfig.path);
+    auto rules = configServicePtr->getCompiledRules();
+    for (const auto &rootRules : rules->roots()) {
+      fs::path rootPath(rootRules.rootPath);
       fs::path inputP(inputPath);
 
       // Check if inputPath is under this root
       auto rel = fs::relative(inputP, rootPath);
       if (!rel.empty() && rel.native()[0] != '.') {
         // File is under this root
-        if (!rootConfig.enable_delete) {
+        if (!rootRules.enableDelete) {
           // Deletion not enabled for this root
           shouldDelete = false;
           break;
@@ -129,27 +94,8 @@ ConverterService::convertToMp3(const std::string &inputPath,
         }
 
         // Apply delete rules
-        bool isWhitelist = (rootConfig.delete_mode == "whitelist");
-
-        if (rootConfig.delete_rules.empty()) {
-          // Empty whitelist = delete nothing, Empty blacklist = delete all
-          shouldDelete = !isWhitelist;
-        } else {
-          bool ruleMatched = false;
-          for (const auto &rule : rootConfig.delete_rules) {
-            if (checkDeleteRule(firstDir, rule)) {
-              ruleMatched = true;
-              break;
-            }
-          }
-
-          if (isWhitelist) {
-            shouldDelete = ruleMatched; // Delete only matched
-          } else {
-            shouldDelete = !ruleMatched; // Delete all except matched (blacklist
-                                         // = keep these)
-          }
-        }
+        // Empty whitelist = delete nothing, Empty blacklist = delete all
+        shouldDelete = rootRules.deletion.allows(firstDir);
         break; // Found the root, done
       }
     }
@@ -217,8 +163,16 @@ std::optional<std::string> ConverterService::convertToAv1Mp4(
     const std::string &inputPath, const std::string &outputDir,
     live2mp3::utils::FfmpegProgressCallback progressCallback,
     live2mp3::utils::CancelCheckCallback cancelCheck,
-    std::function<void(pid_t)> pidCallback) {
+    std::function<void(pid_t)> pidCallback,
+    live2mp3::utils::FfmpegExitInfo *exitInfo, std::string *audioPath,
+    live2mp3::utils::FileTailer::Result *follow) {
   auto config = configServicePtr->getConfig();
+  if (audioPath) {
+    audioPath->clear();
+  }
+  if (follow) {
+    *follow = live2mp3::utils::FileTailer::Result{};
+  }
 
   // 确定输出路径
   std::string outputPath;
@@ -251,41 +205,81 @@ std::optional<std::string> ConverterService::convertToAv1Mp4(
     return std::nullopt;
   }
 
-  // FFmpeg 命令：使用配置中的命令模板
+  // FFmpeg 命令：使用配置中的命令模板（加载时已分词）
   // 先输出到临时文件
-  std::string cmdTemplate = config.ffmpeg.video_convert_command;
-  std::string cmd;
+  auto commands = configServicePtr->getCompiledCommands();
+  std::vector<std::string> argv;
   try {
-    cmd = fmt::format(fmt::runtime(cmdTemplate), fmt::arg("input", inputPath),
-                      fmt::arg("output", writingPath));
-    // Check if redirect is already in template, if not add it?
-    // User template usually doesn't include 2>&1, but our default did.
-    // The default in ConfigService includes 2>&1.
-    // If user removes it, we might lose logs.
-    // But we should follow the config.
+    // 边录边转：从 stdin 读取跟随管道
+    argv = commands->videoConvert.render(follow ? "pipe:0" : inputPath,
+                                         writingPath);
+    if (config.ffmpeg.progress_pipe) {
+      argv = live2mp3::utils::withProgressPipe(std::move(argv));
+    }
   } catch (const std::exception &e) {
     LOG_ERROR << "Failed to format video convert command: " << e.what();
     return std::nullopt;
   }
 
+  // 单次解码：在同一条命令末尾追加 MP3 输出，省去之后对合并视频的再次解码
+  std::string audioOutputPath;
+  std::string audioWritingPath;
+  // 并行提取模式下片段 MP3 已由独立任务写入同一路径
+  if (audioPath && config.ffmpeg.single_pass_audio &&
+      !config.ffmpeg.parallel_audio && commands->audioOutputOptions) {
+    audioOutputPath = sidecarAudioPath(outputPath);
+    fs::path audioFsPath(audioOutputPath);
+    audioWritingPath =
+        (audioFsPath.parent_path() / (audioFsPath.stem().string() + "_writing" +
+                                      audioFsPath.extension().string()))
+            .string();
+    std::error_code ec;
+    fs::remove(audioWritingPath, ec); // 模板没有 -y 时避免覆盖确认
+    argv.insert(argv.end(), commands->audioOutputOptions->begin(),
+                commands->audioOutputOptions->end());
+    argv.push_back(audioWritingPath);
+  }
+
   LOG_INFO << "开始 AV1 转换: " << inputPath << " -> " << writingPath
-           << " (临时文件)";
+           << (audioWritingPath.empty() ? "" : " + " + audioWritingPath)
+           << (follow ? " (跟随写入, 临时文件)" : " (临时文件)");
 
-  // 获取输入文件时长用于计算进度百分比
-  int totalDuration = live2mp3::utils::getMediaDuration(inputPath);
+  // 获取输入文件时长用于计算进度百分比（跟随时文件仍在增长，时长未知）
+  int totalDuration = follow ? 0 : mediaInfoServicePtr->getDuration(inputPath);
   if (totalDuration < 0) {
     LOG_WARN << "无法获取媒体时长，进度百分比将不可用: " << inputPath;
     totalDuration = 0;
   }
 
-  if (live2mp3::utils::runFfmpegWithProgress(cmd, progressCallback,
-                                             totalDuration, cancelCheck,
-                                             nullptr, pidCallback)) {
+  std::unique_ptr<live2mp3::utils::FileTailer> tailer;
+  int stdinFd = -1;
+  if (follow) {
+    tailer = std::make_unique<live2mp3::utils::FileTailer>(
+        inputPath, config.scheduler.follow_idle_seconds);
+    stdinFd = tailer->start();
+    if (stdinFd < 0) {
+      return std::nullopt;
+    }
+  }
+
+  bool success = live2mp3::utils::runFfmpegWithProgress(
+      argv, progressCallback, totalDuration, cancelCheck, nullptr, pidCallback,
+      exitInfo, stdinFd);
+  if (tailer) {
+    // FFmpeg 已退出：未读完时停止跟随；只有读到结束条件的结果才完整
+    tailer->stop();
+    *follow = tailer->finish();
+    if (success && !follow->ok) {
+      LOG_ERROR << "跟随中断，输出不完整: " << inputPath;
+      success = false;
+    }
+  }
+
+  if (success) {
     // 转换成功，重命名为最终文件名
     try {
       fs::rename(writingPath, outputPath);
       LOG_INFO << "AV1 转换成功: " << outputPath;
-      return outputPath;
     } catch (const fs::filesystem_error &e) {
       LOG_ERROR << "重命名文件失败: " << writingPath << " -> " << outputPath
                 << ", 错误: " << e.what();
@@ -293,23 +287,204 @@ std::optional<std::string> ConverterService::convertToAv1Mp4(
       if (fs::exists(writingPath)) {
         fs::remove(writingPath);
       }
+      std::error_code ec;
+      fs::remove(audioWritingPath, ec);
       return std::nullopt;
     }
+
+    // 片段 MP3 失败不影响视频结果，合并阶段会回退为单独提取
+    if (!audioWritingPath.empty()) {
+      std::error_code ec;
+      fs::rename(audioWritingPath, audioOutputPath, ec);
+      if (ec) {
+        LOG_WARN << "片段 MP3 重命名失败: " << audioWritingPath << ", 错误: "
+                 << ec.message();
+        fs::remove(audioWritingPath, ec);
+      } else {
+        *audioPath = audioOutputPath;
+      }
+    }
+    return outputPath;
   } else {
     LOG_ERROR << "AV1 转换失败: " << inputPath;
     // 清理失败的临时文件
     if (fs::exists(writingPath)) {
       fs::remove(writingPath);
     }
+    std::error_code ec;
+    fs::remove(audioWritingPath, ec);
+    return std::nullopt;
+  }
+}
+
+std::string ConverterService::sidecarAudioPath(const std::string &videoPath) {
+  auto config = configServicePtr->getConfig();
+  return fs::path(videoPath)
+      .replace_extension(config.output.audio_extension)
+      .string();
+}
+
+std::optional<std::vector<std::string>> ConverterService::splitVideoAtKeyframes(
+    const std::string &inputPath, const std::string &chunkDir,
+    int chunkSeconds, live2mp3::utils::FfmpegProgressCallback progressCallback,
+    live2mp3::utils::CancelCheckCallback cancelCheck,
+    std::function<void(pid_t)> pidCallback,
+    live2mp3::utils::FfmpegExitInfo *exitInfo) {
+  auto config = configServicePtr->getConfig();
+  auto commands = configServicePtr->getCompiledCommands();
+  std::string program = commands->videoConvert.program();
+  if (program.empty()) {
+    LOG_ERROR << "视频命令需要 shell，无法分段: " << inputPath;
+    return std::nullopt;
+  }
+
+  // 清掉上次中断留下的片段，避免混入结果
+  std::error_code ec;
+  fs::remove_all(chunkDir, ec);
+  fs::create_directories(chunkDir, ec);
+  if (ec) {
+    LOG_ERROR << "创建分段目录失败: " << chunkDir << ", 错误: " << ec.message();
+    return std::nullopt;
+  }
+
+  // segment 复用器只在关键帧处切分；只取视频流，音频在拼接时整段编码
+  std::vector<std::string> argv = {program,
+                                   "-y",
+                                   "-i",
+                                   inputPath,
+                                   "-map",
+                                   "0:v:0",
+                                   "-c",
+                                   "copy",
+                                   "-f",
+                                   "segment",
+                                   "-segment_time",
+                                   std::to_string(chunkSeconds),
+                                   "-reset_timestamps",
+                                   "1",
+                                   (fs::path(chunkDir) / "chunk_%04d.mkv")
+                                       .string()};
+  if (config.ffmpeg.progress_pipe) {
+    argv = live2mp3::utils::withProgressPipe(std::move(argv));
+  }
+
+  LOG_INFO << "按关键帧分段: " << inputPath << " -> " << chunkDir << " (每段 "
+           << chunkSeconds << " 秒)";
+
+  int totalDuration = mediaInfoServicePtr->getDuration(inputPath);
+  if (!live2mp3::utils::runFfmpegWithProgress(
+          argv, progressCallback, std::max(totalDuration, 0), cancelCheck,
+          nullptr, pidCallback, exitInfo)) {
+    LOG_ERROR << "分段失败: " << inputPath;
+    fs::remove_all(chunkDir, ec);
+    return std::nullopt;
+  }
+
+  std::vector<std::string> chunks;
+  for (const auto &entry : fs::directory_iterator(chunkDir, ec)) {
+    if (entry.path().extension() == ".mkv") {
+      chunks.push_back(entry.path().string());
+    }
+  }
+  std::sort(chunks.begin(), chunks.end());
+  if (chunks.empty()) {
+    LOG_ERROR << "分段未产生任何片段: " << inputPath;
     return std::nullopt;
   }
+  return chunks;
+}
+
+std::optional<std::string> ConverterService::assembleChunks(
+    const std::vector<std::string> &encodedChunks,
+    const std::string &sourcePath, const std::string &outputDir,
+    live2mp3::utils::FfmpegProgressCallback progressCallback,
+    live2mp3::utils::CancelCheckCallback cancelCheck,
+    std::function<void(pid_t)> pidCallback,
+    live2mp3::utils::FfmpegExitInfo *exitInfo) {
+  auto config = configServicePtr->getConfig();
+  auto commands = configServicePtr->getCompiledCommands();
+  std::string program = commands->videoConvert.program();
+  if (program.empty() || !commands->chunkAudioOptions) {
+    LOG_ERROR << "视频命令需要 shell，无法拼接分段: " << sourcePath;
+    return std::nullopt;
+  }
+
+  // 与 convertToAv1Mp4 指定输出目录时的命名一致
+  fs::path source(sourcePath);
+  std::string outputPath =
+      (fs::path(outputDir) / (source.stem().string() +
+                              config.output.video_extension))
+          .string();
+  std::string writingPath =
+      (fs::path(outputDir) / (source.stem().string() + "_writing" +
+                              config.output.video_extension))
+          .string();
+  std::string listPath =
+      (fs::path(outputDir) / (source.stem().string() + "_chunk_list.txt"))
+          .string();
+  {
+    std::ofstream listFile(listPath);
+    if (!listFile.is_open()) {
+      LOG_ERROR << "创建列表文件失败: " << listPath;
+      return std::nullopt;
+    }
+    // concat 列表中单引号需写成 '\''（结束引号、转义、重新开始引号）
+    for (const auto &f : encodedChunks) {
+      std::string escaped;
+      escaped.reserve(f.size());
+      for (char c : f) {
+        if (c == '\'')
+          escaped += "'\\''";
+        else
+          escaped.push_back(c);
+      }
+      listFile << "file '" << escaped << "'\n";
+    }
+  }
+
+  // 视频直接复制拼接，音频取自源文件并按视频命令模板中的音频选项编码
+  std::vector<std::string> argv = {program, "-y", "-f", "concat", "-safe",
+                                   "0", "-i", listPath, "-i", sourcePath,
+                                   "-map", "0:v:0", "-map", "1:a?", "-c:v",
+                                   "copy"};
+  argv.insert(argv.end(), commands->chunkAudioOptions->begin(),
+              commands->chunkAudioOptions->end());
+  argv.push_back(writingPath);
+  if (config.ffmpeg.progress_pipe) {
+    argv = live2mp3::utils::withProgressPipe(std::move(argv));
+  }
+
+  LOG_INFO << "拼接 " << encodedChunks.size() << " 个转码片段: " << sourcePath
+           << " -> " << writingPath << " (临时文件)";
+
+  int totalDuration = mediaInfoServicePtr->getDuration(sourcePath);
+  bool success = live2mp3::utils::runFfmpegWithProgress(
+      argv, progressCallback, std::max(totalDuration, 0), cancelCheck, nullptr,
+      pidCallback, exitInfo);
+
+  std::error_code ec;
+  fs::remove(listPath, ec);
+  if (success) {
+    fs::rename(writingPath, outputPath, ec);
+    if (!ec) {
+      LOG_INFO << "分段转码拼接成功: " << outputPath;
+      return outputPath;
+    }
+    LOG_ERROR << "重命名文件失败: " << writingPath << " -> " << outputPath
+              << ", 错误: " << ec.message();
+  } else {
+    LOG_ERROR << "分段拼接失败: " << sourcePath;
+  }
+  fs::remove(writingPath, ec);
+  return std::nullopt;
 }
 
 std::optional<std::string> ConverterService::extractMp3FromVideo(
     const std::string &videoPath, const std::string &outputDir,
     live2mp3::utils::FfmpegProgressCallback progressCallback,
     live2mp3::utils::CancelCheckCallback cancelCheck,
-    std::function<void(pid_t)> pidCallback) {
+    std::function<void(pid_t)> pidCallback,
+    live2mp3::utils::FfmpegExitInfo *exitInfo) {
   auto config = configServicePtr->getConfig();
 
   // 确定输出路径
@@ -341,13 +516,15 @@ std::optional<std::string> ConverterService::extractMp3FromVideo(
     return std::nullopt;
   }
 
-  // FFmpeg 命令：使用配置中的命令模板
+  // FFmpeg 命令：使用配置中的命令模板（加载时已分词）
   // 先输出到临时文件
-  std::string cmdTemplate = config.ffmpeg.audio_convert_command;
-  std::string cmd;
+  auto commands = configServicePtr->getCompiledCommands();
+  std::vector<std::string> argv;
   try {
-    cmd = fmt::format(fmt::runtime(cmdTemplate), fmt::arg("input", videoPath),
-                      fmt::arg("output", writingPath));
+    argv = commands->audioConvert.render(videoPath, writingPath);
+    if (config.ffmpeg.progress_pipe) {
+      argv = live2mp3::utils::withProgressPipe(std::move(argv));
+    }
   } catch (const std::exception &e) {
     LOG_ERROR << "Failed to format audio convert command: " << e.what();
     return std::nullopt;
@@ -357,15 +534,15 @@ std::optional<std::string> ConverterService::extractMp3FromVideo(
            << " (临时文件)";
 
   // 获取输入文件时长用于计算进度百分比
-  int totalDuration = live2mp3::utils::getMediaDuration(videoPath);
+  int totalDuration = mediaInfoServicePtr->getDuration(videoPath);
   if (totalDuration < 0) {
     LOG_WARN << "无法获取媒体时长，进度百分比将不可用: " << videoPath;
     totalDuration = 0;
   }
 
-  if (live2mp3::utils::runFfmpegWithProgress(cmd, progressCallback,
+  if (live2mp3::utils::runFfmpegWithProgress(argv, progressCallback,
                                              totalDuration, cancelCheck,
-                                             nullptr, pidCallback)) {
+                                             nullptr, pidCallback, exitInfo)) {
     // 提取成功，重命名为最终文件名
     try {
       fs::rename(writingPath, outputPath);
@@ -445,6 +622,12 @@ void ConverterService::initAndStart(const Json::Value &config) {
     LOG_FATAL << "PendingFileService not found";
     return;
   }
+
+  mediaInfoServicePtr = drogon::app().getSharedPlugin<MediaInfoService>();
+  if (!mediaInfoServicePtr) {
+    LOG_FATAL << "MediaInfoService not found";
+    return;
+  }
 }
 
 void ConverterService::shutdown() { LOG_DEBUG << "ConverterService shutdown"; }
@@ -1,11 +1,14 @@
 #pragma once
 
 #include "../utils/FfmpegUtils.h"
+#include "../utils/FileTailer.h"
 #include "ConfigService.h"
+#include "MediaInfoService.h"
 #include "services/PendingFileService.h"
 #include <drogon/plugins/Plugin.h>
 #include <optional>
 #include <string>
+#include <vector>
 
 /**
  * @brief 媒体转换服务类
@@ -42,6 +45,13 @@ public:
    * @param inputPath 输入视频路径
    * @param outputDir 输出目录，留空则使用配置的临时目录或输出根目录
    * @param progressCallback 可选的进度回调，实时报告转换进度
+   * @param exitInfo 可选，失败时填充 FFmpeg 退出信息用于分类
+   * @param audioPath 可选；启用 single_pass_audio、未启用 parallel_audio
+   *        且命令模板支持时，同一次解码额外输出片段 MP3（见 sidecarAudioPath），
+   *        成功时填入其路径，否则置空
+   * @param follow 可选；非空时边录边转：以 pipe:0 为输入，由 FileTailer
+   *        跟随仍在写入的 inputPath，写入方关闭文件或 follow_idle_seconds
+   *        未增长后收尾，并填入跟随结果（读取的字节数等）
    * @return std::optional<std::string>
    * 转换成功返回输出文件路径，失败返回nullopt
    */
@@ -49,7 +59,52 @@ public:
       const std::string &inputPath, const std::string &outputDir = "",
       live2mp3::utils::FfmpegProgressCallback progressCallback = nullptr,
       live2mp3::utils::CancelCheckCallback cancelCheck = nullptr,
-      std::function<void(pid_t)> pidCallback = nullptr);
+      std::function<void(pid_t)> pidCallback = nullptr,
+      live2mp3::utils::FfmpegExitInfo *exitInfo = nullptr,
+      std::string *audioPath = nullptr,
+      live2mp3::utils::FileTailer::Result *follow = nullptr);
+
+  /**
+   * @brief 转码视频对应的片段 MP3 路径（同目录、同名，扩展名为音频扩展名）
+   *
+   * 单次解码模式下 convertToAv1Mp4 把 MP3 写在这里，合并阶段据此查找。
+   */
+  std::string sidecarAudioPath(const std::string &videoPath);
+
+  /**
+   * @brief 按关键帧把视频流切成约 chunkSeconds 秒的片段（流复制，不含音频）
+   *
+   * 使用 segment 复用器，只在达到时长后的第一个关键帧处切分，
+   * 片段首尾相接、不重叠也不丢帧，时间戳从 0 开始。
+   *
+   * @param chunkDir 片段输出目录（不存在时创建）
+   * @return 按顺序排列的片段路径，失败返回 nullopt
+   */
+  std::optional<std::vector<std::string>> splitVideoAtKeyframes(
+      const std::string &inputPath, const std::string &chunkDir,
+      int chunkSeconds,
+      live2mp3::utils::FfmpegProgressCallback progressCallback = nullptr,
+      live2mp3::utils::CancelCheckCallback cancelCheck = nullptr,
+      std::function<void(pid_t)> pidCallback = nullptr,
+      live2mp3::utils::FfmpegExitInfo *exitInfo = nullptr);
+
+  /**
+   * @brief 拼接分段转码的视频，并按视频命令模板的音频选项一次性编码源文件音频
+   *
+   * 输出路径与 convertToAv1Mp4 相同（outputDir 下同名、视频扩展名），
+   * 调用方据此把结果当作整段转码的输出使用。
+   *
+   * @param encodedChunks 按顺序排列的已转码片段
+   * @param sourcePath 原始视频（提供音频）
+   * @return 成功返回输出路径，失败返回 nullopt
+   */
+  std::optional<std::string> assembleChunks(
+      const std::vector<std::string> &encodedChunks,
+      const std::string &sourcePath, const std::string &outputDir,
+      live2mp3::utils::FfmpegProgressCallback progressCallback = nullptr,
+      live2mp3::utils::CancelCheckCallback cancelCheck = nullptr,
+      std::function<void(pid_t)> pidCallback = nullptr,
+      live2mp3::utils::FfmpegExitInfo *exitInfo = nullptr);
 
   /**
    * @brief 从视频文件中提取MP3
@@ -59,13 +114,15 @@ public:
    * @param videoPath 视频文件路径
    * @param outputDir 输出目录，留空则使用配置的输出根目录
    * @param progressCallback 可选的进度回调，实时报告转换进度
+   * @param exitInfo 可选，失败时填充 FFmpeg 退出信息用于分类
    * @return std::optional<std::string> 成功返回MP3文件路径，失败返回nullopt
    */
   std::optional<std::string> extractMp3FromVideo(
       const std::string &videoPath, const std::string &outputDir = "",
       live2mp3::utils::FfmpegProgressCallback progressCallback = nullptr,
       live2mp3::utils::CancelCheckCallback cancelCheck = nullptr,
-      std::function<void(pid_t)> pidCallback = nullptr);
+      std::function<void(pid_t)> pidCallback = nullptr,
+      live2mp3::utils::FfmpegExitInfo *exitInfo = nullptr);
 
   /**
    * @brief 获取临时目录使用量(字节)
@@ -86,6 +143,7 @@ public:
 private:
   std::shared_ptr<ConfigService> configServicePtr;
   std::shared_ptr<PendingFileService> pendingFileServicePtr;
+  std::shared_ptr<MediaInfoService> mediaInfoServicePtr;
 
   /**
    * @brief 根据输入路径生成输出路径
@@ -1,4 +1,6 @@
 #include "DatabaseService.h"
+#include "../repos/StatusCodes.h"
+#include <cctype>
 
 DatabaseService &DatabaseService::getInstance() {
   auto instance = drogon::app().getSharedPlugin<DatabaseService>();
@@ -11,7 +13,9 @@ DatabaseService &DatabaseService::getInstance() {
   return fallback;
 }
 
-void DatabaseService::init(const std::string &dbPath) {
+thread_local int DatabaseService::txnDepth_ = 0;
+
+void DatabaseService::init(const std::string &dbPath, int readPoolSize) {
   // No lock needed during single-threaded initialization
   if (db_)
     return;
@@ -22,13 +26,221 @@ void DatabaseService::init(const std::string &dbPath) {
     return;
   }
   LOG_INFO << "Opened database: " << dbPath;
+  dbPath_ = dbPath;
+  applyPragmas(db_, true);
+  stmtCache_.attach(db_);
   initSchema();
+  openReadPool(readPoolSize);
+}
+
+void DatabaseService::applyPragmas(sqlite3 *db, bool writer) {
+  // busy_timeout 兜底：检查点或其他进程持有锁时等待而不是立即 SQLITE_BUSY
+  sqlite3_busy_timeout(db, 5000);
+  const char *common = "PRAGMA cache_size=-16000;"   // 约 16MB 页缓存
+                       "PRAGMA mmap_size=268435456;" // 256MB 内存映射读
+                       "PRAGMA temp_store=MEMORY;";
+  sqlite3_exec(db, common, nullptr, nullptr, nullptr);
+
+  if (writer) {
+    // WAL 下读不阻塞写、写不阻塞读；synchronous=NORMAL 在 WAL 下仍保证一致性
+    char *err = nullptr;
+    if (sqlite3_exec(db,
+                     "PRAGMA journal_mode=WAL;"
+                     "PRAGMA synchronous=NORMAL;",
+                     nullptr, nullptr, &err) != SQLITE_OK) {
+      LOG_WARN << "Failed to enable WAL: " << (err ? err : "unknown");
+      sqlite3_free(err);
+    }
+  } else {
+    sqlite3_exec(db, "PRAGMA query_only=1;", nullptr, nullptr, nullptr);
+  }
+}
+
+void DatabaseService::openReadPool(int size) {
+  for (int i = 0; i < size; ++i) {
+    auto reader = std::make_unique<ReadConnection>();
+    int rc = sqlite3_open_v2(dbPath_.c_str(), &reader->db,
+                             SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX,
+                             nullptr);
+    if (rc != SQLITE_OK) {
+      LOG_WARN << "Can't open read connection: "
+               << sqlite3_errmsg(reader->db);
+      sqlite3_close(reader->db);
+      break;
+    }
+    applyPragmas(reader->db, false);
+    reader->cache.attach(reader->db);
+    idleReaders_.push_back(reader.get());
+    readers_.push_back(std::move(reader));
+  }
+  LOG_INFO << "Opened " << readers_.size() << " read-only connections";
+}
+
+void DatabaseService::closeReadPool() {
+  std::lock_guard<std::mutex> lock(readPoolMutex_);
+  for (auto &reader : readers_) {
+    reader->cache.clear();
+    sqlite3_close(reader->db);
+  }
+  idleReaders_.clear();
+  readers_.clear();
 }
 
 sqlite3 *DatabaseService::getDb() { return db_; }
 
-bool DatabaseService::executeQuery(const std::string &query) {
+CachedStatement DatabaseService::prepareCached(const std::string &sql) {
+  return CachedStatement(&stmtCache_, sql);
+}
+
+bool DatabaseService::isReadOnlySql(const std::string &sql) {
+  size_t i = 0;
+  while (i < sql.size() && std::isspace(static_cast<unsigned char>(sql[i])))
+    ++i;
+  static constexpr char kSelect[] = "SELECT";
+  for (size_t k = 0; k < sizeof(kSelect) - 1; ++k, ++i) {
+    if (i >= sql.size() ||
+        std::toupper(static_cast<unsigned char>(sql[i])) != kSelect[k])
+      return false;
+  }
+  return true;
+}
+
+DatabaseService::ConnectionLease
+DatabaseService::acquireConnection(const std::string &sql) {
+  if (txnDepth_ == 0 && !readers_.empty() && isReadOnlySql(sql)) {
+    std::unique_lock<std::mutex> lock(readPoolMutex_);
+    if (idleReaders_.empty()) {
+      readPoolWaits_++;
+      readPoolCv_.wait(lock, [this]() { return !idleReaders_.empty(); });
+    }
+    ReadConnection *reader = idleReaders_.back();
+    idleReaders_.pop_back();
+    return ConnectionLease(this, reader);
+  }
+  return ConnectionLease(this);
+}
+
+void DatabaseService::releaseReader(ReadConnection *reader) {
+  {
+    std::lock_guard<std::mutex> lock(readPoolMutex_);
+    idleReaders_.push_back(reader);
+  }
+  readPoolCv_.notify_one();
+}
+
+DatabaseService::ReadPoolStats DatabaseService::getReadPoolStats() const {
+  ReadPoolStats stats;
+  std::lock_guard<std::mutex> lock(readPoolMutex_);
+  stats.size = readers_.size();
+  stats.idle = idleReaders_.size();
+  stats.waits = readPoolWaits_.load();
+  return stats;
+}
+
+StatementCache::Stats DatabaseService::getStatementCacheStats() const {
+  StatementCache::Stats total = stmtCache_.getStats();
+  std::lock_guard<std::mutex> lock(readPoolMutex_);
+  for (const auto &reader : readers_) {
+    auto stats = reader->cache.getStats();
+    total.hits += stats.hits;
+    total.misses += stats.misses;
+    total.cached += stats.cached;
+  }
+  return total;
+}
+
+// ============ ConnectionLease ============
+
+DatabaseService::ConnectionLease::ConnectionLease(DatabaseService *owner,
+                                                  ReadConnection *reader)
+    : owner_(owner), reader_(reader) {}
+
+DatabaseService::ConnectionLease::ConnectionLease(DatabaseService *owner)
+    : owner_(owner), writeLock_(owner->writeMutex_) {}
+
+DatabaseService::ConnectionLease::ConnectionLease(
+    ConnectionLease &&other) noexcept
+    : owner_(other.owner_), reader_(other.reader_),
+      writeLock_(std::move(other.writeLock_)) {
+  other.reader_ = nullptr;
+}
+
+DatabaseService::ConnectionLease::~ConnectionLease() {
+  if (reader_)
+    owner_->releaseReader(reader_);
+}
+
+sqlite3 *DatabaseService::ConnectionLease::db() const {
+  return reader_ ? reader_->db : owner_->db_;
+}
+
+StatementCache *DatabaseService::ConnectionLease::cache() const {
+  return reader_ ? &reader_->cache : &owner_->stmtCache_;
+}
+
+// ============ StatementCache ============
+
+sqlite3_stmt *StatementCache::acquire(const std::string &sql) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = idle_.find(sql);
+    if (it != idle_.end() && !it->second.empty()) {
+      sqlite3_stmt *stmt = it->second.back();
+      it->second.pop_back();
+      idleCount_--;
+      hits_++;
+      return stmt;
+    }
+  }
+
+  misses_++;
+  if (!db_)
+    return nullptr;
+  sqlite3_stmt *stmt = nullptr;
+  if (sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, 0) != SQLITE_OK) {
+    return nullptr;
+  }
+  return stmt;
+}
+
+void StatementCache::release(const std::string &sql, sqlite3_stmt *stmt) {
+  sqlite3_reset(stmt);
+  sqlite3_clear_bindings(stmt);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto &list = idle_[sql];
+    if (list.size() < MAX_IDLE_PER_SQL && idleCount_ < MAX_IDLE_TOTAL) {
+      list.push_back(stmt);
+      idleCount_++;
+      return;
+    }
+  }
+  sqlite3_finalize(stmt);
+}
+
+void StatementCache::clear() {
   std::lock_guard<std::mutex> lock(mutex_);
+  for (auto &[sql, list] : idle_) {
+    for (auto *stmt : list) {
+      sqlite3_finalize(stmt);
+    }
+  }
+  idle_.clear();
+  idleCount_ = 0;
+}
+
+StatementCache::Stats StatementCache::getStats() const {
+  Stats stats;
+  stats.hits = hits_.load();
+  stats.misses = misses_.load();
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats.cached = idleCount_;
+  return stats;
+}
+
+bool DatabaseService::executeQuery(const std::string &query) {
+  std::lock_guard<std::recursive_mutex> lock(writeMutex_);
   char *zErrMsg = 0;
   int rc = sqlite3_exec(db_, query.c_str(), 0, 0, &zErrMsg);
   if (rc != SQLITE_OK) {
@@ -42,14 +254,17 @@ bool DatabaseService::executeQuery(const std::string &query) {
 int DatabaseService::queryScalar(const std::string &sql,
                                  std::function<void(sqlite3_stmt *)> binder,
                                  int defaultValue) {
-  if (!db_)
+  ConnectionLease conn = acquireConnection(sql);
+  if (!conn.db())
     return defaultValue;
 
-  sqlite3_stmt *stmt;
-  if (sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, 0) != SQLITE_OK) {
-    LOG_ERROR << "[queryScalar] Failed to prepare: " << sqlite3_errmsg(db_);
+  CachedStatement cached(conn.cache(), sql);
+  if (!cached) {
+    LOG_ERROR << "[queryScalar] Failed to prepare: "
+              << sqlite3_errmsg(conn.db());
     return defaultValue;
   }
+  sqlite3_stmt *stmt = cached.get();
 
   if (binder) {
     binder(stmt);
@@ -60,20 +275,21 @@ int DatabaseService::queryScalar(const std::string &sql,
     result = sqlite3_column_int(stmt, 0);
   }
 
-  sqlite3_finalize(stmt);
   return result;
 }
 
 bool DatabaseService::executeUpdate(
     const std::string &sql, std::function<void(sqlite3_stmt *)> binder) {
+  std::lock_guard<std::recursive_mutex> lock(writeMutex_);
   if (!db_)
     return false;
 
-  sqlite3_stmt *stmt;
-  if (sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, 0) != SQLITE_OK) {
+  auto cached = prepareCached(sql);
+  if (!cached) {
     LOG_ERROR << "[executeUpdate] Failed to prepare: " << sqlite3_errmsg(db_);
     return false;
   }
+  sqlite3_stmt *stmt = cached.get();
 
   if (binder) {
     binder(stmt);
@@ -83,21 +299,22 @@ bool DatabaseService::executeUpdate(
   if (!success) {
     LOG_ERROR << "[executeUpdate] Failed: " << sqlite3_errmsg(db_);
   }
-  sqlite3_finalize(stmt);
   return success;
 }
 
 int DatabaseService::executeUpdateCount(
     const std::string &sql, std::function<void(sqlite3_stmt *)> binder) {
+  std::lock_guard<std::recursive_mutex> lock(writeMutex_);
   if (!db_)
     return -1;
 
-  sqlite3_stmt *stmt;
-  if (sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, 0) != SQLITE_OK) {
+  auto cached = prepareCached(sql);
+  if (!cached) {
     LOG_ERROR << "[executeUpdateCount] Failed to prepare: "
               << sqlite3_errmsg(db_);
     return -1;
   }
+  sqlite3_stmt *stmt = cached.get();
 
   if (binder) {
     binder(stmt);
@@ -105,91 +322,224 @@ int DatabaseService::executeUpdateCount(
 
   if (sqlite3_step(stmt) != SQLITE_DONE) {
     LOG_ERROR << "[executeUpdateCount] Failed: " << sqlite3_errmsg(db_);
-    sqlite3_finalize(stmt);
     return -1;
   }
 
-  int changes = sqlite3_changes(db_);
-  sqlite3_finalize(stmt);
-  return changes;
+  return sqlite3_changes(db_);
 }
 
 int DatabaseService::lastInsertId() {
+  std::lock_guard<std::recursive_mutex> lock(writeMutex_);
   if (!db_)
     return -1;
   return static_cast<int>(sqlite3_last_insert_rowid(db_));
 }
+namespace {
+
+// 各表 DDL，表名参数化以便迁移时先建临时表
+std::string pendingFilesDdl(const std::string &table) {
+  return "CREATE TABLE IF NOT EXISTS " + table +
+         " ("
+         "id INTEGER PRIMARY KEY AUTOINCREMENT,"
+         "dir_path TEXT NOT NULL,"
+         "filename TEXT NOT NULL,"
+         "fingerprint TEXT,"
+         "stable_count INTEGER DEFAULT 0,"
+         "status INTEGER NOT NULL DEFAULT 0,"
+         "temp_mp4_path TEXT,"
+         "temp_mp3_path TEXT,"
+         "updated_at INTEGER NOT NULL DEFAULT (" +
+         std::string(DatabaseService::NOW_EPOCH_SQL) +
+         "),"
+         "start_time TEXT,"
+         "end_time TEXT,"
+         "UNIQUE(dir_path, filename)"
+         ");";
+}
+
+std::string batchesDdl(const std::string &table) {
+  const std::string now = DatabaseService::NOW_EPOCH_SQL;
+  return "CREATE TABLE IF NOT EXISTS " + table +
+         " ("
+         "id INTEGER PRIMARY KEY AUTOINCREMENT,"
+         "streamer TEXT NOT NULL,"
+         "status INTEGER NOT NULL DEFAULT 0,"
+         "output_dir TEXT,"
+         "tmp_dir TEXT,"
+         "final_mp4_path TEXT,"
+         "final_mp3_path TEXT,"
+         "total_files INTEGER DEFAULT 0,"
+         "encoded_count INTEGER DEFAULT 0,"
+         "failed_count INTEGER DEFAULT 0,"
+         "created_at INTEGER NOT NULL DEFAULT (" +
+         now +
+         "),"
+         "updated_at INTEGER NOT NULL DEFAULT (" +
+         now +
+         ")"
+         ");";
+}
+
+std::string batchFilesDdl(const std::string &table) {
+  const std::string now = DatabaseService::NOW_EPOCH_SQL;
+  return "CREATE TABLE IF NOT EXISTS " + table +
+         " ("
+         "id INTEGER PRIMARY KEY AUTOINCREMENT,"
+         "batch_id INTEGER NOT NULL,"
+         "dir_path TEXT NOT NULL,"
+         "filename TEXT NOT NULL,"
+         "fingerprint TEXT NOT NULL,"
+         "pending_file_id INTEGER,"
+         "status INTEGER NOT NULL DEFAULT 0,"
+         "encoded_path TEXT,"
+         "retry_count INTEGER DEFAULT 0,"
+         "created_at INTEGER NOT NULL DEFAULT (" +
+         now +
+         "),"
+         "updated_at INTEGER NOT NULL DEFAULT (" +
+         now +
+         "),"
+         "FOREIGN KEY (batch_id) REFERENCES task_batches(id)"
+         ");";
+}
+
+// 旧版 datetime('now', 'localtime') 字符串 -> epoch 秒
+std::string legacyTimeSql(const std::string &column) {
+  return "COALESCE(CAST(strftime('%s', " + column +
+         ", 'utc') AS INTEGER), " + DatabaseService::NOW_EPOCH_SQL + ")";
+}
+
+} // namespace
+
 void DatabaseService::initSchema() {
+  int version = queryScalar("PRAGMA user_version");
+  bool hasTables =
+      queryScalar("SELECT COUNT(*) FROM sqlite_master WHERE type = 'table' "
+                  "AND name = 'pending_files'") > 0;
+
+  if (hasTables && version < SCHEMA_VERSION) {
+    LOG_INFO << "Migrating database schema from version " << version << " to "
+             << SCHEMA_VERSION;
+    if (!migrateLegacySchema()) {
+      LOG_FATAL << "Failed to migrate database schema";
+      return;
+    }
+  }
+
   // Pending files table for stability tracking
   // filepath 拆分为 dir_path + filename
-  const char *pendingSql =
-      "CREATE TABLE IF NOT EXISTS pending_files ("
-      "id INTEGER PRIMARY KEY AUTOINCREMENT,"
-      "dir_path TEXT NOT NULL,"
-      "filename TEXT NOT NULL,"
-      "fingerprint TEXT,"
-      "stable_count INTEGER DEFAULT 0,"
-      "status TEXT DEFAULT 'pending',"
-      "temp_mp4_path TEXT,"
-      "temp_mp3_path TEXT,"
-      "updated_at DATETIME DEFAULT (datetime('now', 'localtime')),"
-      "start_time TEXT,"
-      "end_time TEXT,"
-      "UNIQUE(dir_path, filename)"
-      ");";
-  if (!executeQuery(pendingSql)) {
+  if (!executeQuery(pendingFilesDdl("pending_files"))) {
     LOG_FATAL << "Failed to initialize pending_files schema";
   }
 
   // 批次表：管理转码/合并/MP3提取的整个流程
-  const char *batchesSql =
-      "CREATE TABLE IF NOT EXISTS task_batches ("
-      "id INTEGER PRIMARY KEY AUTOINCREMENT,"
-      "streamer TEXT NOT NULL,"
-      "status TEXT DEFAULT 'encoding',"
-      "output_dir TEXT,"
-      "tmp_dir TEXT,"
-      "final_mp4_path TEXT,"
-      "final_mp3_path TEXT,"
-      "total_files INTEGER DEFAULT 0,"
-      "encoded_count INTEGER DEFAULT 0,"
-      "failed_count INTEGER DEFAULT 0,"
-      "created_at DATETIME DEFAULT (datetime('now', 'localtime')),"
-      "updated_at DATETIME DEFAULT (datetime('now', 'localtime'))"
-      ");";
-  if (!executeQuery(batchesSql)) {
+  if (!executeQuery(batchesDdl("task_batches"))) {
     LOG_FATAL << "Failed to initialize task_batches schema";
   }
 
   // 批次文件表：跟踪批次中每个文件的转码状态
-  const char *batchFilesSql =
-      "CREATE TABLE IF NOT EXISTS task_batch_files ("
-      "id INTEGER PRIMARY KEY AUTOINCREMENT,"
-      "batch_id INTEGER NOT NULL,"
-      "dir_path TEXT NOT NULL,"
-      "filename TEXT NOT NULL,"
-      "fingerprint TEXT NOT NULL,"
-      "pending_file_id INTEGER,"
-      "status TEXT DEFAULT 'pending',"
-      "encoded_path TEXT,"
-      "retry_count INTEGER DEFAULT 0,"
-      "created_at DATETIME DEFAULT (datetime('now', 'localtime')),"
-      "updated_at DATETIME DEFAULT (datetime('now', 'localtime')),"
-      "FOREIGN KEY (batch_id) REFERENCES task_batches(id)"
-      ");";
-  if (!executeQuery(batchFilesSql)) {
+  if (!executeQuery(batchFilesDdl("task_batch_files"))) {
     LOG_FATAL << "Failed to initialize task_batch_files schema";
   }
 
+  // 媒体元数据表：按指纹缓存时长/流信息，每个文件只探测一次
+  if (!executeQuery("CREATE TABLE IF NOT EXISTS media_info ("
+                    "fingerprint TEXT PRIMARY KEY,"
+                    "duration_ms INTEGER NOT NULL,"
+                    "bit_rate INTEGER DEFAULT 0,"
+                    "format_name TEXT,"
+                    "source TEXT,"
+                    "streams TEXT,"
+                    "updated_at INTEGER NOT NULL DEFAULT (" +
+                    std::string(NOW_EPOCH_SQL) +
+                    ")"
+                    ");")) {
+    LOG_FATAL << "Failed to initialize media_info schema";
+  }
+
   // fingerprint 唯一索引
   executeQuery("CREATE UNIQUE INDEX IF NOT EXISTS idx_batch_files_fingerprint "
                "ON task_batch_files(fingerprint)");
+
+  // 按状态取数并按时间过滤/排序（staged 超时、completed 历史、claim stable）
+  executeQuery("CREATE INDEX IF NOT EXISTS idx_pending_status_updated "
+               "ON pending_files(status, updated_at)");
+  // existsByFingerprint：fingerprint = ? AND status = completed
+  executeQuery("CREATE INDEX IF NOT EXISTS idx_pending_fingerprint "
+               "ON pending_files(fingerprint, status)");
+  executeQuery("CREATE INDEX IF NOT EXISTS idx_batches_status "
+               "ON task_batches(status)");
+  // 批次完成判定：按 batch_id 取未完成文件数与最近更新时间，覆盖索引无需回表
+  executeQuery("CREATE INDEX IF NOT EXISTS idx_batch_files_batch_status "
+               "ON task_batch_files(batch_id, status, updated_at)");
+  executeQuery("CREATE INDEX IF NOT EXISTS idx_batch_files_pending_file "
+               "ON task_batch_files(pending_file_id)");
+
+  executeQuery("PRAGMA user_version = " + std::to_string(SCHEMA_VERSION));
 }
 
-void DatabaseService::initAndStart(const Json::Value &config) { init(); }
+bool DatabaseService::migrateLegacySchema() {
+  using namespace status_code;
+
+  // SQLite 不支持修改列类型，按官方推荐流程：建新表 -> 拷贝 -> 删旧表 -> 改名
+  const std::string steps[] = {
+      pendingFilesDdl("pending_files_new"),
+      "INSERT INTO pending_files_new (id, dir_path, filename, fingerprint, "
+      "stable_count, status, temp_mp4_path, temp_mp3_path, updated_at, "
+      "start_time, end_time) "
+      "SELECT id, dir_path, filename, fingerprint, stable_count, " +
+          caseSql<PendingStatus>("status") +
+          ", temp_mp4_path, temp_mp3_path, " + legacyTimeSql("updated_at") +
+          ", start_time, end_time FROM pending_files",
+      "DROP TABLE pending_files",
+      "ALTER TABLE pending_files_new RENAME TO pending_files",
+
+      batchesDdl("task_batches_new"),
+      "INSERT INTO task_batches_new (id, streamer, status, output_dir, "
+      "tmp_dir, final_mp4_path, final_mp3_path, total_files, encoded_count, "
+      "failed_count, created_at, updated_at) "
+      "SELECT id, streamer, " +
+          caseSql<BatchStatus>("status") +
+          ", output_dir, tmp_dir, final_mp4_path, final_mp3_path, "
+          "total_files, encoded_count, failed_count, " +
+          legacyTimeSql("created_at") + ", " + legacyTimeSql("updated_at") +
+          " FROM task_batches",
+
+      batchFilesDdl("task_batch_files_new"),
+      "INSERT INTO task_batch_files_new (id, batch_id, dir_path, filename, "
+      "fingerprint, pending_file_id, status, encoded_path, retry_count, "
+      "created_at, updated_at) "
+      "SELECT id, batch_id, dir_path, filename, fingerprint, "
+      "pending_file_id, " +
+          caseSql<BatchFileStatus>("status") +
+          ", encoded_path, retry_count, " + legacyTimeSql("created_at") +
+          ", " + legacyTimeSql("updated_at") + " FROM task_batch_files",
+      "DROP TABLE task_batch_files",
+      "DROP TABLE task_batches",
+      "ALTER TABLE task_batches_new RENAME TO task_batches",
+      "ALTER TABLE task_batch_files_new RENAME TO task_batch_files",
+  };
+
+  ScopedTransaction txn(*this);
+  if (!txn.begin())
+    return false;
+  for (const auto &step : steps) {
+    if (!executeQuery(step))
+      return false;
+  }
+  return txn.commit();
+}
+
+void DatabaseService::initAndStart(const Json::Value &config) {
+  init(config.get("db_path", "live2mp3.db").asString(),
+       config.get("read_pool_size", 4).asInt());
+}
 
 void DatabaseService::shutdown() {
+  closeReadPool();
   if (db_) {
+    // 未 finalize 的语句会导致 sqlite3_close 失败
+    stmtCache_.clear();
     sqlite3_close(db_);
   }
 }
@@ -1,65 +1,99 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
 #include <drogon/drogon.h>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <optional>
 #include <sqlite3.h>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 /**
- * @brief RAII 事务管理
+ * @brief 预编译语句缓存（按 SQL 文本）
  *
- * 自动在析构时回滚未提交的事务，避免遗漏 ROLLBACK。
+ * 每个连接持有一个实例。取出的语句由调用方独占，归还时执行
+ * reset + clear_bindings 后放回空闲列表，下次相同 SQL 直接复用，
+ * 省去 sqlite3_prepare_v2 的解析开销。
  */
-class ScopedTransaction {
+class StatementCache {
 public:
-  explicit ScopedTransaction(sqlite3 *db) : db_(db) {}
-  ~ScopedTransaction() {
-    if (active_) {
-      rollback();
-    }
-  }
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    size_t cached = 0; ///< 当前空闲的缓存语句数
+  };
 
-  ScopedTransaction(const ScopedTransaction &) = delete;
-  ScopedTransaction &operator=(const ScopedTransaction &) = delete;
+  StatementCache() = default;
+  ~StatementCache() { clear(); }
+  StatementCache(const StatementCache &) = delete;
+  StatementCache &operator=(const StatementCache &) = delete;
 
-  bool begin() {
-    if (sqlite3_exec(db_, "BEGIN IMMEDIATE TRANSACTION", nullptr, nullptr,
-                     nullptr) != SQLITE_OK) {
-      LOG_ERROR << "[ScopedTransaction] Failed to begin: "
-                << sqlite3_errmsg(db_);
-      return false;
-    }
-    active_ = true;
-    return true;
-  }
+  void attach(sqlite3 *db) { db_ = db; }
 
-  bool commit() {
-    if (!active_)
-      return false;
-    if (sqlite3_exec(db_, "COMMIT", nullptr, nullptr, nullptr) != SQLITE_OK) {
-      LOG_ERROR << "[ScopedTransaction] Failed to commit: "
-                << sqlite3_errmsg(db_);
-      return false;
-    }
-    active_ = false;
-    return true;
+  /**
+   * @brief 取出一条语句，缓存中没有则新建
+   * @return sqlite3_stmt* 失败返回 nullptr
+   */
+  sqlite3_stmt *acquire(const std::string &sql);
+
+  /**
+   * @brief 归还语句，超出缓存上限时直接 finalize
+   */
+  void release(const std::string &sql, sqlite3_stmt *stmt);
+
+  /**
+   * @brief finalize 所有空闲语句（关闭连接前必须调用）
+   */
+  void clear();
+
+  Stats getStats() const;
+
+private:
+  // 同一 SQL 最多保留的空闲语句数、所有 SQL 合计上限
+  static constexpr size_t MAX_IDLE_PER_SQL = 4;
+  static constexpr size_t MAX_IDLE_TOTAL = 256;
+
+  sqlite3 *db_ = nullptr;
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, std::vector<sqlite3_stmt *>> idle_;
+  size_t idleCount_ = 0;
+  std::atomic<uint64_t> hits_{0};
+  std::atomic<uint64_t> misses_{0};
+};
+
+/**
+ * @brief 从 StatementCache 取出的语句，析构时自动归还
+ */
+class CachedStatement {
+public:
+  CachedStatement() = default;
+  CachedStatement(StatementCache *cache, std::string sql)
+      : cache_(cache), sql_(std::move(sql)), stmt_(cache_->acquire(sql_)) {}
+  ~CachedStatement() {
+    if (stmt_)
+      cache_->release(sql_, stmt_);
   }
 
-  void rollback() {
-    if (!active_)
-      return;
-    sqlite3_exec(db_, "ROLLBACK", nullptr, nullptr, nullptr);
-    active_ = false;
+  CachedStatement(const CachedStatement &) = delete;
+  CachedStatement &operator=(const CachedStatement &) = delete;
+  CachedStatement(CachedStatement &&other) noexcept
+      : cache_(other.cache_), sql_(std::move(other.sql_)),
+        stmt_(other.stmt_) {
+    other.stmt_ = nullptr;
   }
 
-  bool isActive() const { return active_; }
+  sqlite3_stmt *get() const { return stmt_; }
+  explicit operator bool() const { return stmt_ != nullptr; }
 
 private:
-  sqlite3 *db_;
-  bool active_ = false;
+  StatementCache *cache_ = nullptr;
+  std::string sql_;
+  sqlite3_stmt *stmt_ = nullptr;
 };
 
 /**
@@ -67,6 +101,10 @@ private:
  *
  * 管理SQLite数据库连接，处理数据库初始化和基础查询执行。
  * 提供通用的查询和更新方法，减少样板代码。
+ *
+ * 数据库以 WAL 模式打开：所有写操作经由唯一的写连接（writeMutex_ 串行化），
+ * 以 SELECT 开头的查询从只读连接池中租用连接执行，读写互不阻塞。
+ * 在 ScopedTransaction 内部发起的查询仍走写连接，以便读到未提交的数据。
  */
 class DatabaseService : public drogon::Plugin<DatabaseService> {
 public:
@@ -83,21 +121,50 @@ public:
   // 获取单例实例
   static DatabaseService &getInstance();
 
+  /// 当前 Unix 时间戳（秒）的 SQL 表达式，时间列统一存储为整数
+  static constexpr const char *NOW_EPOCH_SQL = "unixepoch()";
+
   /**
    * @brief 初始化数据库
    *
    * @param dbPath 数据库文件路径，默认为 "live2mp3.db"
+   * @param readPoolSize 只读连接数量，为 0 时所有查询都走写连接
    */
-  void init(const std::string &dbPath = "live2mp3.db");
+  void init(const std::string &dbPath = "live2mp3.db", int readPoolSize = 4);
 
-  // 获取原始sqlite3连接指针
+  // 获取原始sqlite3写连接指针（仅应在 ScopedTransaction 内使用）
   sqlite3 *getDb();
 
+  // 获取数据库文件路径（其他持久化文件放在同目录下）
+  const std::string &getDbPath() const { return dbPath_; }
+
   /**
-   * @brief 执行简单的SQL查询（无参数无返回值）
+   * @brief 执行简单的SQL查询（无参数无返回值，走写连接）
    */
   bool executeQuery(const std::string &query);
 
+  /**
+   * @brief 从写连接的语句缓存中取出预编译语句（离开作用域自动归还）
+   *
+   * 供仓储层在事务中直接使用；失败时返回的对象为空。
+   */
+  CachedStatement prepareCached(const std::string &sql);
+
+  /**
+   * @brief 语句缓存命中统计（写连接与所有读连接合计）
+   */
+  StatementCache::Stats getStatementCacheStats() const;
+
+  /**
+   * @brief 只读连接池状态
+   */
+  struct ReadPoolStats {
+    size_t size = 0;  ///< 读连接总数
+    size_t idle = 0;  ///< 当前空闲的读连接数
+    uint64_t waits = 0; ///< 因连接全部被占用而等待的次数
+  };
+  ReadPoolStats getReadPoolStats() const;
+
   // ============ 通用查询方法 ============
 
   /**
@@ -108,14 +175,17 @@ public:
   queryAll(const std::string &sql, std::function<T(sqlite3_stmt *)> rowMapper,
            std::function<void(sqlite3_stmt *)> binder = nullptr) {
     std::vector<T> results;
-    if (!db_)
+    ConnectionLease conn = acquireConnection(sql);
+    if (!conn.db())
       return results;
 
-    sqlite3_stmt *stmt;
-    if (sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, 0) != SQLITE_OK) {
-      LOG_ERROR << "[queryAll] Failed to prepare: " << sqlite3_errmsg(db_);
+    CachedStatement cached(conn.cache(), sql);
+    if (!cached) {
+      LOG_ERROR << "[queryAll] Failed to prepare: "
+                << sqlite3_errmsg(conn.db());
       return results;
     }
+    sqlite3_stmt *stmt = cached.get();
 
     if (binder) {
       binder(stmt);
@@ -125,7 +195,6 @@ public:
       results.push_back(rowMapper(stmt));
     }
 
-    sqlite3_finalize(stmt);
     return results;
   }
 
@@ -136,14 +205,17 @@ public:
   std::optional<T>
   queryOne(const std::string &sql, std::function<T(sqlite3_stmt *)> rowMapper,
            std::function<void(sqlite3_stmt *)> binder = nullptr) {
-    if (!db_)
+    ConnectionLease conn = acquireConnection(sql);
+    if (!conn.db())
       return std::nullopt;
 
-    sqlite3_stmt *stmt;
-    if (sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, 0) != SQLITE_OK) {
-      LOG_ERROR << "[queryOne] Failed to prepare: " << sqlite3_errmsg(db_);
+    CachedStatement cached(conn.cache(), sql);
+    if (!cached) {
+      LOG_ERROR << "[queryOne] Failed to prepare: "
+                << sqlite3_errmsg(conn.db());
       return std::nullopt;
     }
+    sqlite3_stmt *stmt = cached.get();
 
     if (binder) {
       binder(stmt);
@@ -154,7 +226,6 @@ public:
       result = rowMapper(stmt);
     }
 
-    sqlite3_finalize(stmt);
     return result;
   }
 
@@ -185,9 +256,138 @@ public:
   int lastInsertId();
 
 private:
+  friend class ScopedTransaction;
+
+  /**
+   * @brief 只读连接（每个连接有自己的语句缓存）
+   */
+  struct ReadConnection {
+    sqlite3 *db = nullptr;
+    StatementCache cache;
+  };
+
+  /**
+   * @brief 单次语句执行期间占用的连接
+   *
+   * 读连接在析构时归还连接池；写连接则在析构时释放 writeMutex_。
+   * 必须在其上的 CachedStatement 之前构造，保证语句先归还。
+   */
+  class ConnectionLease {
+  public:
+    ConnectionLease(DatabaseService *owner, ReadConnection *reader);
+    explicit ConnectionLease(DatabaseService *owner);
+    ~ConnectionLease();
+    ConnectionLease(const ConnectionLease &) = delete;
+    ConnectionLease &operator=(const ConnectionLease &) = delete;
+    ConnectionLease(ConnectionLease &&other) noexcept;
+
+    sqlite3 *db() const;
+    StatementCache *cache() const;
+
+  private:
+    DatabaseService *owner_;
+    ReadConnection *reader_ = nullptr;
+    std::unique_lock<std::recursive_mutex> writeLock_;
+  };
+
   // 初始化数据库Schema
   void initSchema();
+  // 将旧版（文本状态/日期字符串）表重建为当前结构
+  bool migrateLegacySchema();
+
+  // PRAGMA user_version 记录的 Schema 版本
+  // 0: 文本状态 + datetime 字符串；1: 整数状态编码 + epoch 秒 + 索引
+  static constexpr int SCHEMA_VERSION = 1;
+  // 打开只读连接池（需在 Schema 初始化之后）
+  void openReadPool(int size);
+  void closeReadPool();
+
+  // SELECT 且不在事务中时租用读连接，否则锁定写连接
+  ConnectionLease acquireConnection(const std::string &sql);
+  void releaseReader(ReadConnection *reader);
+
+  static bool isReadOnlySql(const std::string &sql);
+  static void applyPragmas(sqlite3 *db, bool writer);
 
   sqlite3 *db_ = nullptr;
-  std::mutex mutex_;
+  std::string dbPath_;
+  // 写连接：同一线程内允许重入（事务内调用通用更新方法）
+  std::recursive_mutex writeMutex_;
+  StatementCache stmtCache_;
+
+  std::vector<std::unique_ptr<ReadConnection>> readers_;
+  std::vector<ReadConnection *> idleReaders_;
+  mutable std::mutex readPoolMutex_;
+  std::condition_variable readPoolCv_;
+  std::atomic<uint64_t> readPoolWaits_{0};
+
+  // 当前线程持有的事务层数（事务内的读也走写连接）
+  static thread_local int txnDepth_;
+};
+
+/**
+ * @brief RAII 事务管理
+ *
+ * 自动在析构时回滚未提交的事务，避免遗漏 ROLLBACK。
+ * 从 begin 到 commit/rollback 期间独占写连接，其他线程的写操作会等待。
+ */
+class ScopedTransaction {
+public:
+  explicit ScopedTransaction(DatabaseService &service)
+      : service_(service), db_(service.getDb()) {}
+  ~ScopedTransaction() {
+    if (active_) {
+      rollback();
+    }
+  }
+
+  ScopedTransaction(const ScopedTransaction &) = delete;
+  ScopedTransaction &operator=(const ScopedTransaction &) = delete;
+
+  bool begin() {
+    lock_ = std::unique_lock<std::recursive_mutex>(service_.writeMutex_);
+    if (sqlite3_exec(db_, "BEGIN IMMEDIATE TRANSACTION", nullptr, nullptr,
+                     nullptr) != SQLITE_OK) {
+      LOG_ERROR << "[ScopedTransaction] Failed to begin: "
+                << sqlite3_errmsg(db_);
+      lock_.unlock();
+      return false;
+    }
+    active_ = true;
+    DatabaseService::txnDepth_++;
+    return true;
+  }
+
+  bool commit() {
+    if (!active_)
+      return false;
+    if (sqlite3_exec(db_, "COMMIT", nullptr, nullptr, nullptr) != SQLITE_OK) {
+      LOG_ERROR << "[ScopedTransaction] Failed to commit: "
+                << sqlite3_errmsg(db_);
+      return false;
+    }
+    finish();
+    return true;
+  }
+
+  void rollback() {
+    if (!active_)
+      return;
+    sqlite3_exec(db_, "ROLLBACK", nullptr, nullptr, nullptr);
+    finish();
+  }
+
+  bool isActive() const { return active_; }
+
+private:
+  void finish() {
+    active_ = false;
+    DatabaseService::txnDepth_--;
+    lock_.unlock();
+  }
+
+  DatabaseService &service_;
+  sqlite3 *db_;
+  std::unique_lock<std::recursive_mutex> lock_;
+  bool active_ = false;
 };
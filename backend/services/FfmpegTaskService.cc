@@ -3,11 +3,91 @@
 #include "ConfigService.h"
 #include "ConverterService.h"
 #include "MergerService.h"
+#include <algorithm>
+#include <random>
 #include <chrono>
+#include <system_error>
 #include <drogon/drogon.h>
+#include <filesystem>
 
+namespace fs = std::filesystem;
 using namespace drogon;
 
+namespace {
+/// 看门狗检查间隔（秒）
+constexpr double WATCHDOG_INTERVAL_SECONDS = 5.0;
+/// 执行线程创建失败（如达到进程线程数上限）后重新入队的等待时间
+constexpr std::chrono::seconds RUNNER_RETRY_DELAY{5};
+
+/**
+ * @brief 合并多个输入文件的失败分类：任一暂时性失败则整体可重试
+ *
+ * 未运行 FFmpeg 的失败（建目录、重命名等）按暂时性处理。
+ */
+live2mp3::utils::FfmpegFailureKind
+accumulateFailure(live2mp3::utils::FfmpegFailureKind current,
+                  const live2mp3::utils::FfmpegExitInfo &exitInfo) {
+  using live2mp3::utils::FfmpegFailureKind;
+  auto kind = live2mp3::utils::classifyFfmpegFailure(exitInfo);
+  if (kind != FfmpegFailureKind::PERMANENT)
+    kind = FfmpegFailureKind::TRANSIENT;
+  if (current == FfmpegFailureKind::TRANSIENT)
+    return current;
+  return kind;
+}
+} // namespace
+
+FfmpegTaskPriority defaultTaskPriority(FfmpegTaskType type) {
+  switch (type) {
+  case FfmpegTaskType::MERGE:
+  case FfmpegTaskType::CONVERT_MP3:
+    return FfmpegTaskPriority::HIGH;
+  case FfmpegTaskType::CONVERT_MP4:
+  case FfmpegTaskType::FOLLOW_MP4:
+    return FfmpegTaskPriority::LOW;
+  case FfmpegTaskType::OTHER:
+  default:
+    return FfmpegTaskPriority::NORMAL;
+  }
+}
+
+const char *taskPriorityName(FfmpegTaskPriority priority) {
+  switch (priority) {
+  case FfmpegTaskPriority::HIGH:
+    return "high";
+  case FfmpegTaskPriority::LOW:
+    return "low";
+  case FfmpegTaskPriority::NORMAL:
+  default:
+    return "normal";
+  }
+}
+
+const char *taskTypeName(FfmpegTaskType type) {
+  switch (type) {
+  case FfmpegTaskType::CONVERT_MP4:
+    return "convert_mp4";
+  case FfmpegTaskType::CONVERT_MP3:
+    return "convert_mp3";
+  case FfmpegTaskType::MERGE:
+    return "merge";
+  case FfmpegTaskType::FOLLOW_MP4:
+    return "follow_mp4";
+  case FfmpegTaskType::OTHER:
+  default:
+    return "other";
+  }
+}
+
+std::optional<FfmpegTaskType> parseTaskType(std::string_view name) {
+  for (size_t i = 0; i < FFMPEG_TASK_TYPE_COUNT; ++i) {
+    auto type = static_cast<FfmpegTaskType>(i);
+    if (name == taskTypeName(type))
+      return type;
+  }
+  return std::nullopt;
+}
+
 // ============================================================
 // FfmpegTaskProcDetail 实现
 // ============================================================
@@ -24,6 +104,7 @@ FfmpegTaskProcDetail::FfmpegTaskProcDetail() {
                    .count();
   startTime = 0;
   endTime = 0;
+  failureKind = live2mp3::utils::FfmpegFailureKind::NONE;
 }
 
 void FfmpegTaskProcDetail::setPipeInfo(
@@ -42,10 +123,12 @@ FfmpegTaskResult FfmpegTaskProcDetail::getProcessResult() {
   FfmpegTaskResult result;
   result.id = id;
   result.type = type;
+  result.priority = priority;
   result.status = status;
   result.files = files;
   result.outputFiles = outputFiles;
   result.resultMessage = resultMessage;
+  result.failureKind = failureKind;
   result.createTime = createTime;
   result.startTime = startTime;
   result.endTime = endTime;
@@ -106,11 +189,23 @@ void FfmpegTaskProcDetail::cancel() {
 
 bool FfmpegTaskProcDetail::isCancelled() const { return cancelled_.load(); }
 
+void FfmpegTaskProcDetail::abort(const std::string &reason) {
+  {
+    std::lock_guard<std::mutex> lock(mutexStatic_);
+    abortReason_ = reason;
+  }
+  aborted_ = true;
+  cancelled_ = true;
+}
+
+bool FfmpegTaskProcDetail::isAborted() const { return aborted_.load(); }
+
 void FfmpegTaskProcDetail::run() {
   if (cancelled_) {
     {
       std::lock_guard<std::mutex> lock(mutexStatic_);
       status = FfmpegTaskStatus::FAILED;
+      failureKind = live2mp3::utils::FfmpegFailureKind::CANCELLED;
       resultMessage = "Task cancelled before execution";
       endTime = std::chrono::duration_cast<std::chrono::milliseconds>(
                     std::chrono::system_clock::now().time_since_epoch())
@@ -143,7 +238,11 @@ void FfmpegTaskProcDetail::run() {
       {
         std::lock_guard<std::mutex> lock(mutexStatic_);
         status = FfmpegTaskStatus::FAILED;
-        resultMessage = "Task cancelled during execution";
+        // 看门狗中止视为暂时性失败（卡死的进程重试通常可以恢复）
+        failureKind = aborted_ ? live2mp3::utils::FfmpegFailureKind::TRANSIENT
+                               : live2mp3::utils::FfmpegFailureKind::CANCELLED;
+        resultMessage = aborted_ ? "Task aborted by watchdog: " + abortReason_
+                                 : "Task cancelled during execution";
         endTime = std::chrono::duration_cast<std::chrono::milliseconds>(
                       std::chrono::system_clock::now().time_since_epoch())
                       .count();
@@ -170,9 +269,19 @@ void FfmpegTaskProcDetail::run() {
                     std::chrono::system_clock::now().time_since_epoch())
                     .count();
     }
+  } catch (const FfmpegTaskError &e) {
+    std::lock_guard<std::mutex> lock(mutexStatic_);
+    status = FfmpegTaskStatus::FAILED;
+    failureKind = e.kind();
+    resultMessage = e.what();
+    endTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+                  std::chrono::system_clock::now().time_since_epoch())
+                  .count();
   } catch (const std::exception &e) {
+    // 未分类的异常按暂时性处理，保持原有的重试行为
     std::lock_guard<std::mutex> lock(mutexStatic_);
     status = FfmpegTaskStatus::FAILED;
+    failureKind = live2mp3::utils::FfmpegFailureKind::TRANSIENT;
     resultMessage = e.what();
     endTime = std::chrono::duration_cast<std::chrono::milliseconds>(
                   std::chrono::system_clock::now().time_since_epoch())
@@ -200,6 +309,7 @@ void FfmpegTaskProcDetail::setOutputFiles(
 void FfmpegTaskProcDetail::setInfo(const FfmpegTaskInput &input) {
   std::lock_guard<std::mutex> lock(mutexStatic_);
   type = input.type;
+  priority = input.priority;
   files = input.files;
   outputFiles = input.outputFiles;
   executeFunc_.func = input.func;
@@ -239,10 +349,13 @@ bool FfmpegTaskProcDetail::isRetryExhausted() const {
 void FfmpegTaskProcDetail::resetForRetry() {
   std::lock_guard<std::mutex> lock(mutexStatic_);
   status = FfmpegTaskStatus::PENDING;
+  failureKind = live2mp3::utils::FfmpegFailureKind::NONE;
   resultMessage.clear();
   startTime = 0;
   endTime = 0;
   cancelled_ = false;
+  aborted_ = false;
+  abortReason_.clear();
   pid_ = 0;
 
   // 重建 promise/future 以便再次使用
@@ -255,14 +368,41 @@ void FfmpegTaskProcDetail::resetForRetry() {
 // ============================================================
 
 FfAsyncChannel::FfAsyncChannel(
-    size_t maxConcurrent, int maxRetries,
-    std::shared_ptr<CommonThreadService> threadServicePtr)
-    : maxConcurrent_(maxConcurrent), maxRetries_(maxRetries),
-      threadServicePtr_(threadServicePtr) {
+    std::vector<FfmpegLaneSpec> lanes, int maxRetries, int agingSeconds)
+    : maxRetries_(maxRetries), agingSeconds_(agingSeconds) {
+  if (lanes.empty()) {
+    lanes.push_back({"default", 1, {}});
+  }
+
+  // 未被认领的类型留在默认 lane（下标 0），同一类型以先出现的 lane 为准
+  std::array<bool, FFMPEG_TASK_TYPE_COUNT> claimed{};
+  for (size_t i = 0; i < lanes.size(); ++i) {
+    lanes_.push_back(Lane{lanes[i].name,
+                          std::max<size_t>(lanes[i].maxConcurrent, 1),
+                          0,
+                          {}});
+    for (auto type : lanes[i].types) {
+      size_t t = static_cast<size_t>(type);
+      if (claimed[t]) {
+        LOG_WARN << "FfAsyncChannel: task type " << taskTypeName(type)
+                 << " already assigned to lane " << lanes_[laneOfType_[t]].name
+                 << ", ignoring lane " << lanes[i].name;
+        continue;
+      }
+      claimed[t] = true;
+      laneOfType_[t] = i;
+    }
+  }
+
   // 启动调度线程
   schedulerThread_ = std::thread([this]() { schedulerLoop(); });
-  LOG_INFO << "FfAsyncChannel: scheduler thread started, maxConcurrent="
-           << maxConcurrent << ", maxRetries=" << maxRetries;
+  for (const auto &lane : lanes_) {
+    LOG_INFO << "FfAsyncChannel: lane " << lane.name
+             << " maxConcurrent=" << lane.maxConcurrent;
+  }
+  LOG_INFO << "FfAsyncChannel: scheduler thread started, lanes="
+           << lanes_.size() << ", maxRetries=" << maxRetries
+           << ", agingSeconds=" << agingSeconds;
 }
 
 FfAsyncChannel::~FfAsyncChannel() { close(); }
@@ -296,16 +436,19 @@ void FfAsyncChannel::close() {
     // 注意：不清理 taskMap_，让 onTaskFinished 正常递减 runningCount_
 
     // 清空待处理队列
-    while (!pendingQueue_.empty()) {
-      pendingQueue_.pop();
-    }
+    clearPendingLocked();
   }
 
   // 等待所有运行中的任务完成（onTaskFinished 会递减 runningCount_）
   {
     std::unique_lock<std::mutex> lock(mutex_);
     drainCv_.wait(lock, [this]() { return runningCount_ == 0; });
+    for (auto &[id, runner] : runners_) {
+      finishedRunners_.push_back(std::move(runner));
+    }
+    runners_.clear();
   }
+  joinFinishedRunners();
 
   LOG_INFO << "FfAsyncChannel::close() - 所有任务已结束";
 }
@@ -321,6 +464,260 @@ std::vector<FfmpegTaskProcess> FfAsyncChannel::getRunningTasks() {
   return tasks;
 }
 
+FfmpegQueueStats FfAsyncChannel::getQueueStats() {
+  FfmpegQueueStats stats;
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto &lane : lanes_) {
+    FfmpegQueueStats::Lane laneStats{lane.name, lane.maxConcurrent, 0,
+                                     lane.running};
+    for (size_t i = 0; i < FFMPEG_TASK_PRIORITY_COUNT; ++i) {
+      stats.pending[i] += lane.queues[i].size();
+      laneStats.pending += lane.queues[i].size();
+    }
+    stats.lanes.push_back(std::move(laneStats));
+  }
+  stats.running = runningByPriority_;
+  stats.watchdogAborts = watchdogAborts_;
+  stats.retryDelayed = delayedRetries_.size();
+  return stats;
+}
+
+std::optional<size_t> FfAsyncChannel::findLane(const std::string &name) const {
+  // lane 列表在构造后不再增删，名称只读
+  for (size_t i = 0; i < lanes_.size(); ++i) {
+    if (lanes_[i].name == name)
+      return i;
+  }
+  return std::nullopt;
+}
+
+size_t FfAsyncChannel::laneOf(FfmpegTaskType type) const {
+  return laneOfType_[static_cast<size_t>(type)];
+}
+
+void FfAsyncChannel::setLaneConcurrency(size_t lane, size_t maxConcurrent) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (lane >= lanes_.size())
+      return;
+    lanes_[lane].maxConcurrent = std::max<size_t>(maxConcurrent, 1);
+  }
+  // 调高后可能有任务可以派发
+  cv_.notify_one();
+}
+
+void FfAsyncChannel::setRetryBackoff(int baseSeconds, int maxSeconds) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  retryBackoffBaseSeconds_ = baseSeconds;
+  retryBackoffMaxSeconds_ = maxSeconds;
+}
+
+void FfAsyncChannel::setWatchdog(const FfmpegWatchdogConfig &config) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  watchdog_ = config;
+}
+
+size_t FfAsyncChannel::checkWatchdog() {
+  std::vector<std::pair<std::shared_ptr<FfmpegTaskProcDetail>, std::string>>
+      toAbort;
+  long long nowMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::system_clock::now().time_since_epoch())
+                        .count();
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto &[id, task] : taskMap_) {
+      if (!task || task->isCancelled())
+        continue;
+      auto result = task->getProcessResult();
+      if (result.type == FfmpegTaskType::OTHER || result.startTime <= 0)
+        continue; // 尚在线程池中排队
+
+      auto &state = watchStates_[id];
+      if (state.lastAdvanceMs == 0 ||
+          result.progressTime != state.lastProgressTime) {
+        state.lastProgressTime = result.progressTime;
+        state.lastAdvanceMs =
+            state.lastAdvanceMs == 0 ? result.startTime : nowMs;
+      }
+
+      long long stalledSec = (nowMs - state.lastAdvanceMs) / 1000;
+      long long elapsedSec = (nowMs - result.startTime) / 1000;
+      long long budgetSec = 0;
+      if (watchdog_.taskTimeoutSeconds > 0 && result.totalDuration > 0) {
+        budgetSec = watchdog_.taskTimeoutSeconds +
+                    static_cast<long long>(watchdog_.timeoutDurationFactor *
+                                           result.totalDuration / 1000.0);
+      }
+
+      if (watchdog_.stallTimeoutSeconds > 0 &&
+          stalledSec >= watchdog_.stallTimeoutSeconds) {
+        toAbort.emplace_back(task, "no progress for " +
+                                       std::to_string(stalledSec) +
+                                       "s (time=" +
+                                       std::to_string(result.progressTime) +
+                                       "ms)");
+      } else if (budgetSec > 0 && elapsedSec > budgetSec) {
+        toAbort.emplace_back(task, "exceeded wall-clock budget of " +
+                                       std::to_string(budgetSec) + "s (ran " +
+                                       std::to_string(elapsedSec) + "s)");
+      }
+    }
+    watchdogAborts_ += toAbort.size();
+  }
+
+  for (auto &[task, reason] : toAbort) {
+    LOG_WARN << "FfAsyncChannel: watchdog aborting task " << task->getId()
+             << ": " << reason;
+    task->abort(reason);
+  }
+  return toAbort.size();
+}
+
+void FfAsyncChannel::enqueueLocked(std::shared_ptr<QueueItem> itemPtr) {
+  itemPtr->enqueueTime = std::chrono::steady_clock::now();
+  auto &lane = lanes_[itemPtr->lane];
+  lane.queues[static_cast<size_t>(itemPtr->priority)].push_back(
+      std::move(itemPtr));
+}
+
+bool FfAsyncChannel::hasPendingLocked() const {
+  for (const auto &lane : lanes_) {
+    for (const auto &queue : lane.queues) {
+      if (!queue.empty())
+        return true;
+    }
+  }
+  return false;
+}
+
+bool FfAsyncChannel::hasDispatchableLocked() const {
+  for (const auto &lane : lanes_) {
+    if (lane.running >= lane.maxConcurrent)
+      continue;
+    for (const auto &queue : lane.queues) {
+      if (!queue.empty())
+        return true;
+    }
+  }
+  return false;
+}
+
+std::shared_ptr<FfAsyncChannel::QueueItem> FfAsyncChannel::popNextLocked() {
+  auto now = std::chrono::steady_clock::now();
+  std::deque<std::shared_ptr<QueueItem>> *best = nullptr;
+  long long bestLevel = 0;
+
+  // 每个队列内按入队时间有序，只需比较有空闲槽位的 lane 的各队首
+  for (auto &lane : lanes_) {
+    if (lane.running >= lane.maxConcurrent)
+      continue;
+    for (size_t i = 0; i < FFMPEG_TASK_PRIORITY_COUNT; ++i) {
+      auto &queue = lane.queues[i];
+      if (queue.empty())
+        continue;
+      const auto &head = queue.front();
+
+      long long level = static_cast<long long>(i);
+      if (agingSeconds_ > 0) {
+        auto waited = std::chrono::duration_cast<std::chrono::seconds>(
+                          now - head->enqueueTime)
+                          .count();
+        level = std::max(0LL, level - waited / agingSeconds_);
+      }
+
+      if (!best || level < bestLevel ||
+          (level == bestLevel &&
+           head->enqueueTime < best->front()->enqueueTime)) {
+        best = &queue;
+        bestLevel = level;
+      }
+    }
+  }
+
+  if (!best)
+    return nullptr;
+
+  auto itemPtr = std::move(best->front());
+  best->pop_front();
+  if (bestLevel < static_cast<long long>(itemPtr->priority)) {
+    LOG_DEBUG << "FfAsyncChannel: task " << itemPtr->task->getId() << " aged "
+              << taskPriorityName(itemPtr->priority) << " -> level "
+              << bestLevel;
+  }
+  return itemPtr;
+}
+
+void FfAsyncChannel::promoteDelayedLocked(
+    std::chrono::steady_clock::time_point now) {
+  while (!delayedRetries_.empty() && delayedRetries_.begin()->first <= now) {
+    auto itemPtr = std::move(delayedRetries_.begin()->second);
+    delayedRetries_.erase(delayedRetries_.begin());
+    enqueueLocked(std::move(itemPtr));
+  }
+}
+
+std::chrono::milliseconds FfAsyncChannel::retryDelayLocked(int retryNum) {
+  if (retryBackoffBaseSeconds_ <= 0)
+    return std::chrono::milliseconds(0);
+
+  // 指数退避：base * 2^(n-1)，封顶后在 [d/2, d] 内随机（equal jitter），
+  // 避免同一时刻失败的一批任务同时重试
+  long long delayMs = static_cast<long long>(retryBackoffBaseSeconds_) * 1000;
+  long long capMs = static_cast<long long>(
+                        std::max(retryBackoffMaxSeconds_,
+                                 retryBackoffBaseSeconds_)) *
+                    1000;
+  for (int i = 1; i < retryNum && delayMs < capMs; ++i) {
+    delayMs *= 2;
+  }
+  delayMs = std::min(delayMs, capMs);
+
+  std::uniform_int_distribution<long long> jitter(delayMs / 2, delayMs);
+  return std::chrono::milliseconds(jitter(rng_));
+}
+
+size_t FfAsyncChannel::clearPendingLocked() {
+  size_t count = delayedRetries_.size();
+  delayedRetries_.clear();
+  for (auto &lane : lanes_) {
+    for (auto &queue : lane.queues) {
+      count += queue.size();
+      queue.clear();
+    }
+  }
+  return count;
+}
+
+void FfAsyncChannel::releaseSlotLocked(const std::string &taskId,
+                                       const QueueItem &item) {
+  taskMap_.erase(taskId);
+  watchStates_.erase(taskId);
+  runningCount_--;
+  runningByPriority_[static_cast<size_t>(item.priority)]--;
+  lanes_[item.lane].running--;
+}
+
+void FfAsyncChannel::retireRunnerLocked(const std::string &taskId) {
+  auto it = runners_.find(taskId);
+  if (it == runners_.end())
+    return; // close() 已接管
+  finishedRunners_.push_back(std::move(it->second));
+  runners_.erase(it);
+}
+
+void FfAsyncChannel::joinFinishedRunners() {
+  std::vector<std::thread> finished;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    finished.swap(finishedRunners_);
+  }
+  for (auto &runner : finished) {
+    if (runner.joinable())
+      runner.join();
+  }
+}
+
 void FfAsyncChannel::submit(FfmpegTaskInput item,
                             std::function<void(FfmpegTaskResult)> onComplete) {
   if (closed_) {
@@ -334,12 +731,14 @@ void FfAsyncChannel::submit(FfmpegTaskInput item,
   std::string taskId = taskProcDetail->getId();
 
   LOG_DEBUG << "FfAsyncChannel::submit: queued task id=" << taskId
-            << " type=" << static_cast<int>(item.type);
+            << " type=" << taskTypeName(item.type)
+            << " priority=" << taskPriorityName(item.priority);
 
   {
     std::lock_guard<std::mutex> lock(mutex_);
-    pendingQueue_.push(std::make_shared<QueueItem>(
-        QueueItem{taskProcDetail, std::move(onComplete)}));
+    size_t lane = laneOfType_[static_cast<size_t>(item.type)];
+    enqueueLocked(std::make_shared<QueueItem>(QueueItem{
+        taskProcDetail, std::move(onComplete), item.priority, lane, {}}));
   }
 
   // 唤醒调度线程
@@ -350,52 +749,64 @@ void FfAsyncChannel::schedulerLoop() {
   LOG_INFO << "FfAsyncChannel: scheduler loop started";
 
   while (true) {
-    std::shared_ptr<QueueItem> itemPtr;
-    bool hasItem = false;
+    joinFinishedRunners();
 
     {
       std::unique_lock<std::mutex> lock(mutex_);
 
-      // 等待条件：有任务 && 有空闲槽位，或者通道关闭
-      cv_.wait(lock, [this]() {
-        return closed_ ||
-               (!pendingQueue_.empty() && runningCount_ < maxConcurrent_);
-      });
+      // 等待条件：某个 lane 有任务且有空闲槽位，或者通道关闭；
+      // 有退避中的重试任务时最多等到最早的一个到期
+      while (true) {
+        promoteDelayedLocked(std::chrono::steady_clock::now());
+        if (closed_ || hasDispatchableLocked())
+          break;
+        if (delayedRetries_.empty()) {
+          cv_.wait(lock);
+        } else {
+          cv_.wait_until(lock, delayedRetries_.begin()->first);
+        }
+      }
 
-      if (closed_ && pendingQueue_.empty()) {
+      if (closed_ && !hasPendingLocked() && delayedRetries_.empty()) {
         break; // 通道关闭且无待处理任务
       }
 
       if (closed_) {
         // 通道关闭但还有待处理任务，丢弃
-        LOG_INFO << "FfAsyncChannel: discarding " << pendingQueue_.size()
+        size_t discarded = clearPendingLocked();
+        LOG_INFO << "FfAsyncChannel: discarding " << discarded
                  << " pending tasks on close";
-        while (!pendingQueue_.empty()) {
-          pendingQueue_.pop();
-        }
         break;
       }
 
-      if (!pendingQueue_.empty() && runningCount_ < maxConcurrent_) {
-        itemPtr = std::move(pendingQueue_.front());
-        pendingQueue_.pop();
-        hasItem = true;
+      auto itemPtr = popNextLocked();
+      if (itemPtr) {
         runningCount_++;
+        runningByPriority_[static_cast<size_t>(itemPtr->priority)]++;
+        lanes_[itemPtr->lane].running++;
 
         // 注册到任务映射表
         std::string taskId = itemPtr->task->getId();
         taskMap_[taskId] = itemPtr->task;
-      }
-    }
-
-    if (hasItem) {
-      std::string taskId = itemPtr->task->getId();
 
-      // 提交到线程池执行
-      threadServicePtr_->runTask([this, itemPtr, taskId]() {
-        itemPtr->task->run();
-        onTaskFinished(taskId, itemPtr);
-      });
+        // 在持锁时启动执行线程：onTaskFinished 需要同一把锁，
+        // 保证线程登记到 runners_ 之后才可能被回收
+        try {
+          runners_[taskId] = std::thread([this, itemPtr, taskId]() {
+            itemPtr->task->run();
+            onTaskFinished(taskId, itemPtr);
+          });
+        } catch (const std::system_error &e) {
+          LOG_ERROR << "FfAsyncChannel: failed to start runner for task "
+                    << taskId << ": " << e.what() << ", requeue in "
+                    << RUNNER_RETRY_DELAY.count() << "s";
+          runners_.erase(taskId);
+          releaseSlotLocked(taskId, *itemPtr);
+          delayedRetries_.emplace(
+              std::chrono::steady_clock::now() + RUNNER_RETRY_DELAY,
+              std::move(itemPtr));
+        }
+      }
     }
   }
 
@@ -410,37 +821,48 @@ void FfAsyncChannel::onTaskFinished(const std::string &taskId,
   if (closed_) {
     {
       std::lock_guard<std::mutex> lock(mutex_);
-      taskMap_.erase(taskId);
-      runningCount_--;
+      releaseSlotLocked(taskId, *itemPtr);
+      retireRunnerLocked(taskId);
     }
     drainCv_.notify_one();
     return;
   }
 
-  if (result.status == FfmpegTaskStatus::FAILED &&
-      !itemPtr->task->isCancelled() && !itemPtr->task->isRetryExhausted()) {
-    // 任务失败，尚未耗尽重试次数，重新入队
+  // 只有暂时性失败（含看门狗中止）才重试；确定性失败直接结束
+  bool transient =
+      result.failureKind == live2mp3::utils::FfmpegFailureKind::TRANSIENT;
+  if (result.status == FfmpegTaskStatus::FAILED && transient &&
+      !itemPtr->task->isRetryExhausted()) {
+    // 任务失败，尚未耗尽重试次数，退避后重新入队
     int retryNum = itemPtr->task->incrementRetry();
-    LOG_WARN << "FfAsyncChannel: task " << taskId << " failed, retry "
-             << retryNum << "/" << itemPtr->task->getMaxRetries();
-
     itemPtr->task->resetForRetry();
 
     {
       std::lock_guard<std::mutex> lock(mutex_);
-      taskMap_.erase(taskId);
-      runningCount_--;
-      pendingQueue_.push(std::move(itemPtr));
+      auto delay = retryDelayLocked(retryNum);
+      LOG_WARN << "FfAsyncChannel: task " << taskId << " failed ("
+               << result.resultMessage << "), retry " << retryNum << "/"
+               << itemPtr->task->getMaxRetries() << " in "
+               << delay.count() / 1000.0 << "s";
+      releaseSlotLocked(taskId, *itemPtr);
+      retireRunnerLocked(taskId);
+      delayedRetries_.emplace(std::chrono::steady_clock::now() + delay,
+                              std::move(itemPtr));
     }
     cv_.notify_one();
     return;
   }
 
+  if (result.status == FfmpegTaskStatus::FAILED &&
+      result.failureKind == live2mp3::utils::FfmpegFailureKind::PERMANENT) {
+    LOG_ERROR << "FfAsyncChannel: task " << taskId
+              << " failed permanently, not retrying: " << result.resultMessage;
+  }
+
   // 任务最终完成（成功或重试耗尽）
   {
     std::lock_guard<std::mutex> lock(mutex_);
-    taskMap_.erase(taskId);
-    runningCount_--;
+    releaseSlotLocked(taskId, *itemPtr);
   }
 
   LOG_DEBUG << "FfAsyncChannel: task " << taskId
@@ -455,7 +877,12 @@ void FfAsyncChannel::onTaskFinished(const std::string &taskId,
     }
   }
 
-  // 唤醒调度线程处理下一个任务
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    retireRunnerLocked(taskId);
+  }
+
+  // 唤醒调度线程处理下一个任务并回收本线程
   cv_.notify_one();
 }
 
@@ -466,46 +893,228 @@ void FfAsyncChannel::onTaskFinished(const std::string &taskId,
 void FfmpegTaskService::initAndStart(const Json::Value &config) {
   size_t maxConcurrent = 2;
   int maxRetries = 3;
+  int agingSeconds = 600;
+  std::vector<FfmpegLaneConfig> laneConfigs;
 
   configService_ = drogon::app().getSharedPlugin<ConfigService>();
   if (configService_) {
     auto appConfig = configService_->getConfig();
     maxConcurrent = appConfig.ffmpeg_task.maxConcurrentTasks;
     maxRetries = appConfig.scheduler.ffmpeg_retry_count;
+    agingSeconds = appConfig.ffmpeg_task.priorityAgingSeconds;
+    laneConfigs = appConfig.ffmpeg_task.lanes;
   } else {
     LOG_ERROR << "FfmpegTaskService: ConfigService not found, using defaults";
   }
 
-  threadServicePtr_ = drogon::app().getSharedPlugin<CommonThreadService>();
-  if (!threadServicePtr_) {
-    LOG_FATAL << "FfmpegTaskService: CommonThreadService not found";
-    return;
+  // 默认 lane 接收未被配置 lane 认领的任务类型
+  std::vector<FfmpegLaneSpec> lanes;
+  lanes.push_back({"default", maxConcurrent, {}});
+  for (const auto &laneConfig : laneConfigs) {
+    FfmpegLaneSpec lane;
+    lane.name = laneConfig.name;
+    lane.maxConcurrent =
+        static_cast<size_t>(std::max(laneConfig.maxConcurrent, 1));
+    for (const auto &typeName : laneConfig.types) {
+      if (auto type = parseTaskType(typeName)) {
+        lane.types.push_back(*type);
+      } else {
+        LOG_WARN << "FfmpegTaskService: lane " << lane.name
+                 << " has unknown task type '" << typeName << "', ignored";
+      }
+    }
+    if (lane.name.empty() || lane.types.empty()) {
+      LOG_WARN << "FfmpegTaskService: skipping lane without name or types";
+      continue;
+    }
+    lanes.push_back(std::move(lane));
   }
 
-  size_t threadCount = threadServicePtr_->getThreadCount();
+  // 跟随任务在整个直播期间占用名额，不能与 AV1 转码共用默认 lane；
+  // 配置未指定时给它单独的 lane
+  bool followAssigned =
+      std::any_of(lanes.begin(), lanes.end(), [](const FfmpegLaneSpec &lane) {
+        return std::find(lane.types.begin(), lane.types.end(),
+                         FfmpegTaskType::FOLLOW_MP4) != lane.types.end();
+      });
+  if (!followAssigned) {
+    constexpr size_t kFollowLaneConcurrent = 4;
+    lanes.push_back(
+        {"follow", kFollowLaneConcurrent, {FfmpegTaskType::FOLLOW_MP4}});
+    LOG_INFO << "FfmpegTaskService: follow_mp4 not assigned to a lane, using "
+                "dedicated lane 'follow' (maxConcurrent="
+             << kFollowLaneConcurrent << ")";
+  }
 
-  if (maxConcurrent > threadCount) {
-    LOG_WARN << "FfmpegTaskService: maxConcurrentTasks (" << maxConcurrent
-             << ") exceeds thread pool size (" << threadCount
-             << "), clamping to " << threadCount;
-    maxConcurrent = threadCount;
+  size_t totalConcurrent = 0;
+  for (const auto &lane : lanes) {
+    totalConcurrent += lane.maxConcurrent;
   }
 
-  channel_ = std::make_unique<FfAsyncChannel>(maxConcurrent, maxRetries,
-                                              threadServicePtr_);
+  channel_ = std::make_unique<FfAsyncChannel>(std::move(lanes), maxRetries,
+                                              agingSeconds);
+
+  if (configService_) {
+    const auto &taskConfig = configService_->getConfig().ffmpeg_task;
+    FfmpegWatchdogConfig watchdog;
+    watchdog.taskTimeoutSeconds = taskConfig.taskTimeoutSeconds;
+    watchdog.timeoutDurationFactor = taskConfig.timeoutDurationFactor;
+    watchdog.stallTimeoutSeconds = taskConfig.stallTimeoutSeconds;
+    channel_->setWatchdog(watchdog);
+    channel_->setRetryBackoff(taskConfig.retryBackoffBaseSeconds,
+                              taskConfig.retryBackoffMaxSeconds);
+
+    startAdaptiveConcurrency(taskConfig.adaptive);
+  }
+
+  // 看门狗：定期检查超时/停滞的运行任务，尽快释放并发槽位
+  watchdogTimerId_ = drogon::app().getLoop()->runEvery(
+      WATCHDOG_INTERVAL_SECONDS, [this]() {
+        if (channel_)
+          channel_->checkWatchdog();
+      });
 
   LOG_INFO << "FfmpegTaskService initialized: "
-           << "maxConcurrent=" << maxConcurrent << ", maxRetries=" << maxRetries
-           << ", threadPoolSize=" << threadCount;
+           << "totalConcurrent=" << totalConcurrent
+           << ", maxRetries=" << maxRetries
+           << ", priorityAgingSeconds=" << agingSeconds;
+}
+
+void FfmpegTaskService::startAdaptiveConcurrency(
+    const FfmpegAdaptiveConfig &config) {
+  if (!config.enabled)
+    return;
+
+  auto lane = channel_->findLane(config.lane);
+  if (!lane) {
+    LOG_WARN << "FfmpegTaskService: adaptive concurrency lane '" << config.lane
+             << "' not found, controller disabled";
+    return;
+  }
+
+  adaptiveConfig_ = config;
+  adaptiveLane_ = *lane;
+  adaptiveConfig_.minConcurrent = std::max(adaptiveConfig_.minConcurrent, 1);
+  adaptiveConfig_.maxConcurrent =
+      std::max(adaptiveConfig_.maxConcurrent, adaptiveConfig_.minConcurrent);
+  adaptiveConfig_.minConcurrent =
+      std::min(adaptiveConfig_.minConcurrent, adaptiveConfig_.maxConcurrent);
+
+  // 初始上限收敛到 [min, max] 内
+  auto stats = channel_->getQueueStats();
+  size_t current = stats.lanes[adaptiveLane_].maxConcurrent;
+  size_t clamped = std::clamp<size_t>(
+      current, static_cast<size_t>(adaptiveConfig_.minConcurrent),
+      static_cast<size_t>(adaptiveConfig_.maxConcurrent));
+  if (clamped != current) {
+    channel_->setLaneConcurrency(adaptiveLane_, clamped);
+  }
+
+  loadSampler_.sample(); // 建立 /proc/stat 基线
+  lastSampleTime_ = std::chrono::steady_clock::now();
+  double interval = std::max(adaptiveConfig_.intervalSeconds, 1);
+  adaptiveTimerId_ = drogon::app().getLoop()->runEvery(
+      interval, [this]() { adjustConcurrency(); });
+
+  LOG_INFO << "FfmpegTaskService: adaptive concurrency enabled for lane "
+           << adaptiveConfig_.lane << ", range [" << adaptiveConfig_.minConcurrent
+           << ", " << adaptiveConfig_.maxConcurrent << "], interval "
+           << interval << "s";
+}
+
+void FfmpegTaskService::adjustConcurrency() {
+  if (!channel_)
+    return;
+
+  auto load = loadSampler_.sample();
+  auto stats = channel_->getQueueStats();
+  const auto &lane = stats.lanes[adaptiveLane_];
+  size_t limit = lane.maxConcurrent;
+  size_t minLimit = static_cast<size_t>(adaptiveConfig_.minConcurrent);
+  size_t maxLimit = static_cast<size_t>(adaptiveConfig_.maxConcurrent);
+
+  // lane 本区间的吞吐：各运行任务已处理时长的增量之和 / 区间时长。
+  // 不使用 task.speed：它是从任务开始算起的平均倍率，反映不出本区间的变化。
+  auto now = std::chrono::steady_clock::now();
+  double intervalMs =
+      std::chrono::duration<double, std::milli>(now - lastSampleTime_).count();
+  lastSampleTime_ = now;
+  long long processedMs = 0;
+  std::map<std::string, int> progress;
+  for (const auto &task : channel_->getRunningTasks()) {
+    if (channel_->laneOf(task.type) != adaptiveLane_)
+      continue;
+    progress[task.id] = task.progressTime;
+    // 本区间新开始的任务从 0 算起；进度回退（重新开始）时同样按当前值计
+    auto it = lastProgress_.find(task.id);
+    int previous = it != lastProgress_.end() ? it->second : 0;
+    processedMs += task.progressTime >= previous ? task.progressTime - previous
+                                                 : task.progressTime;
+  }
+  lastProgress_ = std::move(progress);
+  double laneSpeed = intervalMs > 0 ? processedMs / intervalMs : 0.0;
+
+  bool cpuPressured = load.cpuPressure >= 0 &&
+                      load.cpuPressure > adaptiveConfig_.cpuPressureHigh;
+  bool ioPressured = load.ioPressure >= 0 &&
+                     load.ioPressure > adaptiveConfig_.ioPressureHigh;
+  bool cpuSaturated =
+      load.cpuBusy >= 0 && load.cpuBusy > adaptiveConfig_.cpuBusyHigh;
+  bool backlogged = lane.pending > 0 && lane.running >= limit;
+
+  size_t next = limit;
+  const char *reason = nullptr;
+
+  if (cpuPressured || ioPressured) {
+    // 乘性减：压力超限时减半
+    next = std::max(minLimit, limit / 2);
+    reason = cpuPressured ? "cpu pressure" : "io pressure";
+    probeSpeed_.reset();
+    adaptiveHold_ = false;
+  } else if (probeSpeed_) {
+    // 上一轮试探性加一：本区间吞吐没有高于试探前的区间，说明已到瓶颈，退回
+    if (lane.running >= limit && laneSpeed <= *probeSpeed_) {
+      next = std::max(minLimit, limit - 1);
+      reason = "no speedup";
+      adaptiveHold_ = true;
+    }
+    probeSpeed_.reset();
+  } else if (adaptiveHold_) {
+    adaptiveHold_ = false;
+  } else if (backlogged && !cpuSaturated && limit < maxLimit) {
+    // 加性增：有积压且 CPU 有余量
+    next = limit + 1;
+    reason = "backlog";
+    probeSpeed_ = laneSpeed;
+  }
+
+  LOG_DEBUG << "FfmpegTaskService: adaptive sample lane=" << lane.name
+            << " limit=" << limit << " running=" << lane.running
+            << " pending=" << lane.pending << " cpuBusy=" << load.cpuBusy
+            << " cpuPsi=" << load.cpuPressure << " ioPsi=" << load.ioPressure
+            << " speed=" << laneSpeed;
+
+  if (next != limit) {
+    channel_->setLaneConcurrency(adaptiveLane_, next);
+    LOG_INFO << "FfmpegTaskService: lane " << lane.name << " concurrency "
+             << limit << " -> " << next << " (" << reason << ")";
+  }
 }
 
 void FfmpegTaskService::shutdown() {
   LOG_INFO << "FfmpegTaskService shutdown";
+  if (adaptiveTimerId_ != 0) {
+    drogon::app().getLoop()->invalidateTimer(adaptiveTimerId_);
+    adaptiveTimerId_ = 0;
+  }
+  if (watchdogTimerId_ != 0) {
+    drogon::app().getLoop()->invalidateTimer(watchdogTimerId_);
+    watchdogTimerId_ = 0;
+  }
   if (channel_) {
     channel_->close();
     channel_.reset();
   }
-  threadServicePtr_.reset();
 }
 
 void FfmpegTaskService::ConvertMp4Task(
@@ -541,6 +1150,7 @@ void FfmpegTaskService::ConvertMp4Task(
   std::string resultMessage;
   bool hasError = false;
   int successCount = 0;
+  auto failureKind = live2mp3::utils::FfmpegFailureKind::NONE;
 
   auto progressCallback = [item](const live2mp3::utils::FfmpegPipeInfo &info) {
     if (auto detail = item.lock()) {
@@ -561,23 +1171,36 @@ void FfmpegTaskService::ConvertMp4Task(
 
     auto pidCallback = [detail](pid_t pid) { detail->setPid(pid); };
 
+    live2mp3::utils::FfmpegExitInfo exitInfo;
+    std::string audioPath;
     auto outputPath = converterService->convertToAv1Mp4(
-        inputPath, outputDir, progressCallback, cancelCheck, pidCallback);
+        inputPath, outputDir, progressCallback, cancelCheck, pidCallback,
+        &exitInfo, &audioPath);
     if (outputPath) {
       successCount++;
-      detail->setOutputFiles({*outputPath});
+      // 单次解码模式下第二个输出为片段 MP3
+      if (audioPath.empty()) {
+        detail->setOutputFiles({*outputPath});
+      } else {
+        detail->setOutputFiles({*outputPath, audioPath});
+      }
       LOG_INFO << "ConvertMp4Task: 转换成功 " << inputPath << " -> "
                << *outputPath;
     } else {
       hasError = true;
+      failureKind = accumulateFailure(failureKind, exitInfo);
       detail->setOutputFiles({});
-      resultMessage += "转换失败: " + inputPath + "; ";
-      LOG_ERROR << "ConvertMp4Task: 转换失败 " << inputPath;
+      resultMessage += "转换失败: " + inputPath + " (" +
+                       live2mp3::utils::describeFfmpegExit(exitInfo) + "); ";
+      LOG_ERROR << "ConvertMp4Task: 转换失败 " << inputPath << " ["
+                << live2mp3::utils::failureKindName(failureKind) << "]";
     }
   }
 
   if (!hasError) {
     resultMessage = "成功转换 " + std::to_string(successCount) + " 个文件";
+  } else if (!detail->isCancelled()) {
+    throw FfmpegTaskError(failureKind, resultMessage);
   }
 
   LOG_DEBUG << "ConvertMp4Task 完成: " << resultMessage;
@@ -626,6 +1249,7 @@ void FfmpegTaskService::ConvertMp3Task(
   std::string resultMessage;
   bool hasError = false;
   int successCount = 0;
+  auto failureKind = live2mp3::utils::FfmpegFailureKind::NONE;
 
   auto progressCallback = [item](const live2mp3::utils::FfmpegPipeInfo &info) {
     if (auto detail = item.lock()) {
@@ -646,8 +1270,10 @@ void FfmpegTaskService::ConvertMp3Task(
 
     auto pidCallback = [detail](pid_t pid) { detail->setPid(pid); };
 
+    live2mp3::utils::FfmpegExitInfo exitInfo;
     auto outputPath = converterService->extractMp3FromVideo(
-        inputPath, outputDir, progressCallback, cancelCheck, pidCallback);
+        inputPath, outputDir, progressCallback, cancelCheck, pidCallback,
+        &exitInfo);
     if (outputPath) {
       successCount++;
       detail->setOutputFiles({*outputPath});
@@ -655,14 +1281,19 @@ void FfmpegTaskService::ConvertMp3Task(
                << *outputPath;
     } else {
       hasError = true;
+      failureKind = accumulateFailure(failureKind, exitInfo);
       detail->setOutputFiles({});
-      resultMessage += "提取失败: " + inputPath + "; ";
-      LOG_ERROR << "ConvertMp3Task: 提取失败 " << inputPath;
+      resultMessage += "提取失败: " + inputPath + " (" +
+                       live2mp3::utils::describeFfmpegExit(exitInfo) + "); ";
+      LOG_ERROR << "ConvertMp3Task: 提取失败 " << inputPath << " ["
+                << live2mp3::utils::failureKindName(failureKind) << "]";
     }
   }
 
   if (!hasError) {
     resultMessage = "成功提取 " + std::to_string(successCount) + " 个文件";
+  } else if (!detail->isCancelled()) {
+    throw FfmpegTaskError(failureKind, resultMessage);
   }
 
   LOG_DEBUG << "ConvertMp3Task 完成: " << resultMessage;
@@ -714,15 +1345,59 @@ void FfmpegTaskService::MergeTask(std::weak_ptr<FfmpegTaskProcDetail> item) {
 
   auto pidCallback = [detail](pid_t pid) { detail->setPid(pid); };
 
-  auto outputPath = mergerService->mergeVideoFiles(
-      inputFiles, outputDir, progressCallback, cancelCheck, pidCallback);
+  live2mp3::utils::FfmpegExitInfo exitInfo;
+  auto outputPath =
+      mergerService->mergeVideoFiles(inputFiles, outputDir, progressCallback,
+                                     cancelCheck, pidCallback, &exitInfo);
   if (outputPath) {
-    detail->setOutputFiles({*outputPath});
     LOG_INFO << "MergeTask: 合并成功 " << inputFiles.size() << " 个文件 -> "
              << *outputPath;
+
+    // 各片段已有 MP3（单次解码或并行提取）：直接按帧拼接（已提前拼接时复用），
+    // 第二个输出为最终 MP3；缺少任一片段或拼接失败时由调用方单独提取
+    std::vector<std::string> audioFiles;
+    if (auto converterService =
+            drogon::app().getSharedPlugin<ConverterService>()) {
+      for (const auto &file : inputFiles) {
+        std::string audioPath = converterService->sidecarAudioPath(file);
+        std::error_code ec;
+        if (!fs::exists(audioPath, ec)) {
+          audioFiles.clear();
+          break;
+        }
+        audioFiles.push_back(std::move(audioPath));
+      }
+    }
+
+    std::optional<std::string> audioOutput;
+    if (!audioFiles.empty() && !detail->isCancelled()) {
+      live2mp3::utils::FfmpegExitInfo audioExitInfo;
+      audioOutput =
+          mergerService->mergeAudioFiles(audioFiles, outputDir, progressCallback,
+                                         cancelCheck, pidCallback, &audioExitInfo);
+      if (!audioOutput) {
+        LOG_WARN << "MergeTask: 片段 MP3 拼接失败 ("
+                 << live2mp3::utils::describeFfmpegExit(audioExitInfo) << ")";
+      }
+    }
+
+    if (audioOutput) {
+      detail->setOutputFiles({*outputPath, *audioOutput});
+      LOG_INFO << "MergeTask: 片段 MP3 拼接成功 -> " << *audioOutput;
+    } else {
+      detail->setOutputFiles({*outputPath});
+    }
   } else {
     detail->setOutputFiles({});
-    LOG_ERROR << "MergeTask: 合并失败 " << inputFiles.size() << " 个文件";
+    auto failureKind = accumulateFailure(
+        live2mp3::utils::FfmpegFailureKind::NONE, exitInfo);
+    LOG_ERROR << "MergeTask: 合并失败 " << inputFiles.size() << " 个文件 ["
+              << live2mp3::utils::failureKindName(failureKind) << "]";
+    if (!detail->isCancelled()) {
+      throw FfmpegTaskError(failureKind,
+                            "合并失败: " +
+                                live2mp3::utils::describeFfmpegExit(exitInfo));
+    }
   }
 
   LOG_DEBUG << "MergeTask 完成";
@@ -741,6 +1416,7 @@ FfmpegTaskService::getTaskFunc(FfmpegTaskType type) {
     return ConvertMp3Task;
   case FfmpegTaskType::MERGE:
     return MergeTask;
+  case FfmpegTaskType::FOLLOW_MP4: // 需要跟随状态，执行函数由 FollowService 提供
   case FfmpegTaskType::OTHER:
   default:
     return nullptr;
@@ -752,26 +1428,24 @@ void FfmpegTaskService::submitTask(
     const std::vector<std::string> &outputFiles,
     std::function<void(FfmpegTaskResult)> onComplete,
     std::function<void(std::weak_ptr<FfmpegTaskProcDetail>)> callback,
-    std::function<void(std::weak_ptr<FfmpegTaskProcDetail>)> customFunc) {
+    std::function<void(std::weak_ptr<FfmpegTaskProcDetail>)> customFunc,
+    std::optional<FfmpegTaskPriority> priority) {
 
   if (!channel_) {
     LOG_ERROR << "FfmpegTaskService::submitTask: channel_ 未初始化";
     return;
   }
 
-  auto taskFunc = getTaskFunc(type);
+  auto taskFunc = customFunc ? customFunc : getTaskFunc(type);
   if (!taskFunc) {
-    if (customFunc) {
-      taskFunc = customFunc;
-    } else {
-      LOG_ERROR
-          << "FfmpegTaskService::submitTask: 未知任务类型且未提供自定义函数";
-      return;
-    }
+    LOG_ERROR
+        << "FfmpegTaskService::submitTask: 未知任务类型且未提供自定义函数";
+    return;
   }
 
   FfmpegTaskInput input;
   input.type = type;
+  input.priority = priority.value_or(defaultTaskPriority(type));
   input.files = files;
   input.outputFiles = outputFiles;
   input.func = taskFunc;
@@ -786,3 +1460,10 @@ std::vector<FfmpegTaskProcess> FfmpegTaskService::getRunningTasks() {
   }
   return channel_->getRunningTasks();
 }
+
+FfmpegQueueStats FfmpegTaskService::getQueueStats() {
+  if (!channel_) {
+    return {};
+  }
+  return channel_->getQueueStats();
+}
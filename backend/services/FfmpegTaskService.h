@@ -1,11 +1,15 @@
 #pragma once
 
 #include "../utils/FfmpegUtils.h"
+#include "../utils/LoadSampler.h"
 #include "../utils/ThreadSafe.hpp"
 #include "services/CommonThreadService.h"
 #include "services/ConfigService.h"
+#include <array>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <deque>
 #include <drogon/plugins/Plugin.h>
 #include <drogon/utils/coroutine.h>
 #include <functional>
@@ -14,9 +18,11 @@
 #include <memory>
 #include <mutex>
 #include <optional>
-#include <queue>
+#include <random>
+#include <stdexcept>
 #include <shared_mutex>
 #include <string>
+#include <string_view>
 #include <thread>
 #include <vector>
 
@@ -46,7 +52,103 @@ enum class FfmpegTaskType {
   CONVERT_MP4 = 0, ///< 转换mp4任务
   CONVERT_MP3,     ///< 转换mp3任务
   MERGE,           ///< 合并任务
-  OTHER            ///< 其他任务
+  OTHER,           ///< 其他任务
+  FOLLOW_MP4       ///< 边录边转 mp4 任务（跟随写入中的文件，由调用方提供执行函数）
+};
+
+/**
+ * @brief 任务优先级（数值越小越先调度）
+ *
+ * 合并和提取 MP3 只需几秒到几分钟，并且直接产出最终文件，
+ * 不应排在耗时数小时的 AV1 转码之后。
+ */
+enum class FfmpegTaskPriority {
+  HIGH = 0, ///< 高：合并、提取 MP3
+  NORMAL,   ///< 普通：自定义任务
+  LOW       ///< 低：转换 mp4（AV1 转码）
+};
+
+/// 优先级数量
+inline constexpr size_t FFMPEG_TASK_PRIORITY_COUNT = 3;
+
+/**
+ * @brief 按任务类型获取默认优先级
+ */
+FfmpegTaskPriority defaultTaskPriority(FfmpegTaskType type);
+
+/**
+ * @brief 优先级名称（"high" / "normal" / "low"）
+ */
+const char *taskPriorityName(FfmpegTaskPriority priority);
+
+/**
+ * @brief 任务类型名称（"convert_mp4" / "convert_mp3" / "merge" / "other" /
+ * "follow_mp4"）
+ */
+const char *taskTypeName(FfmpegTaskType type);
+
+/**
+ * @brief 解析任务类型名称，未知返回 std::nullopt
+ */
+std::optional<FfmpegTaskType> parseTaskType(std::string_view name);
+
+/// 任务类型数量
+inline constexpr size_t FFMPEG_TASK_TYPE_COUNT = 5;
+
+/**
+ * @brief 任务通道（lane）定义
+ */
+struct FfmpegLaneSpec {
+  std::string name;                 ///< 通道名称
+  size_t maxConcurrent = 1;         ///< 通道内最大并发任务数
+  std::vector<FfmpegTaskType> types; ///< 进入该通道的任务类型
+};
+
+/**
+ * @brief 任务通道中各优先级、各 lane 的任务数
+ *
+ * pending/running 数组下标为 FfmpegTaskPriority 的数值，为所有 lane 之和。
+ */
+struct FfmpegQueueStats {
+  struct Lane {
+    std::string name;
+    size_t maxConcurrent = 0;
+    size_t pending = 0;
+    size_t running = 0;
+  };
+
+  std::array<size_t, FFMPEG_TASK_PRIORITY_COUNT> pending{}; ///< 排队中
+  std::array<size_t, FFMPEG_TASK_PRIORITY_COUNT> running{}; ///< 执行中
+  std::vector<Lane> lanes;                                  ///< 各 lane 占用
+  uint64_t watchdogAborts = 0; ///< 被看门狗中止的任务次数
+  size_t retryDelayed = 0;     ///< 退避等待中的重试任务数
+};
+
+/**
+ * @brief 带失败分类的任务异常
+ *
+ * 任务处理函数抛出该异常表示失败；暂时性失败会退避后重试，
+ * 确定性失败直接结束。其他异常按暂时性处理。
+ */
+class FfmpegTaskError : public std::runtime_error {
+public:
+  FfmpegTaskError(live2mp3::utils::FfmpegFailureKind kind,
+                  const std::string &message)
+      : std::runtime_error(message), kind_(kind) {}
+
+  live2mp3::utils::FfmpegFailureKind kind() const { return kind_; }
+
+private:
+  live2mp3::utils::FfmpegFailureKind kind_;
+};
+
+/**
+ * @brief 运行中任务的看门狗配置
+ */
+struct FfmpegWatchdogConfig {
+  int taskTimeoutSeconds = 600;       ///< 基础墙钟预算（秒），<=0 不限
+  double timeoutDurationFactor = 4.0; ///< 每秒输入时长追加的预算（秒）
+  int stallTimeoutSeconds = 180;      ///< 进度停滞上限（秒），<=0 不检测
 };
 
 /**
@@ -54,6 +156,7 @@ enum class FfmpegTaskType {
  */
 struct FfmpegTaskBase {
   FfmpegTaskType type;                  ///< 任务类型
+  FfmpegTaskPriority priority = FfmpegTaskPriority::NORMAL; ///< 调度优先级
   std::vector<std::string> files;       ///< 关联的文件列表
   std::vector<std::string> outputFiles; ///< 输出文件列表
 };
@@ -77,6 +180,8 @@ struct FfmpegTaskProcess : public FfmpegTaskBase {
   std::string id;            ///< 任务唯一ID
   FfmpegTaskStatus status;   ///< 当前状态
   std::string resultMessage; ///< 结果消息或错误信息
+  live2mp3::utils::FfmpegFailureKind failureKind =
+      live2mp3::utils::FfmpegFailureKind::NONE; ///< 失败分类
   long long createTime;      ///< 创建时间戳
   long long startTime;       ///< 开始时间戳
   long long endTime;         ///< 结束时间戳
@@ -141,6 +246,19 @@ public:
    */
   bool isCancelled() const;
 
+  /**
+   * @brief 由看门狗中止任务：记录原因并置取消标志
+   *
+   * 不直接杀进程，由执行线程中 runFfmpegWithProgress 的取消检查终止 FFmpeg，
+   * 避免与其 waitpid 竞争。与 cancel() 不同，中止的任务仍可重试。
+   */
+  void abort(const std::string &reason);
+
+  /**
+   * @brief 是否被看门狗中止
+   */
+  bool isAborted() const;
+
   /**
    * @brief 获取任务结果
    */
@@ -223,6 +341,8 @@ private:
   std::promise<FfmpegTaskResult> promise_;
   std::shared_future<FfmpegTaskResult> future_;
   std::atomic<bool> cancelled_{false};
+  std::atomic<bool> aborted_{false};
+  std::string abortReason_; ///< 看门狗中止原因（受 mutexStatic_ 保护）
   std::atomic<pid_t> pid_{0};
   std::atomic<int> totalDuration_{0};
 
@@ -238,8 +358,15 @@ private:
 /**
  * @brief 任务通道
  *
- * 使用专用调度线程检查队列，在线程池空闲且限额允许时提交任务。
- * 失败的任务会自动重入队列末尾进行重试。
+ * 使用专用调度线程检查队列，在 lane 限额允许时为任务启动独立的执行线程。
+ * 执行线程大部分时间阻塞在等待 FFmpeg 退出上（输出与回收由 ProcessReactor
+ * 完成），因此并发上限与公共线程池大小无关。
+ * 任务按类型分入若干 lane，每个 lane 有独立的并发上限，
+ * 使重负载的 AV1 转码与以 I/O 为主的合并/提取互不占用名额。
+ * lane 内每个优先级一个 FIFO 队列，有空闲槽位时取有效优先级最高的队首任务；
+ * 排队每满 agingSeconds 秒有效优先级提升一级，避免低优先级任务饿死。
+ * 暂时性失败的任务按指数退避（带抖动）后重入所属队列末尾，
+ * 确定性失败（输入损坏、编码器缺失等）不重试。
  */
 class FfAsyncChannel {
 public:
@@ -261,14 +388,56 @@ public:
    */
   std::vector<FfmpegTaskProcess> getRunningTasks();
 
+  /**
+   * @brief 获取各优先级、各 lane 的排队/执行任务数
+   */
+  FfmpegQueueStats getQueueStats();
+
+  /**
+   * @brief 按名称查找 lane 下标
+   */
+  std::optional<size_t> findLane(const std::string &name) const;
+
+  /**
+   * @brief 任务类型所属的 lane 下标
+   */
+  size_t laneOf(FfmpegTaskType type) const;
+
+  /**
+   * @brief 调整 lane 的并发上限
+   *
+   * 调低时正在运行的任务不受影响，只是暂停派发直到低于新上限。
+   */
+  void setLaneConcurrency(size_t lane, size_t maxConcurrent);
+
+  /**
+   * @brief 设置看门狗参数
+   */
+  void setWatchdog(const FfmpegWatchdogConfig &config);
+
+  /**
+   * @brief 设置重试退避参数（秒），baseSeconds <= 0 表示立即重试
+   */
+  void setRetryBackoff(int baseSeconds, int maxSeconds);
+
+  /**
+   * @brief 检查运行中的任务，中止超时或进度停滞的任务
+   *
+   * 墙钟预算 = taskTimeoutSeconds + timeoutDurationFactor × 输入时长，
+   * 输入时长未知时只做停滞检测。OTHER 类型任务不报告 FFmpeg 进度，不检查。
+   *
+   * @return 本次中止的任务数
+   */
+  size_t checkWatchdog();
+
   /**
    * @brief 构造函数
-   * @param maxConcurrent 最大并发任务数
+   * @param lanes lane 列表，第一个为默认 lane，接收其余 lane 未认领的任务类型
    * @param maxRetries 最大重试次数
-   * @param threadServicePtr 线程池服务指针
+   * @param agingSeconds 优先级老化间隔（秒），<= 0 表示严格按优先级
    */
-  FfAsyncChannel(size_t maxConcurrent, int maxRetries,
-                 std::shared_ptr<CommonThreadService> threadServicePtr);
+  FfAsyncChannel(std::vector<FfmpegLaneSpec> lanes, int maxRetries,
+                 int agingSeconds = 600);
 
   ~FfAsyncChannel();
 
@@ -276,21 +445,57 @@ private:
   struct QueueItem {
     std::shared_ptr<FfmpegTaskProcDetail> task;
     std::function<void(FfmpegTaskResult)> onComplete;
+    FfmpegTaskPriority priority;
+    size_t lane;                                       ///< 所属 lane 下标
+    std::chrono::steady_clock::time_point enqueueTime; ///< 最近一次入队时间
+  };
+
+  /**
+   * @brief 看门狗对单个运行任务的跟踪状态
+   */
+  struct WatchState {
+    int lastProgressTime = -1;   ///< 上次看到的 FFmpeg time（毫秒）
+    long long lastAdvanceMs = 0; ///< 进度最后一次变化的时间戳（毫秒）
+  };
+
+  struct Lane {
+    std::string name;
+    size_t maxConcurrent;
+    size_t running = 0;
+    std::array<std::deque<std::shared_ptr<QueueItem>>,
+               FFMPEG_TASK_PRIORITY_COUNT>
+        queues;
   };
 
   std::mutex mutex_;
-  std::queue<std::shared_ptr<QueueItem>> pendingQueue_;
+  std::vector<Lane> lanes_;
+  std::array<size_t, FFMPEG_TASK_TYPE_COUNT> laneOfType_{}; ///< 类型 -> lane
   std::unordered_map<std::string, std::shared_ptr<FfmpegTaskProcDetail>>
       taskMap_;
+  std::unordered_map<std::string, WatchState> watchStates_;
+  FfmpegWatchdogConfig watchdog_;
+  uint64_t watchdogAborts_ = 0;
+
+  // 重试退避：到期时间 -> 任务，到期后移回所属队列
+  std::multimap<std::chrono::steady_clock::time_point,
+                std::shared_ptr<QueueItem>>
+      delayedRetries_;
+  int retryBackoffBaseSeconds_ = 30;
+  int retryBackoffMaxSeconds_ = 600;
+  std::mt19937 rng_{std::random_device{}()};
 
-  size_t maxConcurrent_;
   int maxRetries_;
+  int agingSeconds_;
   size_t runningCount_{0};
+  std::array<size_t, FFMPEG_TASK_PRIORITY_COUNT> runningByPriority_{};
   std::atomic<bool> closed_{false};
   std::thread schedulerThread_;
   std::condition_variable cv_;
   std::condition_variable drainCv_;
-  std::shared_ptr<CommonThreadService> threadServicePtr_;
+
+  // 每个运行中的任务一个执行线程；结束后移入 finishedRunners_ 由调度线程 join
+  std::unordered_map<std::string, std::thread> runners_;
+  std::vector<std::thread> finishedRunners_;
 
   /**
    * @brief 调度线程主循环
@@ -298,7 +503,60 @@ private:
   void schedulerLoop();
 
   /**
-   * @brief 任务完成回调（在线程池线程中调用）
+   * @brief 入队到所属 lane、优先级队列末尾（需持有 mutex_）
+   */
+  void enqueueLocked(std::shared_ptr<QueueItem> itemPtr);
+
+  /**
+   * @brief 是否有排队任务（需持有 mutex_）
+   */
+  bool hasPendingLocked() const;
+
+  /**
+   * @brief 是否有 lane 同时存在排队任务和空闲槽位（需持有 mutex_）
+   */
+  bool hasDispatchableLocked() const;
+
+  /**
+   * @brief 从有空闲槽位的 lane 中取出有效优先级最高的队首任务（需持有 mutex_）
+   *
+   * 有效优先级 = 基础优先级 - 排队时长 / agingSeconds_，最低为 HIGH；
+   * 相同时先入队者优先。
+   */
+  std::shared_ptr<QueueItem> popNextLocked();
+
+  /**
+   * @brief 把退避到期的重试任务移回队列（需持有 mutex_）
+   */
+  void promoteDelayedLocked(std::chrono::steady_clock::time_point now);
+
+  /**
+   * @brief 第 retryNum 次重试的退避时长（指数退避 + 抖动，需持有 mutex_）
+   */
+  std::chrono::milliseconds retryDelayLocked(int retryNum);
+
+  /**
+   * @brief 清空所有排队与退避中的任务（需持有 mutex_），返回清除的数量
+   */
+  size_t clearPendingLocked();
+
+  /**
+   * @brief 任务结束后释放槽位（需持有 mutex_）
+   */
+  void releaseSlotLocked(const std::string &taskId, const QueueItem &item);
+
+  /**
+   * @brief 执行线程即将退出，把它移入待回收列表（需持有 mutex_）
+   */
+  void retireRunnerLocked(const std::string &taskId);
+
+  /**
+   * @brief join 已退出的执行线程（不持有 mutex_ 时调用）
+   */
+  void joinFinishedRunners();
+
+  /**
+   * @brief 任务完成回调（在任务的执行线程中调用）
    */
   void onTaskFinished(const std::string &taskId,
                       std::shared_ptr<QueueItem> itemPtr);
@@ -328,7 +586,9 @@ public:
    * @param outputFiles 输出目录/文件列表
    * @param onComplete 任务完成/最终失败时的回调
    * @param callback 可选的任务详情回调（在任务创建后立即调用）
-   * @param customFunc 仅当 type 为 OTHER 时使用的自定义处理函数
+   * @param customFunc 自定义处理函数；OTHER / FOLLOW_MP4 必须提供，其他类型
+   *        提供时替代内置函数（仍按 type 归入 lane、计算优先级与看门狗）
+   * @param priority 调度优先级，未指定时按 defaultTaskPriority(type)
    */
   void submitTask(
       FfmpegTaskType type, const std::vector<std::string> &files,
@@ -337,7 +597,8 @@ public:
       std::function<void(std::weak_ptr<FfmpegTaskProcDetail>)> callback =
           nullptr,
       std::function<void(std::weak_ptr<FfmpegTaskProcDetail>)> customFunc =
-          nullptr);
+          nullptr,
+      std::optional<FfmpegTaskPriority> priority = std::nullopt);
 
   // 任务处理静态函数
   static void ConvertMp4Task(std::weak_ptr<FfmpegTaskProcDetail> item);
@@ -349,11 +610,37 @@ public:
    */
   std::vector<FfmpegTaskProcess> getRunningTasks();
 
+  /**
+   * @brief 获取各优先级的排队/执行任务数
+   */
+  FfmpegQueueStats getQueueStats();
+
 private:
   static std::function<void(std::weak_ptr<FfmpegTaskProcDetail>)>
   getTaskFunc(FfmpegTaskType type);
 
+  /**
+   * @brief 启动自适应并发定时器（配置未启用或 lane 不存在时不启动）
+   */
+  void startAdaptiveConcurrency(const FfmpegAdaptiveConfig &config);
+
+  /**
+   * @brief 自适应并发的一次调整（AIMD，在事件循环线程中调用）
+   */
+  void adjustConcurrency();
+
   std::unique_ptr<FfAsyncChannel> channel_;
-  std::shared_ptr<CommonThreadService> threadServicePtr_;
   std::shared_ptr<ConfigService> configService_;
+
+  // 自适应并发状态（仅由定时器所在的事件循环线程访问）
+  FfmpegAdaptiveConfig adaptiveConfig_;
+  size_t adaptiveLane_ = 0;
+  live2mp3::utils::LoadSampler loadSampler_;
+  std::optional<double> probeSpeed_; ///< 最近一次加并发前的 lane 吞吐
+  /// 上一轮采样时 lane 内各运行任务的已处理时长（毫秒），用于计算区间增量
+  std::map<std::string, int> lastProgress_;
+  std::chrono::steady_clock::time_point lastSampleTime_;
+  bool adaptiveHold_ = false;        ///< 上次已退回，本轮不再试探
+  trantor::TimerId adaptiveTimerId_{0};
+  trantor::TimerId watchdogTimerId_{0};
 };
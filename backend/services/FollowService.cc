@@ -0,0 +1,256 @@
+#include "FollowService.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <drogon/drogon.h>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+void FollowService::initAndStart(const Json::Value &config) {
+  configServicePtr_ = drogon::app().getSharedPlugin<ConfigService>();
+  if (!configServicePtr_) {
+    LOG_FATAL << "Failed to get ConfigService plugin";
+    return;
+  }
+
+  converterServicePtr_ = drogon::app().getSharedPlugin<ConverterService>();
+  if (!converterServicePtr_) {
+    LOG_FATAL << "Failed to get ConverterService plugin";
+    return;
+  }
+
+  ffmpegTaskServicePtr_ = drogon::app().getSharedPlugin<FfmpegTaskService>();
+  if (!ffmpegTaskServicePtr_) {
+    LOG_FATAL << "Failed to get FfmpegTaskService plugin";
+    return;
+  }
+
+  LOG_INFO << "FollowService initialized";
+}
+
+void FollowService::shutdown() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_.clear();
+}
+
+void FollowService::consider(const std::string &path) {
+  auto config = configServicePtr_->getConfig();
+  if (!config.scheduler.follow_mode)
+    return;
+
+  std::string ext = fs::path(path).extension().string();
+  std::transform(ext.begin(), ext.end(), ext.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  const auto &allowed = config.scheduler.follow_extensions;
+  if (std::none_of(allowed.begin(), allowed.end(), [&](std::string a) {
+        std::transform(a.begin(), a.end(), a.begin(),
+                       [](unsigned char c) { return std::tolower(c); });
+        return a == ext;
+      })) {
+    return;
+  }
+
+  // 只跟随仍在写入的文件；早已停止写入的文件等稳定后正常转码
+  std::error_code ec;
+  auto mtime = fs::last_write_time(path, ec);
+  if (ec)
+    return;
+  auto idle = fs::file_time_type::clock::now() - mtime;
+  if (idle > std::chrono::seconds(config.scheduler.follow_idle_seconds))
+    return;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!entries_.try_emplace(path).second)
+      return;
+  }
+
+  fs::path tmpDir = fs::path(config.output.output_root) / "tmp";
+  fs::create_directories(tmpDir, ec);
+
+  LOG_INFO << "开始边录边转: " << path;
+  ffmpegTaskServicePtr_->submitTask(
+      FfmpegTaskType::FOLLOW_MP4, {path}, {tmpDir.string()},
+      [this, path](FfmpegTaskResult result) { onFollowFinished(path, result); },
+      nullptr, [this](std::weak_ptr<FfmpegTaskProcDetail> item) {
+        runFollowTask(item);
+      });
+}
+
+bool FollowService::isFollowing(const std::string &path) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.count(path) > 0;
+}
+
+bool FollowService::attach(const std::string &path, AttachCallback cb) {
+  std::optional<std::string> encoded;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(path);
+    if (it == entries_.end())
+      return false;
+    if (!it->second.done) {
+      it->second.waiters.push_back(std::move(cb));
+      return true;
+    }
+    Entry entry = std::move(it->second);
+    entries_.erase(it);
+    if (entry.ok && isFresh(path, entry))
+      encoded = entry.encodedPath;
+  }
+
+  if (encoded) {
+    LOG_INFO << "使用边录边转结果: " << path << " -> " << *encoded;
+  } else {
+    LOG_WARN << "边录边转结果不可用，回退为普通转码: " << path;
+  }
+  cb(encoded);
+  return true;
+}
+
+void FollowService::runFollowTask(std::weak_ptr<FfmpegTaskProcDetail> item) {
+  auto detail = item.lock();
+  if (!detail) {
+    LOG_WARN << "FollowService::runFollowTask: 任务详情已过期";
+    return;
+  }
+
+  auto result = detail->getProcessResult();
+  if (result.files.empty() || result.outputFiles.empty()) {
+    LOG_ERROR << "FollowService::runFollowTask: 缺少输入文件或输出目录";
+    return;
+  }
+  const std::string &inputPath = result.files[0];
+
+  auto progressCallback = [item](const live2mp3::utils::FfmpegPipeInfo &info) {
+    if (auto detail = item.lock()) {
+      detail->setPipeInfo(info);
+    }
+  };
+  auto cancelCheck = [detail]() {
+    return detail->isCancelled() || !drogon::app().isRunning();
+  };
+  auto pidCallback = [detail](pid_t pid) { detail->setPid(pid); };
+
+  live2mp3::utils::FfmpegExitInfo exitInfo;
+  live2mp3::utils::FileTailer::Result tail;
+  std::string audioPath;
+  auto outputPath = converterServicePtr_->convertToAv1Mp4(
+      inputPath, result.outputFiles[0], progressCallback, cancelCheck,
+      pidCallback, &exitInfo, &audioPath, &tail);
+
+  if (!outputPath) {
+    detail->setOutputFiles({});
+    if (detail->isCancelled())
+      return;
+    // 不重试：文件稳定后会按普通流程重新转码
+    throw FfmpegTaskError(live2mp3::utils::FfmpegFailureKind::PERMANENT,
+                          "边录边转失败: " + inputPath + " (" +
+                              live2mp3::utils::describeFfmpegExit(exitInfo) +
+                              ")");
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(inputPath);
+    if (it == entries_.end()) {
+      // 条目已被清理（服务关闭）：结果无人领取，不留在临时目录
+      Entry orphan;
+      orphan.encodedPath = *outputPath;
+      orphan.audioPath = audioPath;
+      removeOutputs(orphan);
+      detail->setOutputFiles({});
+      return;
+    }
+    it->second.bytes = tail.bytes;
+  }
+  if (audioPath.empty()) {
+    detail->setOutputFiles({*outputPath});
+  } else {
+    detail->setOutputFiles({*outputPath, audioPath});
+  }
+  LOG_INFO << "边录边转完成: " << inputPath << " -> " << *outputPath << " ("
+           << tail.bytes << " 字节"
+           << (tail.writerClosed ? "，录制方已关闭文件" : "") << ")";
+}
+
+void FollowService::onFollowFinished(const std::string &path,
+                                     const FfmpegTaskResult &result) {
+  std::vector<AttachCallback> waiters;
+  std::optional<std::string> encoded;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(path);
+    if (it == entries_.end())
+      return;
+    Entry &entry = it->second;
+    entry.done = true;
+    entry.finishedAt = std::chrono::steady_clock::now();
+    entry.ok = result.status == FfmpegTaskStatus::COMPLETED &&
+               !result.outputFiles.empty();
+    if (entry.ok) {
+      entry.encodedPath = result.outputFiles[0];
+      if (result.outputFiles.size() > 1)
+        entry.audioPath = result.outputFiles[1];
+    }
+    if (entry.waiters.empty())
+      return; // 等待调度器领取
+
+    // 已有批次在等待：当场判断并移交结果
+    waiters = std::move(entry.waiters);
+    if (entry.ok && isFresh(path, entry))
+      encoded = entry.encodedPath;
+    entries_.erase(it);
+  }
+
+  if (!encoded) {
+    LOG_WARN << "边录边转结果不可用，回退为普通转码: " << path;
+  }
+  for (auto &cb : waiters) {
+    cb(encoded);
+  }
+}
+
+bool FollowService::isFresh(const std::string &path, const Entry &entry) {
+  std::error_code ec;
+  auto size = fs::file_size(path, ec);
+  if (!ec && size == entry.bytes)
+    return true;
+
+  LOG_INFO << "边录边转结果已过期（跟随 " << entry.bytes << " 字节，当前 "
+           << (ec ? 0 : size) << " 字节），删除: " << entry.encodedPath;
+  removeOutputs(entry);
+  return false;
+}
+
+void FollowService::removeOutputs(const Entry &entry) {
+  std::error_code ec;
+  if (!entry.encodedPath.empty())
+    fs::remove(entry.encodedPath, ec);
+  if (!entry.audioPath.empty())
+    fs::remove(entry.audioPath, ec);
+}
+
+void FollowService::reap() {
+  auto now = std::chrono::steady_clock::now();
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto it = entries_.begin(); it != entries_.end();) {
+    const Entry &entry = it->second;
+    // 仍在转码或已有批次等待的条目由任务完成回调处理
+    if (!entry.done || !entry.waiters.empty()) {
+      ++it;
+      continue;
+    }
+    std::error_code ec;
+    bool sourceGone = !fs::exists(it->first, ec);
+    if (!sourceGone && now - entry.finishedAt < RESULT_TTL) {
+      ++it;
+      continue;
+    }
+    LOG_INFO << "清理无人领取的边录边转结果: " << it->first
+             << (sourceGone ? "（源文件已不存在）" : "（超时未加入批次）");
+    removeOutputs(entry);
+    it = entries_.erase(it);
+  }
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "ConfigService.h"
+#include "ConverterService.h"
+#include "FfmpegTaskService.h"
+#include <chrono>
+#include <drogon/plugins/Plugin.h>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief 边录边转服务
+ *
+ * 扫描发现仍在写入的流式文件（follow_extensions）时立即提交 FOLLOW_MP4 任务，
+ * 由 FFmpeg 跟随文件增长转码，录制结束时转码也基本完成。
+ * 文件稳定并加入批次后，调度器通过 attach 领取结果：
+ * 跟随读取的字节数与当前文件大小一致时直接使用，否则视为过期并删除输出，
+ * 由调用方回退为普通转码。
+ */
+class FollowService : public drogon::Plugin<FollowService> {
+public:
+  /// 领取结果回调：成功时为转码输出路径，失败或过期时为 nullopt
+  using AttachCallback = std::function<void(std::optional<std::string>)>;
+
+  FollowService() = default;
+  FollowService(const FollowService &) = delete;
+  FollowService &operator=(const FollowService &) = delete;
+
+  void initAndStart(const Json::Value &config) override;
+  void shutdown() override;
+
+  /**
+   * @brief 检查尚未稳定的文件，符合条件时开始跟随转码
+   *
+   * 需要开启 follow_mode、扩展名在 follow_extensions 中、最近
+   * follow_idle_seconds 内仍有写入，且尚未被跟随。输出写入
+   * output_root/tmp，与批次转码的临时目录一致。
+   *
+   * @param path 源文件路径
+   */
+  void consider(const std::string &path);
+
+  /**
+   * @brief 文件是否有尚未领取的跟随任务
+   */
+  bool isFollowing(const std::string &path);
+
+  /**
+   * @brief 领取文件的跟随转码结果
+   *
+   * 已完成时在当前线程调用 cb，仍在转码时在完成后调用；结果只能领取一次。
+   *
+   * @return 文件未被跟随时返回 false，此时不会调用 cb
+   */
+  bool attach(const std::string &path, AttachCallback cb);
+
+  /**
+   * @brief 清理无人领取的跟随结果
+   *
+   * 源文件已不存在（被删除、移走），或完成后超过 RESULT_TTL 仍未加入批次
+   * （被规则排除、已弃用、批次失败等）的条目被移除，并删除其转码输出与片段 MP3。
+   * 由调度器每轮调用。
+   */
+  void reap();
+
+private:
+  /// 完成后等待领取的最长时间
+  static constexpr std::chrono::hours RESULT_TTL{6};
+
+  struct Entry {
+    bool done = false;
+    bool ok = false;
+    std::string encodedPath;
+    std::string audioPath;        ///< 单次解码时同时输出的片段 MP3
+    uint64_t bytes = 0;           ///< 跟随读取的字节数
+    std::chrono::steady_clock::time_point finishedAt;
+    std::vector<AttachCallback> waiters;
+  };
+
+  /**
+   * @brief FOLLOW_MP4 任务执行函数
+   */
+  void runFollowTask(std::weak_ptr<FfmpegTaskProcDetail> item);
+
+  /**
+   * @brief 跟随任务结束（含重试后的最终结果），记录结果并通知等待者
+   */
+  void onFollowFinished(const std::string &path,
+                        const FfmpegTaskResult &result);
+
+  /**
+   * @brief 结果是否与当前文件一致（否则删除输出）
+   */
+  static bool isFresh(const std::string &path, const Entry &entry);
+
+  /**
+   * @brief 删除条目的转码输出与片段 MP3
+   */
+  static void removeOutputs(const Entry &entry);
+
+  std::shared_ptr<ConfigService> configServicePtr_;
+  std::shared_ptr<ConverterService> converterServicePtr_;
+  std::shared_ptr<FfmpegTaskService> ffmpegTaskServicePtr_;
+
+  std::unordered_map<std::string, Entry> entries_;
+  std::mutex mutex_;
+};
@@ -0,0 +1,258 @@
+#include "MediaInfoService.h"
+#include "../utils/FfmpegUtils.h"
+#include "../utils/MediaProbe.h"
+#include <drogon/drogon.h>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+// MediaInfo 便捷方法
+const MediaStream *MediaInfo::firstStream(const std::string &codecType) const {
+  for (const auto &s : streams) {
+    if (s.codec_type == codecType)
+      return &s;
+  }
+  return nullptr;
+}
+
+void to_json(nlohmann::json &j, const MediaStream &s) {
+  j = nlohmann::json{
+      {"index", s.index},
+      {"codec_type", s.codec_type},
+      {"codec_name", s.codec_name},
+      {"width", s.width},
+      {"height", s.height},
+      {"sample_rate", s.sample_rate},
+      {"channels", s.channels},
+      {"bit_rate", s.bit_rate},
+  };
+}
+
+void from_json(const nlohmann::json &j, MediaStream &s) {
+  s.index = j.value("index", 0);
+  s.codec_type = j.value("codec_type", "");
+  s.codec_name = j.value("codec_name", "");
+  s.width = j.value("width", 0);
+  s.height = j.value("height", 0);
+  s.sample_rate = j.value("sample_rate", 0);
+  s.channels = j.value("channels", 0);
+  s.bit_rate = j.value("bit_rate", int64_t{0});
+}
+
+void to_json(nlohmann::json &j, const MediaInfo &m) {
+  j = nlohmann::json{
+      {"fingerprint", m.fingerprint},
+      {"duration_ms", m.duration_ms},
+      {"bit_rate", m.bit_rate},
+      {"format_name", m.format_name},
+      {"source", m.source},
+  };
+  if (m.has_streams) {
+    j["streams"] = m.streams;
+  }
+}
+
+namespace {
+
+const char *containerName(live2mp3::utils::ContainerFormat format) {
+  switch (format) {
+  case live2mp3::utils::ContainerFormat::FLV:
+    return "flv";
+  case live2mp3::utils::ContainerFormat::MPEGTS:
+    return "mpegts";
+  case live2mp3::utils::ContainerFormat::MP4:
+    return "mp4";
+  default:
+    return "";
+  }
+}
+
+/// ffprobe 的数值字段多为字符串（"44100"、"123.456"），兼容两种写法
+double jsonNumber(const nlohmann::json &obj, const char *key) {
+  auto it = obj.find(key);
+  if (it == obj.end())
+    return 0;
+  if (it->is_number())
+    return it->get<double>();
+  if (it->is_string()) {
+    try {
+      return std::stod(it->get<std::string>());
+    } catch (...) {
+    }
+  }
+  return 0;
+}
+
+/// 解析 ffprobe -show_format -show_streams 的 JSON 输出
+std::optional<MediaInfo> parseFfprobeJson(const std::string &text) {
+  auto root = nlohmann::json::parse(text, nullptr, false);
+  if (!root.is_object() || !root.contains("format"))
+    return std::nullopt;
+
+  const auto &format = root["format"];
+  MediaInfo info;
+  info.duration_ms = static_cast<int>(jsonNumber(format, "duration") * 1000);
+  info.bit_rate = static_cast<int64_t>(jsonNumber(format, "bit_rate"));
+  info.format_name = format.value("format_name", "");
+  info.has_streams = true;
+
+  if (root.contains("streams") && root["streams"].is_array()) {
+    for (const auto &st : root["streams"]) {
+      MediaStream s;
+      s.index = st.value("index", 0);
+      s.codec_type = st.value("codec_type", "");
+      s.codec_name = st.value("codec_name", "");
+      s.width = st.value("width", 0);
+      s.height = st.value("height", 0);
+      s.sample_rate = static_cast<int>(jsonNumber(st, "sample_rate"));
+      s.channels = st.value("channels", 0);
+      s.bit_rate = static_cast<int64_t>(jsonNumber(st, "bit_rate"));
+      info.streams.push_back(std::move(s));
+    }
+  }
+  if (info.duration_ms <= 0)
+    return std::nullopt;
+  return info;
+}
+
+} // namespace
+
+void MediaInfoService::initAndStart(const Json::Value &config) {
+  LOG_INFO << "MediaInfoService initialized (" << repo_.count()
+           << " cached entries)";
+}
+
+void MediaInfoService::shutdown() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  cache_.clear();
+}
+
+std::shared_ptr<const MediaInfo>
+MediaInfoService::getMediaInfo(const std::string &filePath,
+                               const std::string &fingerprint, Detail detail) {
+  std::string key =
+      fingerprint.empty() ? fingerprints_.getFingerprint(filePath) : fingerprint;
+  if (key.empty()) {
+    failures_++;
+    LOG_WARN << "[MediaInfoService] 无法计算文件指纹: " << filePath;
+    return nullptr;
+  }
+
+  if (auto info = lookup(key, detail)) {
+    return info;
+  }
+  return probe(filePath, key, detail);
+}
+
+std::shared_ptr<const MediaInfo>
+MediaInfoService::lookup(const std::string &fingerprint, Detail detail) {
+  auto sufficient = [detail](const MediaInfo &info) {
+    return detail == Detail::DURATION || info.has_streams;
+  };
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = cache_.find(fingerprint);
+    if (it != cache_.end() && sufficient(*it->second)) {
+      memoryHits_++;
+      return it->second;
+    }
+  }
+
+  auto row = repo_.findByFingerprint(fingerprint);
+  if (!row || !sufficient(*row))
+    return nullptr;
+  dbHits_++;
+  auto info = std::make_shared<const MediaInfo>(std::move(*row));
+  remember(info);
+  return info;
+}
+
+std::shared_ptr<const MediaInfo>
+MediaInfoService::probe(const std::string &filePath,
+                        const std::string &fingerprint, Detail detail) {
+  std::optional<MediaInfo> result;
+
+  if (detail == Detail::DURATION) {
+    if (auto durationMs = live2mp3::utils::probeDurationNative(filePath)) {
+      MediaInfo info;
+      info.duration_ms = *durationMs;
+      info.format_name =
+          containerName(live2mp3::utils::detectContainer(filePath));
+      info.source = "native";
+      std::error_code ec;
+      auto size = fs::file_size(filePath, ec);
+      if (!ec && *durationMs > 0) {
+        info.bit_rate = static_cast<int64_t>(size * 8000 / *durationMs);
+      }
+      nativeProbes_++;
+      result = std::move(info);
+    }
+  }
+
+  if (!result) {
+    if (auto json = live2mp3::utils::runFfprobeJson(filePath)) {
+      ffprobeProbes_++;
+      result = parseFfprobeJson(*json);
+      if (result) {
+        result->source = "ffprobe";
+      } else {
+        LOG_WARN << "[MediaInfoService] 无法解析 ffprobe 输出: " << filePath;
+      }
+    }
+  }
+
+  if (!result) {
+    failures_++;
+    return nullptr;
+  }
+
+  result->fingerprint = fingerprint;
+  auto info = std::make_shared<const MediaInfo>(std::move(*result));
+  if (!repo_.upsert(*info)) {
+    LOG_WARN << "[MediaInfoService] 写入 media_info 失败: " << filePath;
+  }
+  remember(info);
+  LOG_DEBUG << "[MediaInfoService] Probed " << filePath << " ("
+            << info->source << "): " << info->duration_ms << " ms";
+  return info;
+}
+
+void MediaInfoService::remember(const std::shared_ptr<const MediaInfo> &info) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (cache_.size() >= MAX_CACHED) {
+    cache_.clear();
+  }
+  cache_[info->fingerprint] = info;
+}
+
+int MediaInfoService::getDuration(const std::string &filePath,
+                                  const std::string &fingerprint) {
+  auto info = getMediaInfo(filePath, fingerprint);
+  return info ? info->duration_ms : -1;
+}
+
+int MediaInfoService::getTotalDuration(
+    const std::vector<std::string> &filePaths) {
+  int totalDuration = 0;
+  for (const auto &path : filePaths) {
+    int duration = getDuration(path);
+    if (duration < 0) {
+      return -1; // 任何一个文件失败则返回 -1
+    }
+    totalDuration += duration;
+  }
+  return totalDuration;
+}
+
+MediaInfoService::Stats MediaInfoService::getStats() const {
+  Stats stats;
+  stats.memoryHits = memoryHits_.load();
+  stats.dbHits = dbHits_.load();
+  stats.nativeProbes = nativeProbes_.load();
+  stats.ffprobeProbes = ffprobeProbes_.load();
+  stats.failures = failures_.load();
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats.cached = cache_.size();
+  return stats;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "../models/MediaInfo.h"
+#include "../repos/MediaInfoRepo.h"
+#include "../utils/FingerprintIndex.h"
+#include <atomic>
+#include <drogon/plugins/Plugin.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief 媒体元数据服务
+ *
+ * 以文件指纹为键缓存时长、码率、流编码与分辨率，查找顺序为
+ * 内存 -> media_info 表 -> 探测。探测优先使用原生容器解析
+ * （只得到时长与总码率），无法识别或需要流信息时调用一次
+ * JSON 格式的 ffprobe 并整行保存。同一文件在稳定检测、转码、
+ * 合并等阶段只探测一次，重启后仍然有效。
+ *
+ * 未提供指纹时按路径计算（stat 未变化时使用内存中的指纹缓存）。
+ */
+class MediaInfoService : public drogon::Plugin<MediaInfoService> {
+public:
+  /// 需要的信息粒度
+  enum class Detail {
+    DURATION, ///< 只需要时长（允许原生探测的结果）
+    STREAMS   ///< 需要流信息（必要时补调 ffprobe）
+  };
+
+  struct Stats {
+    uint64_t memoryHits = 0;
+    uint64_t dbHits = 0;
+    uint64_t nativeProbes = 0;
+    uint64_t ffprobeProbes = 0;
+    uint64_t failures = 0;
+    size_t cached = 0; ///< 内存中的条目数
+  };
+
+  MediaInfoService() = default;
+  MediaInfoService(const MediaInfoService &) = delete;
+  MediaInfoService &operator=(const MediaInfoService &) = delete;
+
+  void initAndStart(const Json::Value &config) override;
+  void shutdown() override;
+
+  /**
+   * @brief 获取媒体元数据
+   *
+   * @param filePath 文件路径（缓存未命中时用于探测）
+   * @param fingerprint 已知的文件指纹，留空则按路径计算
+   * @return 失败返回 nullptr
+   */
+  std::shared_ptr<const MediaInfo>
+  getMediaInfo(const std::string &filePath, const std::string &fingerprint = "",
+               Detail detail = Detail::DURATION);
+
+  /**
+   * @brief 获取媒体时长（毫秒），失败返回 -1
+   */
+  int getDuration(const std::string &filePath,
+                  const std::string &fingerprint = "");
+
+  /**
+   * @brief 获取多个文件的总时长（毫秒），任一失败返回 -1
+   */
+  int getTotalDuration(const std::vector<std::string> &filePaths);
+
+  Stats getStats() const;
+
+private:
+  /// 内存缓存条目上限，超过时清空（数据库中仍有完整记录）
+  static constexpr size_t MAX_CACHED = 4096;
+
+  std::shared_ptr<const MediaInfo> lookup(const std::string &fingerprint,
+                                          Detail detail);
+  std::shared_ptr<const MediaInfo> probe(const std::string &filePath,
+                                         const std::string &fingerprint,
+                                         Detail detail);
+  void remember(const std::shared_ptr<const MediaInfo> &info);
+
+  MediaInfoRepo repo_;
+  live2mp3::utils::FingerprintIndex fingerprints_;
+
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, std::shared_ptr<const MediaInfo>> cache_;
+
+  std::atomic<uint64_t> memoryHits_{0};
+  std::atomic<uint64_t> dbHits_{0};
+  std::atomic<uint64_t> nativeProbes_{0};
+  std::atomic<uint64_t> ffprobeProbes_{0};
+  std::atomic<uint64_t> failures_{0};
+};
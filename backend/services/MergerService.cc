@@ -1,25 +1,51 @@
 #include "MergerService.h"
 #include "../utils/FfmpegUtils.h"
+#include "../utils/Mp3Concat.h"
 #include "ConfigService.h"
+#include <atomic>
 #include <drogon/drogon.h>
 #include <filesystem>
-#include <fmt/format.h>
 #include <fstream>
 #include <iomanip>
 #include <regex>
 #include <sstream>
+#include <unistd.h>
 
 namespace fs = std::filesystem;
 
+namespace {
+
+/**
+ * @brief 临时文件名后缀（进程号 + 序号）
+ *
+ * 同一输出可能被提前拼接与合并任务同时生成，各自写入不同的临时文件，
+ * 完成后再重命名到最终路径，不会交错写坏同一个文件。
+ */
+std::string uniqueTempSuffix() {
+  static std::atomic<uint64_t> counter{0};
+  return "_" + std::to_string(getpid()) + "_" +
+         std::to_string(counter.fetch_add(1));
+}
+
+} // namespace
+
 void MergerService::initAndStart(const Json::Value &config) {
   configServicePtr = drogon::app().getSharedPlugin<ConfigService>();
   if (!configServicePtr) {
     LOG_FATAL << "获取 ConfigService 插件失败";
     return;
   }
+  mediaInfoServicePtr = drogon::app().getSharedPlugin<MediaInfoService>();
+  if (!mediaInfoServicePtr) {
+    LOG_FATAL << "获取 MediaInfoService 插件失败";
+    return;
+  }
 }
 
-void MergerService::shutdown() { configServicePtr.reset(); }
+void MergerService::shutdown() {
+  configServicePtr.reset();
+  mediaInfoServicePtr.reset();
+}
 
 std::optional<std::chrono::system_clock::time_point>
 MergerService::parseTime(const std::string &filename) {
@@ -81,7 +107,8 @@ std::optional<std::string> MergerService::mergeVideoFiles(
     const std::vector<std::string> &files, const std::string &outputDir,
     live2mp3::utils::FfmpegProgressCallback progressCallback,
     live2mp3::utils::CancelCheckCallback cancelCheck,
-    std::function<void(pid_t)> pidCallback) {
+    std::function<void(pid_t)> pidCallback,
+    live2mp3::utils::FfmpegExitInfo *exitInfo) {
   if (files.empty())
     return std::nullopt;
 
@@ -94,29 +121,115 @@ std::optional<std::string> MergerService::mergeVideoFiles(
     return files[0];
   }
 
+  // 使用配置的扩展名
+  return concatFiles(files, outputDir, config.output.video_extension, true,
+                     progressCallback, cancelCheck, pidCallback, exitInfo);
+}
+
+std::optional<std::string> MergerService::mergeAudioFiles(
+    const std::vector<std::string> &files, const std::string &outputDir,
+    live2mp3::utils::FfmpegProgressCallback progressCallback,
+    live2mp3::utils::CancelCheckCallback cancelCheck,
+    std::function<void(pid_t)> pidCallback,
+    live2mp3::utils::FfmpegExitInfo *exitInfo) {
+  if (files.empty())
+    return std::nullopt;
+
+  if (files.size() == 1) {
+    LOG_INFO << "只有单个文件，跳过合并: " << files[0];
+    return files[0];
+  }
+
+  auto config = configServicePtr->getConfig();
+  std::string stem = fs::path(files[0]).stem().string();
+  std::string extension = config.output.audio_extension;
+  fs::path outputPath = fs::path(outputDir) / (stem + "_merged" + extension);
+  fs::path writingPath =
+      fs::path(outputDir) /
+      (stem + "_merged_writing" + uniqueTempSuffix() + extension);
+
+  // 已有比所有片段都新的拼接结果（流结束后已提前拼接）时直接复用
+  std::error_code ec;
+  auto outputTime = fs::last_write_time(outputPath, ec);
+  if (!ec) {
+    bool fresh = true;
+    for (const auto &f : files) {
+      auto t = fs::last_write_time(f, ec);
+      if (ec || t > outputTime) {
+        fresh = false;
+        break;
+      }
+    }
+    if (fresh) {
+      LOG_INFO << "MP3 拼接结果已是最新，跳过: " << outputPath.string();
+      return outputPath.string();
+    }
+  }
+
+  // 原生按帧拼接：重建 Xing/LAME 头，时长与跳转正确，耗时只取决于磁盘读写
+  live2mp3::utils::Mp3ConcatStats stats;
+  if (live2mp3::utils::concatMp3Files(files, writingPath.string(), &stats)) {
+    fs::rename(writingPath, outputPath, ec);
+    if (!ec) {
+      LOG_INFO << "MP3 拼接成功: " << files.size() << " 个文件 -> "
+               << outputPath.string() << " (" << stats.frames << " 帧, "
+               << stats.durationMs / 1000 << " 秒)";
+      return outputPath.string();
+    }
+    LOG_ERROR << "重命名文件失败: " << writingPath.string() << " -> "
+              << outputPath.string() << ", 错误: " << ec.message();
+    fs::remove(writingPath, ec);
+    return std::nullopt;
+  }
+
+  // 参数不一致等无法按帧拼接的情况交给合并命令；
+  // 拼接只需几秒，不为进度百分比逐个探测 MP3 时长
+  LOG_WARN << "MP3 按帧拼接失败，改用合并命令: " << outputPath.string();
+  return concatFiles(files, outputDir, extension, false, progressCallback,
+                     cancelCheck, pidCallback, exitInfo);
+}
+
+std::optional<std::string> MergerService::concatFiles(
+    const std::vector<std::string> &files, const std::string &outputDir,
+    const std::string &extension, bool withDuration,
+    live2mp3::utils::FfmpegProgressCallback progressCallback,
+    live2mp3::utils::CancelCheckCallback cancelCheck,
+    std::function<void(pid_t)> pidCallback,
+    live2mp3::utils::FfmpegExitInfo *exitInfo) {
+  auto config = configServicePtr->getConfig();
+
   // 使用第一个文件的文件名作为基础，添加 "_merged" 后缀
   fs::path firstPath(files[0]);
   std::string stem = firstPath.stem().string();
-  // 使用配置的扩展名
-  std::string extension = config.output.video_extension;
   std::string outputName = stem + "_merged" + extension;
   std::string outputPath = (fs::path(outputDir) / outputName).string();
 
   // 生成临时写入路径（添加 _writing 后缀）
-  std::string writingName = stem + "_merged_writing" + extension;
+  std::string suffix = uniqueTempSuffix();
+  std::string writingName = stem + "_merged_writing" + suffix + extension;
   std::string writingPath = (fs::path(outputDir) / writingName).string();
 
   // 创建 concat 列表文件
   std::string listPath =
-      (fs::path(outputDir) / (stem + "_concat_list.txt")).string();
+      (fs::path(outputDir) / (stem + "_concat_list" + suffix + ".txt"))
+          .string();
   {
     std::ofstream listFile(listPath);
     if (!listFile.is_open()) {
       LOG_ERROR << "创建列表文件失败: " << listPath;
       return std::nullopt;
     }
+    // concat 列表中单引号需写成 '\''（结束引号、转义、重新开始引号）
     for (const auto &f : files) {
-      listFile << "file '" << f << "'\n";
+      std::string escaped;
+      escaped.reserve(f.size());
+      for (char c : f) {
+        if (c == '\'')
+          escaped += "'\\''";
+        else
+          escaped.push_back(c);
+      }
+      listFile << "file '" << escaped << "'\n";
     }
   }
 
@@ -126,25 +239,29 @@ std::optional<std::string> MergerService::mergeVideoFiles(
   // FFmpeg 命令：使用配置中的命令模板
   // -c copy 表示直接复制流，不重新编码（要求所有文件编码格式一致）
   // 先输出到临时文件
-  std::string cmdTemplate = config.ffmpeg.merge_command;
-  std::string cmd;
+  auto commands = configServicePtr->getCompiledCommands();
+  std::vector<std::string> argv;
   try {
-    cmd = fmt::format(fmt::runtime(cmdTemplate), fmt::arg("input", listPath),
-                      fmt::arg("output", writingPath));
+    argv = commands->merge.render(listPath, writingPath);
+    if (config.ffmpeg.progress_pipe) {
+      argv = live2mp3::utils::withProgressPipe(std::move(argv));
+    }
   } catch (const std::exception &e) {
     LOG_ERROR << "Failed to format merge command: " << e.what();
     return std::nullopt;
   }
 
   // 获取所有输入文件的总时长用于计算进度百分比
-  int totalDuration = live2mp3::utils::getTotalMediaDuration(files);
+  int totalDuration =
+      withDuration ? mediaInfoServicePtr->getTotalDuration(files) : 0;
   if (totalDuration < 0) {
     LOG_WARN << "无法获取媒体总时长，进度百分比将不可用";
     totalDuration = 0;
   }
 
   bool success = live2mp3::utils::runFfmpegWithProgress(
-      cmd, progressCallback, totalDuration, cancelCheck, nullptr, pidCallback);
+      argv, progressCallback, totalDuration, cancelCheck, nullptr, pidCallback,
+      exitInfo);
 
   // 清理列表文件
   if (fs::exists(listPath)) {
@@ -2,6 +2,7 @@
 
 #include "../utils/FfmpegUtils.h"
 #include "ConfigService.h"
+#include "MediaInfoService.h"
 #include <chrono>
 #include <drogon/plugins/Plugin.h>
 #include <optional>
@@ -33,6 +34,7 @@ public:
    * @param files 待合并的文件路径列表
    * @param outputDir 输出目录
    * @param progressCallback 可选的进度回调，实时报告合并进度
+   * @param exitInfo 可选，失败时填充 FFmpeg 退出信息用于分类
    * @return std::optional<std::string>
    * 成功返回合并后的文件路径，失败返回nullopt
    */
@@ -40,7 +42,25 @@ public:
       const std::vector<std::string> &files, const std::string &outputDir,
       live2mp3::utils::FfmpegProgressCallback progressCallback = nullptr,
       live2mp3::utils::CancelCheckCallback cancelCheck = nullptr,
-      std::function<void(pid_t)> pidCallback = nullptr);
+      std::function<void(pid_t)> pidCallback = nullptr,
+      live2mp3::utils::FfmpegExitInfo *exitInfo = nullptr);
+
+  /**
+   * @brief 按帧拼接多个 MP3 片段（不解码）
+   *
+   * 用于各片段已有 MP3 的情况（单次解码或并行提取），输出命名与
+   * mergeVideoFiles 一致（首个文件名 + "_merged" + 音频扩展名），单文件时
+   * 直接返回该文件。优先使用原生按帧拼接（重建 Xing/LAME 头），失败时
+   * 回退到合并命令；输出已存在且比所有输入都新时直接复用。
+   *
+   * @return std::optional<std::string> 成功返回 MP3 路径，失败返回nullopt
+   */
+  std::optional<std::string> mergeAudioFiles(
+      const std::vector<std::string> &files, const std::string &outputDir,
+      live2mp3::utils::FfmpegProgressCallback progressCallback = nullptr,
+      live2mp3::utils::CancelCheckCallback cancelCheck = nullptr,
+      std::function<void(pid_t)> pidCallback = nullptr,
+      live2mp3::utils::FfmpegExitInfo *exitInfo = nullptr);
 
   /**
    * @brief 从文件名解析时间
@@ -66,5 +86,17 @@ public:
   static std::string parseTitle(const std::string &filename);
 
 private:
+  /// 使用合并命令模板把 files 拼接为 outputDir 下的 <首个文件名>_merged<extension>，
+  /// withDuration 为 false 时不获取总时长（进度百分比不可用）
+  std::optional<std::string>
+  concatFiles(const std::vector<std::string> &files,
+              const std::string &outputDir, const std::string &extension,
+              bool withDuration,
+              live2mp3::utils::FfmpegProgressCallback progressCallback,
+              live2mp3::utils::CancelCheckCallback cancelCheck,
+              std::function<void(pid_t)> pidCallback,
+              live2mp3::utils::FfmpegExitInfo *exitInfo);
+
   std::shared_ptr<ConfigService> configServicePtr;
+  std::shared_ptr<MediaInfoService> mediaInfoServicePtr;
 };
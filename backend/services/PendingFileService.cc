@@ -1,8 +1,9 @@
 #include "PendingFileService.h"
-#include "../utils/FfmpegUtils.h"
+#include "../utils/FileUtils.h"
 #include "ConfigService.h"
 #include "MergerService.h"
 #include <drogon/drogon.h>
+#include <algorithm>
 #include <filesystem>
 #include <iomanip>
 #include <sstream>
@@ -35,10 +36,15 @@ void to_json(nlohmann::json &j, const PendingFile &p) {
 }
 
 void PendingFileService::initAndStart(const Json::Value &config) {
+  mediaInfoServicePtr_ = drogon::app().getSharedPlugin<MediaInfoService>();
+  if (!mediaInfoServicePtr_) {
+    LOG_FATAL << "MediaInfoService not found";
+    return;
+  }
   LOG_INFO << "PendingFileService initialized";
 }
 
-void PendingFileService::shutdown() {}
+void PendingFileService::shutdown() { mediaInfoServicePtr_.reset(); }
 
 int PendingFileService::addOrUpdateFile(const std::string &filepath,
                                         const std::string &fingerprint) {
@@ -51,6 +57,20 @@ int PendingFileService::addOrUpdateFile(const std::string &filepath,
   auto existing = repo_.findByPath(filepath);
 
   if (existing.has_value()) {
+    // 旧版本指纹：按旧算法重算，一致说明文件未变，原地升级指纹并保留状态
+    int oldVersion =
+        live2mp3::utils::getFingerprintVersion(existing->fingerprint);
+    if (existing->fingerprint != fingerprint && oldVersion > 0 &&
+        oldVersion != live2mp3::utils::FINGERPRINT_VERSION &&
+        live2mp3::utils::calculateFileFingerprint(filepath, oldVersion) ==
+            existing->fingerprint &&
+        repo_.updateFingerprint(dirPath, fname, fingerprint)) {
+      LOG_DEBUG << "[addOrUpdateFile] Migrated fingerprint v" << oldVersion
+                << " -> v" << live2mp3::utils::FINGERPRINT_VERSION << ": "
+                << filepath;
+      existing->fingerprint = fingerprint;
+    }
+
     // File exists, check if fingerprint matches
     if (existing->fingerprint == fingerprint) {
       // Fingerprint matches. Check status.
@@ -95,11 +115,76 @@ int PendingFileService::addOrUpdateFile(const std::string &filepath,
   }
 }
 
+std::vector<int> PendingFileService::addOrUpdateFiles(
+    const std::vector<std::pair<std::string, std::string>> &files) {
+  std::vector<int> counts(files.size(), -1);
+  if (files.empty())
+    return counts;
+
+  // 1. 按 (目录, 文件名) 一次性读取本批文件的已有记录
+  std::vector<PendingFileRepo::FingerprintUpsert> items;
+  items.reserve(files.size());
+  std::vector<std::pair<std::string, std::string>> keys;
+  keys.reserve(files.size());
+  for (const auto &[filepath, fingerprint] : files) {
+    fs::path p(filepath);
+    items.push_back({p.parent_path().string(), p.filename().string(),
+                     fingerprint});
+    keys.emplace_back(items.back().dirPath, items.back().filename);
+  }
+  auto existing = repo_.findByKeys(keys);
+
+  // 2. 在内存中筛掉无需写库的文件（指纹相同且已不是 pending），
+  //    旧版本指纹与写入一起在第 3 步的事务中迁移
+  std::vector<PendingFileRepo::FingerprintUpsert> writes;
+  std::vector<PendingFileRepo::FingerprintUpsert> migrations;
+  std::vector<size_t> writeIndex;
+  for (size_t i = 0; i < files.size(); ++i) {
+    const auto &[filepath, fingerprint] = files[i];
+    auto it = existing.find(filepath);
+    if (it != existing.end()) {
+      auto &row = it->second;
+      int oldVersion = live2mp3::utils::getFingerprintVersion(row.fingerprint);
+      if (row.fingerprint != fingerprint && oldVersion > 0 &&
+          oldVersion != live2mp3::utils::FINGERPRINT_VERSION &&
+          live2mp3::utils::calculateFileFingerprint(filepath, oldVersion) ==
+              row.fingerprint) {
+        migrations.push_back(items[i]);
+        row.fingerprint = fingerprint;
+      }
+      if (row.fingerprint == fingerprint && row.status != "pending") {
+        continue;
+      }
+    }
+    writes.push_back(std::move(items[i]));
+    writeIndex.push_back(i);
+  }
+
+  // 3. 单事务写入
+  if (writes.empty() && migrations.empty())
+    return counts;
+  auto written = repo_.upsertFingerprints(writes, migrations);
+  if (written.size() != writes.size()) {
+    if (!writes.empty())
+      LOG_ERROR << "[addOrUpdateFiles] Batch upsert failed ("
+                << writes.size() << " files)";
+    return counts;
+  }
+  for (size_t k = 0; k < writeIndex.size(); ++k) {
+    counts[writeIndex[k]] = written[k];
+  }
+
+  LOG_DEBUG << "[addOrUpdateFiles] " << files.size() << " files, "
+            << writes.size() << " written";
+  return counts;
+}
+
 std::vector<PendingFile> PendingFileService::getStableFiles(int minCount) {
   return repo_.findStableWithMinCount(minCount);
 }
 
-bool PendingFileService::markAsStable(const std::string &filepath) {
+bool PendingFileService::markAsStable(const std::string &filepath,
+                                      const std::string &fingerprint) {
   fs::path p(filepath);
   std::string fname = p.filename().string();
 
@@ -111,7 +196,7 @@ bool PendingFileService::markAsStable(const std::string &filepath) {
 
   if (parsedTime.has_value()) {
     // 2. Get media duration
-    int durationMs = live2mp3::utils::getMediaDuration(filepath);
+    int durationMs = mediaInfoServicePtr_->getDuration(filepath, fingerprint);
     if (durationMs == -1) {
       LOG_WARN << "[markAsStable] Cannot get duration for " << filepath
                << ", marking as deprecated";
@@ -212,6 +297,20 @@ bool PendingFileService::isProcessed(const std::string &md5) {
   return repo_.existsByFingerprint(md5);
 }
 
+bool PendingFileService::isFileProcessed(const std::string &filepath,
+                                         const std::string &fingerprint) {
+  if (isProcessed(fingerprint))
+    return true;
+
+  auto existing = repo_.findByPath(filepath);
+  if (!existing || existing->status != "completed")
+    return false;
+  int oldVersion = live2mp3::utils::getFingerprintVersion(existing->fingerprint);
+  return oldVersion > 0 && oldVersion != live2mp3::utils::FINGERPRINT_VERSION &&
+         live2mp3::utils::calculateFileFingerprint(filepath, oldVersion) ==
+             existing->fingerprint;
+}
+
 std::vector<PendingFile> PendingFileService::getCompletedFiles() {
   return repo_.findByStatus("completed");
 }
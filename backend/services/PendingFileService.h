@@ -2,6 +2,7 @@
 
 #include "../repos/BatchTaskRepo.h"
 #include "../repos/PendingFileRepo.h"
+#include "MediaInfoService.h"
 #include "models/PendingFile.h"
 #include <drogon/plugins/Plugin.h>
 #include <optional>
@@ -37,6 +38,18 @@ public:
    */
   int addOrUpdateFile(const std::string &filepath, const std::string &md5);
 
+  /**
+   * @brief 批量添加或更新文件指纹
+   *
+   * 与 addOrUpdateFile 语义相同，但只按本批文件的 (目录, 文件名) 一次性读取
+   * 已有记录，并在单个事务中完成全部指纹迁移/插入/重置/计数递增。
+   *
+   * @param files (文件路径, 指纹) 列表
+   * @return std::vector<int> 与输入顺序对应的 stable_count，-1 表示已处理或失败
+   */
+  std::vector<int> addOrUpdateFiles(
+      const std::vector<std::pair<std::string, std::string>> &files);
+
   /**
    * @brief 获取满足稳定性条件的文件
    *
@@ -51,13 +64,16 @@ public:
    * @brief 标记文件为稳定状态
    *
    * 将文件状态从 "pending" 更新为 "stable"，表示已经通过稳定性检查，
-   * 准备进入转换队列。
+   * 准备进入转换队列。时长来自 MediaInfoService，稳定时的探测结果
+   * 会被后续转码、合并阶段复用。
    *
    * @param filepath 文件路径
+   * @param fingerprint 已知的文件指纹，留空则按路径计算
    * @return true 操作成功
    * @return false 操作失败
    */
-  bool markAsStable(const std::string &filepath);
+  bool markAsStable(const std::string &filepath,
+                    const std::string &fingerprint = "");
 
   /**
    * @brief 获取所有稳定状态的文件
@@ -198,6 +214,18 @@ public:
    */
   bool isProcessed(const std::string &md5);
 
+  /**
+   * @brief 检查文件是否已处理（兼容旧版本指纹）
+   *
+   * 先按当前版本指纹查询；未命中且同路径的已完成记录仍为旧版本指纹时，
+   * 按旧算法重算比较（v1 为头尾各 50KB 采样），已是当前版本的记录不重算。
+   *
+   * @param filepath 文件路径
+   * @param fingerprint 文件当前版本的指纹
+   */
+  bool isFileProcessed(const std::string &filepath,
+                       const std::string &fingerprint);
+
   /**
    * @brief 获取所有已完成的文件
    *
@@ -247,6 +275,7 @@ public:
 private:
   PendingFileRepo repo_;
   BatchTaskRepo batchRepo_;
+  std::shared_ptr<MediaInfoService> mediaInfoServicePtr_;
 
   /**
    * @brief 清理临时目录
@@ -2,53 +2,21 @@
 #include "ConfigService.h"
 #include <drogon/drogon.h>
 #include <filesystem>
-#include <regex>
 
 namespace fs = std::filesystem;
 
-// Helper for Glob matching
-static bool globMatch(const std::string &str, const std::string &pattern) {
-  std::string reStr;
-  for (size_t i = 0; i < pattern.size(); ++i) {
-    char c = pattern[i];
-    if (c == '*')
-      reStr += ".*";
-    else if (c == '?')
-      reStr += ".";
-    else if (std::string(".^+|{}()[]\\").find(c) != std::string::npos) {
-      reStr += "\\";
-      reStr += c;
-    } else {
-      reStr += c;
-    }
-  }
-  // Glob usually matches the whole string
-  // But for subdirs, maybe we match the name? Yes.
-  try {
-    std::regex re(reStr);
-    return std::regex_match(str, re);
-  } catch (...) {
+namespace {
+
+/**
+ * @brief path 是否位于 root 目录下（按路径分隔符边界比较，/rec/ab 不属于 /rec/a）
+ */
+bool isUnderRoot(const std::string &path, const std::string &root) {
+  if (path.size() <= root.size() || path.compare(0, root.size(), root) != 0)
     return false;
-  }
+  return root.back() == '/' || path[root.size()] == '/';
 }
 
-static bool checkRule(const std::string &subDirName, const FilterRule &rule) {
-  if (rule.type == "exact") {
-    return subDirName == rule.pattern;
-  } else if (rule.type == "regex") {
-    try {
-      std::regex re(rule.pattern);
-      return std::regex_search(subDirName,
-                               re); // Use search for flexibility or match?
-      // "search" is more forgiving (partial match ok if regex not anchored).
-    } catch (...) {
-      return false;
-    }
-  } else if (rule.type == "glob") {
-    return globMatch(subDirName, rule.pattern);
-  }
-  return false;
-}
+} // namespace
 
 void ScannerService::initAndStart(const Json::Value &config) {
   configServicePtr = drogon::app().getSharedPlugin<ConfigService>();
@@ -58,15 +26,19 @@ void ScannerService::initAndStart(const Json::Value &config) {
   }
 }
 
-void ScannerService::shutdown() { configServicePtr.reset(); }
+void ScannerService::shutdown() {
+  watcher_.stop();
+  configServicePtr.reset();
+}
 
-ScannerService::ScanResult ScannerService::scan() {
+ScannerService::ScanResult ScannerService::scan(const FileCallback &onFile) {
   ScanResult result;
   auto config = configServicePtr->getConfig();
   auto scannerConfig = config.scanner;
+  auto rules = configServicePtr->getCompiledRules();
 
-  for (const auto &rootConfig : scannerConfig.video_roots) {
-    auto rootPath = rootConfig.path;
+  for (const auto &rootRules : rules->roots()) {
+    const auto &rootPath = rootRules.rootPath;
     if (rootPath.empty())
       continue;
     if (!fs::exists(rootPath)) {
@@ -78,9 +50,10 @@ ScannerService::ScanResult ScannerService::scan() {
       for (const auto &entry : fs::recursive_directory_iterator(rootPath)) {
         if (entry.is_regular_file()) {
           std::string path = entry.path().string();
-          // Pass rootConfig to shouldInclude
-          if (shouldInclude(path, rootConfig, scannerConfig.extensions)) {
+          if (shouldInclude(path, rootRules, scannerConfig.extensions)) {
             result.files.push_back(path);
+            if (onFile)
+              onFile(path);
           }
         }
       }
@@ -91,9 +64,102 @@ ScannerService::ScanResult ScannerService::scan() {
   return result;
 }
 
-bool ScannerService::shouldInclude(const std::string &filepath,
-                                   const VideoRootConfig &rootConfig,
-                                   const std::vector<std::string> &extensions) {
+ScannerService::ScanResult
+ScannerService::scanChanged(const FileCallback &onFile) {
+  auto config = configServicePtr->getConfig();
+  const auto &scannerConfig = config.scanner;
+
+  if (scannerConfig.scan_mode != "watch") {
+    if (watcher_.isRunning()) {
+      watcher_.stop();
+      std::lock_guard<std::mutex> lock(candidatesMutex_);
+      candidates_.clear();
+      needFullScan_ = true;
+    }
+    return scan(onFile);
+  }
+
+  std::vector<std::string> roots;
+  for (const auto &rootConfig : scannerConfig.video_roots) {
+    roots.push_back(rootConfig.path);
+  }
+
+  // 首次启动或根目录配置变化时（重新）建立监听
+  if (!watcher_.isRunning() || watcher_.getRoots() != roots) {
+    if (!watcher_.start(roots)) {
+      LOG_WARN << "Directory watcher unavailable, falling back to full scan";
+      return scan(onFile);
+    }
+    std::lock_guard<std::mutex> lock(candidatesMutex_);
+    needFullScan_ = true;
+  }
+
+  // 先 drain 再扫描：扫描期间产生的事件留到下一轮
+  auto changes = watcher_.drain();
+
+  std::unique_lock<std::mutex> lock(candidatesMutex_);
+  if (needFullScan_ || changes.overflow) {
+    LOG_INFO << "Watch mode: running full rescan"
+             << (changes.overflow ? " (event overflow)" : "");
+    // 扫描期间不持锁：回调中可能调用 releaseCandidate()
+    fullScanInProgress_ = true;
+    releasedDuringScan_.clear();
+    lock.unlock();
+
+    auto result = scan(onFile);
+
+    lock.lock();
+    candidates_.clear();
+    for (const auto &path : result.files) {
+      if (releasedDuringScan_.count(path) == 0)
+        candidates_.insert(path);
+    }
+    releasedDuringScan_.clear();
+    fullScanInProgress_ = false;
+    needFullScan_ = false;
+    return result;
+  }
+
+  for (const auto &path : changes.removed) {
+    candidates_.erase(path);
+  }
+
+  auto rules = configServicePtr->getCompiledRules();
+  for (const auto &path : changes.files) {
+    for (const auto &rootRules : rules->roots()) {
+      if (rootRules.rootPath.empty() || !isUnderRoot(path, rootRules.rootPath))
+        continue;
+      if (shouldInclude(path, rootRules, scannerConfig.extensions)) {
+        candidates_.insert(path);
+      }
+      break;
+    }
+  }
+
+  ScanResult result;
+  result.fullScan = false;
+  result.files.assign(candidates_.begin(), candidates_.end());
+  LOG_DEBUG << "Watch mode: " << changes.files.size() << " changed, "
+            << result.files.size() << " candidates";
+  lock.unlock();
+
+  if (onFile) {
+    for (const auto &path : result.files)
+      onFile(path);
+  }
+  return result;
+}
+
+void ScannerService::releaseCandidate(const std::string &filepath) {
+  std::lock_guard<std::mutex> lock(candidatesMutex_);
+  candidates_.erase(filepath);
+  if (fullScanInProgress_)
+    releasedDuringScan_.insert(filepath);
+}
+
+bool ScannerService::shouldInclude(
+    const std::string &filepath, const live2mp3::utils::RootRuleSet &rootRules,
+    const std::vector<std::string> &extensions) {
 
   std::string filename = fs::path(filepath).filename().string();
   std::string extension = fs::path(filepath).extension().string();
@@ -113,7 +179,7 @@ bool ScannerService::shouldInclude(const std::string &filepath,
   // Get relative path from root
   try {
     fs::path p(filepath);
-    fs::path root(rootConfig.path);
+    fs::path root(rootRules.rootPath);
     fs::path relative = fs::relative(p, root);
 
     // Determine the "first level subdirectory"
@@ -150,33 +216,7 @@ bool ScannerService::shouldInclude(const std::string &filepath,
     // - Blacklist mode: User specifies "deny list". Root file -> empty != deny
     // rules (unless deny rule matches empty string?). Allow.
 
-    bool isWhitelist = (rootConfig.filter_mode == "whitelist");
-
-    if (rootConfig.rules.empty()) {
-      // If whitelist empty: Allow nothing? Or allow everything? Usually
-      // whitelist empty -> allow nothing. If blacklist empty: Allow everything.
-      if (isWhitelist)
-        return false;
-      else
-        return true;
-    }
-
-    bool ruleMatched = false;
-    for (const auto &rule : rootConfig.rules) {
-      if (checkRule(firstDir, rule)) {
-        ruleMatched = true;
-        break;
-      }
-    }
-
-    if (isWhitelist) {
-      // In whitelist mode, we include ONLY if rule matched
-      return ruleMatched;
-    } else {
-      // In blacklist mode, we include ONLY if rule NOT matched
-      return !ruleMatched;
-    }
-
+    return rootRules.filter.allows(firstDir);
   } catch (const std::exception &) {
     return false;
   }
@@ -1,8 +1,12 @@
 #pragma once
 
 #include "ConfigService.h"
+#include "utils/DirWatcher.h"
 #include <drogon/plugins/Plugin.h>
+#include <functional>
+#include <mutex>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 /**
@@ -10,6 +14,9 @@
  *
  * 负责扫描配置的目录，查找符合条件的文件。
  * 支持多种过滤模式（白名单、黑名单、正则、通配符等）。
+ *
+ * scan_mode = "watch" 时使用 inotify 维护候选文件集合，
+ * 只有新增/变化且尚未稳定的文件会交给稳定性检测阶段。
  */
 class ScannerService : public drogon::Plugin<ScannerService> {
 public:
@@ -18,8 +25,12 @@ public:
 
   struct ScanResult {
     std::vector<std::string> files;
+    bool fullScan = true; ///< 是否为全量遍历的结果
   };
 
+  /// 逐个接收扫描到的文件，用于边遍历边处理
+  using FileCallback = std::function<void(const std::string &)>;
+
   ScannerService() = default;
   ScannerService(const ScannerService &) = delete;
   ScannerService(ScannerService &&) = delete;
@@ -29,14 +40,44 @@ public:
   /**
    * @brief 扫描所有配置的根目录
    *
+   * @param onFile 可选，每发现一个文件立即回调（在扫描线程中调用）
    * @return ScanResult 包含所有发现的文件路径
    */
-  ScanResult scan();
+  ScanResult scan(const FileCallback &onFile = nullptr);
+
+  /**
+   * @brief 获取需要做稳定性检测的文件
+   *
+   * poll 模式下等同于 scan()。
+   * watch 模式下返回候选集合（自上次以来有变化、或尚未确认稳定的文件）；
+   * 首次调用、事件溢出或根目录变化时回退为一次全量扫描。
+   *
+   * @param onFile 可选，每个候选文件的回调，语义同 scan()
+   * @return ScanResult 候选文件列表
+   */
+  ScanResult scanChanged(const FileCallback &onFile = nullptr);
+
+  /**
+   * @brief 将文件移出候选集合
+   *
+   * 文件已稳定或无需处理时由调度器调用；之后该文件再次变化会重新加入。
+   *
+   * @param filepath 文件路径
+   */
+  void releaseCandidate(const std::string &filepath);
 
 private:
   std::shared_ptr<ConfigService> configServicePtr;
 
+  live2mp3::utils::DirWatcher watcher_;
+  std::mutex candidatesMutex_;
+  std::unordered_set<std::string> candidates_;
+  bool needFullScan_ = true;
+  // 全量扫描进行中被释放的文件，扫描结束后不再放回候选集合
+  bool fullScanInProgress_ = false;
+  std::unordered_set<std::string> releasedDuringScan_;
+
   bool shouldInclude(const std::string &filepath,
-                     const VideoRootConfig &rootConfig,
+                     const live2mp3::utils::RootRuleSet &rootRules,
                      const std::vector<std::string> &extensions);
 };
@@ -1,12 +1,41 @@
 #include "SchedulerService.h"
+#include "DatabaseService.h"
 #include "../utils/CoroUtils.hpp"
 #include "../utils/FileUtils.h"
 #include <algorithm>
+#include <condition_variable>
+#include <ctime>
+#include <deque>
 #include <drogon/drogon.h>
 #include <filesystem>
 
 namespace fs = std::filesystem;
 
+namespace {
+
+/**
+ * @brief 稳定性扫描流水线的共享状态
+ *
+ * 遍历(扫描线程) -> paths -> 指纹 Worker(线程池) -> results -> 数据库(扫描线程)
+ *
+ * paths + inFlight + results 的总数不超过 capacity。
+ * 线程池繁忙时扫描线程会自己计算指纹，不依赖 Worker 被调度；
+ * 扫描结束后才被调度到的 Worker 看到 closed 且队列为空会直接退出。
+ */
+struct ScanPipeline {
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::deque<std::string> paths;
+  std::deque<std::pair<std::string, std::string>> results; // 路径, 指纹
+  size_t capacity = 256;
+  size_t inFlight = 0; // 已被 Worker 取走、尚未产出结果
+  bool closed = false;
+
+  size_t pending() const { return paths.size() + inFlight + results.size(); }
+};
+
+} // namespace
+
 void SchedulerService::initAndStart(const Json::Value &config) {
   configServicePtr_ = drogon::app().getSharedPlugin<ConfigService>();
   if (!configServicePtr_) {
@@ -51,12 +80,30 @@ void SchedulerService::initAndStart(const Json::Value &config) {
     return;
   }
 
+  followServicePtr_ = drogon::app().getSharedPlugin<FollowService>();
+  if (!followServicePtr_) {
+    LOG_FATAL << "Failed to get FollowService plugin";
+    return;
+  }
+
+  chunkEncodeServicePtr_ = drogon::app().getSharedPlugin<ChunkEncodeService>();
+  if (!chunkEncodeServicePtr_) {
+    LOG_FATAL << "Failed to get ChunkEncodeService plugin";
+    return;
+  }
+
   batchTaskServicePtr_ = drogon::app().getSharedPlugin<BatchTaskService>();
   if (!batchTaskServicePtr_) {
     LOG_FATAL << "Failed to get BatchTaskService plugin";
     return;
   }
 
+  mediaInfoServicePtr_ = drogon::app().getSharedPlugin<MediaInfoService>();
+  if (!mediaInfoServicePtr_) {
+    LOG_FATAL << "Failed to get MediaInfoService plugin";
+    return;
+  }
+
   initAtomicConfig();
   // 清理临时目录
   pendingFileServicePtr_->cleanupOnStartup();
@@ -64,13 +111,19 @@ void SchedulerService::initAndStart(const Json::Value &config) {
   // 启动时恢复被中断的任务
   batchTaskServicePtr_->recoverInterruptedTasks();
 
-  
+  // 加载指纹索引（与数据库文件放在一起）
+  fingerprintIndexPath_ =
+      DatabaseService::getInstance().getDbPath() + ".fpindex";
+  fingerprintIndex_.load(fingerprintIndexPath_);
 
   start();
   LOG_INFO << "Scheduler init and start";
 }
 
 void SchedulerService::shutdown() {
+  if (!fingerprintIndexPath_.empty()) {
+    fingerprintIndex_.save(fingerprintIndexPath_);
+  }
   configServicePtr_.reset();
   mergerServicePtr_.reset();
   scannerServicePtr_.reset();
@@ -79,6 +132,7 @@ void SchedulerService::shutdown() {
   ffmpegTaskServicePtr_.reset();
   commonThreadServicePtr_.reset();
   batchTaskServicePtr_.reset();
+  mediaInfoServicePtr_.reset();
 }
 
 std::string SchedulerService::getCurrentFile() {
@@ -102,6 +156,7 @@ nlohmann::json SchedulerService::getDetailedStatus() {
   status["scan_running"] = scanRunning_.load();
   status["current_file"] = currentFile_;
   status["current_phase"] = currentPhase_;
+  status["batches_awaiting_merge"] = readinessWheel_.size();
   return status;
 }
 
@@ -121,6 +176,12 @@ void SchedulerService::start() {
           [this]() -> drogon::Task<> { co_await this->runTaskAsync(false); });
     });
 
+    // 批次合并由事件 + 时间轮驱动；启动时从数据库恢复已完成转码的批次
+    for (const auto &progress : batchTaskServicePtr_->loadDrainedBatches()) {
+      scheduleBatchReadiness(progress.batch_id);
+    }
+    drogon::app().getLoop()->runEvery(1.0, [this]() { onReadinessTick(); });
+
     LOG_INFO << "Scheduler started with interval " << interval << "s";
   });
 }
@@ -158,6 +219,9 @@ drogon::Task<void> SchedulerService::runTaskAsync(bool immediate) {
         case FfmpegTaskType::MERGE:
           taskTypeStr = "MERGE";
           break;
+        case FfmpegTaskType::FOLLOW_MP4:
+          taskTypeStr = "FOLLOW_MP4";
+          break;
         default:
           taskTypeStr = "OTHER";
           break;
@@ -211,6 +275,12 @@ drogon::Task<void> SchedulerService::runTaskAsync(bool immediate) {
   setPhase("check_encoded_batches");
   checkEncodedBatches();
 
+  // 直播结束后提前拼接整场 MP3（拼接在线程池中进行）
+  commonThreadServicePtr_->runTask([this]() { assemblePendingAudio(); });
+
+  // 清理无人领取的边录边转结果
+  followServicePtr_->reap();
+
   {
     std::lock_guard<std::mutex> lock(mutex_);
     currentFile_ = "";
@@ -223,31 +293,193 @@ drogon::Task<void> SchedulerService::runTaskAsync(bool immediate) {
 void SchedulerService::runStabilityScan() {
   LOG_INFO << "Phase 1: Running stability scan...";
 
-  auto scanResult = scannerServicePtr_->scan();
-  LOG_INFO << "Found " << scanResult.files.size() << " files to check";
-
   int requiredStableCount = atomicConfig_.stability_checks.load();
+  size_t workerCount = static_cast<size_t>(
+      std::max(0, atomicConfig_.scan_fingerprint_workers.load()));
+  // 扫描线程本身占用线程池中的一个线程
+  size_t poolThreads = commonThreadServicePtr_->getThreadCount();
+  workerCount = std::min(workerCount, poolThreads > 1 ? poolThreads - 1 : 0);
+
+  auto pipeline = std::make_shared<ScanPipeline>();
+  pipeline->capacity = static_cast<size_t>(
+      std::max(1, atomicConfig_.scan_queue_size.load()));
+
+  // 数据库阶段：攒够一批后在一个事务中写库
+  std::vector<std::pair<std::string, std::string>> dbBatch;
+  auto flushBatch = [&]() {
+    if (dbBatch.empty())
+      return;
+    applyStabilityResults(dbBatch, requiredStableCount);
+    dbBatch.clear();
+  };
+  auto addToBatch = [&](std::string file, std::string fingerprint) {
+    dbBatch.emplace_back(std::move(file), std::move(fingerprint));
+    if (dbBatch.size() >= pipeline->capacity)
+      flushBatch();
+  };
+
+  auto drainResults = [&]() {
+    std::deque<std::pair<std::string, std::string>> ready;
+    {
+      std::lock_guard<std::mutex> lock(pipeline->mutex);
+      ready.swap(pipeline->results);
+    }
+    if (!ready.empty())
+      pipeline->cv.notify_all();
+    for (auto &[file, fingerprint] : ready) {
+      addToBatch(std::move(file), std::move(fingerprint));
+    }
+  };
 
-  for (const auto &file : scanResult.files) {
+  // 扫描线程直接处理一个文件（串行模式或队列满时帮忙）
+  auto processInline = [&](const std::string &file) {
+    addToBatch(file, fingerprintIndex_.getFingerprint(file));
+  };
+
+  // 尝试从 paths 中取一个文件自己处理，没有可取的返回 false
+  auto helpOne = [&]() {
+    std::string file;
+    {
+      std::lock_guard<std::mutex> lock(pipeline->mutex);
+      if (pipeline->paths.empty())
+        return false;
+      file = std::move(pipeline->paths.front());
+      pipeline->paths.pop_front();
+    }
+    processInline(file);
+    return true;
+  };
+
+  auto waitForResults = [&]() {
+    std::unique_lock<std::mutex> lock(pipeline->mutex);
+    pipeline->cv.wait(lock, [&]() {
+      return !pipeline->results.empty() || !pipeline->paths.empty() ||
+             pipeline->inFlight == 0;
+    });
+  };
+
+  for (size_t i = 0; i < workerCount; ++i) {
+    commonThreadServicePtr_->runTask([this, pipeline]() {
+      while (true) {
+        std::string file;
+        {
+          std::unique_lock<std::mutex> lock(pipeline->mutex);
+          pipeline->cv.wait(lock, [&]() {
+            return !pipeline->paths.empty() || pipeline->closed;
+          });
+          if (pipeline->paths.empty())
+            return;
+          file = std::move(pipeline->paths.front());
+          pipeline->paths.pop_front();
+          pipeline->inFlight++;
+        }
+
+        std::string fingerprint = fingerprintIndex_.getFingerprint(file);
+
+        {
+          std::lock_guard<std::mutex> lock(pipeline->mutex);
+          pipeline->results.emplace_back(std::move(file),
+                                         std::move(fingerprint));
+          pipeline->inFlight--;
+        }
+        pipeline->cv.notify_all();
+      }
+    });
+  }
+
+  // 遍历阶段：边扫描边投递
+  auto scanResult = scannerServicePtr_->scanChanged(
+      [&](const std::string &file) {
+        if (workerCount == 0) {
+          processInline(file);
+          return;
+        }
+        while (true) {
+          drainResults();
+          {
+            std::lock_guard<std::mutex> lock(pipeline->mutex);
+            if (pipeline->pending() < pipeline->capacity) {
+              pipeline->paths.push_back(file);
+              break;
+            }
+          }
+          if (!helpOne())
+            waitForResults();
+        }
+        pipeline->cv.notify_one();
+      });
+
+  {
+    std::lock_guard<std::mutex> lock(pipeline->mutex);
+    pipeline->closed = true;
+  }
+  pipeline->cv.notify_all();
+
+  // 收尾：处理剩余结果，必要时帮忙计算指纹，直到 Worker 全部交回结果
+  while (true) {
+    drainResults();
+    if (helpOne())
+      continue;
     {
-      std::lock_guard<std::mutex> lock(mutex_);
-      currentFile_ = file;
+      std::lock_guard<std::mutex> lock(pipeline->mutex);
+      if (pipeline->pending() == 0)
+        break;
     }
+    waitForResults();
+  }
+  flushBatch();
+
+  LOG_INFO << "Checked " << scanResult.files.size() << " files"
+           << (scanResult.fullScan ? "" : " (watch candidates)") << " with "
+           << workerCount << " fingerprint workers";
+
+  // 全量扫描时清理已消失文件的索引记录
+  if (scanResult.fullScan) {
+    fingerprintIndex_.retainOnly(std::unordered_set<std::string>(
+        scanResult.files.begin(), scanResult.files.end()));
+  }
+  fingerprintIndex_.save(fingerprintIndexPath_);
+
+  auto stats = fingerprintIndex_.takeStats();
+  LOG_INFO << "Fingerprint index: " << stats.hits << " hits, " << stats.misses
+           << " reads, " << stats.entries << " entries";
+}
 
-    std::string fingerprint = live2mp3::utils::calculateFileFingerprint(file);
+void SchedulerService::applyStabilityResults(
+    const std::vector<std::pair<std::string, std::string>> &results,
+    int requiredStableCount) {
+  std::vector<std::pair<std::string, std::string>> valid;
+  valid.reserve(results.size());
+  for (const auto &[file, fingerprint] : results) {
     if (fingerprint.empty()) {
       LOG_WARN << "无法计算文件指纹: " << file;
+      scannerServicePtr_->releaseCandidate(file);
       continue;
     }
+    valid.emplace_back(file, fingerprint);
+  }
+
+  auto stableCounts = pendingFileServicePtr_->addOrUpdateFiles(valid);
 
-    int stableCount =
-        pendingFileServicePtr_->addOrUpdateFile(file, fingerprint);
+  for (size_t i = 0; i < valid.size(); ++i) {
+    const auto &file = valid[i].first;
+    int stableCount = stableCounts[i];
 
-    if (stableCount >= requiredStableCount) {
+    if (stableCount < 0) {
+      // 已处理过或写库失败：移出候选，文件再次变化时会重新加入
+      scannerServicePtr_->releaseCandidate(file);
+    } else if (stableCount >= requiredStableCount) {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        currentFile_ = file;
+      }
       LOG_INFO << "File is stable (count=" << stableCount << "): " << file;
-      pendingFileServicePtr_->markAsStable(file);
+      pendingFileServicePtr_->markAsStable(file, valid[i].second);
+      scannerServicePtr_->releaseCandidate(file);
     } else {
       LOG_DEBUG << "File stability count: " << stableCount << " for: " << file;
+      // 仍在写入：边录边转模式下立即开始跟随转码
+      followServicePtr_->consider(file);
     }
   }
 }
@@ -258,6 +490,8 @@ void SchedulerService::runMergeEncodeOutput(bool immediate) {
 
   int mergeWindowSeconds = atomicConfig_.merge_window_seconds.load();
   int stopWaitingSeconds = atomicConfig_.stop_waiting_seconds.load();
+  // 提前转码：片段稳定即转码，直播是否结束只影响合并时机（scheduleBatchReadiness）
+  bool encodeAhead = atomicConfig_.encode_ahead.load();
 
   // 1. 原子性地获取并标记所有稳定的原始文件为 processing
   auto stableFiles = pendingFileServicePtr_->getAndClaimStableFiles();
@@ -301,11 +535,11 @@ void SchedulerService::runMergeEncodeOutput(bool immediate) {
       validFiles, mergeWindowSeconds);
 
   // 4. 处理分配结果
-  auto now = std::chrono::system_clock::now();
   auto config = atomicConfig_.getAtomicConfig();
 
   // Phase A: 创建/合并批次
   std::vector<int> batchIdsToProcess;
+  bool parallelAudio = configServicePtr_->getConfig().ffmpeg.parallel_audio;
 
   for (auto &assign : assignments) {
     int batchId = assign.batchId;
@@ -361,6 +595,25 @@ void SchedulerService::runMergeEncodeOutput(bool immediate) {
                << assign.streamer << "'";
     }
 
+    // 并行提取：片段一稳定就只解码音频输出 MP3（不受 stop_waiting 限制），
+    // 输出与单次解码的片段 MP3 同名，合并阶段直接使用
+    if (parallelAudio) {
+      auto batchOpt = batchTaskServicePtr_->getBatch(batchId);
+      if (batchOpt) {
+        for (const auto &f : assign.files) {
+          ffmpegTaskServicePtr_->submitTask(
+              FfmpegTaskType::CONVERT_MP3, {f.pf.getFilepath()},
+              {batchOpt->tmp_dir}, [this, batchId](FfmpegTaskResult result) {
+                onSegmentAudioExtracted(batchId, result);
+              });
+        }
+        std::lock_guard<std::mutex> lock(audioMutex_);
+        audioPendingBatches_.insert(batchId);
+      }
+    }
+
+    // 有新文件加入，取消可能已安排的合并
+    scheduleBatchReadiness(batchId);
     batchIdsToProcess.push_back(batchId);
   }
 
@@ -378,20 +631,40 @@ void SchedulerService::runMergeEncodeOutput(bool immediate) {
           return bf.status == "encoding" || bf.status == "encoded";
         });
 
-    if (!hasActiveFiles) {
+    // 边录边转的文件不受 stop_waiting 限制，直接领取跟随转码的结果；
+    // 结果不可用（失败或文件又有变化）时回退为普通转码
+    for (auto &bf : batchFiles) {
+      std::string filepath = bf.getFilepath();
+      if (bf.status != "pending" || !followServicePtr_->isFollowing(filepath))
+        continue;
+      // 已完成的结果会在 attach 内同步回调，先标记为转码中
+      batchTaskServicePtr_->markFileEncoding(batchId, filepath);
+      bf.status = "encoding";
+      std::string tmpDir = batchOpt->tmp_dir;
+      followServicePtr_->attach(
+          filepath, [this, batchId, filepath,
+                     tmpDir](std::optional<std::string> encoded) {
+            if (encoded) {
+              FfmpegTaskResult result;
+              result.type = FfmpegTaskType::FOLLOW_MP4;
+              result.status = FfmpegTaskStatus::COMPLETED;
+              result.files = {filepath};
+              result.outputFiles = {*encoded};
+              onFileEncoded(batchId, filepath, result);
+              return;
+            }
+            submitEncode(batchId, filepath, tmpDir);
+          });
+    }
+
+    if (!hasActiveFiles && !encodeAhead) {
       // 批次未在处理：判断时间是否就绪
-      auto fileTimes = batchTaskServicePtr_->getBatchFileTimes(batchId);
-      if (!fileTimes.empty()) {
-        auto latestTime = *std::max_element(fileTimes.begin(), fileTimes.end());
-        auto age =
-            std::chrono::duration_cast<std::chrono::seconds>(now - latestTime)
-                .count();
-        if (!immediate && age <= stopWaitingSeconds) {
-          LOG_DEBUG << "Batch id=" << batchId << " for streamer '"
-                    << batchOpt->streamer << "' not ready yet (age=" << age
-                    << "s, threshold=" << stopWaitingSeconds << "s)";
-          continue;
-        }
+      auto age = secondsSinceLastSegment(batchFiles);
+      if (age && !immediate && *age <= stopWaitingSeconds) {
+        LOG_DEBUG << "Batch id=" << batchId << " for streamer '"
+                  << batchOpt->streamer << "' not ready yet (age=" << *age
+                  << "s, threshold=" << stopWaitingSeconds << "s)";
+        continue;
       }
     }
 
@@ -400,16 +673,23 @@ void SchedulerService::runMergeEncodeOutput(bool immediate) {
       if (bf.status == "pending") {
         std::string filepath = bf.getFilepath();
         batchTaskServicePtr_->markFileEncoding(batchId, filepath);
-        ffmpegTaskServicePtr_->submitTask(
-            FfmpegTaskType::CONVERT_MP4, {filepath}, {batchOpt->tmp_dir},
-            [this, batchId, filepath](FfmpegTaskResult result) {
-              onFileEncoded(batchId, filepath, result);
-            });
+        submitEncode(batchId, filepath, batchOpt->tmp_dir);
       }
     }
   }
 }
 
+void SchedulerService::submitEncode(int batchId, const std::string &filepath,
+                                    const std::string &tmpDir) {
+  auto onComplete = [this, batchId, filepath](FfmpegTaskResult result) {
+    onFileEncoded(batchId, filepath, result);
+  };
+  if (chunkEncodeServicePtr_->submit(filepath, tmpDir, onComplete))
+    return;
+  ffmpegTaskServicePtr_->submitTask(FfmpegTaskType::CONVERT_MP4, {filepath},
+                                    {tmpDir}, onComplete);
+}
+
 void SchedulerService::onFileEncoded(int batchId, const std::string &filepath,
                                      const FfmpegTaskResult &result) {
   if (result.status == FfmpegTaskStatus::COMPLETED &&
@@ -425,6 +705,182 @@ void SchedulerService::onFileEncoded(int batchId, const std::string &filepath,
     batchTaskServicePtr_->markFileFailed(batchId, filepath);
     LOG_ERROR << "Batch " << batchId << ": file encoding failed " << filepath;
   }
+  scheduleBatchReadiness(batchId);
+}
+
+std::optional<int64_t> SchedulerService::secondsSinceLastSegment(
+    const std::vector<BatchFile> &batchFiles) {
+  // 以片段结束时间（文件名时间 + 时长）计算，长片段刚写完时不会被误判为已超时
+  std::optional<std::chrono::system_clock::time_point> latestEnd;
+  for (const auto &bf : batchFiles) {
+    auto start = MergerService::parseTime(bf.filename);
+    if (!start)
+      continue;
+    auto end = *start;
+    int durationMs =
+        mediaInfoServicePtr_->getDuration(bf.getFilepath(), bf.fingerprint);
+    if (durationMs > 0)
+      end += std::chrono::milliseconds(durationMs);
+    if (!latestEnd || end > *latestEnd)
+      latestEnd = end;
+  }
+  if (!latestEnd)
+    return std::nullopt;
+  return std::chrono::duration_cast<std::chrono::seconds>(
+             std::chrono::system_clock::now() - *latestEnd)
+      .count();
+}
+
+void SchedulerService::onSegmentAudioExtracted(int batchId,
+                                               const FfmpegTaskResult &result) {
+  if (result.status != FfmpegTaskStatus::COMPLETED ||
+      result.outputFiles.empty()) {
+    // 缺少片段 MP3 时合并后从整场视频提取
+    LOG_WARN << "Batch " << batchId << ": segment MP3 extraction failed";
+    return;
+  }
+  LOG_DEBUG << "Batch " << batchId << ": segment MP3 extracted -> "
+            << result.outputFiles[0];
+  commonThreadServicePtr_->runTask([this]() { assemblePendingAudio(); });
+}
+
+void SchedulerService::assemblePendingAudio() {
+  // 整体取出，并发调用之间不会重复处理同一批次
+  std::set<int> batchIds;
+  {
+    std::lock_guard<std::mutex> lock(audioMutex_);
+    batchIds.swap(audioPendingBatches_);
+  }
+  for (int batchId : batchIds) {
+    if (!tryAssembleBatchAudio(batchId)) {
+      std::lock_guard<std::mutex> lock(audioMutex_);
+      audioPendingBatches_.insert(batchId);
+    }
+  }
+}
+
+bool SchedulerService::tryAssembleBatchAudio(int batchId) {
+  // 在 audioMutex_ 内确认仍在 encoding 并登记，与 onBatchEncodingComplete
+  // 的 encoding -> merging 抢占互斥：合并开始后不再提前拼接，拼接期间不开始合并
+  std::optional<BatchInfo> batchOpt;
+  {
+    std::lock_guard<std::mutex> lock(audioMutex_);
+    batchOpt = batchTaskServicePtr_->getBatch(batchId);
+    if (!batchOpt || batchOpt->status != "encoding") {
+      return true; // 已进入合并：由合并阶段使用片段 MP3
+    }
+    audioAssembling_.insert(batchId);
+  }
+  struct AssemblingGuard {
+    SchedulerService *self;
+    int batchId;
+    ~AssemblingGuard() {
+      std::lock_guard<std::mutex> lock(self->audioMutex_);
+      self->audioAssembling_.erase(batchId);
+    }
+  } guard{this, batchId};
+  auto &batch = *batchOpt;
+
+  auto batchFiles = batchTaskServicePtr_->getBatchFiles(batchId);
+  std::vector<std::string> segments;
+  for (const auto &bf : batchFiles) {
+    std::string segment = converterServicePtr_->sidecarAudioPath(
+        (fs::path(batch.tmp_dir) / bf.filename).string());
+    std::error_code ec;
+    if (!fs::exists(segment, ec)) {
+      return false;
+    }
+    segments.push_back(std::move(segment));
+  }
+  if (segments.empty()) {
+    return false;
+  }
+
+  auto age = secondsSinceLastSegment(batchFiles);
+  int stopWaitingSeconds = atomicConfig_.stop_waiting_seconds.load();
+  if (!age || *age <= stopWaitingSeconds) {
+    return false; // 直播可能仍在继续
+  }
+
+  std::optional<std::string> mp3Path;
+  if (segments.size() == 1) {
+    // 单片段：复制到输出目录（片段 MP3 留给转码完成后的单文件流程）
+    fs::path target =
+        fs::path(batch.output_dir) / fs::path(segments[0]).filename();
+    fs::path writing = fs::path(batch.output_dir) /
+                       (target.stem().string() + "_writing" +
+                        target.extension().string());
+    std::error_code ec;
+    fs::copy_file(segments[0], writing, fs::copy_options::overwrite_existing,
+                  ec);
+    if (!ec)
+      fs::rename(writing, target, ec);
+    if (ec) {
+      LOG_WARN << "Batch " << batchId << ": 复制片段 MP3 失败: " << ec.message();
+      fs::remove(writing, ec);
+    } else {
+      mp3Path = target.string();
+    }
+  } else {
+    mp3Path = mergerServicePtr_->mergeAudioFiles(segments, batch.output_dir);
+  }
+
+  if (!mp3Path) {
+    LOG_WARN << "Batch " << batchId
+             << ": early MP3 assembly failed, MP3 will be produced after merge";
+    return true;
+  }
+
+  // 记录最终 MP3；期间有新片段加入时由 Phase A 重新登记并再次拼接
+  discardReplacedMp3(batchId, *mp3Path);
+  batchTaskServicePtr_->setBatchFinalPaths(batchId, batch.final_mp4_path,
+                                           *mp3Path);
+  LOG_INFO << "Batch " << batchId << ": MP3 ready before video -> " << *mp3Path
+           << " (" << segments.size() << " segments)";
+  return true;
+}
+
+void SchedulerService::scheduleBatchReadiness(int batchId) {
+  auto progress = batchTaskServicePtr_->getBatchProgress(batchId);
+  if (!progress || progress->outstanding > 0) {
+    readinessWheel_.cancel(batchId);
+    return;
+  }
+
+  int64_t now = static_cast<int64_t>(std::time(nullptr));
+  int stopWaitingSeconds = atomicConfig_.stop_waiting_seconds.load();
+  int64_t deadline = progress->last_update + stopWaitingSeconds;
+  if (atomicConfig_.encode_ahead.load()) {
+    // 片段早已转码完，等待的只是直播结束；无法解析片段时间时沿用最后变化时间
+    auto age =
+        secondsSinceLastSegment(batchTaskServicePtr_->getBatchFiles(batchId));
+    if (age) {
+      deadline = now - *age + stopWaitingSeconds;
+    }
+  }
+  if (deadline > now) {
+    LOG_DEBUG << "Batch " << batchId << ": all files encoded, merge in "
+              << (deadline - now) << "s";
+    readinessWheel_.schedule(batchId, deadline);
+    return;
+  }
+
+  readinessWheel_.cancel(batchId);
+  onBatchEncodingComplete(batchId);
+}
+
+void SchedulerService::onReadinessTick() {
+  auto expired =
+      readinessWheel_.advance(static_cast<int64_t>(std::time(nullptr)));
+  if (expired.empty())
+    return;
+  // 重新判断：期间可能追加了文件或截止时间已变化。判断可能调用 ffprobe、
+  // 合并需要移动文件，均在线程池中进行，不占用事件循环
+  commonThreadServicePtr_->runTask([this, expired = std::move(expired)]() {
+    for (int batchId : expired) {
+      scheduleBatchReadiness(batchId);
+    }
+  });
 }
 
 void SchedulerService::checkEncodedBatches() {
@@ -445,6 +901,22 @@ void SchedulerService::checkEncodedBatches() {
 }
 
 void SchedulerService::onBatchEncodingComplete(int batchId) {
+  // 事件触发与周期兜底可能同时到达，只有抢到 encoding -> merging 的一方继续；
+  // 正在提前拼接 MP3 时不等待（拼接可能持续较久），一秒后由时间轮重试
+  {
+    std::lock_guard<std::mutex> lock(audioMutex_);
+    if (audioAssembling_.count(batchId) > 0) {
+      LOG_DEBUG << "Batch " << batchId
+                << ": early MP3 assembly in progress, retry merge later";
+      readinessWheel_.schedule(
+          batchId, static_cast<int64_t>(std::time(nullptr)) + 1);
+      return;
+    }
+    if (!batchTaskServicePtr_->claimBatchForMerge(batchId)) {
+      LOG_DEBUG << "Batch " << batchId << ": already claimed for merge";
+      return;
+    }
+  }
   LOG_INFO << "Batch " << batchId << ": all files encoded, starting merge...";
 
   auto batchOpt = batchTaskServicePtr_->getBatch(batchId);
@@ -466,8 +938,6 @@ void SchedulerService::onBatchEncodingComplete(int batchId) {
   LOG_INFO << "Batch " << batchId << ": " << encodedPaths.size()
            << " encoded files, " << batch.failed_count << " failed";
 
-  batchTaskServicePtr_->updateBatchStatus(batchId, "merging");
-
   if (encodedPaths.size() == 1) {
     // 单文件：直接移动到输出目录
     LOG_INFO << "Batch " << batchId
@@ -475,6 +945,13 @@ void SchedulerService::onBatchEncodingComplete(int batchId) {
     auto movedFiles = moveFilesToOutputDir(encodedPaths, batch.output_dir);
     if (!movedFiles.empty()) {
       std::string finalMp4 = movedFiles[0];
+
+      // 已有片段 MP3（转码时同时输出或并行提取）：无需再次解码
+      std::string mp3Path = adoptSidecarAudio(encodedPaths[0], finalMp4);
+      if (!mp3Path.empty()) {
+        completeBatch(batchId, finalMp4, mp3Path);
+        return;
+      }
       batchTaskServicePtr_->setBatchFinalPaths(batchId, finalMp4, "");
 
       // 继续提取 MP3
@@ -515,20 +992,29 @@ void SchedulerService::onMergeComplete(int batchId,
     std::string finalMp4 = result.outputFiles[0];
     LOG_INFO << "Batch " << batchId << ": merge successful -> " << finalMp4;
 
-    batchTaskServicePtr_->setBatchFinalPaths(batchId, finalMp4, "");
-
-    // 清理 tmp 中的源编码文件
+    // 清理 tmp 中的源编码文件及其片段 MP3
     auto encodedPaths = batchTaskServicePtr_->getEncodedPaths(batchId);
     for (const auto &path : encodedPaths) {
-      try {
-        if (fs::exists(path)) {
-          fs::remove(path);
-          LOG_DEBUG << "清理 tmp 文件: " << path;
+      for (const auto &tmpPath :
+           {path, converterServicePtr_->sidecarAudioPath(path)}) {
+        try {
+          if (fs::exists(tmpPath)) {
+            fs::remove(tmpPath);
+            LOG_DEBUG << "清理 tmp 文件: " << tmpPath;
+          }
+        } catch (...) {
         }
-      } catch (...) {
       }
     }
 
+    // 合并任务已拼接片段 MP3（单次解码或并行提取模式）
+    if (result.outputFiles.size() > 1) {
+      completeBatch(batchId, finalMp4, result.outputFiles[1]);
+      return;
+    }
+
+    batchTaskServicePtr_->setBatchFinalPaths(batchId, finalMp4, "");
+
     // 继续提取 MP3
     batchTaskServicePtr_->updateBatchStatus(batchId, "extracting_mp3");
     ffmpegTaskServicePtr_->submitTask(FfmpegTaskType::CONVERT_MP3, {finalMp4},
@@ -542,11 +1028,18 @@ void SchedulerService::onMergeComplete(int batchId,
              << ": merge failed, fallback to individual files";
 
     auto encodedPaths = batchTaskServicePtr_->getEncodedPaths(batchId);
-    auto movedFiles = moveFilesToOutputDir(encodedPaths, batch.output_dir);
 
-    // 为每个移动的文件提取 MP3
-    for (const auto &mp4Path : movedFiles) {
-      ffmpegTaskServicePtr_->submitTask(FfmpegTaskType::CONVERT_MP3, {mp4Path},
+    // 降级后每个文件各有 MP3，提前拼接的整场 MP3 不再对应任何视频
+    discardReplacedMp3(batchId, "");
+
+    // 为每个移动的文件提取 MP3（已有片段 MP3 的直接移动）
+    for (const auto &encodedPath : encodedPaths) {
+      auto moved = moveFilesToOutputDir({encodedPath}, batch.output_dir);
+      if (moved.empty())
+        continue;
+      if (!adoptSidecarAudio(encodedPath, moved[0]).empty())
+        continue;
+      ffmpegTaskServicePtr_->submitTask(FfmpegTaskType::CONVERT_MP3, {moved[0]},
                                         {batch.output_dir});
     }
 
@@ -569,6 +1062,7 @@ void SchedulerService::onMp3Complete(int batchId,
       !result.outputFiles.empty()) {
     std::string mp3Path = result.outputFiles[0];
     LOG_INFO << "Batch " << batchId << ": MP3 created -> " << mp3Path;
+    discardReplacedMp3(batchId, mp3Path);
     batchTaskServicePtr_->setBatchFinalPaths(batchId, batchOpt->final_mp4_path,
                                              mp3Path);
   } else {
@@ -581,6 +1075,60 @@ void SchedulerService::onMp3Complete(int batchId,
   LOG_INFO << "Batch " << batchId << ": processing completed";
 }
 
+std::string SchedulerService::adoptSidecarAudio(const std::string &encodedPath,
+                                                const std::string &finalMp4) {
+  std::string sidecar = converterServicePtr_->sidecarAudioPath(encodedPath);
+  std::string target = converterServicePtr_->sidecarAudioPath(finalMp4);
+  std::error_code ec;
+  if (!fs::exists(sidecar, ec))
+    return "";
+
+  if (fs::exists(target, ec)) {
+    // 已提前复制到输出目录（并行提取模式）：不旧于片段 MP3 时直接使用
+    auto targetTime = fs::last_write_time(target, ec);
+    auto sidecarTime = fs::last_write_time(sidecar, ec);
+    if (ec || targetTime < sidecarTime)
+      return "";
+    fs::remove(sidecar, ec);
+    return target;
+  }
+
+  fs::rename(sidecar, target, ec);
+  if (ec) {
+    LOG_WARN << "移动片段 MP3 失败: " << sidecar << ", 错误: " << ec.message();
+    return "";
+  }
+  LOG_INFO << "移动文件: " << sidecar << " -> " << target;
+  return target;
+}
+
+void SchedulerService::discardReplacedMp3(int batchId,
+                                          const std::string &newMp3) {
+  auto batchOpt = batchTaskServicePtr_->getBatch(batchId);
+  if (!batchOpt || batchOpt->final_mp3_path.empty() ||
+      batchOpt->final_mp3_path == newMp3)
+    return;
+
+  std::error_code ec;
+  if (fs::remove(batchOpt->final_mp3_path, ec)) {
+    LOG_INFO << "Batch " << batchId
+             << ": removed superseded MP3 " << batchOpt->final_mp3_path;
+  }
+  batchTaskServicePtr_->setBatchFinalPaths(batchId, batchOpt->final_mp4_path,
+                                           "");
+}
+
+void SchedulerService::completeBatch(int batchId, const std::string &finalMp4,
+                                     const std::string &mp3Path) {
+  LOG_INFO << "Batch " << batchId << ": MP3 created -> " << mp3Path
+           << " (from segment MP3s)";
+  discardReplacedMp3(batchId, mp3Path);
+  batchTaskServicePtr_->setBatchFinalPaths(batchId, finalMp4, mp3Path);
+  markBatchFilesCompleted(batchId);
+  batchTaskServicePtr_->updateBatchStatus(batchId, "completed");
+  LOG_INFO << "Batch " << batchId << ": processing completed";
+}
+
 void SchedulerService::markBatchFilesCompleted(int batchId) {
   auto batchFiles = batchTaskServicePtr_->getBatchFiles(batchId);
   for (const auto &bf : batchFiles) {
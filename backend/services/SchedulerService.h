@@ -1,18 +1,25 @@
 #pragma once
 
 #include "BatchTaskService.h"
+#include "ChunkEncodeService.h"
 #include "CommonThreadService.h"
 #include "ConfigService.h"
 #include "ConverterService.h"
 #include "FfmpegTaskService.h"
+#include "FollowService.h"
+#include "MediaInfoService.h"
 #include "MergerService.h"
 #include "PendingFileService.h"
 #include "ScannerService.h"
+#include "utils/FingerprintIndex.h"
+#include "utils/TimerWheel.h"
 #include "utils/ThreadSafe.hpp"
 #include <atomic>
 #include <drogon/plugins/Plugin.h>
 #include <drogon/utils/coroutine.h>
 #include <mutex>
+#include <optional>
+#include <set>
 #include <string>
 
 /**
@@ -47,6 +54,14 @@ public:
 
   nlohmann::json getDetailedStatus();
 
+  /**
+   * @brief 提交单个文件的转码，完成后回调 onFileEncoded
+   *
+   * 开启分段转码且时长足够时按关键帧分段并行转码，否则为一个 CONVERT_MP4 任务。
+   */
+  void submitEncode(int batchId, const std::string &filepath,
+                    const std::string &tmpDir);
+
   /**
    * @brief 单文件转码完成回调
    */
@@ -80,16 +95,72 @@ private:
    */
   void runStabilityScan();
 
+  /**
+   * @brief 阶段 1 的数据库环节：批量更新 pending_files 并判断稳定
+   *
+   * 只在扫描线程中调用，保证数据库写入串行；一批结果在一个事务中写入。
+   *
+   * @param results (文件路径, 指纹) 列表
+   */
+  void applyStabilityResults(
+      const std::vector<std::pair<std::string, std::string>> &results,
+      int requiredStableCount);
+
   /**
    * @brief 阶段 2: 分批创建批次并提交转码任务（不等待）
    */
   void runMergeEncodeOutput(bool immediate = false);
 
   /**
-   * @brief 阶段 3: 轮询数据库，找到编码完成的批次，触发合并
+   * @brief 阶段 3（兜底）: 轮询数据库，找到编码完成的批次，触发合并
+   *
+   * 正常情况下批次由 scheduleBatchReadiness 事件驱动触发，
+   * 这里只处理内存状态遗漏的批次（以数据库为准）。
    */
   void checkEncodedBatches();
 
+  /**
+   * @brief 根据批次当前进度安排合并时间
+   *
+   * 仍有未完成文件时取消定时；全部完成时在 最后变化时间 + stop_waiting_seconds
+   * 触发合并，已过截止时间则立即触发。提前转码模式下转码完成时间与直播
+   * 是否结束无关，改以最后一个片段的结束时间计算截止时间。
+   */
+  void scheduleBatchReadiness(int batchId);
+
+  /**
+   * @brief 每秒推进一次就绪时间轮，处理到期批次
+   */
+  void onReadinessTick();
+
+  /**
+   * @brief 批次最后一个片段结束（文件名时间 + 时长）距今的秒数
+   *
+   * @return 无法解析任何片段时间时返回 nullopt
+   */
+  std::optional<int64_t>
+  secondsSinceLastSegment(const std::vector<BatchFile> &batchFiles);
+
+  /**
+   * @brief 片段 MP3 提取完成（并行提取模式）
+   */
+  void onSegmentAudioExtracted(int batchId, const FfmpegTaskResult &result);
+
+  /**
+   * @brief 尝试为仍在转码的批次提前拼接整场 MP3
+   *
+   * 全部片段 MP3 已就绪且最后一个片段结束超过 stop_waiting_seconds 时，
+   * 按帧拼接到输出目录并记录为批次最终 MP3。
+   *
+   * @return 批次不再需要提前拼接（已完成或已进入合并）时返回 true
+   */
+  bool tryAssembleBatchAudio(int batchId);
+
+  /**
+   * @brief 周期检查等待提前拼接 MP3 的批次
+   */
+  void assemblePendingAudio();
+
   /**
    * @brief 将文件移动到输出目录（降级处理）
    */
@@ -97,6 +168,34 @@ private:
   moveFilesToOutputDir(const std::vector<std::string> &files,
                        const std::string &outputDir);
 
+  /**
+   * @brief 把片段 MP3 移到最终视频旁（单次解码或并行提取模式）
+   *
+   * 目标位置已有不旧于片段的 MP3（已提前拼接）时直接使用它。
+   *
+   * @param encodedPath 转码输出（移动前）的路径
+   * @param finalMp4 移动/合并后的最终视频路径
+   * @return 最终 MP3 路径；片段 MP3 不存在或移动失败时返回空字符串
+   */
+  std::string adoptSidecarAudio(const std::string &encodedPath,
+                                const std::string &finalMp4);
+
+  /**
+   * @brief 删除批次此前记录、但不再使用的最终 MP3
+   *
+   * 提前拼接的结果在之后有片段加入时会换名（单片段副本 -> _merged），
+   * 记录新路径前删掉旧文件，避免输出目录留下孤立的 MP3。
+   *
+   * @param newMp3 即将记录的 MP3 路径，为空表示不再记录任何 MP3
+   */
+  void discardReplacedMp3(int batchId, const std::string &newMp3);
+
+  /**
+   * @brief 最终 MP4/MP3 均已就绪，结束批次
+   */
+  void completeBatch(int batchId, const std::string &finalMp4,
+                     const std::string &mp3Path);
+
   /**
    * @brief 批次完成后标记原始文件为 completed
    */
@@ -115,6 +214,9 @@ private:
     std::atomic<int> merge_window_seconds{7200};
     std::atomic<int> stop_waiting_seconds{600};
     std::atomic<int> stability_checks{2};
+    std::atomic<int> scan_fingerprint_workers{4};
+    std::atomic<int> scan_queue_size{256};
+    std::atomic<bool> encode_ahead{true};
     live2mp3::utils::ThreadSafeString output_root;
 
     void loadFrom(const AppConfig &config) {
@@ -122,6 +224,9 @@ private:
       merge_window_seconds.store(config.scheduler.merge_window_seconds);
       stop_waiting_seconds.store(config.scheduler.stop_waiting_seconds);
       stability_checks.store(config.scheduler.stability_checks);
+      scan_fingerprint_workers.store(config.scheduler.scan_fingerprint_workers);
+      scan_queue_size.store(config.scheduler.scan_queue_size);
+      encode_ahead.store(config.scheduler.encode_ahead);
       output_root.set(config.output.output_root);
     }
 
@@ -133,6 +238,10 @@ private:
       config.scheduler.merge_window_seconds = merge_window_seconds.load();
       config.scheduler.stop_waiting_seconds = stop_waiting_seconds.load();
       config.scheduler.stability_checks = stability_checks.load();
+      config.scheduler.scan_fingerprint_workers =
+          scan_fingerprint_workers.load();
+      config.scheduler.scan_queue_size = scan_queue_size.load();
+      config.scheduler.encode_ahead = encode_ahead.load();
       config.output.output_root = *output_root.get();
       return config;
     }
@@ -147,6 +256,22 @@ private:
   std::shared_ptr<FfmpegTaskService> ffmpegTaskServicePtr_;
   std::shared_ptr<CommonThreadService> commonThreadServicePtr_;
   std::shared_ptr<BatchTaskService> batchTaskServicePtr_;
+  std::shared_ptr<MediaInfoService> mediaInfoServicePtr_;
+  std::shared_ptr<FollowService> followServicePtr_;
+  std::shared_ptr<ChunkEncodeService> chunkEncodeServicePtr_;
+
+  // stat 快照 -> 指纹索引，未变化的文件跳过读取
+  live2mp3::utils::FingerprintIndex fingerprintIndex_;
+  std::string fingerprintIndexPath_;
+
+  // 批次合并截止时间（仅包含已全部转码完成、等待 stop_waiting 的批次）
+  live2mp3::utils::TimerWheel readinessWheel_;
+
+  // 已提交片段 MP3 提取、尚未提前拼接的批次（并行提取模式）
+  std::set<int> audioPendingBatches_;
+  // 正在提前拼接 MP3 的批次；onBatchEncodingComplete 遇到时推迟抢占合并
+  std::set<int> audioAssembling_;
+  std::mutex audioMutex_;
 
   std::atomic<bool> scanRunning_{false};
   AtomicConfig atomicConfig_;
@@ -0,0 +1,226 @@
+/**
+ * @file CommandTemplate.cc
+ * @brief 命令模板分词实现
+ */
+
+#include "CommandTemplate.h"
+#include <drogon/drogon.h>
+#include <algorithm>
+#include <fmt/format.h>
+#include <iterator>
+
+namespace live2mp3::utils {
+
+namespace {
+
+/// 未加引号时需要 shell 解释的字符
+bool isShellSpecial(char c) {
+  switch (c) {
+  case '|':
+  case '&':
+  case ';':
+  case '<':
+  case '>':
+  case '(':
+  case ')':
+  case '$':
+  case '`':
+  case '*':
+  case '?':
+  case '[':
+    return true;
+  default:
+    return false;
+  }
+}
+
+} // namespace
+
+CommandTemplate::CommandTemplate(std::string command)
+    : command_(std::move(command)) {
+  if (auto argv = tokenize(command_)) {
+    argv_ = std::move(*argv);
+    shell_ = argv_.empty();
+  }
+  if (shell_) {
+    LOG_DEBUG << "CommandTemplate: using /bin/sh -c for: " << command_;
+  }
+}
+
+std::optional<std::vector<std::string>>
+CommandTemplate::tokenize(const std::string &command) {
+  std::vector<std::string> argv;
+  std::string token;
+  bool inToken = false;
+  bool tokenQuoted = false; ///< 当前参数是否含引号（决定 2>&1、~、# 等的含义）
+
+  auto finishToken = [&]() -> bool {
+    if (!inToken)
+      return true;
+    if (!tokenQuoted) {
+      if (token == "2>&1") {
+        // 输出总是一起捕获，重定向是多余的
+        inToken = false;
+        token.clear();
+        return true;
+      }
+      // 赋值前缀、~ 展开、注释都需要 shell
+      if (token.front() == '~' || token.front() == '#' ||
+          (argv.empty() && token.find('=') != std::string::npos))
+        return false;
+    }
+    argv.push_back(std::move(token));
+    token.clear();
+    inToken = false;
+    tokenQuoted = false;
+    return true;
+  };
+
+  for (size_t i = 0; i < command.size(); ++i) {
+    char c = command[i];
+    if (c == ' ' || c == '\t' || c == '\n') {
+      if (!finishToken())
+        return std::nullopt;
+      continue;
+    }
+
+    inToken = true;
+    if (c == '\'') {
+      size_t end = command.find('\'', i + 1);
+      if (end == std::string::npos)
+        return std::nullopt;
+      token.append(command, i + 1, end - i - 1);
+      tokenQuoted = true;
+      i = end;
+    } else if (c == '"') {
+      tokenQuoted = true;
+      for (++i; i < command.size() && command[i] != '"'; ++i) {
+        char q = command[i];
+        if (q == '$' || q == '`')
+          return std::nullopt;
+        if (q == '\\' && i + 1 < command.size() &&
+            (command[i + 1] == '"' || command[i + 1] == '\\' ||
+             command[i + 1] == '$' || command[i + 1] == '`')) {
+          q = command[++i];
+        }
+        token.push_back(q);
+      }
+      if (i >= command.size())
+        return std::nullopt;
+    } else if (c == '\\') {
+      if (i + 1 >= command.size())
+        return std::nullopt;
+      token.push_back(command[++i]);
+      tokenQuoted = true;
+    } else if (c == '2' && command.compare(i, 4, "2>&1") == 0 &&
+               token.empty() &&
+               (i + 4 == command.size() || command[i + 4] == ' ' ||
+                command[i + 4] == '\t' || command[i + 4] == '\n')) {
+      token = "2>&1";
+      i += 3;
+    } else if (isShellSpecial(c)) {
+      return std::nullopt;
+    } else {
+      token.push_back(c);
+    }
+  }
+  if (!finishToken())
+    return std::nullopt;
+  return argv;
+}
+
+std::vector<std::string>
+CommandTemplate::render(const std::string &input,
+                        const std::string &output) const {
+  if (shell_) {
+    return {"/bin/sh", "-c",
+            fmt::format(fmt::runtime(command_), fmt::arg("input", input),
+                        fmt::arg("output", output))};
+  }
+
+  std::vector<std::string> argv;
+  argv.reserve(argv_.size());
+  for (const auto &arg : argv_) {
+    argv.push_back(fmt::format(fmt::runtime(arg), fmt::arg("input", input),
+                               fmt::arg("output", output)));
+  }
+  return argv;
+}
+
+std::optional<std::vector<std::string>> CommandTemplate::outputOptions() const {
+  if (shell_ || argv_.empty() || argv_.back() != "{output}")
+    return std::nullopt;
+
+  auto output = std::prev(argv_.end());
+  auto input = std::find(std::make_reverse_iterator(output), argv_.rend(),
+                         std::string("-i"));
+  if (input == argv_.rend())
+    return std::nullopt;
+  auto first = std::next(input.base()); // 跳过输入路径
+  if (first > output)
+    return std::nullopt;
+  return std::vector<std::string>(first, output);
+}
+
+std::vector<std::string>
+selectAudioOptions(const std::vector<std::string> &options) {
+  // 不带取值的音频选项
+  static const std::vector<std::string> flags = {"-an"};
+  // 带一个取值的音频选项（按名称前缀匹配，-c:a:0 之类的流说明符也算）
+  static const std::vector<std::string> valued = {
+      "-acodec", "-ab", "-ar", "-ac", "-aq", "-af", "-movflags"};
+
+  std::vector<std::string> selected;
+  for (size_t i = 0; i < options.size(); ++i) {
+    const std::string &opt = options[i];
+    if (opt.empty() || opt.front() != '-')
+      continue;
+    if (std::find(flags.begin(), flags.end(), opt) != flags.end()) {
+      selected.push_back(opt);
+      continue;
+    }
+    bool audio = opt.find(":a") != std::string::npos ||
+                 std::find(valued.begin(), valued.end(), opt) != valued.end();
+    if (audio && i + 1 < options.size()) {
+      selected.push_back(opt);
+      selected.push_back(options[++i]);
+    }
+  }
+  return selected;
+}
+
+std::string formatArgv(const std::vector<std::string> &argv) {
+  std::string line;
+  for (const auto &arg : argv) {
+    if (!line.empty())
+      line.push_back(' ');
+    if (!arg.empty() &&
+        arg.find_first_of(" \t\n'\"\\$`|&;<>()*?[]") == std::string::npos) {
+      line += arg;
+      continue;
+    }
+    line.push_back('\'');
+    for (char c : arg) {
+      if (c == '\'')
+        line += "'\\''";
+      else
+        line.push_back(c);
+    }
+    line.push_back('\'');
+  }
+  return line;
+}
+
+CompiledCommands::CompiledCommands(const std::string &videoConvertCommand,
+                                   const std::string &audioConvertCommand,
+                                   const std::string &mergeCommand)
+    : videoConvert(videoConvertCommand), audioConvert(audioConvertCommand),
+      merge(mergeCommand) {
+  // 视频命令只需以 {output} 结尾，附加输出写在其后
+  if (auto videoOptions = videoConvert.outputOptions()) {
+    audioOutputOptions = audioConvert.outputOptions();
+    chunkAudioOptions = selectAudioOptions(*videoOptions);
+  }
+}
+
+} // namespace live2mp3::utils
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace live2mp3::utils {
+
+/**
+ * @brief 预先分词的命令模板
+ *
+ * 构造时按 shell 规则（空白分隔、单/双引号、反斜杠转义）一次性切分为 argv，
+ * 每个参数中的 {input} / {output} 在 render() 时填充，路径原样成为一个参数，
+ * 文件名中的引号、空格、$ 等字符不需要转义。末尾的 2>&1 会被丢弃
+ * （stdout 和 stderr 总是一起被捕获）。
+ *
+ * 模板含管道、重定向、变量展开、通配符等无法安全分词的 shell 语法时，
+ * isShell() 为 true，render() 返回 /bin/sh -c 形式的 argv，行为与旧版一致。
+ * 构造完成后只读，可在多线程中共享。
+ */
+class CommandTemplate {
+public:
+  CommandTemplate() = default;
+  explicit CommandTemplate(std::string command);
+
+  /**
+   * @brief 按 shell 规则分词
+   * @return std::nullopt 含需要 shell 解释的语法或引号未闭合
+   */
+  static std::optional<std::vector<std::string>>
+  tokenize(const std::string &command);
+
+  /**
+   * @brief 填充占位符，生成可直接 exec 的 argv
+   * @throws std::exception 模板格式错误（如未转义的花括号）
+   */
+  std::vector<std::string> render(const std::string &input,
+                                  const std::string &output) const;
+
+  /**
+   * @brief 输出选项：最后一个 `-i <输入>` 之后、末尾 {output} 之前的参数
+   *
+   * 例如 `ffmpeg -y -i {input} -vn -acodec libmp3lame -q:a 2 {output}`
+   * 返回 `-vn -acodec libmp3lame -q:a 2`，可作为另一条命令的附加输出。
+   *
+   * @return std::nullopt 需要 shell，或 {output} 不是最后一个参数
+   */
+  std::optional<std::vector<std::string>> outputOptions() const;
+
+  /**
+   * @brief 可执行文件（第一个参数），需要 shell 时为空
+   */
+  std::string program() const {
+    return shell_ ? std::string() : argv_.front();
+  }
+
+  bool isShell() const { return shell_; }
+  const std::string &command() const { return command_; }
+
+private:
+  std::string command_;
+  std::vector<std::string> argv_;
+  bool shell_ = true;
+};
+
+/**
+ * @brief 从输出选项中挑出音频编码相关的部分
+ *
+ * 保留名称含 `:a` 的选项（`-c:a`、`-b:a`、`-q:a`、`-filter:a` 等）、
+ * `-acodec` / `-ab` / `-ar` / `-ac` / `-aq` / `-af` / `-an` 以及 `-movflags`，
+ * 视频编码、滤镜等选项被丢弃。用于视频已单独编码、只需按原模板编码音频的场合。
+ */
+std::vector<std::string>
+selectAudioOptions(const std::vector<std::string> &options);
+
+/**
+ * @brief 把 argv 格式化为一行（含空白或引号的参数加单引号），用于日志
+ */
+std::string formatArgv(const std::vector<std::string> &argv);
+
+/**
+ * @brief 某一版本配置中所有 FFmpeg 命令模板的分词结果
+ */
+struct CompiledCommands {
+  /**
+   * @param videoConvertCommand 视频转码命令模板
+   * @param audioConvertCommand 音频提取命令模板
+   * @param mergeCommand 合并命令模板
+   */
+  CompiledCommands(const std::string &videoConvertCommand,
+                   const std::string &audioConvertCommand,
+                   const std::string &mergeCommand);
+
+  CommandTemplate videoConvert;
+  CommandTemplate audioConvert;
+  CommandTemplate merge;
+
+  /// 附加在视频转码命令末尾的 MP3 输出选项（取自 audioConvert），
+  /// 任一模板不支持时为 std::nullopt，此时只能单独提取 MP3
+  std::optional<std::vector<std::string>> audioOutputOptions;
+
+  /// 分段转码拼接时的音频编码选项（取自 videoConvert 的输出选项），
+  /// 视频命令需要 shell 或 {output} 不在末尾时为 std::nullopt，此时不分段
+  std::optional<std::vector<std::string>> chunkAudioOptions;
+};
+
+} // namespace live2mp3::utils
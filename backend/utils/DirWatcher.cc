@@ -0,0 +1,208 @@
+/**
+ * @file DirWatcher.cc
+ * @brief inotify 目录监听实现
+ */
+
+#include "DirWatcher.h"
+#include <cerrno>
+#include <cstring>
+#include <drogon/drogon.h>
+#include <filesystem>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace live2mp3::utils {
+
+#ifdef __linux__
+// 关心的事件：写入、写完关闭、移入/移出、创建、删除
+constexpr uint32_t WATCH_MASK = IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE |
+                                IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE |
+                                IN_DELETE_SELF | IN_ONLYDIR;
+#endif
+
+DirWatcher::~DirWatcher() { stop(); }
+
+bool DirWatcher::start(const std::vector<std::string> &roots) {
+#ifdef __linux__
+  stop();
+
+  inotifyFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (inotifyFd_ < 0) {
+    LOG_ERROR << "[DirWatcher] inotify_init1 失败: " << strerror(errno);
+    return false;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    roots_ = roots;
+    wdToDir_.clear();
+    changed_.clear();
+    removed_.clear();
+    overflow_ = false;
+  }
+
+  for (const auto &root : roots) {
+    if (!root.empty())
+      addWatchRecursive(root, false);
+  }
+
+  running_ = true;
+  thread_ = std::thread([this]() { loop(); });
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  LOG_INFO << "[DirWatcher] 已启动，监听 " << wdToDir_.size() << " 个目录";
+  return true;
+#else
+  LOG_WARN << "[DirWatcher] 当前平台不支持 inotify";
+  return false;
+#endif
+}
+
+void DirWatcher::stop() {
+#ifdef __linux__
+  if (!running_.exchange(false)) {
+    return;
+  }
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  if (inotifyFd_ >= 0) {
+    close(inotifyFd_);
+    inotifyFd_ = -1;
+  }
+  LOG_INFO << "[DirWatcher] 已停止";
+#endif
+}
+
+std::vector<std::string> DirWatcher::getRoots() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return roots_;
+}
+
+DirWatcher::Changes DirWatcher::drain() {
+  Changes changes;
+  std::lock_guard<std::mutex> lock(mutex_);
+  changes.files.assign(changed_.begin(), changed_.end());
+  changes.removed.assign(removed_.begin(), removed_.end());
+  changes.overflow = overflow_;
+  changed_.clear();
+  removed_.clear();
+  overflow_ = false;
+  return changes;
+}
+
+void DirWatcher::addWatchRecursive(const std::string &dir, bool seedFiles) {
+#ifdef __linux__
+  std::vector<std::string> dirs{dir};
+  std::error_code ec;
+  for (auto it = fs::recursive_directory_iterator(
+           dir, fs::directory_options::skip_permission_denied, ec);
+       !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+    if (it->is_directory(ec)) {
+      dirs.push_back(it->path().string());
+    } else if (seedFiles && it->is_regular_file(ec)) {
+      // 新目录可能在加入监听前已经有文件写入，直接作为候选
+      std::lock_guard<std::mutex> lock(mutex_);
+      changed_.insert(it->path().string());
+    }
+  }
+
+  for (const auto &d : dirs) {
+    int wd = inotify_add_watch(inotifyFd_, d.c_str(), WATCH_MASK);
+    if (wd < 0) {
+      LOG_WARN << "[DirWatcher] 无法监听目录 " << d << ": " << strerror(errno)
+               << "，将回退到全量扫描";
+      std::lock_guard<std::mutex> lock(mutex_);
+      overflow_ = true;
+      continue;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    wdToDir_[wd] = d;
+  }
+#endif
+}
+
+void DirWatcher::loop() {
+#ifdef __linux__
+  // 足够容纳多个事件（每个事件 = sizeof(inotify_event) + 文件名）
+  alignas(struct inotify_event) char buf[64 * 1024];
+
+  while (running_) {
+    struct pollfd pfd = {inotifyFd_, POLLIN, 0};
+    int ret = poll(&pfd, 1, 500);
+    if (ret < 0) {
+      if (errno == EINTR)
+        continue;
+      LOG_ERROR << "[DirWatcher] poll 失败: " << strerror(errno);
+      break;
+    }
+    if (ret == 0)
+      continue;
+
+    while (true) {
+      ssize_t len = read(inotifyFd_, buf, sizeof(buf));
+      if (len <= 0)
+        break;
+      handleEvents(buf, len);
+    }
+  }
+#endif
+}
+
+void DirWatcher::handleEvents(const char *buf, long len) {
+#ifdef __linux__
+  std::vector<std::string> newDirs;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const char *p = buf; p < buf + len;) {
+      const auto *ev = reinterpret_cast<const struct inotify_event *>(p);
+      p += sizeof(struct inotify_event) + ev->len;
+
+      if (ev->mask & IN_Q_OVERFLOW) {
+        LOG_WARN << "[DirWatcher] 事件队列溢出，下次将全量扫描";
+        overflow_ = true;
+        continue;
+      }
+
+      if (ev->mask & IN_IGNORED) {
+        wdToDir_.erase(ev->wd);
+        continue;
+      }
+
+      auto it = wdToDir_.find(ev->wd);
+      if (it == wdToDir_.end() || ev->len == 0)
+        continue;
+
+      std::string path = (fs::path(it->second) / ev->name).string();
+
+      if (ev->mask & IN_ISDIR) {
+        if (ev->mask & (IN_CREATE | IN_MOVED_TO)) {
+          newDirs.push_back(path);
+        }
+        continue;
+      }
+
+      if (ev->mask & (IN_DELETE | IN_MOVED_FROM)) {
+        changed_.erase(path);
+        removed_.insert(path);
+      } else {
+        removed_.erase(path);
+        changed_.insert(path);
+      }
+    }
+  }
+
+  // 在锁外递归添加新目录（会遍历文件系统）
+  for (const auto &dir : newDirs) {
+    addWatchRecursive(dir, true);
+  }
+#endif
+}
+
+} // namespace live2mp3::utils
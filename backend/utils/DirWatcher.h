@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace live2mp3::utils {
+
+/**
+ * @brief 基于 inotify 的递归目录监听器
+ *
+ * 在后台线程中读取 inotify 事件，收集发生变化的文件路径，
+ * 供扫描器增量获取。新建的子目录会自动加入监听。
+ *
+ * 当内核事件队列溢出(IN_Q_OVERFLOW)或无法添加监听(如超过
+ * max_user_watches)时，会置位 overflow 标志，调用方应回退到一次全量扫描。
+ *
+ * 非 Linux 平台上 start() 始终返回 false。
+ */
+class DirWatcher {
+public:
+  /**
+   * @brief 一次 drain 的结果
+   */
+  struct Changes {
+    std::vector<std::string> files; ///< 发生变化的文件路径（已去重）
+    std::vector<std::string> removed; ///< 被删除/移走的文件路径
+    bool overflow = false; ///< 是否发生过事件丢失，需要全量扫描
+  };
+
+  DirWatcher() = default;
+  ~DirWatcher();
+  DirWatcher(const DirWatcher &) = delete;
+  DirWatcher &operator=(const DirWatcher &) = delete;
+
+  /**
+   * @brief 开始递归监听给定的根目录
+   *
+   * @param roots 根目录列表
+   * @return true 监听线程已启动
+   * @return false 平台不支持或 inotify 初始化失败
+   */
+  bool start(const std::vector<std::string> &roots);
+
+  /**
+   * @brief 停止监听并回收线程
+   */
+  void stop();
+
+  bool isRunning() const { return running_.load(); }
+
+  /**
+   * @brief 当前监听的根目录
+   */
+  std::vector<std::string> getRoots() const;
+
+  /**
+   * @brief 取出自上次调用以来累积的变化
+   */
+  Changes drain();
+
+private:
+  void loop();
+  /// seedFiles 为 true 时，把目录下已有的文件也记为变化（用于运行中新建的目录）
+  void addWatchRecursive(const std::string &dir, bool seedFiles);
+  void handleEvents(const char *buf, long len);
+
+  int inotifyFd_ = -1;
+  std::thread thread_;
+  std::atomic<bool> running_{false};
+
+  mutable std::mutex mutex_;
+  std::vector<std::string> roots_;
+  std::unordered_map<int, std::string> wdToDir_;
+  std::unordered_set<std::string> changed_;
+  std::unordered_set<std::string> removed_;
+  bool overflow_ = false;
+};
+
+} // namespace live2mp3::utils
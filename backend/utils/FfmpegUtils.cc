@@ -6,20 +6,266 @@
  */
 
 #include "FfmpegUtils.h"
+#include "MediaProbe.h"
+#include "ProcessReactor.h"
+#include <algorithm>
 #include <array>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <deque>
 #include <drogon/drogon.h>
 #include <fcntl.h>
+#include <limits>
+#include <memory>
+#include <mutex>
 #include <regex>
 #include <signal.h>
+#include <spawn.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
 namespace live2mp3::utils {
 
+namespace {
+
+/// 保留的非进度输出行数
+constexpr size_t OUTPUT_TAIL_LINES = 20;
+
+/// 进度行（frame=... / size=...）不计入输出尾部
+bool isProgressLine(std::string_view line) {
+  return line.starts_with("frame=") || line.starts_with("size=");
+}
+
+void appendTailLine(std::deque<std::string> &tail, std::string_view line) {
+  if (line.empty() || isProgressLine(line))
+    return;
+  tail.emplace_back(line);
+  if (tail.size() > OUTPUT_TAIL_LINES)
+    tail.pop_front();
+}
+
+/// 等待退出期间检查取消回调的间隔（任务取消会直接终止进程，这里只兜底）
+constexpr auto CANCEL_CHECK_INTERVAL = std::chrono::milliseconds(500);
+
+/**
+ * @brief 单次执行的共享状态，反应器线程写入，调用线程等待
+ */
+struct RunState {
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool done = false;
+  int status = 0;
+  std::deque<std::string> tail;
+
+  // 以下只在反应器线程中访问
+  FfmpegProgressParser parser;
+  bool progressSeen = false; ///< 进度管道有数据后不再解析 stderr 统计行
+};
+
+/// 从文本开头解析数字（允许前导空格），不分配内存
+template <typename T> bool parseLeadingNumber(std::string_view text, T &out) {
+  const char *first = text.data();
+  const char *last = first + text.size();
+  while (first < last && *first == ' ')
+    ++first;
+  auto [ptr, ec] = std::from_chars(first, last, out);
+  return ec == std::errc() && ptr != first;
+}
+
+int clampToInt(long long value) {
+  return static_cast<int>(std::clamp<long long>(
+      value, 0, std::numeric_limits<int>::max()));
+}
+
+// 暂时性错误：换个时间重试有望成功
+constexpr const char *TRANSIENT_PATTERNS[] = {
+    "No space left on device",
+    "Cannot allocate memory",
+    "Resource temporarily unavailable",
+    "Too many open files",
+    "Input/output error",
+    "Device or resource busy",
+    "Connection reset",
+    "Connection timed out",
+    "Stale file handle",
+};
+
+// 确定性错误：输入或配置本身有问题，重试只会浪费一次完整转码
+constexpr const char *PERMANENT_PATTERNS[] = {
+    "Invalid data found when processing input",
+    "moov atom not found",
+    "No such file or directory",
+    "Permission denied",
+    "Unknown encoder",
+    "Encoder not found",
+    "Decoder not found",
+    "Unrecognized option",
+    "Option not found",
+    "Invalid argument",
+    "does not contain any stream",
+    "Output file #0 does not contain any stream",
+    "Error while opening encoder",
+    "Impossible to open",
+};
+
+} // namespace
+
+FfmpegFailureKind classifyFfmpegFailure(const FfmpegExitInfo &info) {
+  if (info.cancelled)
+    return FfmpegFailureKind::CANCELLED;
+  if (!info.started)
+    return FfmpegFailureKind::TRANSIENT;
+  if (info.exitCode == 0 && info.termSignal == 0)
+    return FfmpegFailureKind::NONE;
+
+  // 从最后一行往前找，越靠后的错误越接近真正原因
+  for (auto it = info.outputTail.rbegin(); it != info.outputTail.rend(); ++it) {
+    for (const char *pattern : TRANSIENT_PATTERNS) {
+      if (it->find(pattern) != std::string::npos)
+        return FfmpegFailureKind::TRANSIENT;
+    }
+    for (const char *pattern : PERMANENT_PATTERNS) {
+      if (it->find(pattern) != std::string::npos)
+        return FfmpegFailureKind::PERMANENT;
+    }
+  }
+
+  // 被信号杀死（OOM killer 的 SIGKILL、外部 SIGTERM 等）
+  if (info.termSignal != 0)
+    return FfmpegFailureKind::TRANSIENT;
+
+  // 126/127: sh 找不到或无法执行 ffmpeg，属于配置错误
+  return FfmpegFailureKind::PERMANENT;
+}
+
+const char *failureKindName(FfmpegFailureKind kind) {
+  switch (kind) {
+  case FfmpegFailureKind::NONE:
+    return "none";
+  case FfmpegFailureKind::TRANSIENT:
+    return "transient";
+  case FfmpegFailureKind::PERMANENT:
+    return "permanent";
+  case FfmpegFailureKind::CANCELLED:
+  default:
+    return "cancelled";
+  }
+}
+
+std::string describeFfmpegExit(const FfmpegExitInfo &info) {
+  std::string desc;
+  if (!info.started) {
+    desc = "not started";
+  } else if (info.cancelled) {
+    desc = "cancelled";
+  } else if (info.termSignal != 0) {
+    desc = "killed by signal " + std::to_string(info.termSignal);
+  } else {
+    desc = "exit code " + std::to_string(info.exitCode);
+  }
+  if (!info.outputTail.empty()) {
+    desc += ": " + info.outputTail.back();
+  }
+  return desc;
+}
+
+bool FfmpegProgressParser::feed(std::string_view line) {
+  size_t eq = line.find('=');
+  if (eq == std::string_view::npos)
+    return false;
+  std::string_view key = line.substr(0, eq);
+  std::string_view value = line.substr(eq + 1);
+
+  // 无法解析的值（如 N/A）保留上一组的数值
+  if (key == "frame") {
+    long long frame;
+    if (parseLeadingNumber(value, frame))
+      info_.frame = clampToInt(frame);
+  } else if (key == "fps") {
+    double fps;
+    if (parseLeadingNumber(value, fps))
+      info_.fps = static_cast<int>(fps);
+  } else if (key == "bitrate") {
+    // 形如 "1234.5kbits/s"
+    double bitrate;
+    if (parseLeadingNumber(value, bitrate))
+      info_.bitrate = static_cast<int>(bitrate);
+  } else if (key == "total_size") {
+    long long size;
+    if (parseLeadingNumber(value, size))
+      info_.size = clampToInt(size);
+  } else if (key == "out_time_us" || key == "out_time_ms") {
+    // 两者单位都是微秒（out_time_ms 是 FFmpeg 的历史命名错误）；开头可能为负
+    long long us;
+    if (parseLeadingNumber(value, us) && us >= 0)
+      info_.time = clampToInt(us / 1000);
+  } else if (key == "progress") {
+    ended_ = value == "end";
+    return true;
+  }
+  return false;
+}
+
+std::string withProgressPipe(const std::string &cmd) {
+  size_t begin = cmd.find_first_not_of(" \t");
+  if (begin == std::string::npos)
+    return cmd;
+  size_t end = cmd.find_first_of(" \t", begin);
+  if (end == std::string::npos)
+    end = cmd.size();
+
+  // 第一个词可能带路径或引号，如 /usr/bin/ffmpeg、"ffmpeg"
+  std::string_view program(cmd.data() + begin, end - begin);
+  while (!program.empty() && (program.front() == '"' || program.front() == '\''))
+    program.remove_prefix(1);
+  while (!program.empty() && (program.back() == '"' || program.back() == '\''))
+    program.remove_suffix(1);
+  size_t slash = program.rfind('/');
+  if (slash != std::string_view::npos)
+    program.remove_prefix(slash + 1);
+
+  if (program != "ffmpeg" || cmd.find(" -progress ") != std::string::npos)
+    return cmd;
+
+  return cmd.substr(0, end) + " -progress pipe:" +
+         std::to_string(FFMPEG_PROGRESS_FD) + " -nostats" + cmd.substr(end);
+}
+
+std::vector<std::string> withProgressPipe(std::vector<std::string> argv) {
+  if (argv.size() == 3 && argv[1] == "-c") {
+    // /bin/sh -c "<命令>"：注入到命令字符串中
+    argv[2] = withProgressPipe(argv[2]);
+    return argv;
+  }
+  if (argv.empty())
+    return argv;
+
+  std::string_view program(argv[0]);
+  size_t slash = program.rfind('/');
+  if (slash != std::string_view::npos)
+    program.remove_prefix(slash + 1);
+  if (program != "ffmpeg" ||
+      std::find(argv.begin(), argv.end(), "-progress") != argv.end())
+    return argv;
+
+  argv.insert(argv.begin() + 1,
+              {"-progress", "pipe:" + std::to_string(FFMPEG_PROGRESS_FD),
+               "-nostats"});
+  return argv;
+}
+
 int getMediaDuration(const std::string &filePath) {
+  // 录制常见的 FLV / TS / MP4 直接读容器结构，无需启动进程
+  if (auto native = probeDurationNative(filePath)) {
+    return *native;
+  }
+  LOG_DEBUG << "getMediaDuration: 无法原生解析，回退到 ffprobe: " << filePath;
+
   // 使用 ffprobe 获取媒体时长
   // ffprobe -v error -show_entries format=duration -of
   // default=noprint_wrappers=1:nokey=1 <file>
@@ -68,11 +314,77 @@ int getTotalMediaDuration(const std::vector<std::string> &filePaths) {
   return totalDuration;
 }
 
+std::optional<std::string> runFfprobeJson(const std::string &filePath) {
+  int pipefd[2];
+  if (pipe2(pipefd, O_CLOEXEC) == -1) {
+    LOG_ERROR << "runFfprobeJson: pipe() 创建失败";
+    return std::nullopt;
+  }
+
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null",
+                                   O_RDONLY, 0);
+  posix_spawn_file_actions_adddup2(&actions, pipefd[1], STDOUT_FILENO);
+  posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null",
+                                   O_WRONLY, 0);
+
+  // 路径作为独立参数传递，无需转义
+  std::vector<std::string> argv = {
+      "ffprobe",      "-v",          "error", "-print_format", "json",
+      "-show_format", "-show_streams", filePath};
+  std::vector<char *> spawnArgv;
+  spawnArgv.reserve(argv.size() + 1);
+  for (const auto &arg : argv) {
+    spawnArgv.push_back(const_cast<char *>(arg.c_str()));
+  }
+  spawnArgv.push_back(nullptr);
+
+  pid_t pid = 0;
+  int spawnError = posix_spawnp(&pid, spawnArgv[0], &actions, nullptr,
+                                spawnArgv.data(), environ);
+  posix_spawn_file_actions_destroy(&actions);
+  close(pipefd[1]);
+  if (spawnError != 0) {
+    LOG_ERROR << "runFfprobeJson: posix_spawn(ffprobe) 失败: "
+              << strerror(spawnError);
+    close(pipefd[0]);
+    return std::nullopt;
+  }
+
+  std::string output;
+  std::array<char, 4096> buffer;
+  while (true) {
+    ssize_t n = read(pipefd[0], buffer.data(), buffer.size());
+    if (n > 0) {
+      output.append(buffer.data(), static_cast<size_t>(n));
+    } else if (n == 0 || errno != EINTR) {
+      break;
+    }
+  }
+  close(pipefd[0]);
+
+  // 只等待自己启动的 PID，不会与 ProcessReactor 抢着回收
+  int status = 0;
+  while (waitpid(pid, &status, 0) == -1 && errno == EINTR) {
+  }
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    LOG_WARN << "runFfprobeJson: ffprobe 执行失败，文件: " << filePath;
+    return std::nullopt;
+  }
+  return output;
+}
+
 bool terminateFfmpegProcess(pid_t pid) {
   if (pid <= 0) {
     return false;
   }
 
+  // 由反应器监管的进程：发送 SIGTERM，超时后由反应器升级为 SIGKILL 并回收
+  if (ProcessReactor::instance().terminate(pid)) {
+    return true;
+  }
+
   // 使用 kill(-pid, ...) 向整个进程组发送信号
   // 先发送 SIGTERM 让进程组优雅退出
   if (kill(-pid, SIGTERM) == 0) {
@@ -126,16 +438,18 @@ FfmpegPipeInfo parseFfmpegProgressLine(const std::string &line) {
     info.size = std::stoi(match[1].str()) * 1024; // 转换为字节
   }
 
-  // 解析 time=HH:MM:SS.xx -> 转换为毫秒
-  // 匹配格式: time=00:00:05.00
-  static std::regex timeRe(R"(time=(\d{2}):(\d{2}):(\d{2})\.(\d{2}))");
+  // 解析 time=H:MM:SS.xx -> 转换为毫秒
+  // 匹配格式: time=00:00:05.00 / time=100:00:05.00（小时位数不固定）
+  static std::regex timeRe(R"(time=(\d+):(\d{2}):(\d{2})(?:\.(\d+))?)");
   if (std::regex_search(line, match, timeRe)) {
-    int hours = std::stoi(match[1].str());
+    long long hours = std::stoll(match[1].str());
     int minutes = std::stoi(match[2].str());
     int seconds = std::stoi(match[3].str());
-    int centiseconds = std::stoi(match[4].str());
-    info.time =
-        (hours * 3600 + minutes * 60 + seconds) * 1000 + centiseconds * 10;
+    // 小数部分按位数换算为毫秒（.5 = 500ms，.05 = 50ms）
+    std::string fraction = match[4].str().substr(0, 3);
+    fraction.resize(3, '0');
+    info.time = clampToInt((hours * 3600 + minutes * 60 + seconds) * 1000 +
+                           std::stoi(fraction));
   }
 
   // 解析 bitrate=XXX.Xkbits/s
@@ -151,51 +465,132 @@ FfmpegPipeInfo parseFfmpegProgressLine(const std::string &line) {
 bool runFfmpegWithProgress(const std::string &cmd,
                            FfmpegProgressCallback callback, int totalDuration,
                            CancelCheckCallback cancelCheck, pid_t *outPid,
-                           std::function<void(pid_t)> onPidAvailable) {
+                           std::function<void(pid_t)> onPidAvailable,
+                           FfmpegExitInfo *exitInfo) {
+  return runFfmpegWithProgress(std::vector<std::string>{"/bin/sh", "-c", cmd},
+                               std::move(callback), totalDuration,
+                               std::move(cancelCheck), outPid,
+                               std::move(onPidAvailable), exitInfo);
+}
+
+bool runFfmpegWithProgress(const std::vector<std::string> &argv,
+                           FfmpegProgressCallback callback, int totalDuration,
+                           CancelCheckCallback cancelCheck, pid_t *outPid,
+                           std::function<void(pid_t)> onPidAvailable,
+                           FfmpegExitInfo *exitInfo, int stdinFd) {
+  FfmpegExitInfo localExitInfo;
+  FfmpegExitInfo &exitResult = exitInfo ? *exitInfo : localExitInfo;
+  exitResult = FfmpegExitInfo{};
+
+  // 启动后（或失败时）关闭调用方交来的 stdin fd，读端只保留在子进程中
+  struct StdinGuard {
+    int fd;
+    ~StdinGuard() {
+      if (fd >= 0)
+        close(fd);
+    }
+  } stdinGuard{stdinFd};
+
   // 创建管道用于读取子进程输出
+  // O_CLOEXEC：并发启动的其他子进程不会继承写端，否则本管道要等它们退出才 EOF
   int pipefd[2];
-  if (pipe(pipefd) == -1) {
+  int progressFd[2];
+  if (pipe2(pipefd, O_CLOEXEC) == -1) {
     LOG_ERROR << "runFfmpegWithProgress: pipe() 创建失败";
     return false;
   }
-
-  pid_t pid = fork();
-  if (pid == -1) {
-    LOG_ERROR << "runFfmpegWithProgress: fork() 失败";
+  if (pipe2(progressFd, O_CLOEXEC) == -1) {
+    LOG_ERROR << "runFfmpegWithProgress: 进度管道创建失败";
     close(pipefd[0]);
     close(pipefd[1]);
     return false;
   }
 
-  if (pid == 0) {
-    // 子进程
-    close(pipefd[0]); // 关闭读端
-
-    // 创建新的进程组，使子进程成为组长
-    // 这样 kill(-pid, ...) 可以杀死整个进程树
-    setpgid(0, 0);
-
-    // 重定向 stdin 到 /dev/null，防止 FFmpeg 在后台尝试读取而挂起（SIGTTIN）
-    int devNull = open("/dev/null", O_RDONLY);
-    if (devNull != -1) {
-      dup2(devNull, STDIN_FILENO);
-      close(devNull);
-    }
+  // 写端不能恰好占用 fd 3，否则 dup2 到自身不会清除 O_CLOEXEC
+  if (progressFd[1] == FFMPEG_PROGRESS_FD) {
+    int moved = fcntl(progressFd[1], F_DUPFD_CLOEXEC, FFMPEG_PROGRESS_FD + 1);
+    close(progressFd[1]);
+    progressFd[1] = moved;
+  }
 
-    // 重定向 stdout 和 stderr 到管道写端
-    dup2(pipefd[1], STDOUT_FILENO);
-    dup2(pipefd[1], STDERR_FILENO);
+  // posix_spawn 在 glibc 中使用 CLONE_VFORK，不复制整个服务进程的页表
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  // 重定向 stdin 到 /dev/null，防止 FFmpeg 在后台尝试读取而挂起（SIGTTIN）；
+  // 边录边转时 stdin 为跟随管道的读端
+  if (stdinFd >= 0) {
+    posix_spawn_file_actions_adddup2(&actions, stdinFd, STDIN_FILENO);
+  } else {
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null",
+                                     O_RDONLY, 0);
+  }
+  // 重定向 stdout 和 stderr 到管道写端
+  posix_spawn_file_actions_adddup2(&actions, pipefd[1], STDOUT_FILENO);
+  posix_spawn_file_actions_adddup2(&actions, pipefd[1], STDERR_FILENO);
+  // 进度管道写端放到固定的 fd，供 -progress pipe:3 使用
+  posix_spawn_file_actions_adddup2(&actions, progressFd[1],
+                                   FFMPEG_PROGRESS_FD);
+#if defined(__GLIBC__) &&                                                      \
+    (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 34))
+  // 不把服务进程的其他 fd（监听 socket、数据库等）泄漏给 FFmpeg
+  posix_spawn_file_actions_addclosefrom_np(&actions, FFMPEG_PROGRESS_FD + 1);
+#endif
+
+  // 创建新的进程组，使子进程成为组长，这样 kill(-pid, ...) 可以杀死整个进程树；
+  // 恢复默认信号处理和空信号掩码（服务进程忽略了 SIGPIPE）
+  posix_spawnattr_t attr;
+  posix_spawnattr_init(&attr);
+  posix_spawnattr_setpgroup(&attr, 0);
+  sigset_t defaultSignals;
+  sigemptyset(&defaultSignals);
+  sigaddset(&defaultSignals, SIGPIPE);
+  posix_spawnattr_setsigdefault(&attr, &defaultSignals);
+  sigset_t emptyMask;
+  sigemptyset(&emptyMask);
+  posix_spawnattr_setsigmask(&attr, &emptyMask);
+  posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP |
+                                      POSIX_SPAWN_SETSIGDEF |
+                                      POSIX_SPAWN_SETSIGMASK);
+
+  std::vector<char *> spawnArgv;
+  spawnArgv.reserve(argv.size() + 1);
+  for (const auto &arg : argv) {
+    spawnArgv.push_back(const_cast<char *>(arg.c_str()));
+  }
+  spawnArgv.push_back(nullptr);
+
+  pid_t pid = 0;
+  int spawnError = argv.empty()
+                       ? EINVAL
+                       : posix_spawnp(&pid, spawnArgv[0], &actions, &attr,
+                                      spawnArgv.data(), environ);
+  posix_spawn_file_actions_destroy(&actions);
+  posix_spawnattr_destroy(&attr);
+
+  if (spawnError != 0) {
+    // 找不到可执行文件属于配置错误，进程数/内存不足可以重试，交给失败分类判断
+    LOG_ERROR << "runFfmpegWithProgress: posix_spawn("
+              << (argv.empty() ? "" : argv[0])
+              << ") 失败: " << strerror(spawnError);
+    close(pipefd[0]);
     close(pipefd[1]);
-
-    // 使用 /bin/sh -c 执行命令
-    execl("/bin/sh", "sh", "-c", cmd.c_str(), nullptr);
-
-    // 如果 exec 失败则退出
-    _exit(127);
+    close(progressFd[0]);
+    close(progressFd[1]);
+    exitResult.started = true;
+    exitResult.exitCode = 127;
+    exitResult.outputTail.push_back(std::string("posix_spawn: ") +
+                                    strerror(spawnError));
+    return false;
   }
 
   // 父进程
   close(pipefd[1]); // 关闭写端
+  close(progressFd[1]);
+  if (stdinGuard.fd >= 0) {
+    close(stdinGuard.fd); // 父进程不持有读端，FFmpeg 退出后写入方立即得到 EPIPE
+    stdinGuard.fd = -1;
+  }
+  exitResult.started = true;
 
   // 输出 PID（如果请求）
   if (outPid) {
@@ -209,99 +604,108 @@ bool runFfmpegWithProgress(const std::string &cmd,
     onPidAvailable(pid);
   }
 
-  // 设置非阻塞读取
-  int flags = fcntl(pipefd[0], F_GETFL, 0);
-  fcntl(pipefd[0], F_SETFL, flags | O_NONBLOCK);
-
-  bool cancelled = false;
-  std::string lineBuffer;
-  std::array<char, 256> buffer;
-
-  while (true) {
-    // 检查是否需要取消
-    if (cancelCheck && cancelCheck()) {
-      LOG_INFO << "FFmpeg 任务被取消，终止进程 " << pid;
-      terminateFfmpegProcess(pid);
-      cancelled = true;
-      break;
+  // 输出读取与子进程回收交给反应器线程，本线程只等待退出事件
+  auto state = std::make_shared<RunState>();
+  auto report = [callback, totalDuration, pid](FfmpegPipeInfo info) {
+    // 只有解析到有效数据时才调用回调
+    if (info.frame <= 0 && info.time <= 0)
+      return;
+
+    // 填充额外信息
+    info.pid = pid;
+    info.totalDuration = totalDuration;
+
+    // 计算进度百分比
+    if (totalDuration > 0 && info.time > 0) {
+      info.progress = std::min(100.0, (static_cast<double>(info.time) /
+                                       static_cast<double>(totalDuration)) *
+                                          100.0);
+    } else {
+      info.progress = -1.0; // 未知进度
     }
 
-    // 非阻塞读取
-    ssize_t bytesRead = read(pipefd[0], buffer.data(), buffer.size() - 1);
-    if (bytesRead > 0) {
-      buffer[bytesRead] = '\0';
-      lineBuffer += buffer.data();
-
-      // 逐行处理
-      size_t pos;
-      while ((pos = lineBuffer.find_first_of("\r\n")) != std::string::npos) {
-        std::string line = lineBuffer.substr(0, pos);
-        lineBuffer.erase(0, pos + 1);
-
-        // 如果有回调且行非空，解析并报告进度
-        if (callback && !line.empty()) {
-          FfmpegPipeInfo info = parseFfmpegProgressLine(line);
-          // 只有解析到有效数据时才调用回调
-          if (info.frame > 0 || info.time > 0) {
-            // 填充额外信息
-            info.pid = pid;
-            info.totalDuration = totalDuration;
-
-            // 计算进度百分比
-            if (totalDuration > 0 && info.time > 0) {
-              info.progress =
-                  std::min(100.0, (static_cast<double>(info.time) /
-                                   static_cast<double>(totalDuration)) *
-                                      100.0);
-            } else {
-              info.progress = -1.0; // 未知进度
-            }
-
-            callback(info);
-          }
-        }
-      }
-    } else if (bytesRead == 0) {
-      // EOF - 子进程已关闭管道
-      break;
-    } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
-      // 读取错误
-      LOG_ERROR << "runFfmpegWithProgress: read() 错误: " << strerror(errno);
-      break;
+    callback(info);
+  };
+  auto onLine = [state, callback, report](std::string_view line) {
+    {
+      std::lock_guard<std::mutex> lock(state->mutex);
+      appendTailLine(state->tail, line);
     }
-
-    // 检查子进程是否已退出
-    int status;
-    pid_t result = waitpid(pid, &status, WNOHANG);
-    if (result == pid) {
-      // 子进程已退出，读取剩余输出
-      while ((bytesRead = read(pipefd[0], buffer.data(), buffer.size() - 1)) >
-             0) {
-        buffer[bytesRead] = '\0';
-        lineBuffer += buffer.data();
-      }
-      break;
+    // 命令未启用 -progress 时回退为解析 stderr 统计行
+    if (callback && !state->progressSeen)
+      report(parseFfmpegProgressLine(std::string(line)));
+  };
+  auto onProgress = [state, callback, report](std::string_view line) {
+    if (state->parser.feed(line)) {
+      state->progressSeen = true;
+      if (callback)
+        report(state->parser.info());
     }
+  };
+  auto onExit = [state](int status) {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->status = status;
+    state->done = true;
+    state->cv.notify_all();
+  };
+
+  if (!ProcessReactor::instance().watch(pid, pipefd[0], std::move(onLine),
+                                        std::move(onExit), progressFd[0],
+                                        std::move(onProgress))) {
+    LOG_ERROR << "runFfmpegWithProgress: 无法监管 FFmpeg 进程 " << pid;
+    kill(-pid, SIGKILL);
+    waitpid(pid, nullptr, 0);
+    close(pipefd[0]);
+    close(progressFd[0]);
+    exitResult.started = false;
+    return false;
+  }
 
-    // 短暂休眠避免 CPU 占用过高
-    usleep(10000); // 10ms
+  bool cancelled = false;
+  std::unique_lock<std::mutex> lock(state->mutex);
+  while (!state->done) {
+    state->cv.wait_for(lock, CANCEL_CHECK_INTERVAL);
+    if (state->done || cancelled || !cancelCheck)
+      continue;
+
+    // 取消检查可能访问任务状态，不在持锁时调用
+    lock.unlock();
+    bool shouldCancel = cancelCheck();
+    lock.lock();
+    if (shouldCancel && !state->done) {
+      LOG_INFO << "FFmpeg 任务被取消，终止进程 " << pid;
+      ProcessReactor::instance().terminate(pid);
+      cancelled = true;
+    }
   }
 
-  close(pipefd[0]);
+  int status = state->status;
+  std::deque<std::string> tail = std::move(state->tail);
+  lock.unlock();
 
-  // 等待子进程退出并获取返回码
-  int status;
-  if (!cancelled) {
-    waitpid(pid, &status, 0);
+  exitResult.outputTail.assign(tail.begin(), tail.end());
+  exitResult.cancelled = cancelled;
 
+  // 子进程已由反应器回收，status 即其退出状态
+  if (!cancelled) {
     if (WIFEXITED(status)) {
       int exitCode = WEXITSTATUS(status);
+      if (exitCode > 128 && argv[0] == "/bin/sh") {
+        // 经 /bin/sh -c 运行时，子进程被信号终止表现为 shell 退出码 128+N
+        exitResult.termSignal = exitCode - 128;
+        LOG_ERROR << "FFmpeg 进程被信号终止: " << exitResult.termSignal
+                  << " (shell 退出码 " << exitCode << ")";
+        return false;
+      }
+      exitResult.exitCode = exitCode;
       if (exitCode != 0) {
-        LOG_ERROR << "FFmpeg 进程退出码: " << exitCode;
+        LOG_ERROR << "FFmpeg 进程退出码: " << exitCode
+                  << (tail.empty() ? "" : ", 最后输出: " + tail.back());
         return false;
       }
       return true;
     } else if (WIFSIGNALED(status)) {
+      exitResult.termSignal = WTERMSIG(status);
       LOG_ERROR << "FFmpeg 进程被信号终止: " << WTERMSIG(status);
       return false;
     }
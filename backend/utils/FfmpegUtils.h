@@ -1,6 +1,8 @@
 #pragma once
 #include <functional>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <sys/types.h>
 #include <vector>
 
@@ -39,10 +41,53 @@ using FfmpegProgressCallback = std::function<void(const FfmpegPipeInfo &info)>;
  */
 using CancelCheckCallback = std::function<bool()>;
 
+/**
+ * @brief FFmpeg 进程退出信息
+ *
+ * 由 runFfmpegWithProgress 填充，用于判断失败原因。
+ */
+struct FfmpegExitInfo {
+  bool started = false;   ///< 进程是否成功启动
+  bool cancelled = false; ///< 是否因取消被终止
+  int exitCode = -1;      ///< 正常退出时的返回码，否则为 -1
+  int termSignal = 0;     ///< 被信号终止时的信号编号，否则为 0（含 sh 的 128+N）
+  std::vector<std::string> outputTail; ///< 最后若干行非进度输出（stderr）
+};
+
+/**
+ * @brief 失败分类
+ */
+enum class FfmpegFailureKind {
+  NONE = 0,  ///< 未失败
+  TRANSIENT, ///< 暂时性失败（磁盘满、OOM、被信号杀死等），可重试
+  PERMANENT, ///< 确定性失败（输入损坏、编码器不存在、参数错误等），不重试
+  CANCELLED  ///< 被取消
+};
+
+/**
+ * @brief 根据退出信息对失败进行分类
+ *
+ * 优先匹配输出中的已知错误信息；被信号终止（经 /bin/sh 运行时为退出码
+ * 128+N，已在运行时换算为 termSignal）视为暂时性；
+ * 进程未能启动视为暂时性（如 fork 失败）；其余非零退出码视为确定性失败。
+ */
+FfmpegFailureKind classifyFfmpegFailure(const FfmpegExitInfo &info);
+
+/**
+ * @brief 失败分类名称（"transient" / "permanent" / ...）
+ */
+const char *failureKindName(FfmpegFailureKind kind);
+
+/**
+ * @brief 把退出信息格式化为一行摘要（退出码/信号 + 最后一行输出）
+ */
+std::string describeFfmpegExit(const FfmpegExitInfo &info);
+
 /**
  * @brief 获取媒体文件时长
  *
- * 使用 ffprobe 获取媒体文件的时长信息。
+ * FLV / MPEG-TS / MP4 优先在进程内解析容器结构（见 probeDurationNative），
+ * 无法识别时使用 ffprobe 获取媒体文件的时长信息。
  *
  * @param filePath 媒体文件路径
  * @return int 时长（毫秒），失败返回 -1
@@ -57,6 +102,16 @@ int getMediaDuration(const std::string &filePath);
  */
 int getTotalMediaDuration(const std::vector<std::string> &filePaths);
 
+/**
+ * @brief 执行 `ffprobe -print_format json -show_format -show_streams`
+ *
+ * 一次调用取得时长、码率和所有流的编码/分辨率信息，由 MediaInfoService
+ * 解析并按指纹缓存。以 argv 形式启动，路径无需转义。
+ *
+ * @return ffprobe 输出的 JSON 文本；无法启动或退出码非 0 时返回 std::nullopt
+ */
+std::optional<std::string> runFfprobeJson(const std::string &filePath);
+
 /**
  * @brief 解析 FFmpeg 进度输出行
  *
@@ -64,22 +119,74 @@ int getTotalMediaDuration(const std::vector<std::string> &filePaths);
  * 典型输出格式: frame=  123 fps= 25 q=-0.0 size=   1234kB time=00:00:05.00
  * bitrate= 123.4kbits/s
  *
+ * 仅用于未启用 `-progress` 管道的命令模板。
+ *
  * @param line FFmpeg 输出的一行文本
  * @return FfmpegPipeInfo 解析后的进度信息
  */
 FfmpegPipeInfo parseFfmpegProgressLine(const std::string &line);
 
+/// 子进程中 `-progress` 输出使用的文件描述符（对应 `-progress pipe:3`）
+constexpr int FFMPEG_PROGRESS_FD = 3;
+
+/**
+ * @brief `-progress` 机器可读输出的增量解析器
+ *
+ * `-progress` 每隔约 0.5 秒输出一组 key=value 行（frame、fps、bitrate、
+ * total_size、out_time_us、speed 等），以 progress=continue 或 progress=end
+ * 结束一组。逐行调用 feed()，一组结束时返回 true，由 info() 取出结果。
+ * 解析过程手写扫描，不分配内存。
+ */
+class FfmpegProgressParser {
+public:
+  /**
+   * @brief 输入一行（不含换行符）
+   * @return true 一组进度数据已完整
+   */
+  bool feed(std::string_view line);
+
+  const FfmpegPipeInfo &info() const { return info_; }
+
+  /// 是否已读到 progress=end
+  bool ended() const { return ended_; }
+
+private:
+  FfmpegPipeInfo info_{};
+  bool ended_ = false;
+};
+
+/**
+ * @brief 在 FFmpeg 命令中注入 `-progress pipe:3 -nostats`
+ *
+ * 选项插在第一个词（ffmpeg 可执行文件）之后，作为全局选项生效。
+ * 第一个词不是 ffmpeg 时原样返回，进度回退为解析 stderr 统计行。
+ */
+std::string withProgressPipe(const std::string &cmd);
+
+/**
+ * @brief argv 版本：在 argv[0] 之后插入选项；/bin/sh -c 形式则注入到命令字符串
+ */
+std::vector<std::string> withProgressPipe(std::vector<std::string> argv);
+
 /**
  * @brief 执行 FFmpeg 命令并实时报告进度
  *
- * 使用 fork+exec 执行 FFmpeg 命令，解析其输出中的进度信息，
+ * 使用 /bin/sh -c 执行 FFmpeg 命令，解析其输出中的进度信息，
  * 并通过回调函数实时报告给调用者。支持取消和进度百分比计算。
  *
+ * 输出读取和子进程回收由 ProcessReactor 线程完成，调用线程阻塞等待退出事件，
+ * 不再轮询；进度回调在反应器线程中执行。
+ *
+ * 子进程的 FFMPEG_PROGRESS_FD 连接到独立管道：命令带 `-progress pipe:3`
+ * （见 withProgressPipe）时由 FfmpegProgressParser 解析进度，stdout/stderr
+ * 只作诊断输出；否则回退为用 parseFfmpegProgressLine 解析 stderr 统计行。
+ *
  * @param cmd 完整的 FFmpeg 命令行
  * @param callback 可选的进度回调函数，每次解析到新进度时调用
  * @param totalDuration 输入文件总时长（毫秒），用于计算进度百分比；0表示不计算
  * @param cancelCheck 可选的取消检查回调，返回 true 时终止 FFmpeg 进程
  * @param outPid 可选的输出参数，用于获取 FFmpeg 进程 PID
+ * @param exitInfo 可选的输出参数，填充退出码/信号与最后若干行输出
  * @return true 命令执行成功（返回码为0）
  * @return false 命令执行失败或被取消
  */
@@ -88,12 +195,33 @@ bool runFfmpegWithProgress(const std::string &cmd,
                            int totalDuration = 0,
                            CancelCheckCallback cancelCheck = nullptr,
                            pid_t *outPid = nullptr,
-                           std::function<void(pid_t)> onPidAvailable = nullptr);
+                           std::function<void(pid_t)> onPidAvailable = nullptr,
+                           FfmpegExitInfo *exitInfo = nullptr);
+
+/**
+ * @brief 以 argv 形式执行 FFmpeg（不经过 shell）
+ *
+ * 使用 posix_spawnp 启动（按 PATH 查找 argv[0]），参数原样传递，无需引号转义。
+ * 其余参数与行为同字符串版本；无法启动时 exitInfo 的退出码为 127，
+ * 输出尾部包含 posix_spawn 的错误信息。
+ *
+ * @param stdinFd 可选，作为子进程 stdin 的 fd（如 FileTailer 的管道读端，
+ *        命令以 pipe:0 为输入）；函数接管并在启动后关闭它。-1 时为 /dev/null
+ */
+bool runFfmpegWithProgress(const std::vector<std::string> &argv,
+                           FfmpegProgressCallback callback = nullptr,
+                           int totalDuration = 0,
+                           CancelCheckCallback cancelCheck = nullptr,
+                           pid_t *outPid = nullptr,
+                           std::function<void(pid_t)> onPidAvailable = nullptr,
+                           FfmpegExitInfo *exitInfo = nullptr,
+                           int stdinFd = -1);
 
 /**
  * @brief 终止 FFmpeg 进程
  *
- * 向指定 PID 的进程发送 SIGTERM 信号。
+ * 向指定 PID 的进程组发送 SIGTERM 信号。由 ProcessReactor 监管的进程
+ * 立即返回，宽限期后仍未退出时由反应器发送 SIGKILL 并回收。
  *
  * @param pid 进程 PID
  * @return true 信号发送成功
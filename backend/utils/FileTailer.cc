@@ -0,0 +1,169 @@
+/**
+ * @file FileTailer.cc
+ * @brief 跟随正在写入的文件（边录边转）
+ */
+
+#include "FileTailer.h"
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <drogon/drogon.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <vector>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+
+namespace live2mp3::utils {
+
+namespace {
+
+/// 单次读取的块大小
+constexpr size_t CHUNK_SIZE = 1024 * 1024;
+/// 等待增长时的最长睡眠（也是检查停止请求的间隔）
+constexpr int WAIT_INTERVAL_MS = 1000;
+
+/// 写满 len 字节；读端关闭（EPIPE）或出错返回 false
+bool writeAll(int fd, const char *data, size_t len) {
+  while (len > 0) {
+    ssize_t n = write(fd, data, len);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    data += n;
+    len -= static_cast<size_t>(n);
+  }
+  return true;
+}
+
+} // namespace
+
+FileTailer::FileTailer(std::string path, int idleSeconds)
+    : path_(std::move(path)), idleSeconds_(idleSeconds) {}
+
+FileTailer::~FileTailer() {
+  stop();
+  finish();
+}
+
+int FileTailer::start() {
+  int fileFd = open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fileFd < 0) {
+    LOG_ERROR << "[FileTailer] 无法打开文件 " << path_ << ": "
+              << strerror(errno);
+    return -1;
+  }
+  int pipefd[2];
+  if (pipe2(pipefd, O_CLOEXEC) == -1) {
+    LOG_ERROR << "[FileTailer] pipe() 创建失败: " << strerror(errno);
+    close(fileFd);
+    return -1;
+  }
+  thread_ = std::thread([this, fileFd, writeFd = pipefd[1]]() {
+    loop(fileFd, writeFd);
+  });
+  return pipefd[0];
+}
+
+void FileTailer::stop() { stopping_ = true; }
+
+FileTailer::Result FileTailer::finish() {
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  return result_;
+}
+
+void FileTailer::loop(int fileFd, int pipeFd) {
+  Result result;
+  int notifyFd = -1;
+#ifdef __linux__
+  notifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (notifyFd >= 0 &&
+      inotify_add_watch(notifyFd, path_.c_str(),
+                        IN_MODIFY | IN_CLOSE_WRITE | IN_DELETE_SELF |
+                            IN_MOVE_SELF) < 0) {
+    close(notifyFd);
+    notifyFd = -1;
+  }
+#endif
+
+  std::vector<char> buf(CHUNK_SIZE);
+  bool writerGone = false; // 已收到关闭/删除事件，读完剩余数据即结束
+  auto lastGrowth = std::chrono::steady_clock::now();
+
+  while (!stopping_) {
+    ssize_t n = read(fileFd, buf.data(), buf.size());
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      LOG_ERROR << "[FileTailer] 读取失败 " << path_ << ": " << strerror(errno);
+      break;
+    }
+    if (n > 0) {
+      if (!writeAll(pipeFd, buf.data(), static_cast<size_t>(n))) {
+        // 读端的 FFmpeg 已退出
+        LOG_WARN << "[FileTailer] 管道已关闭，停止跟随: " << path_;
+        break;
+      }
+      result.bytes += static_cast<uint64_t>(n);
+      lastGrowth = std::chrono::steady_clock::now();
+      continue;
+    }
+
+    // 到达当前末尾
+    if (writerGone) {
+      result.ok = true;
+      break;
+    }
+    auto idle = std::chrono::steady_clock::now() - lastGrowth;
+    if (idle >= std::chrono::seconds(idleSeconds_)) {
+      LOG_INFO << "[FileTailer] " << idleSeconds_ << " 秒未增长，结束跟随: "
+               << path_;
+      result.ok = true;
+      break;
+    }
+
+#ifdef __linux__
+    if (notifyFd >= 0) {
+      struct pollfd pfd = {notifyFd, POLLIN, 0};
+      if (poll(&pfd, 1, WAIT_INTERVAL_MS) > 0) {
+        alignas(struct inotify_event) char events[4096];
+        ssize_t len;
+        while ((len = read(notifyFd, events, sizeof(events))) > 0) {
+          for (const char *p = events; p < events + len;) {
+            const auto *ev = reinterpret_cast<const struct inotify_event *>(p);
+            p += sizeof(struct inotify_event) + ev->len;
+            if (ev->mask & IN_CLOSE_WRITE) {
+              result.writerClosed = true;
+              writerGone = true;
+            } else if (ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+              writerGone = true;
+            }
+          }
+        }
+      }
+      continue;
+    }
+#endif
+    std::this_thread::sleep_for(std::chrono::milliseconds(WAIT_INTERVAL_MS));
+  }
+
+  if (notifyFd >= 0)
+    close(notifyFd);
+  close(fileFd);
+  close(pipeFd); // FFmpeg 读到 EOF 后收尾
+
+  LOG_DEBUG << "[FileTailer] 结束跟随 " << path_ << ": " << result.bytes
+            << " 字节" << (result.writerClosed ? "（写入方已关闭）" : "");
+  std::lock_guard<std::mutex> lock(mutex_);
+  result_ = result;
+}
+
+} // namespace live2mp3::utils
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace live2mp3::utils {
+
+/**
+ * @brief 跟随正在写入的文件，把内容持续写入管道
+ *
+ * 用于边录边转：FFmpeg 以 pipe:0 读取管道，读端作为其 stdin。
+ * 后台线程从头读取文件并写入管道，到达末尾后等待文件增长
+ * （inotify IN_MODIFY 唤醒，无 inotify 时每秒检查一次）。
+ * 满足以下任一条件时读完剩余数据并关闭写端，FFmpeg 随之读到 EOF 正常收尾：
+ * - 写入方关闭文件（IN_CLOSE_WRITE）；
+ * - 文件被删除或移走；
+ * - 连续 idleSeconds 秒没有增长（稳定信号，覆盖录制中断未关闭文件的情况）。
+ *
+ * 只适用于可以边写边读的流式容器（FLV、MPEG-TS），MP4 的 moov 在文件末尾写入，
+ * 不能这样读取。
+ */
+class FileTailer {
+public:
+  /**
+   * @brief 跟随结果
+   */
+  struct Result {
+    bool ok = false;           ///< 正常读到结束条件（而不是被停止或出错）
+    bool writerClosed = false; ///< 因写入方关闭文件而结束
+    uint64_t bytes = 0;        ///< 写入管道的字节数（结束时的文件大小）
+  };
+
+  FileTailer(std::string path, int idleSeconds);
+  ~FileTailer();
+  FileTailer(const FileTailer &) = delete;
+  FileTailer &operator=(const FileTailer &) = delete;
+
+  /**
+   * @brief 打开文件并启动跟随线程
+   *
+   * @return 管道读端（O_CLOEXEC），由调用方负责关闭；失败返回 -1
+   */
+  int start();
+
+  /**
+   * @brief 请求停止（读端的进程已退出或任务被取消时调用）
+   */
+  void stop();
+
+  /**
+   * @brief 等待跟随线程结束并返回结果
+   */
+  Result finish();
+
+private:
+  void loop(int fileFd, int pipeFd);
+
+  std::string path_;
+  int idleSeconds_;
+  std::thread thread_;
+  std::atomic<bool> stopping_{false};
+  std::mutex mutex_;
+  Result result_;
+};
+
+} // namespace live2mp3::utils
@@ -1,8 +1,15 @@
 #include "FileUtils.h"
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
 #include <filesystem>
 #include <fstream>
 #include <iomanip>
 #include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <vector>
 #include <xxhash.h>
 
@@ -13,7 +20,12 @@ namespace live2mp3::utils {
 // 采样大小：50KB
 constexpr size_t SAMPLE_SIZE = 51200;
 
-std::string calculateFileFingerprint(const std::string &filepath) {
+/**
+ * @brief v1 指纹：ifstream + XXH64 流式计算
+ *
+ * 保留用于识别升级前写入数据库的指纹。
+ */
+static std::string calculateFileFingerprintV1(const std::string &filepath) {
   std::error_code ec;
 
   // 1. 获取文件元数据
@@ -75,4 +87,121 @@ std::string calculateFileFingerprint(const std::string &filepath) {
   return ss.str();
 }
 
+/**
+ * @brief 读满 len 字节（处理 EINTR 和短读），返回实际读取的字节数，出错返回 -1
+ */
+static ssize_t preadFull(int fd, char *buf, size_t len, off_t offset) {
+  size_t done = 0;
+  while (done < len) {
+    ssize_t n = pread(fd, buf + done, len - done, offset + done);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return -1;
+    }
+    if (n == 0)
+      break;
+    done += static_cast<size_t>(n);
+  }
+  return static_cast<ssize_t>(done);
+}
+
+/**
+ * @brief v2 指纹：pread 到线程局部缓冲区，XXH3 一次性计算
+ *
+ * 缓冲区布局: [size(8) | mtime_ns(8) | 头部采样 | 尾部采样]
+ */
+static std::string calculateFileFingerprintV2(const std::string &filepath) {
+  // 每个线程只分配一次，之后复用
+  thread_local std::vector<char> buffer(sizeof(uint64_t) * 2 +
+                                        SAMPLE_SIZE * 2);
+
+  int fd = open(filepath.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return "";
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+    close(fd);
+    return "";
+  }
+
+  // 只读取头尾，不需要内核预读，也不希望采样数据长期占用页缓存
+#if defined(POSIX_FADV_RANDOM)
+  posix_fadvise(fd, 0, 0, POSIX_FADV_RANDOM);
+  posix_fadvise(fd, 0, 0, POSIX_FADV_NOREUSE);
+#elif defined(F_RDAHEAD)
+  fcntl(fd, F_RDAHEAD, 0);
+#endif
+
+  uint64_t size = static_cast<uint64_t>(st.st_size);
+#ifdef __APPLE__
+  int64_t mtimeNs = static_cast<int64_t>(st.st_mtimespec.tv_sec) * 1000000000 +
+                    st.st_mtimespec.tv_nsec;
+#else
+  int64_t mtimeNs =
+      static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+
+  char *p = buffer.data();
+  memcpy(p, &size, sizeof(size));
+  memcpy(p + sizeof(size), &mtimeNs, sizeof(mtimeNs));
+  size_t len = sizeof(size) + sizeof(mtimeNs);
+
+  ssize_t n;
+  if (size <= SAMPLE_SIZE * 2) {
+    // 小文件（≤100KB）：读取全部内容
+    n = preadFull(fd, p + len, static_cast<size_t>(size), 0);
+    if (n >= 0)
+      len += static_cast<size_t>(n);
+  } else {
+    // 大文件：只读取头部和尾部各 50KB
+    n = preadFull(fd, p + len, SAMPLE_SIZE, 0);
+    if (n >= 0) {
+      len += static_cast<size_t>(n);
+      n = preadFull(fd, p + len, SAMPLE_SIZE,
+                    static_cast<off_t>(size - SAMPLE_SIZE));
+      if (n >= 0)
+        len += static_cast<size_t>(n);
+    }
+  }
+  close(fd);
+  if (n < 0)
+    return "";
+
+  XXH64_hash_t hash = XXH3_64bits(p, len);
+
+  char out[24];
+  snprintf(out, sizeof(out), "v2:%016llx",
+           static_cast<unsigned long long>(hash));
+  return out;
+}
+
+std::string calculateFileFingerprint(const std::string &filepath) {
+  return calculateFileFingerprint(filepath, FINGERPRINT_VERSION);
+}
+
+std::string calculateFileFingerprint(const std::string &filepath,
+                                     int version) {
+  switch (version) {
+  case 1:
+    return calculateFileFingerprintV1(filepath);
+  case 2:
+    return calculateFileFingerprintV2(filepath);
+  default:
+    return "";
+  }
+}
+
+int getFingerprintVersion(const std::string &fingerprint) {
+  if (fingerprint.size() > 3 && fingerprint[0] == 'v' &&
+      fingerprint[2] == ':') {
+    return fingerprint[1] - '0';
+  }
+  if (fingerprint.size() == 16) {
+    return 1;
+  }
+  return 0;
+}
+
 } // namespace live2mp3::utils
@@ -4,15 +4,41 @@
 
 namespace live2mp3::utils {
 
+/// 当前指纹版本。v1: XXH64 流式计算，16 位十六进制；v2: XXH3 一次性计算，
+/// 格式为 "v2:" + 16 位十六进制
+constexpr int FINGERPRINT_VERSION = 2;
+
 /**
  * @brief 计算文件的采样指纹（高效替代 MD5）
  *
  * 使用文件大小 + 头部采样(50KB) + 尾部采样(50KB) + 修改时间生成唯一指纹。
  * 对于大文件，只读取 100KB 数据，性能比 MD5 提升 10,000 倍以上。
  *
+ * 当前版本使用 pread 读入线程局部缓冲区（不产生堆分配），
+ * 并通过 posix_fadvise 提示内核按随机访问处理，避免预读整段文件。
+ *
  * @param filepath 文件路径
- * @return std::string 16 位十六进制指纹字符串，失败返回空字符串
+ * @return std::string 当前版本的指纹字符串，失败返回空字符串
  */
 std::string calculateFileFingerprint(const std::string &filepath);
 
+/**
+ * @brief 按指定版本计算文件指纹
+ *
+ * 用于和数据库中旧版本的指纹比较（迁移）。
+ *
+ * @param filepath 文件路径
+ * @param version 指纹版本（1 或 2）
+ * @return std::string 指纹字符串，失败或版本不支持返回空字符串
+ */
+std::string calculateFileFingerprint(const std::string &filepath,
+                                     int version);
+
+/**
+ * @brief 获取指纹字符串的版本
+ *
+ * @return int 版本号；无前缀的 16 位十六进制为 v1，无法识别返回 0
+ */
+int getFingerprintVersion(const std::string &fingerprint);
+
 } // namespace live2mp3::utils
@@ -0,0 +1,149 @@
+/**
+ * @file FingerprintIndex.cc
+ * @brief 文件指纹索引实现
+ */
+
+#include "FingerprintIndex.h"
+#include "FileUtils.h"
+#include <cinttypes>
+#include <cstdio>
+#include <drogon/drogon.h>
+#include <fstream>
+#include <sys/stat.h>
+
+namespace live2mp3::utils {
+
+// 文件格式: 首行版本号，之后每行 dev\tino\tsize\tmtime_ns\tfingerprint\tpath
+// 路径放在最后，允许包含制表符
+// 版本号随指纹算法升级，旧索引直接丢弃重建
+static const char *INDEX_HEADER = "live2mp3-fingerprint-index 2";
+
+bool FingerprintIndex::load(const std::string &indexPath) {
+  std::ifstream in(indexPath);
+  if (!in)
+    return false;
+
+  std::string line;
+  if (!std::getline(in, line) || line != INDEX_HEADER) {
+    LOG_WARN << "[FingerprintIndex] 索引文件版本不符，忽略: " << indexPath;
+    return false;
+  }
+
+  std::unordered_map<std::string, Entry> loaded;
+  while (std::getline(in, line)) {
+    Entry e;
+    char fp[64] = {0};
+    int pathOffset = 0;
+    if (sscanf(line.c_str(),
+               "%" SCNu64 "\t%" SCNu64 "\t%" SCNu64 "\t%" SCNd64
+               "\t%63[^\t]\t%n",
+               &e.dev, &e.ino, &e.size, &e.mtimeNs, fp, &pathOffset) != 5 ||
+        pathOffset <= 0 || static_cast<size_t>(pathOffset) >= line.size()) {
+      continue;
+    }
+    e.fingerprint = fp;
+    loaded.emplace(line.substr(pathOffset), std::move(e));
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_ = std::move(loaded);
+  dirty_ = false;
+  LOG_INFO << "[FingerprintIndex] 已加载 " << entries_.size() << " 条记录";
+  return true;
+}
+
+bool FingerprintIndex::save(const std::string &indexPath) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!dirty_)
+    return true;
+
+  std::string tmpPath = indexPath + ".tmp";
+  {
+    std::ofstream out(tmpPath, std::ios::trunc);
+    if (!out) {
+      LOG_WARN << "[FingerprintIndex] 无法写入: " << tmpPath;
+      return false;
+    }
+    out << INDEX_HEADER << '\n';
+    for (const auto &[path, e] : entries_) {
+      if (path.find('\n') != std::string::npos)
+        continue;
+      out << e.dev << '\t' << e.ino << '\t' << e.size << '\t' << e.mtimeNs
+          << '\t' << e.fingerprint << '\t' << path << '\n';
+    }
+    if (!out.flush()) {
+      LOG_WARN << "[FingerprintIndex] 写入失败: " << tmpPath;
+      return false;
+    }
+  }
+
+  if (std::rename(tmpPath.c_str(), indexPath.c_str()) != 0) {
+    LOG_WARN << "[FingerprintIndex] 重命名失败: " << tmpPath;
+    std::remove(tmpPath.c_str());
+    return false;
+  }
+  dirty_ = false;
+  return true;
+}
+
+std::string FingerprintIndex::getFingerprint(const std::string &filepath) {
+  struct stat st;
+  if (::stat(filepath.c_str(), &st) != 0)
+    return "";
+
+  Entry current;
+  current.dev = static_cast<uint64_t>(st.st_dev);
+  current.ino = static_cast<uint64_t>(st.st_ino);
+  current.size = static_cast<uint64_t>(st.st_size);
+#ifdef __APPLE__
+  current.mtimeNs = static_cast<int64_t>(st.st_mtimespec.tv_sec) * 1000000000 +
+                    st.st_mtimespec.tv_nsec;
+#else
+  current.mtimeNs =
+      static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(filepath);
+    if (it != entries_.end() && it->second.dev == current.dev &&
+        it->second.ino == current.ino && it->second.size == current.size &&
+        it->second.mtimeNs == current.mtimeNs) {
+      stats_.hits++;
+      return it->second.fingerprint;
+    }
+  }
+
+  // stat 在读取之前获取：若读取期间文件又变化，下一轮 stat 不一致会重新计算
+  current.fingerprint = calculateFileFingerprint(filepath);
+  if (current.fingerprint.empty())
+    return "";
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats_.misses++;
+  entries_[filepath] = current;
+  dirty_ = true;
+  return current.fingerprint;
+}
+
+void FingerprintIndex::retainOnly(const std::unordered_set<std::string> &paths) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto it = entries_.begin(); it != entries_.end();) {
+    if (paths.count(it->first) == 0) {
+      it = entries_.erase(it);
+      dirty_ = true;
+    } else {
+      ++it;
+    }
+  }
+}
+
+FingerprintIndex::Stats FingerprintIndex::takeStats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Stats s = stats_;
+  s.entries = entries_.size();
+  stats_ = Stats{};
+  return s;
+}
+
+} // namespace live2mp3::utils
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace live2mp3::utils {
+
+/**
+ * @brief 文件指纹索引（stat 快照 -> 指纹）
+ *
+ * 以路径为键，记录 (dev, inode, size, mtime) 与上次计算的指纹。
+ * stat 结果未变化时直接返回缓存的指纹，不读取文件内容；
+ * 因此稳定状态下每轮扫描的磁盘读取量只与变化的文件数量相关。
+ *
+ * 索引持久化到数据库旁的文本文件中，重启后仍然有效。
+ */
+class FingerprintIndex {
+public:
+  struct Stats {
+    uint64_t hits = 0;   ///< 命中缓存（未读文件）
+    uint64_t misses = 0; ///< 重新计算指纹
+    size_t entries = 0;
+  };
+
+  /**
+   * @brief 从文件加载索引，文件不存在或版本不符时返回 false（索引为空）
+   */
+  bool load(const std::string &indexPath);
+
+  /**
+   * @brief 有修改时写回文件（先写临时文件再 rename）
+   */
+  bool save(const std::string &indexPath);
+
+  /**
+   * @brief 获取文件指纹，stat 未变化时使用缓存
+   *
+   * @return std::string 指纹，失败返回空字符串
+   */
+  std::string getFingerprint(const std::string &filepath);
+
+  /**
+   * @brief 只保留给定集合中的路径（用于全量扫描后清理已消失的文件）
+   */
+  void retainOnly(const std::unordered_set<std::string> &paths);
+
+  /**
+   * @brief 获取并清零命中统计
+   */
+  Stats takeStats();
+
+private:
+  struct Entry {
+    uint64_t dev = 0;
+    uint64_t ino = 0;
+    uint64_t size = 0;
+    int64_t mtimeNs = 0;
+    std::string fingerprint;
+  };
+
+  std::mutex mutex_;
+  std::unordered_map<std::string, Entry> entries_;
+  bool dirty_ = false;
+  Stats stats_;
+};
+
+} // namespace live2mp3::utils
@@ -0,0 +1,74 @@
+/**
+ * @file LoadSampler.cc
+ * @brief /proc/stat 与 PSI 负载采样实现
+ */
+
+#include "LoadSampler.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace live2mp3::utils {
+
+LoadSample LoadSampler::sample() {
+  LoadSample result;
+
+  std::ifstream statFile("/proc/stat");
+  std::string line;
+  if (statFile.is_open() && std::getline(statFile, line)) {
+    // cpu user nice system idle iowait irq softirq steal
+    unsigned long long user = 0, nice = 0, sys = 0, idle = 0, iowait = 0,
+                       irq = 0, softirq = 0, steal = 0;
+    if (sscanf(line.c_str(), "cpu %llu %llu %llu %llu %llu %llu %llu %llu",
+               &user, &nice, &sys, &idle, &iowait, &irq, &softirq,
+               &steal) >= 4) {
+      uint64_t total = user + nice + sys + idle + iowait + irq + softirq + steal;
+      uint64_t idleAll = idle + iowait;
+      if (lastTotal_ > 0 && total > lastTotal_) {
+        uint64_t dTotal = total - lastTotal_;
+        uint64_t dIdle = idleAll >= lastIdle_ ? idleAll - lastIdle_ : 0;
+        result.cpuBusy =
+            1.0 - static_cast<double>(dIdle) / static_cast<double>(dTotal);
+      }
+      lastTotal_ = total;
+      lastIdle_ = idleAll;
+    }
+  }
+
+  if (auto cpu = readPressure("/proc/pressure/cpu"))
+    result.cpuPressure = *cpu;
+  if (auto io = readPressure("/proc/pressure/io"))
+    result.ioPressure = *io;
+
+  return result;
+}
+
+std::optional<double>
+LoadSampler::parsePressureAvg10(const std::string &content) {
+  // some avg10=1.23 avg60=0.50 avg300=0.10 total=12345
+  size_t pos = content.find("some ");
+  if (pos == std::string::npos)
+    return std::nullopt;
+  pos = content.find("avg10=", pos);
+  if (pos == std::string::npos)
+    return std::nullopt;
+
+  const char *begin = content.c_str() + pos + 6;
+  char *end = nullptr;
+  double value = std::strtod(begin, &end);
+  if (end == begin)
+    return std::nullopt;
+  return value;
+}
+
+std::optional<double> LoadSampler::readPressure(const char *path) {
+  std::ifstream file(path);
+  if (!file.is_open())
+    return std::nullopt;
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+  return parsePressureAvg10(buffer.str());
+}
+
+} // namespace live2mp3::utils
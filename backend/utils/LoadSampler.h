@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace live2mp3::utils {
+
+/**
+ * @brief 一次系统负载采样
+ *
+ * 无法读取的指标为负值（例如内核未开启 PSI）。
+ */
+struct LoadSample {
+  double cpuBusy = -1.0;     ///< 两次采样间 CPU 忙碌比例 (0.0-1.0)
+  double cpuPressure = -1.0; ///< /proc/pressure/cpu some avg10 (%)
+  double ioPressure = -1.0;  ///< /proc/pressure/io some avg10 (%)
+};
+
+/**
+ * @brief 读取 /proc/stat 与 PSI（/proc/pressure/cpu、/proc/pressure/io）的负载采样器
+ *
+ * CPU 忙碌比例基于相邻两次 sample() 的 jiffies 差值，首次调用时为 -1。
+ * 非线程安全，应由单一线程（定时器）调用。
+ */
+class LoadSampler {
+public:
+  LoadSample sample();
+
+  /**
+   * @brief 从 PSI 文件内容中解析 "some avg10=" 的值
+   */
+  static std::optional<double> parsePressureAvg10(const std::string &content);
+
+private:
+  static std::optional<double> readPressure(const char *path);
+
+  uint64_t lastTotal_ = 0;
+  uint64_t lastIdle_ = 0;
+};
+
+} // namespace live2mp3::utils
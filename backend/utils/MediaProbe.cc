@@ -0,0 +1,430 @@
+/**
+ * @file MediaProbe.cc
+ * @brief 原生容器时长探测实现（FLV / MPEG-TS / MP4）
+ */
+
+#include "MediaProbe.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <limits>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace live2mp3::utils {
+
+namespace {
+
+/// 尾部扫描窗口（FLV 找最后一个完整 tag、TS 找最后的 PTS）
+constexpr size_t TAIL_WINDOW = 1024 * 1024;
+/// TS 头部扫描窗口
+constexpr size_t HEAD_WINDOW = 1024 * 1024;
+/// moov 读入内存的上限，超过时交给 ffprobe
+constexpr uint64_t MAX_MOOV_SIZE = 64ull * 1024 * 1024;
+
+constexpr size_t TS_PACKET_SIZE = 188;
+constexpr uint8_t TS_SYNC = 0x47;
+constexpr int64_t PTS_WRAP = int64_t{1} << 33;
+
+uint32_t be24(const uint8_t *p) {
+  return (uint32_t{p[0]} << 16) | (uint32_t{p[1]} << 8) | p[2];
+}
+
+uint32_t be32(const uint8_t *p) {
+  return (uint32_t{p[0]} << 24) | (uint32_t{p[1]} << 16) |
+         (uint32_t{p[2]} << 8) | p[3];
+}
+
+uint64_t be64(const uint8_t *p) {
+  return (uint64_t{be32(p)} << 32) | be32(p + 4);
+}
+
+/**
+ * @brief 只读文件句柄（RAII），提供按偏移读满的 pread
+ */
+class MediaFile {
+public:
+  explicit MediaFile(const std::string &path)
+      : fd_(open(path.c_str(), O_RDONLY | O_CLOEXEC)) {
+    struct stat st;
+    if (fd_ >= 0 && fstat(fd_, &st) == 0 && S_ISREG(st.st_mode)) {
+      size_ = static_cast<uint64_t>(st.st_size);
+    } else if (fd_ >= 0) {
+      close(fd_);
+      fd_ = -1;
+    }
+  }
+  ~MediaFile() {
+    if (fd_ >= 0)
+      close(fd_);
+  }
+  MediaFile(const MediaFile &) = delete;
+  MediaFile &operator=(const MediaFile &) = delete;
+
+  bool ok() const { return fd_ >= 0; }
+  uint64_t size() const { return size_; }
+
+  /// 读满 len 字节（处理 EINTR 和短读），不足 len 返回 false
+  bool read(uint64_t offset, void *buf, size_t len) const {
+    auto *out = static_cast<uint8_t *>(buf);
+    size_t done = 0;
+    while (done < len) {
+      ssize_t n = pread(fd_, out + done, len - done,
+                        static_cast<off_t>(offset + done));
+      if (n < 0) {
+        if (errno == EINTR)
+          continue;
+        return false;
+      }
+      if (n == 0)
+        return false;
+      done += static_cast<size_t>(n);
+    }
+    return true;
+  }
+
+  /// 读取 [offset, offset + len) 与文件的交集
+  std::vector<uint8_t> readRange(uint64_t offset, size_t len) const {
+    if (offset >= size_)
+      return {};
+    len = static_cast<size_t>(std::min<uint64_t>(len, size_ - offset));
+    std::vector<uint8_t> buf(len);
+    if (!read(offset, buf.data(), len))
+      return {};
+    return buf;
+  }
+
+private:
+  int fd_ = -1;
+  uint64_t size_ = 0;
+};
+
+ContainerFormat detectFormat(const MediaFile &file) {
+  uint8_t head[TS_PACKET_SIZE * 2 + 1];
+  size_t len = static_cast<size_t>(std::min<uint64_t>(sizeof(head), file.size()));
+  if (len < 12 || !file.read(0, head, len))
+    return ContainerFormat::UNKNOWN;
+
+  if (std::memcmp(head, "FLV", 3) == 0)
+    return ContainerFormat::FLV;
+
+  if (len == sizeof(head) && head[0] == TS_SYNC &&
+      head[TS_PACKET_SIZE] == TS_SYNC && head[TS_PACKET_SIZE * 2] == TS_SYNC)
+    return ContainerFormat::MPEGTS;
+
+  // ISO BMFF：第一个 box 为 ftyp（少数录制工具直接以 moov/mdat/free 开头）
+  static constexpr const char *MP4_BOXES[] = {"ftyp", "moov", "mdat", "free",
+                                              "skip", "wide"};
+  for (const char *box : MP4_BOXES) {
+    if (std::memcmp(head + 4, box, 4) == 0)
+      return ContainerFormat::MP4;
+  }
+  return ContainerFormat::UNKNOWN;
+}
+
+// ------------------------------------------------------------
+// FLV
+// ------------------------------------------------------------
+
+/// 读取 FLV tag 头中的时间戳（24 位 + 扩展高 8 位）
+int64_t flvTimestamp(const uint8_t *tag) {
+  return static_cast<int32_t>(be24(tag + 4) | (uint32_t{tag[7]} << 24));
+}
+
+std::optional<int> probeFlv(const MediaFile &file) {
+  uint8_t header[9];
+  if (!file.read(0, header, sizeof(header)))
+    return std::nullopt;
+  uint64_t firstTag = uint64_t{be32(header + 5)} + 4; // 跳过 PreviousTagSize0
+
+  uint8_t first[11];
+  if (!file.read(firstTag, first, sizeof(first)))
+    return std::nullopt;
+  int64_t firstTs = flvTimestamp(first);
+
+  // 从尾部向前找最后一个完整 tag：类型为音/视频/脚本，StreamID 为 0，
+  // 且紧随其后的 PreviousTagSize 等于 11 + DataSize
+  uint64_t windowStart =
+      file.size() > TAIL_WINDOW ? file.size() - TAIL_WINDOW : firstTag;
+  windowStart = std::max(windowStart, firstTag);
+  auto tail = file.readRange(windowStart, TAIL_WINDOW);
+  if (tail.size() < 15)
+    return std::nullopt;
+
+  for (size_t p = tail.size() - 15 + 1; p-- > 0;) {
+    const uint8_t *tag = tail.data() + p;
+    if (tag[0] != 8 && tag[0] != 9 && tag[0] != 18)
+      continue;
+    if (tag[8] != 0 || tag[9] != 0 || tag[10] != 0)
+      continue;
+    uint64_t dataSize = be24(tag + 1);
+    uint64_t end = p + 11 + dataSize;
+    if (end + 4 > tail.size() || be32(tail.data() + end) != dataSize + 11)
+      continue;
+
+    int64_t duration = flvTimestamp(tag) - firstTs;
+    if (duration <= 0 || duration > std::numeric_limits<int>::max())
+      return std::nullopt;
+    return static_cast<int>(duration);
+  }
+  return std::nullopt;
+}
+
+// ------------------------------------------------------------
+// MPEG-TS
+// ------------------------------------------------------------
+
+/**
+ * @brief 依次解析缓冲区中每个 TS 包的 PES PTS，回调 (pid, pts)
+ */
+template <typename Fn> void forEachPts(const std::vector<uint8_t> &buf, Fn fn) {
+  // 尾部窗口不一定从包边界开始，先找到连续两个同步字节
+  size_t start = 0;
+  while (start < TS_PACKET_SIZE && start + TS_PACKET_SIZE < buf.size() &&
+         !(buf[start] == TS_SYNC && buf[start + TS_PACKET_SIZE] == TS_SYNC))
+    ++start;
+
+  for (size_t off = start; off + TS_PACKET_SIZE <= buf.size();
+       off += TS_PACKET_SIZE) {
+    const uint8_t *pkt = buf.data() + off;
+    if (pkt[0] != TS_SYNC)
+      continue;
+    bool unitStart = pkt[1] & 0x40;
+    if (!unitStart)
+      continue;
+    int pid = ((pkt[1] & 0x1f) << 8) | pkt[2];
+    int adaptation = (pkt[3] >> 4) & 0x3;
+    size_t payload = 4;
+    if (adaptation & 0x2)
+      payload += 1 + pkt[4];
+    if (!(adaptation & 0x1) || payload + 14 > TS_PACKET_SIZE)
+      continue;
+
+    const uint8_t *pes = pkt + payload;
+    if (pes[0] != 0 || pes[1] != 0 || pes[2] != 1)
+      continue;
+    uint8_t streamId = pes[3];
+    // 只看音视频流（0xC0-0xEF）和私有流 1（AC-3 等）
+    if (!(streamId >= 0xC0 && streamId <= 0xEF) && streamId != 0xBD)
+      continue;
+    if (!(pes[7] & 0x80))
+      continue; // 无 PTS
+
+    int64_t pts = (int64_t{pes[9] & 0x0e} << 29) | (int64_t{pes[10]} << 22) |
+                  (int64_t{pes[11] & 0xfe} << 14) | (int64_t{pes[12]} << 7) |
+                  (pes[13] >> 1);
+    fn(pid, pts);
+  }
+}
+
+std::optional<int> probeMpegTs(const MediaFile &file) {
+  auto head = file.readRange(0, HEAD_WINDOW);
+  int refPid = -1;
+  int64_t anchor = 0;
+  int64_t firstPts = 0;
+  forEachPts(head, [&](int pid, int64_t pts) {
+    if (refPid < 0) {
+      refPid = pid;
+      anchor = firstPts = pts;
+    } else if (pid == refPid) {
+      // 头部窗口内也可能发生回绕：按离第一个 PTS 最近的方向展开
+      if (anchor - pts > PTS_WRAP / 2)
+        pts += PTS_WRAP;
+      else if (pts - anchor > PTS_WRAP / 2)
+        pts -= PTS_WRAP;
+      firstPts = std::min(firstPts, pts); // B 帧使 PTS 乱序
+    }
+  });
+  if (refPid < 0)
+    return std::nullopt;
+
+  uint64_t tailStart = file.size() > TAIL_WINDOW ? file.size() - TAIL_WINDOW : 0;
+  auto tail = file.readRange(tailStart, TAIL_WINDOW);
+  std::optional<int64_t> lastPts;
+  forEachPts(tail, [&](int pid, int64_t pts) {
+    if (pid != refPid)
+      return;
+    // 33 位 PTS 回绕：结尾一定在开头之后
+    while (pts < firstPts)
+      pts += PTS_WRAP;
+    if (!lastPts || pts > *lastPts)
+      lastPts = pts;
+  });
+  if (!lastPts || *lastPts <= firstPts)
+    return std::nullopt;
+
+  int64_t durationMs = (*lastPts - firstPts) / 90; // 90kHz 时钟
+  if (durationMs > std::numeric_limits<int>::max())
+    return std::nullopt;
+  return static_cast<int>(durationMs);
+}
+
+// ------------------------------------------------------------
+// MP4
+// ------------------------------------------------------------
+
+struct BoxHeader {
+  char type[4];
+  uint64_t size;       ///< 含头部的总大小
+  uint32_t headerSize; ///< 8 或 16
+};
+
+/// 解析 data[0..len) 开头的 box 头；size 为 0 表示延伸到 limit
+bool parseBoxHeader(const uint8_t *data, uint64_t len, uint64_t limit,
+                    BoxHeader &box) {
+  if (len < 8)
+    return false;
+  uint64_t size = be32(data);
+  std::memcpy(box.type, data + 4, 4);
+  box.headerSize = 8;
+  if (size == 1) {
+    if (len < 16)
+      return false;
+    size = be64(data + 8);
+    box.headerSize = 16;
+  } else if (size == 0) {
+    size = limit;
+  }
+  if (size < box.headerSize || size > limit)
+    return false;
+  box.size = size;
+  return true;
+}
+
+/// 在 [begin, end) 中查找类型为 type 的直接子 box，返回其负载范围
+bool findChild(const uint8_t *begin, const uint8_t *end, const char *type,
+               const uint8_t *&payload, uint64_t &payloadSize) {
+  const uint8_t *p = begin;
+  while (p < end) {
+    BoxHeader box;
+    uint64_t remain = static_cast<uint64_t>(end - p);
+    if (!parseBoxHeader(p, remain, remain, box))
+      return false;
+    if (std::memcmp(box.type, type, 4) == 0) {
+      payload = p + box.headerSize;
+      payloadSize = box.size - box.headerSize;
+      return true;
+    }
+    p += box.size;
+  }
+  return false;
+}
+
+/// 解析 mvhd / mdhd（两者时间字段布局相同），返回毫秒
+std::optional<int64_t> parseHeaderDuration(const uint8_t *payload,
+                                           uint64_t size) {
+  if (size < 4)
+    return std::nullopt;
+  uint8_t version = payload[0];
+  uint64_t timescale;
+  uint64_t duration;
+  if (version == 1) {
+    if (size < 4 + 16 + 4 + 8)
+      return std::nullopt;
+    timescale = be32(payload + 20);
+    duration = be64(payload + 24);
+  } else {
+    if (size < 4 + 8 + 4 + 4)
+      return std::nullopt;
+    timescale = be32(payload + 12);
+    duration = be32(payload + 16);
+    if (duration == 0xffffffffu)
+      return std::nullopt; // 未知时长
+  }
+  if (timescale == 0 || duration == 0)
+    return std::nullopt;
+  return static_cast<int64_t>(static_cast<long double>(duration) * 1000 /
+                              timescale);
+}
+
+std::optional<int> probeMp4(const MediaFile &file) {
+  // 顶层 box 逐个跳过，直到找到 moov（可能位于 mdat 之后）
+  uint64_t offset = 0;
+  while (offset + 8 <= file.size()) {
+    uint8_t raw[16];
+    size_t len = static_cast<size_t>(std::min<uint64_t>(16, file.size() - offset));
+    BoxHeader box;
+    if (!file.read(offset, raw, len) ||
+        !parseBoxHeader(raw, len, file.size() - offset, box))
+      return std::nullopt;
+
+    if (std::memcmp(box.type, "moov", 4) != 0) {
+      offset += box.size;
+      continue;
+    }
+
+    uint64_t moovSize = box.size - box.headerSize;
+    if (moovSize > MAX_MOOV_SIZE)
+      return std::nullopt;
+    std::vector<uint8_t> moov(static_cast<size_t>(moovSize));
+    if (!file.read(offset + box.headerSize, moov.data(), moov.size()))
+      return std::nullopt;
+    const uint8_t *begin = moov.data();
+    const uint8_t *end = begin + moov.size();
+
+    const uint8_t *payload;
+    uint64_t payloadSize;
+    std::optional<int64_t> duration;
+    if (findChild(begin, end, "mvhd", payload, payloadSize))
+      duration = parseHeaderDuration(payload, payloadSize);
+
+    if (!duration) {
+      // mvhd 无时长：取各轨道 mdhd 的最大值
+      for (const uint8_t *p = begin; p < end;) {
+        BoxHeader trak;
+        uint64_t remain = static_cast<uint64_t>(end - p);
+        if (!parseBoxHeader(p, remain, remain, trak))
+          break;
+        const uint8_t *mdia;
+        uint64_t mdiaSize;
+        if (std::memcmp(trak.type, "trak", 4) == 0 &&
+            findChild(p + trak.headerSize, p + trak.size, "mdia", mdia,
+                      mdiaSize) &&
+            findChild(mdia, mdia + mdiaSize, "mdhd", payload, payloadSize)) {
+          auto track = parseHeaderDuration(payload, payloadSize);
+          if (track && (!duration || *track > *duration))
+            duration = track;
+        }
+        p += trak.size;
+      }
+    }
+
+    if (!duration || *duration <= 0 ||
+        *duration > std::numeric_limits<int>::max())
+      return std::nullopt;
+    return static_cast<int>(*duration);
+  }
+  return std::nullopt; // 没有 moov（录制中断或分片 MP4）
+}
+
+} // namespace
+
+ContainerFormat detectContainer(const std::string &filePath) {
+  MediaFile file(filePath);
+  if (!file.ok())
+    return ContainerFormat::UNKNOWN;
+  return detectFormat(file);
+}
+
+std::optional<int> probeDurationNative(const std::string &filePath) {
+  MediaFile file(filePath);
+  if (!file.ok())
+    return std::nullopt;
+
+  switch (detectFormat(file)) {
+  case ContainerFormat::FLV:
+    return probeFlv(file);
+  case ContainerFormat::MPEGTS:
+    return probeMpegTs(file);
+  case ContainerFormat::MP4:
+    return probeMp4(file);
+  case ContainerFormat::UNKNOWN:
+  default:
+    return std::nullopt;
+  }
+}
+
+} // namespace live2mp3::utils
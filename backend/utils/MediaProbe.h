@@ -0,0 +1,38 @@
+#pragma once
+
+#include <optional>
+#include <string>
+
+namespace live2mp3::utils {
+
+/**
+ * @brief 按文件头魔数识别的容器格式
+ */
+enum class ContainerFormat {
+  UNKNOWN = 0,
+  FLV,    ///< Flash Video（录播最常见的格式）
+  MPEGTS, ///< MPEG-TS（188 字节包）
+  MP4     ///< ISO BMFF（mp4 / mov / m4a）
+};
+
+/**
+ * @brief 根据文件开头的字节识别容器格式（不看扩展名）
+ */
+ContainerFormat detectContainer(const std::string &filePath);
+
+/**
+ * @brief 在进程内读取容器结构获取媒体时长
+ *
+ * - FLV：首个 tag 与文件末尾最后一个完整 tag 的时间戳之差，
+ *   末尾被截断（录制中断）时在尾部 1MB 内向前寻找完整 tag；
+ * - MPEG-TS：头部与尾部各 1MB 内同一 PID 的最小/最大 PES PTS 之差；
+ * - MP4：moov/mvhd 的 duration，为 0 时取各轨道 mdhd 的最大值。
+ *
+ * 只做少量 pread，耗时为微秒级，不启动子进程。
+ *
+ * @return 时长（毫秒）；容器无法识别或结构不符合预期时返回 std::nullopt，
+ *         调用方应回退到 ffprobe
+ */
+std::optional<int> probeDurationNative(const std::string &filePath);
+
+} // namespace live2mp3::utils
@@ -0,0 +1,518 @@
+/**
+ * @file Mp3Concat.cc
+ * @brief MP3 按帧拼接实现
+ */
+
+#include "Mp3Concat.h"
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <drogon/drogon.h>
+#include <fcntl.h>
+#include <memory>
+#include <optional>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace live2mp3::utils {
+
+namespace {
+
+/// Xing/Info 头中各字段的存在标志
+constexpr uint32_t XING_FRAMES = 0x1;
+constexpr uint32_t XING_BYTES = 0x2;
+constexpr uint32_t XING_TOC = 0x4;
+constexpr uint32_t XING_QUALITY = 0x8;
+
+/// LAME 标签长度（编码器版本 9 字节起到标签 CRC 结束）
+constexpr size_t LAME_TAG_SIZE = 36;
+/// LAME 标签内字段偏移
+constexpr size_t LAME_DELAY_PADDING = 21;
+constexpr size_t LAME_MUSIC_LENGTH = 28;
+constexpr size_t LAME_MUSIC_CRC = 32;
+constexpr size_t LAME_TAG_CRC = 34;
+
+/// 写出时合并的最大单次 write 长度
+constexpr size_t WRITE_CHUNK = 8 * 1024 * 1024;
+
+uint32_t be32(const uint8_t *p) {
+  return (uint32_t{p[0]} << 24) | (uint32_t{p[1]} << 16) |
+         (uint32_t{p[2]} << 8) | p[3];
+}
+
+void putBe32(uint8_t *p, uint32_t v) {
+  p[0] = static_cast<uint8_t>(v >> 24);
+  p[1] = static_cast<uint8_t>(v >> 16);
+  p[2] = static_cast<uint8_t>(v >> 8);
+  p[3] = static_cast<uint8_t>(v);
+}
+
+/// CRC-16/ARC（多项式 0x8005 反射，初值 0），LAME 标签使用的 CRC
+uint16_t crc16(uint16_t crc, const uint8_t *data, size_t len) {
+  static const auto table = [] {
+    std::array<uint16_t, 256> t{};
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint16_t c = static_cast<uint16_t>(i);
+      for (int k = 0; k < 8; ++k)
+        c = (c & 1) ? static_cast<uint16_t>((c >> 1) ^ 0xA001)
+                    : static_cast<uint16_t>(c >> 1);
+      t[i] = c;
+    }
+    return t;
+  }();
+  for (size_t i = 0; i < len; ++i)
+    crc = static_cast<uint16_t>((crc >> 8) ^ table[(crc ^ data[i]) & 0xFF]);
+  return crc;
+}
+
+/**
+ * @brief Layer III 帧头
+ */
+struct FrameHeader {
+  int version = 0;      ///< 3 = MPEG-1, 2 = MPEG-2, 0 = MPEG-2.5
+  int sampleRate = 0;
+  bool mono = false;
+  bool crc = false;
+  size_t length = 0;    ///< 整帧字节数
+  int samples = 0;      ///< 每帧采样数
+
+  bool compatible(const FrameHeader &o) const {
+    return version == o.version && sampleRate == o.sampleRate &&
+           mono == o.mono;
+  }
+
+  /// Xing/Info 头在帧内的偏移（帧头 + 可选 CRC + side info）
+  size_t xingOffset() const {
+    size_t sideInfo = version == 3 ? (mono ? 17 : 32) : (mono ? 9 : 17);
+    return 4 + (crc ? 2 : 0) + sideInfo;
+  }
+};
+
+bool parseHeader(const uint8_t *p, FrameHeader &h) {
+  if (p[0] != 0xFF || (p[1] & 0xE0) != 0xE0)
+    return false;
+  int version = (p[1] >> 3) & 0x3;
+  int layer = (p[1] >> 1) & 0x3;
+  int bitrateIndex = p[2] >> 4;
+  int rateIndex = (p[2] >> 2) & 0x3;
+  if (version == 1 || layer != 1 || bitrateIndex == 0 || bitrateIndex == 15 ||
+      rateIndex == 3)
+    return false;
+
+  static const int BITRATES_V1[15] = {0,   32,  40,  48,  56,  64,  80, 96,
+                                      112, 128, 160, 192, 224, 256, 320};
+  static const int BITRATES_V2[15] = {0,  8,  16, 24,  32,  40,  48, 56,
+                                      64, 80, 96, 112, 128, 144, 160};
+  static const int RATES[3] = {44100, 48000, 32000};
+
+  bool v1 = version == 3;
+  int bitrate = (v1 ? BITRATES_V1 : BITRATES_V2)[bitrateIndex] * 1000;
+  int shift = version == 3 ? 0 : (version == 2 ? 1 : 2);
+  h.version = version;
+  h.sampleRate = RATES[rateIndex] >> shift;
+  h.mono = (p[3] >> 6) == 3;
+  h.crc = (p[1] & 0x1) == 0;
+  h.samples = v1 ? 1152 : 576;
+  h.length = static_cast<size_t>((v1 ? 144 : 72) * bitrate / h.sampleRate) +
+             ((p[2] >> 1) & 0x1);
+  return true;
+}
+
+/**
+ * @brief 只读映射的输入文件（RAII）
+ */
+class MappedFile {
+public:
+  explicit MappedFile(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+      return;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+      void *p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ,
+                     MAP_PRIVATE, fd, 0);
+      if (p != MAP_FAILED) {
+        data_ = static_cast<const uint8_t *>(p);
+        size_ = static_cast<size_t>(st.st_size);
+        madvise(p, size_, MADV_SEQUENTIAL);
+      }
+    }
+    close(fd);
+  }
+  ~MappedFile() {
+    if (data_)
+      munmap(const_cast<uint8_t *>(data_), size_);
+  }
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  bool ok() const { return data_ != nullptr; }
+  const uint8_t *data() const { return data_; }
+  size_t size() const { return size_; }
+
+private:
+  const uint8_t *data_ = nullptr;
+  size_t size_ = 0;
+};
+
+/**
+ * @brief Xing/Info 头帧解析结果
+ */
+struct InfoFrame {
+  size_t offset = 0;    ///< 头帧在文件中的偏移
+  size_t length = 0;
+  size_t xingOffset = 0; ///< 帧内 "Xing"/"Info" 的偏移
+  uint32_t flags = 0;
+  size_t lameOffset = 0; ///< 帧内 LAME 标签偏移，0 表示没有有效标签
+  int delay = 0;
+  int padding = 0;
+};
+
+/**
+ * @brief 一个输入文件的帧区间
+ */
+struct InputLayout {
+  FrameHeader first;                 ///< 第一个音频帧的帧头
+  std::optional<InfoFrame> info;     ///< Xing/Info 头帧
+  std::vector<std::pair<size_t, size_t>> spans; ///< 连续音频帧区间 [begin, end)
+  std::vector<size_t> frameOffsets;  ///< 各音频帧在文件中的偏移
+  uint64_t samples = 0;
+  size_t skipped = 0;
+};
+
+/// 解析头帧中的 Xing/Info 与 LAME 标签，不是头帧返回 nullopt
+std::optional<InfoFrame> parseInfoFrame(const uint8_t *frame,
+                                        const FrameHeader &h) {
+  InfoFrame info;
+  info.length = h.length;
+  info.xingOffset = h.xingOffset();
+  if (info.xingOffset + 8 > h.length)
+    return std::nullopt;
+
+  const uint8_t *x = frame + info.xingOffset;
+  bool isXing = std::memcmp(x, "Xing", 4) == 0 || std::memcmp(x, "Info", 4) == 0;
+  // VBRI 头固定位于帧头后 32 字节，仅用于识别并丢弃
+  bool isVbri = 36 + 4 <= h.length && std::memcmp(frame + 36, "VBRI", 4) == 0;
+  if (!isXing)
+    return isVbri ? std::optional<InfoFrame>(info) : std::nullopt;
+
+  info.flags = be32(x + 4);
+  size_t pos = info.xingOffset + 8;
+  if (info.flags & XING_FRAMES)
+    pos += 4;
+  if (info.flags & XING_BYTES)
+    pos += 4;
+  if (info.flags & XING_TOC)
+    pos += 100;
+  if (info.flags & XING_QUALITY)
+    pos += 4;
+
+  // LAME 标签：标签 CRC 校验通过，或编码器字段为 LAME/FFmpeg 的写法
+  if (pos + LAME_TAG_SIZE <= h.length) {
+    const uint8_t *lame = frame + pos;
+    uint16_t stored = static_cast<uint16_t>((lame[LAME_TAG_CRC] << 8) |
+                                            lame[LAME_TAG_CRC + 1]);
+    bool crcOk = crc16(0, frame, pos + LAME_TAG_CRC) == stored;
+    bool known = std::memcmp(lame, "LAME", 4) == 0 ||
+                 std::memcmp(lame, "Lavc", 4) == 0 ||
+                 std::memcmp(lame, "Lavf", 4) == 0;
+    if (crcOk || known) {
+      info.lameOffset = pos;
+      const uint8_t *d = lame + LAME_DELAY_PADDING;
+      info.delay = (d[0] << 4) | (d[1] >> 4);
+      info.padding = ((d[1] & 0x0F) << 8) | d[2];
+    }
+  }
+  return info;
+}
+
+/// 在 [pos, end) 中寻找下一个可信帧（当前帧之后紧跟同参数帧或到达末尾）
+size_t resync(const uint8_t *data, size_t pos, size_t end,
+              const FrameHeader *expected) {
+  FrameHeader h, next;
+  for (; pos + 4 <= end; ++pos) {
+    if (!parseHeader(data + pos, h))
+      continue;
+    if (expected && !h.compatible(*expected))
+      continue;
+    size_t nextPos = pos + h.length;
+    if (nextPos == end)
+      return pos;
+    if (nextPos + 4 <= end && parseHeader(data + nextPos, next) &&
+        next.compatible(h))
+      return pos;
+  }
+  return end;
+}
+
+/// 解析输入文件的帧布局，失败返回 nullopt
+std::optional<InputLayout> scanInput(const MappedFile &file,
+                                     const std::string &path) {
+  const uint8_t *data = file.data();
+  size_t begin = 0;
+  size_t end = file.size();
+
+  // ID3v2（可能有多个连续标签），大小为 syncsafe 整数
+  while (end - begin >= 10 && std::memcmp(data + begin, "ID3", 3) == 0) {
+    const uint8_t *s = data + begin + 6;
+    size_t size = (size_t{s[0] & 0x7Fu} << 21) | (size_t{s[1] & 0x7Fu} << 14) |
+                  (size_t{s[2] & 0x7Fu} << 7) | (s[3] & 0x7Fu);
+    size += 10 + ((data[begin + 5] & 0x10) ? 10 : 0); // footer
+    if (size > end - begin)
+      break;
+    begin += size;
+  }
+  // ID3v1 / APEv2 尾部标签
+  if (end - begin >= 128 && std::memcmp(data + end - 128, "TAG", 3) == 0)
+    end -= 128;
+  if (end - begin >= 32 && std::memcmp(data + end - 32, "APETAGEX", 8) == 0) {
+    const uint8_t *f = data + end - 32;
+    size_t size = f[12] | (size_t{f[13]} << 8) | (size_t{f[14]} << 16) |
+                  (size_t{f[15]} << 24);
+    bool hasHeader = (f[23] & 0x80) != 0;
+    size += hasHeader ? 32 : 0;
+    if (size <= end - begin)
+      end -= size;
+  }
+
+  InputLayout layout;
+  size_t pos = resync(data, begin, end, nullptr);
+  layout.skipped += pos - begin;
+  if (pos >= end) {
+    LOG_ERROR << "[Mp3Concat] 未找到 MP3 帧: " << path;
+    return std::nullopt;
+  }
+
+  FrameHeader h;
+  parseHeader(data + pos, h);
+  layout.first = h;
+  if (auto info = parseInfoFrame(data + pos, h)) {
+    info->offset = pos;
+    layout.info = info;
+    layout.skipped += h.length;
+    pos += h.length;
+  }
+
+  size_t spanBegin = pos;
+  while (pos + 4 <= end) {
+    if (parseHeader(data + pos, h) && h.compatible(layout.first) &&
+        pos + h.length <= end) {
+      layout.frameOffsets.push_back(pos);
+      layout.samples += static_cast<uint64_t>(h.samples);
+      pos += h.length;
+      continue;
+    }
+    // 帧头损坏或末尾截断：结束当前区间并重新同步
+    if (pos > spanBegin)
+      layout.spans.emplace_back(spanBegin, pos);
+    size_t next = resync(data, pos + 1, end, &layout.first);
+    layout.skipped += next - pos;
+    pos = next;
+    spanBegin = pos;
+  }
+  if (pos > spanBegin)
+    layout.spans.emplace_back(spanBegin, std::min(pos, end));
+  layout.skipped += end > pos ? end - pos : 0;
+
+  if (layout.frameOffsets.empty()) {
+    LOG_ERROR << "[Mp3Concat] 没有音频帧: " << path;
+    return std::nullopt;
+  }
+  return layout;
+}
+
+bool writeAll(int fd, const uint8_t *data, size_t len) {
+  while (len > 0) {
+    ssize_t n = write(fd, data, std::min(len, WRITE_CHUNK));
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    data += n;
+    len -= static_cast<size_t>(n);
+  }
+  return true;
+}
+
+bool pwriteAll(int fd, const uint8_t *data, size_t len, off_t offset) {
+  while (len > 0) {
+    ssize_t n = pwrite(fd, data, len, offset);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    data += n;
+    len -= static_cast<size_t>(n);
+    offset += n;
+  }
+  return true;
+}
+
+/**
+ * @brief 以第一个输入的头帧为模板生成输出头帧
+ */
+std::vector<uint8_t> buildInfoFrame(const uint8_t *templ, const InfoFrame &info,
+                                    uint64_t frames, uint64_t totalBytes,
+                                    const std::vector<uint64_t> &frameOffsets,
+                                    int delay, int padding, uint16_t musicCrc) {
+  std::vector<uint8_t> frame(templ, templ + info.length);
+  uint8_t *p = frame.data() + info.xingOffset + 8;
+
+  if (info.flags & XING_FRAMES) {
+    putBe32(p, static_cast<uint32_t>(frames));
+    p += 4;
+  }
+  if (info.flags & XING_BYTES) {
+    putBe32(p, static_cast<uint32_t>(totalBytes));
+    p += 4;
+  }
+  if (info.flags & XING_TOC) {
+    // TOC[i]：播放到 i% 时对应的文件位置（占文件大小的 1/256）
+    for (size_t i = 0; i < 100; ++i) {
+      size_t frameIndex = static_cast<size_t>(i * frames / 100);
+      uint64_t offset = frameOffsets[std::min(frameIndex, frameOffsets.size() - 1)];
+      p[i] = static_cast<uint8_t>(std::min<uint64_t>(255, offset * 256 / totalBytes));
+    }
+  }
+
+  if (info.lameOffset) {
+    uint8_t *lame = frame.data() + info.lameOffset;
+    uint8_t *d = lame + LAME_DELAY_PADDING;
+    d[0] = static_cast<uint8_t>(delay >> 4);
+    d[1] = static_cast<uint8_t>(((delay & 0x0F) << 4) | (padding >> 8));
+    d[2] = static_cast<uint8_t>(padding & 0xFF);
+    putBe32(lame + LAME_MUSIC_LENGTH, static_cast<uint32_t>(totalBytes));
+    lame[LAME_MUSIC_CRC] = static_cast<uint8_t>(musicCrc >> 8);
+    lame[LAME_MUSIC_CRC + 1] = static_cast<uint8_t>(musicCrc & 0xFF);
+    // 标签 CRC 覆盖帧开头到 CRC 字段之前（MPEG-1 立体声时为 190 字节）
+    uint16_t tagCrc = crc16(0, frame.data(), info.lameOffset + LAME_TAG_CRC);
+    lame[LAME_TAG_CRC] = static_cast<uint8_t>(tagCrc >> 8);
+    lame[LAME_TAG_CRC + 1] = static_cast<uint8_t>(tagCrc & 0xFF);
+  }
+  return frame;
+}
+
+} // namespace
+
+bool concatMp3Files(const std::vector<std::string> &inputs,
+                    const std::string &outputPath, Mp3ConcatStats *stats) {
+  if (inputs.empty())
+    return false;
+
+  std::vector<std::unique_ptr<MappedFile>> files;
+  std::vector<InputLayout> layouts;
+  files.reserve(inputs.size());
+  layouts.reserve(inputs.size());
+  for (const auto &path : inputs) {
+    auto file = std::make_unique<MappedFile>(path);
+    if (!file->ok()) {
+      LOG_ERROR << "[Mp3Concat] 无法读取: " << path;
+      return false;
+    }
+    auto layout = scanInput(*file, path);
+    if (!layout)
+      return false;
+    if (!layouts.empty() && !layout->first.compatible(layouts[0].first)) {
+      LOG_ERROR << "[Mp3Concat] 音频参数不一致，无法按帧拼接: " << path
+                << " (" << layout->first.sampleRate << " Hz vs "
+                << layouts[0].first.sampleRate << " Hz)";
+      return false;
+    }
+    files.push_back(std::move(file));
+    layouts.push_back(std::move(*layout));
+  }
+
+  // 第一个输入带 Xing/Info 头时才为输出生成头帧（CBR 无头文件保持无头）
+  const InputLayout &head = layouts.front();
+  bool withInfo = head.info && head.info->flags != 0;
+  size_t infoLength = withInfo ? head.info->length : 0;
+
+  int fd = open(outputPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                0644);
+  if (fd < 0) {
+    LOG_ERROR << "[Mp3Concat] 无法创建输出文件: " << outputPath << ", 错误: "
+              << std::strerror(errno);
+    return false;
+  }
+
+  auto fail = [&](const char *what) {
+    LOG_ERROR << "[Mp3Concat] " << what << ": " << outputPath << ", 错误: "
+              << std::strerror(errno);
+    close(fd);
+    unlink(outputPath.c_str());
+    return false;
+  };
+
+  // 先占位头帧，写完音频帧后回填
+  std::vector<uint8_t> placeholder(infoLength, 0);
+  if (infoLength && !writeAll(fd, placeholder.data(), placeholder.size()))
+    return fail("写入失败");
+
+  uint64_t written = infoLength;
+  uint64_t frames = 0;
+  uint64_t samples = 0;
+  size_t skipped = 0;
+  uint16_t musicCrc = 0;
+  std::vector<uint64_t> frameOffsets;
+  for (size_t i = 0; i < layouts.size(); ++i) {
+    const auto &layout = layouts[i];
+    const uint8_t *data = files[i]->data();
+    uint64_t copied = 0;
+    size_t frameIndex = 0;
+    for (const auto &[begin, end] : layout.spans) {
+      if (!writeAll(fd, data + begin, end - begin))
+        return fail("写入失败");
+      if (withInfo && head.info->lameOffset)
+        musicCrc = crc16(musicCrc, data + begin, end - begin);
+      // 帧在输出中的偏移（区间之间的垃圾数据未被写出），用于生成 TOC
+      for (; withInfo && frameIndex < layout.frameOffsets.size() &&
+             layout.frameOffsets[frameIndex] < end;
+           ++frameIndex) {
+        frameOffsets.push_back(written + copied +
+                               (layout.frameOffsets[frameIndex] - begin));
+      }
+      copied += end - begin;
+    }
+    written += copied;
+    frames += layout.frameOffsets.size();
+    samples += layout.samples;
+    skipped += layout.skipped;
+  }
+
+  if (withInfo) {
+    const InfoFrame &info = *head.info;
+    const uint8_t *templ = files.front()->data() + info.offset;
+    // 编码延迟取第一个片段、尾部填充取最后一个片段；最后一个片段没有
+    // LAME 标签时无从得知其填充，记为 0（多保留不到一帧的静音）
+    const auto &tail = layouts.back();
+    int padding = tail.info && tail.info->lameOffset ? tail.info->padding : 0;
+    auto frame = buildInfoFrame(templ, info, frames, written, frameOffsets,
+                                info.delay, padding, musicCrc);
+    if (!pwriteAll(fd, frame.data(), frame.size(), 0))
+      return fail("回填头帧失败");
+  }
+
+  if (close(fd) != 0) {
+    unlink(outputPath.c_str());
+    LOG_ERROR << "[Mp3Concat] 关闭输出文件失败: " << outputPath;
+    return false;
+  }
+
+  if (stats) {
+    stats->frames = frames;
+    stats->bytes = written;
+    stats->skippedBytes = skipped;
+    stats->durationMs =
+        static_cast<int>(samples * 1000 / static_cast<uint64_t>(head.first.sampleRate));
+  }
+  LOG_DEBUG << "[Mp3Concat] " << inputs.size() << " 个文件 -> " << outputPath
+            << " (" << frames << " 帧, " << written << " 字节, 丢弃 " << skipped
+            << " 字节)";
+  return true;
+}
+
+} // namespace live2mp3::utils
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace live2mp3::utils {
+
+/**
+ * @brief MP3 拼接统计
+ */
+struct Mp3ConcatStats {
+  uint64_t frames = 0;     ///< 输出的音频帧数（不含 Info 帧）
+  uint64_t bytes = 0;      ///< 输出文件大小
+  uint64_t skippedBytes = 0; ///< 丢弃的标签/头帧/无法同步的垃圾数据
+  int durationMs = 0;      ///< 按帧数计算的时长
+};
+
+/**
+ * @brief 按帧拼接多个 MP3 文件（不解码、不重新编码）
+ *
+ * 逐帧解析 MPEG Audio Layer III 帧头，只复制音频帧：
+ * - 丢弃各输入的 ID3v2 / ID3v1 / APEv2 标签和 Xing/Info/VBRI 头帧；
+ * - 第一个输入带 Xing/Info 头时，以它为模板为输出重新生成一个头帧：
+ *   帧数、字节数、100 项 seek TOC 按拼接结果重算（VBR 文件的时长与跳转
+ *   依赖这些字段），LAME 标签的编码延迟取第一个输入、尾部填充取最后一个
+ *   输入，并重算音乐 CRC 与标签 CRC，使解码器正确裁掉首尾的补齐样本；
+ * - 相邻片段接缝处各自的填充/延迟（约几十毫秒）只能在重新编码时去除，保持原样。
+ *
+ * 所有输入的 MPEG 版本、采样率、声道数必须一致，否则失败（调用方应回退为
+ * 解码后重新编码）。输入通过 mmap 读取，输出为顺序写入，耗时只与文件大小有关。
+ *
+ * @param inputs 按播放顺序排列的输入文件
+ * @param outputPath 输出文件（覆盖）
+ * @param stats 可选，输出统计
+ * @return true 成功；失败时已记录日志并删除不完整的输出
+ */
+bool concatMp3Files(const std::vector<std::string> &inputs,
+                    const std::string &outputPath,
+                    Mp3ConcatStats *stats = nullptr);
+
+} // namespace live2mp3::utils
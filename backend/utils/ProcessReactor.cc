@@ -0,0 +1,503 @@
+/**
+ * @file ProcessReactor.cc
+ * @brief 基于 epoll + pidfd 的子进程监管实现
+ */
+
+#include "ProcessReactor.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <drogon/drogon.h>
+#include <optional>
+#include <vector>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace live2mp3::utils {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/// 无 pidfd 时轮询 waitpid 的间隔
+constexpr auto WAITPID_POLL_INTERVAL = std::chrono::milliseconds(200);
+/// 进程已退出但管道仍被孙进程持有时，最多再等待的输出时间
+constexpr auto DRAIN_GRACE = std::chrono::seconds(2);
+/// 单行最大长度，超出时按一行投递，防止无换行输出撑大缓冲
+constexpr size_t MAX_LINE_LENGTH = 64 * 1024;
+
+#ifdef __linux__
+int openPidFd(pid_t pid) {
+#ifdef SYS_pidfd_open
+  return static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+#else
+  (void)pid;
+  errno = ENOSYS;
+  return -1;
+#endif
+}
+
+/// 向进程组发信号；子进程尚未来得及 setpgid 时退回到单个进程
+void signalGroup(pid_t pid, int sig) {
+  if (kill(-pid, sig) != 0) {
+    kill(pid, sig);
+  }
+}
+#endif
+
+} // namespace
+
+struct ProcessReactor::Stream {
+  int fd = -1;
+  std::string lineBuffer;
+  LineCallback onLine;
+};
+
+struct ProcessReactor::Child {
+  pid_t pid = 0;
+  Stream out;      ///< stdout/stderr 诊断输出
+  Stream progress; ///< -progress 管道（可选）
+  int pidFd = -1;
+  bool exited = false;
+  int status = 0;
+  ExitCallback onExit;
+  std::optional<Clock::time_point> killAt;     ///< SIGKILL 升级时间
+  std::optional<Clock::time_point> drainUntil; ///< 退出后等待输出的截止时间
+
+  bool outputOpen() const { return out.fd >= 0 || progress.fd >= 0; }
+};
+
+ProcessReactor &ProcessReactor::instance() {
+  static ProcessReactor reactor;
+  return reactor;
+}
+
+ProcessReactor::~ProcessReactor() { stop(); }
+
+bool ProcessReactor::ensureStartedLocked() {
+#ifdef __linux__
+  if (running_)
+    return true;
+
+  epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+  if (epollFd_ < 0) {
+    LOG_ERROR << "[ProcessReactor] epoll_create1 失败: " << strerror(errno);
+    return false;
+  }
+  wakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (wakeFd_ < 0) {
+    LOG_ERROR << "[ProcessReactor] eventfd 失败: " << strerror(errno);
+    close(epollFd_);
+    epollFd_ = -1;
+    return false;
+  }
+  struct epoll_event ev = {};
+  ev.events = EPOLLIN;
+  ev.data.fd = wakeFd_;
+  epoll_ctl(epollFd_, EPOLL_CTL_ADD, wakeFd_, &ev);
+
+  running_ = true;
+  thread_ = std::thread([this]() { loop(); });
+  LOG_INFO << "[ProcessReactor] 已启动";
+  return true;
+#else
+  LOG_WARN << "[ProcessReactor] 当前平台不支持 epoll";
+  return false;
+#endif
+}
+
+bool ProcessReactor::watch(pid_t pid, int outFd, LineCallback onLine,
+                           ExitCallback onExit, int progressFd,
+                           LineCallback onProgress) {
+#ifdef __linux__
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!ensureStartedLocked())
+    return false;
+
+  auto addPipe = [this](int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    return epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &ev) == 0;
+  };
+
+  if (!addPipe(outFd)) {
+    LOG_ERROR << "[ProcessReactor] 无法监听 PID " << pid
+              << " 的输出管道: " << strerror(errno);
+    return false;
+  }
+  if (progressFd >= 0 && !addPipe(progressFd)) {
+    LOG_ERROR << "[ProcessReactor] 无法监听 PID " << pid
+              << " 的进度管道: " << strerror(errno);
+    epoll_ctl(epollFd_, EPOLL_CTL_DEL, outFd, nullptr);
+    return false;
+  }
+
+  auto child = std::make_unique<Child>();
+  child->pid = pid;
+  child->out.fd = outFd;
+  child->out.onLine = std::move(onLine);
+  child->progress.fd = progressFd;
+  child->progress.onLine = std::move(onProgress);
+  child->onExit = std::move(onExit);
+  fdToPid_[outFd] = pid;
+  if (progressFd >= 0)
+    fdToPid_[progressFd] = pid;
+
+  // 子进程尚未被回收，即使已经退出 pidfd_open 也能成功
+  int pidFd = openPidFd(pid);
+  if (pidFd >= 0) {
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = pidFd;
+    if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, pidFd, &ev) == 0) {
+      child->pidFd = pidFd;
+      fdToPid_[pidFd] = pid;
+    } else {
+      close(pidFd);
+    }
+  }
+
+  children_[pid] = std::move(child);
+  // 无 pidfd 时需要开始轮询，唤醒线程重新计算超时
+  if (pidFd < 0)
+    wake();
+  return true;
+#else
+  (void)pid;
+  (void)outFd;
+  (void)onLine;
+  (void)onExit;
+  (void)progressFd;
+  (void)onProgress;
+  return false;
+#endif
+}
+
+bool ProcessReactor::terminate(pid_t pid, std::chrono::milliseconds grace) {
+#ifdef __linux__
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = children_.find(pid);
+    if (it == children_.end() || it->second->exited)
+      return false;
+
+    signalGroup(pid, SIGTERM);
+    LOG_DEBUG << "[ProcessReactor] 已向进程组 " << pid << " 发送 SIGTERM";
+    if (!it->second->killAt)
+      it->second->killAt = Clock::now() + grace;
+  }
+  wake();
+  return true;
+#else
+  (void)pid;
+  (void)grace;
+  return false;
+#endif
+}
+
+size_t ProcessReactor::watchedCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return children_.size();
+}
+
+void ProcessReactor::stop() {
+#ifdef __linux__
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running_.exchange(false))
+      return;
+  }
+  wake();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+
+  // 线程已退出，剩余子进程由当前线程强制结束并回收
+  std::unordered_map<pid_t, std::unique_ptr<Child>> remaining;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    remaining.swap(children_);
+  }
+  for (auto &[pid, child] : remaining) {
+    if (!child->exited)
+      signalGroup(pid, SIGKILL);
+    closeStream(child->out);
+    closeStream(child->progress);
+    if (!child->exited)
+      reap(*child, true);
+    if (child->onExit)
+      child->onExit(child->status);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  fdToPid_.clear();
+  close(wakeFd_);
+  close(epollFd_);
+  wakeFd_ = -1;
+  epollFd_ = -1;
+#endif
+}
+
+void ProcessReactor::wake() {
+#ifdef __linux__
+  if (wakeFd_ >= 0) {
+    uint64_t one = 1;
+    ssize_t ignored = write(wakeFd_, &one, sizeof(one));
+    (void)ignored;
+  }
+#endif
+}
+
+void ProcessReactor::loop() {
+#ifdef __linux__
+  struct epoll_event events[64];
+
+  while (running_) {
+    int timeout;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      timeout = nextTimeoutLocked(Clock::now());
+    }
+
+    int n = epoll_wait(epollFd_, events, 64, timeout);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      LOG_ERROR << "[ProcessReactor] epoll_wait 失败: " << strerror(errno);
+      break;
+    }
+
+    for (int i = 0; i < n; ++i) {
+      int fd = events[i].data.fd;
+      if (fd == wakeFd_) {
+        uint64_t value;
+        ssize_t ignored = read(wakeFd_, &value, sizeof(value));
+        (void)ignored;
+        continue;
+      }
+
+      // 只有本线程删除子进程，释放锁后指针仍然有效
+      Child *child = nullptr;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto fit = fdToPid_.find(fd);
+        if (fit != fdToPid_.end()) {
+          auto cit = children_.find(fit->second);
+          if (cit != children_.end())
+            child = cit->second.get();
+        }
+      }
+      if (!child)
+        continue;
+
+      if (fd == child->out.fd || fd == child->progress.fd) {
+        Stream &stream = fd == child->out.fd ? child->out : child->progress;
+        if (!drainStream(*child, stream))
+          closeStream(stream);
+      } else if (fd == child->pidFd) {
+        reap(*child, false);
+      }
+    }
+
+    handleTimers();
+    finishDone();
+  }
+#endif
+}
+
+bool ProcessReactor::drainStream(Child &child, Stream &stream) {
+#ifdef __linux__
+  if (stream.fd < 0)
+    return false;
+
+  char buf[4096];
+  while (true) {
+    ssize_t n = read(stream.fd, buf, sizeof(buf));
+    if (n > 0) {
+      stream.lineBuffer.append(buf, static_cast<size_t>(n));
+
+      std::string_view pending(stream.lineBuffer);
+      size_t start = 0;
+      size_t pos;
+      while ((pos = pending.find_first_of("\r\n", start)) !=
+             std::string_view::npos) {
+        if (pos > start && stream.onLine)
+          stream.onLine(pending.substr(start, pos - start));
+        start = pos + 1;
+      }
+      stream.lineBuffer.erase(0, start);
+      if (stream.lineBuffer.size() > MAX_LINE_LENGTH) {
+        if (stream.onLine)
+          stream.onLine(stream.lineBuffer);
+        stream.lineBuffer.clear();
+      }
+      continue;
+    }
+    if (n == 0)
+      return false;
+    if (errno == EINTR)
+      continue;
+    if (errno == EAGAIN || errno == EWOULDBLOCK)
+      return true;
+    LOG_ERROR << "[ProcessReactor] 读取 PID " << child.pid
+              << " 输出失败: " << strerror(errno);
+    return false;
+  }
+#else
+  (void)child;
+  (void)stream;
+  return false;
+#endif
+}
+
+void ProcessReactor::closeStream(Stream &stream) {
+#ifdef __linux__
+  if (stream.fd < 0)
+    return;
+
+  // 没有换行结尾的最后一段输出通常就是错误信息
+  if (!stream.lineBuffer.empty()) {
+    if (stream.onLine)
+      stream.onLine(stream.lineBuffer);
+    stream.lineBuffer.clear();
+  }
+
+  epoll_ctl(epollFd_, EPOLL_CTL_DEL, stream.fd, nullptr);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    fdToPid_.erase(stream.fd);
+  }
+  close(stream.fd);
+  stream.fd = -1;
+#else
+  (void)stream;
+#endif
+}
+
+void ProcessReactor::reap(Child &child, bool block) {
+#ifdef __linux__
+  int status = 0;
+  pid_t result;
+  do {
+    result = waitpid(child.pid, &status, block ? 0 : WNOHANG);
+  } while (result < 0 && errno == EINTR);
+
+  if (result == 0)
+    return; // 仍在运行（pidfd 可读但尚未成为僵尸的极短窗口）
+  if (result < 0) {
+    // 被其他代码回收了，无法得知真实状态，按异常退出处理
+    LOG_WARN << "[ProcessReactor] waitpid(" << child.pid
+             << ") 失败: " << strerror(errno);
+    status = W_EXITCODE(255, 0);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  child.exited = true;
+  child.status = status;
+  child.killAt.reset();
+  if (child.outputOpen())
+    child.drainUntil = Clock::now() + DRAIN_GRACE;
+  if (child.pidFd >= 0) {
+    epoll_ctl(epollFd_, EPOLL_CTL_DEL, child.pidFd, nullptr);
+    fdToPid_.erase(child.pidFd);
+    close(child.pidFd);
+    child.pidFd = -1;
+  }
+#else
+  (void)child;
+  (void)block;
+#endif
+}
+
+int ProcessReactor::nextTimeoutLocked(Clock::time_point now) const {
+  std::optional<Clock::time_point> deadline;
+  auto consider = [&deadline](Clock::time_point t) {
+    if (!deadline || t < *deadline)
+      deadline = t;
+  };
+
+  for (const auto &[pid, child] : children_) {
+    if (child->killAt)
+      consider(*child->killAt);
+    if (child->drainUntil)
+      consider(*child->drainUntil);
+    if (!child->exited && child->pidFd < 0)
+      consider(now + WAITPID_POLL_INTERVAL);
+  }
+
+  if (!deadline)
+    return -1; // 只等待 fd 事件
+  auto ms = std::chrono::ceil<std::chrono::milliseconds>(*deadline - now);
+  return static_cast<int>(std::max<long long>(ms.count(), 0));
+}
+
+void ProcessReactor::handleTimers() {
+#ifdef __linux__
+  auto now = Clock::now();
+  std::vector<Child *> poll;
+  std::vector<Child *> drainExpired;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &[pid, child] : children_) {
+      if (child->killAt && now >= *child->killAt && !child->exited) {
+        LOG_WARN << "[ProcessReactor] 进程 " << pid
+                 << " 未响应 SIGTERM，发送 SIGKILL";
+        signalGroup(pid, SIGKILL);
+        child->killAt.reset();
+      }
+      if (!child->exited && child->pidFd < 0)
+        poll.push_back(child.get());
+      if (child->drainUntil && now >= *child->drainUntil &&
+          child->outputOpen())
+        drainExpired.push_back(child.get());
+    }
+  }
+
+  for (Child *child : poll) {
+    reap(*child, false);
+  }
+  for (Child *child : drainExpired) {
+    LOG_WARN << "[ProcessReactor] 进程 " << child->pid
+             << " 已退出但输出管道仍被占用，停止读取";
+    for (Stream *stream : {&child->out, &child->progress}) {
+      drainStream(*child, *stream);
+      closeStream(*stream);
+    }
+  }
+#endif
+}
+
+void ProcessReactor::finishDone() {
+  std::vector<std::unique_ptr<Child>> done;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = children_.begin(); it != children_.end();) {
+      if (it->second->exited && !it->second->outputOpen()) {
+        done.push_back(std::move(it->second));
+        it = children_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  // 在锁外回调，回调中可以再次调用 watch/terminate
+  for (auto &child : done) {
+    if (child->onExit)
+      child->onExit(child->status);
+  }
+}
+
+} // namespace live2mp3::utils
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+#include <thread>
+#include <unordered_map>
+
+namespace live2mp3::utils {
+
+/**
+ * @brief 子进程监管反应器
+ *
+ * 单个后台线程通过 epoll 同时监听所有被接管子进程的输出管道（诊断输出和
+ * 可选的 `-progress` 管道）和 pidfd，按行投递输出、在进程退出且所有管道读尽后
+ * 投递退出状态。子进程只由反应器回收，
+ * 终止请求（SIGTERM，宽限期后 SIGKILL）也由反应器执行，避免 PID 复用后误杀。
+ *
+ * 内核不支持 pidfd_open（< 5.3）时，对尚未退出的子进程周期性 waitpid(WNOHANG)。
+ * 没有子进程、也没有待升级的终止请求时线程阻塞在 epoll_wait 上，不产生空转唤醒。
+ *
+ * 线程安全：所有公开方法可在任意线程调用；回调在反应器线程中执行，必须快速返回。
+ */
+class ProcessReactor {
+public:
+  /// 一行输出（已去掉行尾 \r / \n，不含空行）；视图仅在回调期间有效
+  using LineCallback = std::function<void(std::string_view line)>;
+  /// 进程退出，参数为 waitpid 的 status
+  using ExitCallback = std::function<void(int status)>;
+
+  static ProcessReactor &instance();
+
+  ~ProcessReactor();
+  ProcessReactor(const ProcessReactor &) = delete;
+  ProcessReactor &operator=(const ProcessReactor &) = delete;
+
+  /**
+   * @brief 接管一个已启动的子进程
+   *
+   * 成功后 outFd / progressFd 的所有权转移给反应器（由反应器关闭），
+   * 子进程也由反应器回收。onExit 保证恰好调用一次，且在最后一次行回调之后。
+   *
+   * @param pid 子进程 PID（应为进程组组长，终止时向整个进程组发信号）
+   * @param outFd 子进程输出管道的读端
+   * @param progressFd 可选的进度管道读端（-1 表示无），按行交给 onProgress
+   * @return false 反应器无法启动，fd 和子进程仍归调用方处理
+   */
+  bool watch(pid_t pid, int outFd, LineCallback onLine, ExitCallback onExit,
+             int progressFd = -1, LineCallback onProgress = nullptr);
+
+  /**
+   * @brief 终止被接管的子进程
+   *
+   * 立即向进程组发送 SIGTERM，grace 后仍未退出则发送 SIGKILL。
+   *
+   * @return false 该 PID 不在接管中（已退出或从未接管）
+   */
+  bool terminate(pid_t pid, std::chrono::milliseconds grace =
+                                std::chrono::milliseconds(1000));
+
+  /**
+   * @brief 当前接管中的子进程数
+   */
+  size_t watchedCount() const;
+
+  /**
+   * @brief 停止反应器线程，强制结束并回收所有仍在接管中的子进程
+   */
+  void stop();
+
+private:
+  struct Stream;
+  struct Child;
+
+  ProcessReactor() = default;
+
+  bool ensureStartedLocked();
+  void loop();
+  void wake();
+  /// 读空管道并按行投递；返回 false 表示已到 EOF
+  bool drainStream(Child &child, Stream &stream);
+  void closeStream(Stream &stream);
+  void reap(Child &child, bool block);
+  /// 根据终止/排空截止时间和 pidfd 可用性计算 epoll_wait 超时（需持有 mutex_）
+  int nextTimeoutLocked(std::chrono::steady_clock::time_point now) const;
+  /// 处理到期的 SIGKILL 升级与 waitpid 轮询，收集已结束的子进程
+  void handleTimers();
+  void finishDone();
+
+  int epollFd_ = -1;
+  int wakeFd_ = -1;
+  std::thread thread_;
+  std::atomic<bool> running_{false};
+
+  mutable std::mutex mutex_;
+  std::unordered_map<pid_t, std::unique_ptr<Child>> children_;
+  std::unordered_map<int, pid_t> fdToPid_; ///< 管道 fd / pidfd -> PID
+};
+
+} // namespace live2mp3::utils
@@ -0,0 +1,96 @@
+/**
+ * @file RuleSet.cc
+ * @brief 预编译过滤规则实现
+ */
+
+#include "RuleSet.h"
+#include <drogon/drogon.h>
+
+namespace live2mp3::utils {
+
+RuleSet::RuleSet(const std::vector<Rule> &rules, bool whitelist)
+    : whitelist_(whitelist) {
+  rules_.reserve(rules.size());
+  for (const auto &rule : rules) {
+    CompiledRule compiled;
+    compiled.pattern = rule.pattern;
+    if (rule.type == "exact") {
+      compiled.type = RuleType::Exact;
+    } else if (rule.type == "regex") {
+      compiled.type = RuleType::Regex;
+      try {
+        compiled.regex.emplace(rule.pattern);
+      } catch (const std::regex_error &e) {
+        // 无效正则永不匹配（与原先逐次构造时的行为一致）
+        LOG_WARN << "无效的正则规则 '" << rule.pattern << "': " << e.what();
+      }
+    } else if (rule.type == "glob") {
+      compiled.type = RuleType::Glob;
+    } else {
+      continue;
+    }
+    rules_.push_back(std::move(compiled));
+  }
+}
+
+bool RuleSet::matches(const std::string &name) const {
+  for (const auto &rule : rules_) {
+    switch (rule.type) {
+    case RuleType::Exact:
+      if (name == rule.pattern)
+        return true;
+      break;
+    case RuleType::Regex:
+      if (rule.regex && std::regex_search(name, *rule.regex))
+        return true;
+      break;
+    case RuleType::Glob:
+      if (globMatch(name, rule.pattern))
+        return true;
+      break;
+    }
+  }
+  return false;
+}
+
+bool RuleSet::allows(const std::string &name) const {
+  if (rules_.empty())
+    return !whitelist_;
+  return whitelist_ ? matches(name) : !matches(name);
+}
+
+bool RuleSet::globMatch(const std::string &str, const std::string &pattern) {
+  // 贪心 + 回溯到最近一个 '*'，O(n*m) 最坏，无堆分配
+  size_t s = 0, p = 0;
+  size_t starP = std::string::npos, starS = 0;
+  while (s < str.size()) {
+    if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == str[s])) {
+      ++s;
+      ++p;
+    } else if (p < pattern.size() && pattern[p] == '*') {
+      starP = p++;
+      starS = s;
+    } else if (starP != std::string::npos) {
+      p = starP + 1;
+      s = ++starS;
+    } else {
+      return false;
+    }
+  }
+  while (p < pattern.size() && pattern[p] == '*')
+    ++p;
+  return p == pattern.size();
+}
+
+CompiledRules::CompiledRules(std::vector<RootRuleSet> roots)
+    : roots_(std::move(roots)) {}
+
+const RootRuleSet *CompiledRules::find(const std::string &rootPath) const {
+  for (const auto &root : roots_) {
+    if (root.rootPath == rootPath)
+      return &root;
+  }
+  return nullptr;
+}
+
+} // namespace live2mp3::utils
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <optional>
+#include <regex>
+#include <string>
+#include <vector>
+
+namespace live2mp3::utils {
+
+/**
+ * @brief 预编译的过滤规则集合（白名单/黑名单）
+ *
+ * 构造时一次性编译所有规则：正则预先构造 std::regex，
+ * 通配符使用不依赖正则的匹配器，精确匹配直接比较字符串。
+ * 构造完成后只读，可在多线程中共享。
+ */
+class RuleSet {
+public:
+  /**
+   * @brief 单条规则
+   */
+  struct Rule {
+    std::string type;    ///< "exact" / "regex" / "glob"，其他类型被忽略
+    std::string pattern;
+  };
+
+  RuleSet() = default;
+
+  /**
+   * @param rules 规则列表
+   * @param whitelist true 为白名单，false 为黑名单
+   */
+  RuleSet(const std::vector<Rule> &rules, bool whitelist);
+
+  /**
+   * @brief 是否有任一规则匹配
+   */
+  bool matches(const std::string &name) const;
+
+  /**
+   * @brief 按模式判定是否放行
+   *
+   * 白名单：规则为空时全部拒绝，否则仅放行匹配项；
+   * 黑名单：规则为空时全部放行，否则仅拒绝匹配项。
+   */
+  bool allows(const std::string &name) const;
+
+  bool empty() const { return rules_.empty(); }
+
+  /**
+   * @brief 通配符匹配（'*' 任意长度，'?' 单个字符，需整体匹配）
+   */
+  static bool globMatch(const std::string &str, const std::string &pattern);
+
+private:
+  enum class RuleType { Exact, Regex, Glob };
+
+  struct CompiledRule {
+    RuleType type;
+    std::string pattern;
+    std::optional<std::regex> regex; ///< 仅 Regex 类型且编译成功时有值
+  };
+
+  std::vector<CompiledRule> rules_;
+  bool whitelist_ = false;
+};
+
+/**
+ * @brief 单个视频根目录的已编译规则
+ */
+struct RootRuleSet {
+  std::string rootPath;
+  RuleSet filter;   ///< rules + filter_mode，决定是否扫描
+  RuleSet deletion; ///< delete_rules + delete_mode，决定是否删除源文件
+  bool enableDelete = false;
+};
+
+/**
+ * @brief 所有视频根目录的已编译规则，对应某一版本的配置
+ */
+class CompiledRules {
+public:
+  explicit CompiledRules(std::vector<RootRuleSet> roots);
+
+  /**
+   * @brief 按根目录路径查找，未找到返回 nullptr
+   */
+  const RootRuleSet *find(const std::string &rootPath) const;
+
+  const std::vector<RootRuleSet> &roots() const { return roots_; }
+
+private:
+  std::vector<RootRuleSet> roots_;
+};
+
+} // namespace live2mp3::utils
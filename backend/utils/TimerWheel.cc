@@ -0,0 +1,78 @@
+/**
+ * @file TimerWheel.cc
+ * @brief 秒级哈希时间轮实现
+ */
+
+#include "TimerWheel.h"
+#include <algorithm>
+
+namespace live2mp3::utils {
+
+TimerWheel::TimerWheel(size_t slots) : slots_(std::max<size_t>(slots, 1)) {}
+
+void TimerWheel::schedule(int key, int64_t deadline) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto it = entries_.find(key);
+  if (it != entries_.end()) {
+    slots_[it->second.slot].erase(key);
+  }
+
+  // 已经过去的时间点放到下一个要访问的槽位，保证下次 advance 能触发
+  int64_t at = cursor_ >= 0 ? std::max(deadline, cursor_ + 1) : deadline;
+  size_t slot = slotOf(at);
+  slots_[slot][key] = deadline;
+  entries_[key] = {slot, deadline};
+}
+
+bool TimerWheel::cancel(int key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(key);
+  if (it == entries_.end())
+    return false;
+  slots_[it->second.slot].erase(key);
+  entries_.erase(it);
+  return true;
+}
+
+std::vector<int> TimerWheel::advance(int64_t now) {
+  std::vector<int> expired;
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (cursor_ < 0) {
+    // 首次推进：所有槽位都可能有已到期的键
+    cursor_ = now - static_cast<int64_t>(slots_.size());
+  }
+  if (now <= cursor_)
+    return expired;
+
+  // 间隔超过一圈时只需把每个槽位访问一次
+  int64_t steps =
+      std::min<int64_t>(now - cursor_, static_cast<int64_t>(slots_.size()));
+  for (int64_t t = now - steps + 1; t <= now; ++t) {
+    auto &slot = slots_[slotOf(t)];
+    for (auto it = slot.begin(); it != slot.end();) {
+      if (it->second <= now) {
+        expired.push_back(it->first);
+        entries_.erase(it->first);
+        it = slot.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+  cursor_ = now;
+  return expired;
+}
+
+size_t TimerWheel::slotOf(int64_t t) const {
+  int64_t n = static_cast<int64_t>(slots_.size());
+  return static_cast<size_t>(((t % n) + n) % n);
+}
+
+size_t TimerWheel::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+} // namespace live2mp3::utils
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace live2mp3::utils {
+
+/**
+ * @brief 秒级哈希时间轮
+ *
+ * 每个键对应一个截止时间（Unix 秒），按 deadline % slots 放入槽位。
+ * advance() 只访问自上次推进以来经过的槽位，调度/取消/推进均为 O(1) 摊销，
+ * 与挂起的键数量无关。超过一圈的截止时间在槽位中保留，直到真正到期。
+ *
+ * 线程安全：所有方法内部加锁。
+ */
+class TimerWheel {
+public:
+  explicit TimerWheel(size_t slots = 512);
+
+  /**
+   * @brief 设置（或替换）键的截止时间；已过期的截止时间在下次 advance 时触发
+   */
+  void schedule(int key, int64_t deadline);
+
+  /**
+   * @brief 取消键的截止时间
+   * @return 键原本是否在时间轮中
+   */
+  bool cancel(int key);
+
+  /**
+   * @brief 推进到 now，返回所有截止时间 <= now 的键（并移除它们）
+   */
+  std::vector<int> advance(int64_t now);
+
+  /**
+   * @brief 当前挂起的键数量
+   */
+  size_t size() const;
+
+private:
+  struct Entry {
+    size_t slot;
+    int64_t deadline;
+  };
+
+  size_t slotOf(int64_t t) const;
+
+  std::vector<std::unordered_map<int, int64_t>> slots_; // 键 -> 截止时间
+  std::unordered_map<int, Entry> entries_;
+  int64_t cursor_ = -1; // 最后一次处理到的秒
+  mutable std::mutex mutex_;
+};
+
+} // namespace live2mp3::utils